@@ -11,6 +11,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
+#include <sys/inotify.h>
 #include <sys/ioctl.h>
 #include <sys/stat.h>
 #include <time.h>
@@ -25,6 +27,7 @@
 
 #include <mpv/client.h>
 
+#include "bench.h"
 #include "display.h"
 #include "frame.h"
 #include "layout.h"
@@ -47,8 +50,14 @@ typedef struct {
     int screen_h;
     int pane_count;
     int *pane_font_px;
+    int pane_font_base_px;
     pane_layout *slot_layouts;
     pane_layout *pane_layouts;
+    // Per-iteration scratch, sized once so the steady-state loop does not allocate.
+    mosaic_layout layout;
+    bool *pane_ready;
+    term_pane **input_terms;
+    mpv_handle **input_mpv;
 } app_scene;
 
 typedef struct {
@@ -75,15 +84,44 @@ typedef struct {
     int stream_interval_ms;
     double stream_next_frame_sec;
     bool stream_active;
+    int inotify_fd;         // watches APP_SNAPSHOT_DIR, -1 when polling instead
+    double next_check_sec;  // INFINITY while inotify covers every change
 } snapshot_watch;
 
+typedef struct {
+    bool loaded;
+    double next_check_sec;
+} media_tier_watch;
+
+// Media pane tiers follow system load at this cadence, and layout changes at once.
+#define APP_MEDIA_TIER_CHECK_MS 2000
+
+// The snapshot request and preview lease files live here. inotify on the
+// directory wakes the loop when either changes, so an idle compositor without
+// snapshot users does not wake for them. Timed stat() checks remain while a
+// preview lease is live (it expires by age), and are the fallback without
+// inotify: APP_SNAPSHOT_CHECK_MS while a request or lease exists, otherwise
+// APP_SNAPSHOT_IDLE_CHECK_MS like the config watch.
+#define APP_SNAPSHOT_DIR "/tmp"
+#define APP_SNAPSHOT_CHECK_MS 100
+#define APP_SNAPSHOT_IDLE_CHECK_MS 1000
+// PTY ingestion budget per loop iteration: bytes per pane, and time shared by all
+// ready panes. Whatever is left stays in the kernel and is read next iteration.
+#define APP_PANE_POLL_BYTES (64 * 1024)
+#define APP_PANE_POLL_BUDGET_MS 4
+
 static bool app_scene_init(app_scene *scene, int pane_count) {
     memset(scene, 0, sizeof(*scene));
     scene->pane_count = pane_count;
     scene->pane_font_px = calloc((size_t)pane_count, sizeof(*scene->pane_font_px));
     scene->slot_layouts = calloc((size_t)(KMS_MOSAIC_SLOT_PANE_BASE + pane_count), sizeof(*scene->slot_layouts));
     scene->pane_layouts = calloc((size_t)pane_count, sizeof(*scene->pane_layouts));
-    return scene->pane_font_px && scene->slot_layouts && scene->pane_layouts;
+    scene->pane_ready = calloc((size_t)pane_count, sizeof(*scene->pane_ready));
+    scene->input_terms = calloc((size_t)pane_count, sizeof(*scene->input_terms));
+    scene->input_mpv = calloc((size_t)pane_count, sizeof(*scene->input_mpv));
+    if (!mosaic_layout_init(&scene->layout, KMS_MOSAIC_SLOT_PANE_BASE + pane_count)) return false;
+    return scene->pane_font_px && scene->slot_layouts && scene->pane_layouts && scene->pane_ready &&
+           scene->input_terms && scene->input_mpv;
 }
 
 static void app_scene_destroy(app_scene *scene) {
@@ -91,9 +129,16 @@ static void app_scene_destroy(app_scene *scene) {
     free(scene->pane_font_px);
     free(scene->slot_layouts);
     free(scene->pane_layouts);
+    free(scene->pane_ready);
+    free(scene->input_terms);
+    free(scene->input_mpv);
+    mosaic_layout_destroy(&scene->layout);
     scene->pane_font_px = NULL;
     scene->slot_layouts = NULL;
     scene->pane_layouts = NULL;
+    scene->pane_ready = NULL;
+    scene->input_terms = NULL;
+    scene->input_mpv = NULL;
     scene->pane_count = 0;
 }
 
@@ -214,6 +259,44 @@ static void app_snapshot_watch_init(snapshot_watch *watch) {
     watch->lease_path = "/tmp/kms_mosaic_preview.active";
     watch->output_path = "/tmp/kms_mosaic_preview.rgba";
     watch->stream_interval_ms = 16;
+    watch->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (watch->inotify_fd >= 0 &&
+        inotify_add_watch(watch->inotify_fd, APP_SNAPSHOT_DIR,
+                          IN_CREATE | IN_CLOSE_WRITE | IN_ATTRIB | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE) < 0) {
+        close(watch->inotify_fd);
+        watch->inotify_fd = -1;
+    }
+    // Pick up a request or lease that is already there.
+    watch->next_check_sec = 0.0;
+}
+
+static void app_snapshot_watch_destroy(snapshot_watch *watch) {
+    if (watch->inotify_fd >= 0) close(watch->inotify_fd);
+    watch->inotify_fd = -1;
+}
+
+static bool app_snapshot_watch_names(const char *path, const char *name) {
+    const char *base = path ? strrchr(path, '/') : NULL;
+    return base && !strcmp(base + 1, name);
+}
+
+// Drain the directory's inotify events; a change to the request or lease file
+// (or a dropped event queue) makes the next poll check at once.
+static void app_snapshot_watch_notify(snapshot_watch *watch, const runtime_state *rt) {
+    if (watch->inotify_fd < 0 || !runtime_source_ready(rt, RUNTIME_SRC_SNAPSHOT)) return;
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t n;
+    while ((n = read(watch->inotify_fd, buf, sizeof(buf))) > 0) {
+        for (char *p = buf; p < buf + n;) {
+            const struct inotify_event *ev = (const struct inotify_event *)p;
+            if ((ev->mask & IN_Q_OVERFLOW) ||
+                (ev->len && (app_snapshot_watch_names(watch->request_path, ev->name) ||
+                             app_snapshot_watch_names(watch->lease_path, ev->name)))) {
+                watch->next_check_sec = 0.0;
+            }
+            p += sizeof(*ev) + ev->len;
+        }
+    }
 }
 
 static double app_now_real_sec(void) {
@@ -229,9 +312,7 @@ static int app_snapshot_watch_interval_ms(const snapshot_watch *watch) {
     return watch->stream_interval_ms;
 }
 
-static void app_snapshot_watch_poll(snapshot_watch *watch) {
-    if (!watch) return;
-
+static void app_snapshot_watch_check(snapshot_watch *watch) {
     if (watch->request_path) {
         struct stat st;
         bool exists = stat(watch->request_path, &st) == 0;
@@ -273,6 +354,20 @@ static void app_snapshot_watch_poll(snapshot_watch *watch) {
     watch->stream_active = true;
 }
 
+static void app_snapshot_watch_poll(snapshot_watch *watch) {
+    if (!watch) return;
+    double now_sec = app_now_sec();
+    if (now_sec < watch->next_check_sec) return;
+    app_snapshot_watch_check(watch);
+    if (watch->stream_active || (watch->inotify_fd < 0 && watch->request_exists)) {
+        watch->next_check_sec = now_sec + APP_SNAPSHOT_CHECK_MS / 1000.0;
+    } else if (watch->inotify_fd < 0) {
+        watch->next_check_sec = now_sec + APP_SNAPSHOT_IDLE_CHECK_MS / 1000.0;
+    } else {
+        watch->next_check_sec = INFINITY;
+    }
+}
+
 static bool app_config_watch_poll(config_watch *watch) {
     if (!watch || !watch->enabled) return false;
 
@@ -393,54 +488,222 @@ static void app_init_scene(const options_t *opt, bool use_mpv, pane_runtime *pan
     scene->slot_layouts[KMS_MOSAIC_SLOT_VIDEO] = (pane_layout){.x = 0, .y = 0, .w = scene->logical_w, .h = scene->logical_h};
     if (!ui_state_init(ui, opt, use_mpv)) app_die("ui_state_init");
 
-    mosaic_layout initial_layout = {0};
-    if (!mosaic_layout_init(&initial_layout, KMS_MOSAIC_SLOT_PANE_BASE + scene->pane_count)) app_die("mosaic_layout_init");
     compute_mosaic_layout(scene->screen_w, scene->screen_h, opt->layout_mode, opt->right_frac_pct,
                           opt->pane_split_pct, scene->pane_count, opt->split_tree_spec,
                           opt->rotation, ui->perm, opt->visibility_mode, opt->pane_media, ui->overlay_swap,
-                          ui->fullscreen, ui->fs_pane, &initial_layout);
-    for (int i = 0; i < KMS_MOSAIC_SLOT_PANE_BASE + scene->pane_count; ++i) scene->slot_layouts[i] = initial_layout.role_layouts[i];
+                          ui->fullscreen, ui->fs_pane, &scene->layout);
+    for (int i = 0; i < KMS_MOSAIC_SLOT_PANE_BASE + scene->pane_count; ++i) scene->slot_layouts[i] = scene->layout.role_layouts[i];
     for (int i = 0; i < scene->pane_count; ++i) scene->pane_layouts[i] = scene->slot_layouts[KMS_MOSAIC_SLOT_PANE_BASE + i];
-    mosaic_layout_destroy(&initial_layout);
 
     panes_compute_font_sizes(opt, scene->pane_layouts, scene->pane_count, scene->pane_font_px);
+    scene->pane_font_base_px = opt->font_px;
     if (!opt->no_panes) panes_create(panes, opt, scene->pane_layouts, debug);
 }
 
-static bool app_poll_runtime_with_media(runtime_state *rt, const options_t *opt,
-                                        const pane_runtime *panes, const media_ctx *pane_media) {
+static uint64_t app_sec_to_ns(double sec) {
+    return sec <= 0.0 ? 0 : (uint64_t)(sec * 1e9);
+}
+
+// Absolute CLOCK_MONOTONIC time of the next timed job: fullscreen cycling,
+// config and snapshot checks, the next preview stream frame or stats write, a
+// terminal pane's synchronized update running out, or a rate-capped pane's next
+// update slot. 0 means run now, RUNTIME_NO_DEADLINE wait for events only.
+static uint64_t app_wait_deadline_ns(const runtime_state *rt, const ui_state *ui, const config_watch *cfg_watch,
+                                     const snapshot_watch *snap_watch, const options_t *opt,
+                                     const pane_runtime *panes) {
+    if (rt->scene_dirty || ui->layout_reinit_countdown > 0) return 0;
+    double deadline = snap_watch->next_check_sec;
+    if (rt->direct_mode) {
+        double direct_deadline = app_now_sec() + 0.010;
+        if (direct_deadline < deadline) deadline = direct_deadline;
+    }
+    if (cfg_watch->enabled && cfg_watch->next_check_sec < deadline) deadline = cfg_watch->next_check_sec;
+    if (ui->fs_cycle && ui->fs_next_switch > 0.0 && ui->fs_next_switch < deadline) deadline = ui->fs_next_switch;
+    if (snap_watch->stream_active && snap_watch->stream_next_frame_sec < deadline) {
+        deadline = snap_watch->stream_next_frame_sec;
+    }
+    if (rt->stats.path && rt->stats.next_write_sec < deadline) deadline = rt->stats.next_write_sec;
+    uint64_t deadline_ns = isinf(deadline) ? RUNTIME_NO_DEADLINE : app_sec_to_ns(deadline);
+    uint64_t now_ns = stats_now_ns();
+    for (int i = 0; !opt->no_panes && i < opt->pane_count; ++i) {
+        uint64_t next_ns = rt->pane_next_poll_ns[i];
+        if (next_ns > now_ns && next_ns < deadline_ns) deadline_ns = next_ns;
+        uint64_t sync_ns = term_pane_sync_deadline_ns(panes_get_term(panes, i));
+        if (sync_ns && sync_ns < next_ns) sync_ns = next_ns;
+        if (sync_ns && sync_ns < deadline_ns) deadline_ns = sync_ns;
+    }
+    return deadline_ns > 0 ? deadline_ns : 1;
+}
+
+static bool app_wait_runtime_with_media(runtime_state *rt, const options_t *opt, const pane_runtime *panes,
+                                        const media_ctx *pane_media, uint64_t deadline_ns) {
     runtime_update_pane_fds(rt, opt, panes, pane_media);
-    return poll(rt->pfds, rt->nfds, 10) >= 0 || errno == EINTR;
+    return runtime_wait(rt, deadline_ns);
 }
 
 static bool app_handle_input_ready(runtime_state *rt, ui_state *ui, options_t *opt, bool use_mpv,
-                                   pane_runtime *panes, media_ctx *m, media_ctx *pane_media, bool debug) {
-    if (!(rt->pfds[RUNTIME_POLL_STDIN].revents & POLLIN)) return true;
+                                   pane_runtime *panes, media_ctx *m, media_ctx *pane_media, app_scene *scene,
+                                   bool debug) {
+    if (!runtime_source_ready(rt, RUNTIME_SRC_STDIN)) return true;
     char buf[64];
     ssize_t n = read(0, buf, sizeof(buf));
     if (n > 0) {
-        term_pane **pane_terms = calloc((size_t)opt->pane_count, sizeof(*pane_terms));
-        mpv_handle **pane_mpv = calloc((size_t)opt->pane_count, sizeof(*pane_mpv));
-        if (!pane_terms || !pane_mpv) {
-            free(pane_terms);
-            free(pane_mpv);
-            return rt->running;
-        }
+        rt->scene_dirty = true;
+        term_pane **pane_terms = scene->input_terms;
+        mpv_handle **pane_mpv = scene->input_mpv;
         for (int i = 0; i < opt->pane_count; ++i) pane_terms[i] = panes_get_term(panes, i);
         for (int i = 0; i < opt->pane_count; ++i) pane_mpv[i] = pane_media && pane_media[i].mpv ? pane_media[i].mpv : NULL;
-        (void)ui_handle_input(ui, opt, buf, n, use_mpv,
-                              pane_terms, pane_mpv, opt->pane_count,
-                              m->mpv, &rt->running, debug);
-        free(pane_terms);
-        free(pane_mpv);
+        // Keys typed into a pane reach the screen through its own row damage; only a
+        // change of focus, overlays or layout repaints everything.
+        if (ui_handle_input(ui, opt, buf, n, use_mpv, pane_terms, pane_mpv, opt->pane_count,
+                            m->mpv, &rt->running, debug)) {
+            rt->full_damage = true;
+        }
     }
     return rt->running;
 }
 
-static void app_collect_pane_ready(const options_t *opt, const runtime_state *rt,
+// A pane is polled when its fd is readable, its child exited, or a synchronized
+// update it is holding back has timed out. Apart from a child exit, a pane
+// capped by --pane-max-fps waits for its next slot; its output queues up in the
+// PTY (or the worker's snapshot) and is taken in one batch.
+static void app_collect_pane_ready(const options_t *opt, const runtime_state *rt, const pane_runtime *panes,
                                    bool *pane_ready) {
+    uint64_t now_ns = stats_now_ns();
+    for (int i = 0; i < opt->pane_count; ++i) {
+        const term_pane *tp = opt->no_panes ? NULL : panes_get_term(panes, i);
+        uint64_t sync_ns = term_pane_sync_deadline_ns(tp);
+        bool due = !runtime_pane_throttled(rt, i, now_ns) &&
+                   (runtime_pane_ready(rt, i) || (sync_ns && sync_ns <= now_ns));
+        pane_ready[i] = !opt->no_panes && (due || runtime_pane_child_exited(rt, opt, tp, i));
+    }
+}
+
+static bool app_pane_visible(const options_t *opt, const ui_state *ui, int pane_index) {
+    return !options_pane_hidden(opt, pane_index) && (!ui->fullscreen || ui->fs_pane == pane_index);
+}
+
+// A media pane is on screen for decoding purposes while it or any pane sharing
+// its decoder is visible.
+static bool app_media_visible(const options_t *opt, const ui_state *ui, const media_ctx *pane_media, int pane_index) {
+    if (app_pane_visible(opt, ui, pane_index)) return true;
+    for (int j = 0; j < opt->pane_count && pane_media[pane_index].share_count > 0; ++j) {
+        if (pane_media[j].shared && pane_media[j].share_pane == pane_index && app_pane_visible(opt, ui, j)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Feed ready PTYs into their terminals within the iteration's budget and mark the
+// visible ones that changed as damaged. Panes are visited round-robin from a
+// rotating start, and each gets an equal share of the time left, so a flooding
+// pane cannot starve the others or the frame. Returns true if any visible pane changed.
+static bool app_poll_panes(const options_t *opt, const ui_state *ui, runtime_state *rt, pane_runtime *panes,
+                           const bool *pane_ready) {
+    bool damaged = false;
+    int remaining = 0;
+    for (int i = 0; i < opt->pane_count; ++i) {
+        if (pane_ready[i]) remaining++;
+    }
+    if (!remaining) return false;
+    uint64_t budget_end_ns = stats_now_ns() + (uint64_t)APP_PANE_POLL_BUDGET_MS * 1000000ull;
+    int start = rt->pane_poll_next % opt->pane_count;
+    rt->pane_poll_next = (start + 1) % opt->pane_count;
+    for (int k = 0; k < opt->pane_count; ++k) {
+        int i = (start + k) % opt->pane_count;
+        if (!pane_ready[i]) continue;
+        term_pane *tp = panes_get_term(panes, i);
+        if (!tp) continue;
+        uint64_t poll_start_ns = stats_now_ns();
+        uint64_t deadline_ns = poll_start_ns;
+        if (budget_end_ns > poll_start_ns) deadline_ns += (budget_end_ns - poll_start_ns) / (uint64_t)remaining;
+        remaining--;
+        bool changed = term_pane_poll_budget(tp, APP_PANE_POLL_BYTES, deadline_ns);
+        if (runtime_pane_child_exited(rt, opt, tp, i)) {
+            // A respawn closes the PTY; unregister it while the fd is still ours.
+            runtime_forget_pane_fd(rt, i);
+            if (term_pane_reap_child(tp)) changed = true;
+        }
+        runtime_pane_mark_polled(rt, opt, i, poll_start_ns);
+        stats_record_pane(&rt->stats, i, STATS_PANE_TERM_POLL, poll_start_ns);
+        if (changed && app_pane_visible(opt, ui, i)) {
+            rt->pane_damaged[i] = true;
+            damaged = true;
+        }
+    }
+    return damaged;
+}
+
+static bool app_media_needs_render(const options_t *opt, const runtime_state *rt, const ui_state *ui,
+                                   const media_ctx *pane_media, bool use_mpv) {
+    if (use_mpv && rt->mpv_needs_render) return true;
+    if (!pane_media || !rt->pane_mpv_needs_render) return false;
+    for (int i = 0; i < opt->pane_count; ++i) {
+        if (pane_media[i].mpv_gl && rt->pane_mpv_needs_render[i] && app_media_visible(opt, ui, pane_media, i)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Suspend or resume the decoders of media panes that went off or on screen
+// (fullscreen, --visibility-mode), and hand the decoding they avoided to the
+// stats window about to be written.
+static void app_update_media_visibility(const options_t *opt, const ui_state *ui, runtime_state *rt,
+                                        media_ctx *pane_media) {
+    if (!pane_media) return;
+    bool take = stats_write_due(&rt->stats);
+    for (int i = 0; i < opt->pane_count; ++i) {
+        media_ctx *pm = &pane_media[i];
+        if (!pm->mpv) continue;
+        bool shown = media_set_visible(pm, app_media_visible(opt, ui, pane_media, i),
+                                       options_pane_hidden_video(opt, i));
+        if (shown) rt->pane_mpv_needs_render[i] = 1;
+        if (shown || take) {
+            uint64_t paused_ns;
+            unsigned long long frames;
+            media_take_suspended(pm, &paused_ns, &frames);
+            stats_add_video_suspend(&rt->stats, i, paused_ns, frames);
+        }
+    }
+}
+
+// One-minute load average per online CPU, with hysteresis so tiers do not flap.
+static bool app_system_loaded(bool was_loaded) {
+    double load = 0.0;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (getloadavg(&load, 1) != 1 || cpus < 1) return false;
+    double per_cpu = load / (double)cpus;
+    return was_loaded ? per_cpu > 0.7 : per_cpu > 0.9;
+}
+
+// Re-pick the decode tier of visible media panes after a layout change, when
+// mpv reports a new video size, or when the load check flips.
+static void app_update_media_tiers(const options_t *opt, const ui_state *ui, const app_scene *scene,
+                                   media_ctx *pane_media, media_tier_watch *watch, bool layout_changed) {
+    if (opt->no_video_tiers || !pane_media) return;
+    bool recheck = layout_changed;
+    double now = app_now_sec();
+    if (now >= watch->next_check_sec) {
+        bool loaded = app_system_loaded(watch->loaded);
+        if (loaded != watch->loaded) recheck = true;
+        watch->loaded = loaded;
+        watch->next_check_sec = now + APP_MEDIA_TIER_CHECK_MS / 1000.0;
+    }
     for (int i = 0; i < opt->pane_count; ++i) {
-        pane_ready[i] = !opt->no_panes && runtime_pane_ready(rt, i);
+        media_ctx *pm = &pane_media[i];
+        if (!pm->mpv || !app_media_visible(opt, ui, pane_media, i) || !(recheck || pm->tier_stale)) continue;
+        // A shared decoder serves its largest pane.
+        const pane_layout *target = &scene->pane_layouts[i];
+        for (int j = 0; j < opt->pane_count && pm->share_count > 0; ++j) {
+            const pane_layout *lay = &scene->pane_layouts[j];
+            if (pane_media[j].shared && pane_media[j].share_pane == i &&
+                (long)lay->w * lay->h > (long)target->w * target->h) {
+                target = lay;
+            }
+        }
+        media_update_tier(pm, target->w, target->h, watch->loaded);
     }
 }
 
@@ -452,7 +715,7 @@ static void app_handle_runtime_events(runtime_state *rt, ui_state *ui, const opt
     clock_gettime(CLOCK_MONOTONIC, &ts_now);
     ui_update_fs_cycle(ui, opt->pane_count, opt->fs_cycle_sec, ts_now.tv_sec + ts_now.tv_nsec / 1e9);
 
-    if (use_mpv && (rt->pfds[RUNTIME_POLL_MPV_WAKEUP].revents & POLLIN)) {
+    if (use_mpv && runtime_source_ready(rt, RUNTIME_SRC_MPV_WAKEUP)) {
         media_handle_wakeup(m, debug, &rt->mpv_needs_render);
     }
     for (int i = 0; i < opt->pane_count; ++i) {
@@ -464,7 +727,7 @@ static void app_handle_runtime_events(runtime_state *rt, ui_state *ui, const opt
             }
         }
     }
-    if (m->playlist_fifo_fd >= 0 && (rt->pfds[RUNTIME_POLL_PLAYLIST_FIFO].revents & POLLIN)) {
+    if (m->playlist_fifo_fd >= 0 && runtime_source_ready(rt, RUNTIME_SRC_PLAYLIST_FIFO)) {
         media_handle_playlist_fifo(m, pfifo_buf, pfifo_len);
         runtime_refresh_playlist_fd(rt, m);
     }
@@ -475,7 +738,7 @@ static void app_handle_runtime_events(runtime_state *rt, ui_state *ui, const opt
             runtime_refresh_pane_playlist_fd(rt, opt, pane_media);
         }
     }
-    if (rt->pfds[RUNTIME_POLL_DRM].revents & POLLIN) {
+    if (runtime_source_ready(rt, RUNTIME_SRC_DRM)) {
         drmEventContext ev = {0};
         ev.version = 2;
         ev.page_flip_handler = display_on_page_flip;
@@ -483,7 +746,7 @@ static void app_handle_runtime_events(runtime_state *rt, ui_state *ui, const opt
     }
 }
 
-static void app_update_layout(const options_t *opt, ui_state *ui, pane_runtime *panes, app_scene *scene, bool debug) {
+static bool app_update_layout(const options_t *opt, ui_state *ui, pane_runtime *panes, app_scene *scene, bool debug) {
     if (opt->layout_mode == 6) {
         if (ui->last_layout_mode != 6) {
             if (opt->roles_set) {
@@ -517,15 +780,17 @@ static void app_update_layout(const options_t *opt, ui_state *ui, pane_runtime *
         ui->last_fs_pane = ui->fs_pane;
     }
 
-    mosaic_layout active_layout = {0};
-    if (!mosaic_layout_init(&active_layout, KMS_MOSAIC_SLOT_PANE_BASE + scene->pane_count)) app_die("mosaic_layout_init");
     compute_mosaic_layout(scene->screen_w, scene->screen_h, opt->layout_mode, opt->right_frac_pct,
                           opt->pane_split_pct, scene->pane_count, opt->split_tree_spec,
                           opt->rotation, ui->perm, opt->visibility_mode, opt->pane_media, ui->overlay_swap,
-                          ui->fullscreen, ui->fs_pane, &active_layout);
-    for (int i = 0; i < KMS_MOSAIC_SLOT_PANE_BASE + scene->pane_count; ++i) scene->slot_layouts[i] = active_layout.role_layouts[i];
-    for (int i = 0; i < scene->pane_count; ++i) scene->pane_layouts[i] = scene->slot_layouts[KMS_MOSAIC_SLOT_PANE_BASE + i];
-    mosaic_layout_destroy(&active_layout);
+                          ui->fullscreen, ui->fs_pane, &scene->layout);
+    bool pane_sizes_changed = false;
+    for (int i = 0; i < KMS_MOSAIC_SLOT_PANE_BASE + scene->pane_count; ++i) scene->slot_layouts[i] = scene->layout.role_layouts[i];
+    for (int i = 0; i < scene->pane_count; ++i) {
+        const pane_layout *next = &scene->slot_layouts[KMS_MOSAIC_SLOT_PANE_BASE + i];
+        if (scene->pane_layouts[i].w != next->w || scene->pane_layouts[i].h != next->h) pane_sizes_changed = true;
+        scene->pane_layouts[i] = *next;
+    }
     if (layout_changed) {
         panes_apply_layout_mode_alpha(opt, panes);
         int default_frames = 3;
@@ -545,7 +810,12 @@ static void app_update_layout(const options_t *opt, ui_state *ui, pane_runtime *
         }
     }
 
-    panes_compute_font_sizes(opt, scene->pane_layouts, scene->pane_count, scene->pane_font_px);
+    // Font fitting only depends on pane sizes and the base font option.
+    if (layout_changed || pane_sizes_changed || scene->pane_font_base_px != opt->font_px) {
+        panes_compute_font_sizes(opt, scene->pane_layouts, scene->pane_count, scene->pane_font_px);
+        scene->pane_font_base_px = opt->font_px;
+    }
+    return layout_changed || pane_sizes_changed;
 }
 
 static void app_cleanup(const options_t *opt, media_ctx *m, media_ctx *pane_media, render_gl_ctx *rg, drm_ctx *d,
@@ -582,7 +852,7 @@ static void app_cleanup(const options_t *opt, media_ctx *m, media_ctx *pane_medi
     if (d->conn) drmModeFreeConnector(d->conn);
     if (d->res) drmModeFreeResources(d->res);
     if (d->fd >= 0) close(d->fd);
-    app_restore_linux_console();
+    if (!d->headless) app_restore_linux_console();
 }
 
 int app_run(int argc, char **argv, int *debug, volatile sig_atomic_t *stop_flag) {
@@ -600,28 +870,38 @@ int app_run(int argc, char **argv, int *debug, volatile sig_atomic_t *stop_flag)
     ui_state ui = {0};
     runtime_state rt = {0};
     config_watch cfg_watch = {0};
-    snapshot_watch snap_watch = {0};
+    snapshot_watch snap_watch = {.inotify_fd = -1};
+    media_tier_watch tier_watch = {0};
     char pfifo_buf[1024];
     int pfifo_len = 0;
     char (*pane_pfifo_bufs)[1024] = NULL;
     int *pane_pfifo_lens = NULL;
+    bench_ctx bench = {0};
     int rc = 0;
 
+    // Synthetic benchmark terminals re-execute this binary; they never touch the display.
+    if (argc == 3 && !strcmp(argv[1], "--bench-emit")) return bench_emit(argv[2], stop_flag);
     if (options_parse_cli(&opt, argc, argv, debug)) return 0;
+    if (opt.bench_sec > 0 && !bench_configure(&opt)) app_die("bench_configure");
     if (!panes_init_runtime(&panes, opt.pane_count)) app_die("panes_init_runtime");
 
-    d.fd = display_open_drm_card();
-    display_pick_connector_mode(&d, &opt, *debug);
-    if (opt.list_connectors) {
-        rc = app_list_connectors(&d);
-        goto cleanup;
-    }
+    if (opt.headless_w > 0) {
+        // Same pipeline, but into a pbuffer with a timed present instead of KMS scanout.
+        display_headless_init(&d, &e, opt.headless_w, opt.headless_h, opt.headless_hz, *debug);
+    } else {
+        d.fd = display_open_drm_card();
+        display_pick_connector_mode(&d, &opt, *debug);
+        if (opt.list_connectors) {
+            rc = app_list_connectors(&d);
+            goto cleanup;
+        }
 
-    display_warn_if_missing_dri();
-    if (opt.diag) display_preflight_expect_dri_driver_diag();
-    else display_preflight_expect_dri_driver();
-    display_gbm_init(&g, d.fd, d.mode.hdisplay, d.mode.vdisplay, *debug);
-    display_egl_init(&e, &g, *debug);
+        display_warn_if_missing_dri();
+        if (opt.diag) display_preflight_expect_dri_driver_diag();
+        else display_preflight_expect_dri_driver();
+        display_gbm_init(&g, d.fd, d.mode.hdisplay, d.mode.vdisplay, *debug);
+        display_egl_init(&e, &g, *debug);
+    }
 
     bool use_mpv = media_init(&m, &opt, *debug);
     pane_media = calloc((size_t)opt.pane_count, sizeof(*pane_media));
@@ -631,7 +911,19 @@ int app_run(int argc, char **argv, int *debug, volatile sig_atomic_t *stop_flag)
     if (!pane_pfifo_bufs || !pane_pfifo_lens) app_die("calloc pane playlist fifo buffers");
     for (int i = 0; i < opt.pane_count; ++i) {
         if (opt.pane_media && opt.pane_media[i].enabled) {
-            (void)media_init_pane(&pane_media[i], &opt, &opt.pane_media[i], *debug);
+            // Panes showing the same source sample the first one's frames.
+            int source = -1;
+            for (int j = 0; j < i && !opt.no_shared_decode && source < 0; ++j) {
+                if (pane_media[j].mpv && media_pane_sources_match(&opt, &opt.pane_media[j], &opt.pane_media[i])) {
+                    source = j;
+                }
+            }
+            if (source >= 0) {
+                media_init_shared(&pane_media[i], &pane_media[source], source, &opt, &opt.pane_media[i]);
+                if (*debug) fprintf(stderr, "Pane %d: sharing the decoder of pane %d\n", i + 1, source + 1);
+            } else {
+                (void)media_init_pane(&pane_media[i], &opt, &opt.pane_media[i], *debug);
+            }
         }
     }
     bool has_legacy_root_media =
@@ -644,7 +936,8 @@ int app_run(int argc, char **argv, int *debug, volatile sig_atomic_t *stop_flag)
         } else {
             media_shutdown(&m);
         }
-        memset(&m, 0, sizeof(m));
+        // The copy owns the fds now; leave m closed rather than aliasing fd 0.
+        m = (media_ctx){.wakeup_fd = -1, .playlist_fifo_fd = -1};
         use_mpv = false;
     }
     if (opt.diag) {
@@ -675,34 +968,64 @@ int app_run(int argc, char **argv, int *debug, volatile sig_atomic_t *stop_flag)
     if (!runtime_init(&rt, &opt, use_mpv, &m, d.fd)) app_die("runtime_init");
     app_config_watch_init(&cfg_watch, &opt);
     app_snapshot_watch_init(&snap_watch);
+    runtime_watch_snapshot_fd(&rt, snap_watch.inotify_fd);
+    bench_init(&bench, &opt);
 
+    uint64_t loop_alloc_mark = stats_thread_allocs();
     while (rt.running) {
+        stats_record_allocs(&rt.stats, &loop_alloc_mark);
         if (*stop_flag) {
             fprintf(stderr, "Exiting main loop: stop flag set\n");
             rt.running = false;
             break;
         }
+        if (bench_tick(&bench, &opt, pane_media, &rt)) {
+            fprintf(stderr, "Exiting main loop: benchmark finished\n");
+            break;
+        }
         if (*debug && rt.frame < 5) fprintf(stderr, "Loop frame %d start\n", rt.frame);
-        if (!app_poll_runtime_with_media(&rt, &opt, &panes, pane_media)) app_die("poll");
-        if (!app_handle_input_ready(&rt, &ui, &opt, use_mpv, &panes, &m, pane_media, *debug)) {
+        uint64_t deadline_ns = app_wait_deadline_ns(&rt, &ui, &cfg_watch, &snap_watch, &opt, &panes);
+        deadline_ns = bench_wait_deadline_ns(&bench, deadline_ns);
+        uint64_t stage_start_ns = stats_now_ns();
+        if (!app_wait_runtime_with_media(&rt, &opt, &panes, pane_media, deadline_ns)) app_die("epoll_wait");
+        stats_record(&rt.stats, STATS_STAGE_POLL_WAIT, stage_start_ns);
+        stage_start_ns = stats_now_ns();
+        if (!app_handle_input_ready(&rt, &ui, &opt, use_mpv, &panes, &m, pane_media, &scene, *debug)) {
             fprintf(stderr, "Exiting main loop: input handler requested stop\n");
             break;
         }
+        stats_record(&rt.stats, STATS_STAGE_INPUT, stage_start_ns);
+        stage_start_ns = stats_now_ns();
         app_handle_runtime_events(&rt, &ui, &opt, &m, pane_media, &d,
                                   pfifo_buf, &pfifo_len, pane_pfifo_bufs, pane_pfifo_lens,
                                   use_mpv, *debug);
+        stats_record(&rt.stats, STATS_STAGE_RUNTIME_EVENTS, stage_start_ns);
         if (app_config_watch_poll(&cfg_watch)) {
             fprintf(stderr, "Config file changed: %s\n", cfg_watch.path);
             rc = APP_RUN_RELOAD;
             break;
         }
+        app_snapshot_watch_notify(&snap_watch, &rt);
         app_snapshot_watch_poll(&snap_watch);
 
-        bool *pane_ready = calloc((size_t)scene.pane_count, sizeof(*pane_ready));
-        if (!pane_ready) app_die("calloc pane_ready");
-        app_collect_pane_ready(&opt, &rt, pane_ready);
-        app_update_layout(&opt, &ui, &panes, &scene, *debug);
+        bool *pane_ready = scene.pane_ready;
+        app_collect_pane_ready(&opt, &rt, &panes, pane_ready);
         if (!eglMakeCurrent(e.dpy, e.surf, e.surf, e.ctx)) app_die("eglMakeCurrent loop");
+        stage_start_ns = stats_now_ns();
+        if (app_poll_panes(&opt, &ui, &rt, &panes, pane_ready)) rt.scene_dirty = true;
+        stats_record(&rt.stats, STATS_STAGE_PANE_POLL, stage_start_ns);
+        stage_start_ns = stats_now_ns();
+        bool layout_changed = app_update_layout(&opt, &ui, &panes, &scene, *debug);
+        stats_record(&rt.stats, STATS_STAGE_LAYOUT, stage_start_ns);
+        app_update_media_tiers(&opt, &ui, &scene, pane_media, &tier_watch, layout_changed);
+        // frame_render damages the OSD's old and new rects itself.
+        if (frame_update_osd_text(&opt, &rt, &ui, pane_media, scene.pane_count)) rt.scene_dirty = true;
+        if (layout_changed || ui.layout_reinit_countdown > 0 || rt.direct_mode) {
+            rt.scene_dirty = true;
+            rt.full_damage = true;
+        }
+        app_update_media_visibility(&opt, &ui, &rt, pane_media);
+        if (app_media_needs_render(&opt, &rt, &ui, pane_media, use_mpv)) rt.scene_dirty = true;
         bool snapshot_written = false;
         const char *snapshot_path = NULL;
         if (snap_watch.request_pending) {
@@ -710,23 +1033,41 @@ int app_run(int argc, char **argv, int *debug, volatile sig_atomic_t *stop_flag)
         } else if (snap_watch.stream_active && app_now_sec() >= snap_watch.stream_next_frame_sec) {
             snapshot_path = snap_watch.output_path;
         }
+        if (snapshot_path) rt.scene_dirty = true;
+        stats_maybe_write(&rt.stats, rt.presented_frames, rt.idle_frames, rt.partial_frames);
+        if (!rt.scene_dirty) {
+            // Nothing changed: skip composition, swap and flip and sleep until the next event.
+            rt.idle_frames++;
+            continue;
+        }
+        uint64_t frame_start_ns = stats_now_ns();
         frame_render(&opt, &rt, &rg, &m, pane_media, &d, &g, &e, &panes, &ui,
                      scene.slot_layouts, scene.pane_layouts, scene.pane_count, scene.logical_w, scene.logical_h,
-                     scene.fb_w, scene.fb_h, scene.screen_w, scene.screen_h, scene.pane_font_px,
-                     use_mpv, pane_ready, *debug,
+                     scene.fb_w, scene.fb_h, scene.pane_font_px,
+                     use_mpv, *debug,
                      snapshot_path, &snapshot_written);
+        bench_record_frame(&bench, frame_start_ns);
         if (snapshot_written) {
             if (snap_watch.request_pending) snap_watch.request_pending = false;
             if (snap_watch.stream_active) {
                 snap_watch.stream_next_frame_sec = app_now_sec() + app_snapshot_watch_interval_ms(&snap_watch) / 1000.0;
             }
         }
-        free(pane_ready);
     }
 
-    fprintf(stderr, "Main loop exited: rc=%d running=%d stop_flag=%d\n", rc, rt.running ? 1 : 0, *stop_flag ? 1 : 0);
+    fprintf(stderr, "Main loop exited: rc=%d running=%d stop_flag=%d presented=%llu partial=%llu idle=%llu\n", rc,
+            rt.running ? 1 : 0, *stop_flag ? 1 : 0, rt.presented_frames, rt.partial_frames, rt.idle_frames);
+    if (d.headless) {
+        fprintf(stderr, "Headless: %llu presents, %llu missed virtual vblanks at %uHz\n",
+                d.headless_presents, d.headless_missed_vblanks, (unsigned)d.mode.vrefresh);
+    }
+    if (bench.active) {
+        restore_tty();
+        if (!bench_write_report(&bench, &opt, pane_media, &rt, &d)) rc = 1;
+    }
 
 cleanup:
+    app_snapshot_watch_destroy(&snap_watch);
     ui_state_destroy(&ui);
     runtime_destroy(&rt);
     app_scene_destroy(&scene);
@@ -0,0 +1,455 @@
+#define _GNU_SOURCE
+
+#include "bench.h"
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <GLES2/gl2.h>
+
+static const char *const bench_term_workload_names[BENCH_TERM_WORKLOAD_COUNT] = {
+    [BENCH_TERM_LOGS] = "logs",
+    [BENCH_TERM_STORM] = "storm",
+    [BENCH_TERM_BRAILLE] = "braille",
+};
+
+// Update rates for the synthetic terminals. Fixed rates keep the offered load the
+// same from build to build; the storm rate is deliberately above any refresh.
+#define BENCH_LOGS_HZ 100
+#define BENCH_LOGS_LINES_PER_TICK 10
+#define BENCH_STORM_HZ 240
+#define BENCH_BRAILLE_HZ 30
+
+const char *bench_term_cmd(int workload) {
+    static char cmds[BENCH_TERM_WORKLOAD_COUNT][4200];
+    if (workload < 0 || workload >= BENCH_TERM_WORKLOAD_COUNT) return NULL;
+    if (!cmds[workload][0]) {
+        char exe[4096];
+        ssize_t n = readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+        if (n <= 0) snprintf(exe, sizeof(exe), "kms_mosaic");
+        else exe[n] = '\0';
+        snprintf(cmds[workload], sizeof(cmds[workload]), "exec '%s' --bench-emit %s", exe,
+                 bench_term_workload_names[workload]);
+    }
+    return cmds[workload];
+}
+
+const char *bench_video_url(int w, int h, int fps) {
+    static char url[128];
+    snprintf(url, sizeof(url), "av://lavfi:testsrc2=size=%dx%d:rate=%d", w, h, fps);
+    return url;
+}
+
+bool bench_configure(options_t *opt) {
+    if (opt->bench_terms < 0) opt->bench_terms = BENCH_TERM_WORKLOAD_COUNT;
+    if (opt->bench_videos < 0) opt->bench_videos = 1;
+    if (opt->bench_terms + opt->bench_videos < 1) opt->bench_terms = 1;
+    if (opt->bench_video_w <= 0 || opt->bench_video_h <= 0) {
+        opt->bench_video_w = 1280;
+        opt->bench_video_h = 720;
+    }
+    if (opt->bench_video_fps <= 0) opt->bench_video_fps = 30;
+    if (!options_reset_panes(opt, opt->bench_videos + opt->bench_terms)) return false;
+    // Every video pane plays the same URL; each is meant to cost a decoder.
+    opt->no_shared_decode = true;
+    const char *url = bench_video_url(opt->bench_video_w, opt->bench_video_h, opt->bench_video_fps);
+    for (int i = 0; i < opt->bench_videos; ++i) {
+        opt->pane_media[i].enabled = true;
+        push_pane_video(&opt->pane_media[i], url);
+    }
+    for (int i = 0; i < opt->bench_terms; ++i) {
+        opt->pane_cmds[opt->bench_videos + i] = bench_term_cmd(i % BENCH_TERM_WORKLOAD_COUNT);
+    }
+    return true;
+}
+
+// --- Synthetic terminal workloads -------------------------------------------
+
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} bench_buf;
+
+static void bench_buf_reserve(bench_buf *b, size_t extra) {
+    if (b->len + extra <= b->cap) return;
+    size_t ncap = b->cap ? b->cap : 65536;
+    while (ncap < b->len + extra) ncap *= 2;
+    char *next = realloc(b->data, ncap);
+    if (!next) {
+        perror("bench realloc");
+        exit(1);
+    }
+    b->data = next;
+    b->cap = ncap;
+}
+
+static void bench_buf_printf(bench_buf *b, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+static void bench_buf_printf(bench_buf *b, const char *fmt, ...) {
+    bench_buf_reserve(b, 256);
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(b->data + b->len, b->cap - b->len, fmt, ap);
+    va_end(ap);
+    if (n < 0) return;
+    if ((size_t)n >= b->cap - b->len) {
+        bench_buf_reserve(b, (size_t)n + 1);
+        va_start(ap, fmt);
+        vsnprintf(b->data + b->len, b->cap - b->len, fmt, ap);
+        va_end(ap);
+    }
+    b->len += (size_t)n;
+}
+
+static void bench_buf_put_cp(bench_buf *b, uint32_t cp) {
+    bench_buf_reserve(b, 4);
+    if (cp < 0x80) {
+        b->data[b->len++] = (char)cp;
+    } else if (cp < 0x800) {
+        b->data[b->len++] = (char)(0xC0 | (cp >> 6));
+        b->data[b->len++] = (char)(0x80 | (cp & 0x3F));
+    } else {
+        b->data[b->len++] = (char)(0xE0 | (cp >> 12));
+        b->data[b->len++] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        b->data[b->len++] = (char)(0x80 | (cp & 0x3F));
+    }
+}
+
+static bool bench_buf_flush(bench_buf *b) {
+    size_t off = 0;
+    while (off < b->len) {
+        ssize_t n = write(STDOUT_FILENO, b->data + off, b->len - off);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        off += (size_t)n;
+    }
+    b->len = 0;
+    return true;
+}
+
+// Fixed-seed xorshift so every run emits the same byte stream.
+static uint32_t bench_rand(uint32_t *state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+static void bench_term_size(int *cols, int *rows) {
+    struct winsize ws;
+    *cols = 80;
+    *rows = 24;
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_col > 0 && ws.ws_row > 0) {
+        *cols = ws.ws_col;
+        *rows = ws.ws_row;
+    }
+    if (*cols > 1024) *cols = 1024;
+    if (*rows > 512) *rows = 512;
+}
+
+static void bench_emit_logs(bench_buf *b, uint32_t *rng, unsigned long tick) {
+    static const char *const levels[] = {"\x1b[32mINFO \x1b[0m", "\x1b[36mDEBUG\x1b[0m",
+                                         "\x1b[33mWARN \x1b[0m", "\x1b[31mERROR\x1b[0m"};
+    static const char *const paths[] = {"/api/v1/items", "/api/v1/users", "/healthz", "/metrics", "/api/v2/search"};
+    for (int i = 0; i < BENCH_LOGS_LINES_PER_TICK; ++i) {
+        unsigned long ms = tick * (1000 / BENCH_LOGS_HZ) + (unsigned long)i;
+        uint32_t r = bench_rand(rng);
+        int level = (r & 15) == 0 ? 3 : (r & 7) == 1 ? 2 : (r & 3) == 2 ? 1 : 0;
+        bench_buf_printf(b, "%02lu:%02lu:%02lu.%03lu %s svc-%02u[%5u]: GET %s/%u status=%u latency=%u.%03ums bytes=%u\r\n",
+                         (ms / 3600000) % 24, (ms / 60000) % 60, (ms / 1000) % 60, ms % 1000, levels[level],
+                         (r >> 4) % 16, 1000 + (r >> 8) % 30000, paths[(r >> 12) % 5],
+                         bench_rand(rng) % 100000, level == 3 ? 500u : 200u,
+                         (r >> 16) % 250, (r >> 3) % 1000, bench_rand(rng) % 65536);
+    }
+}
+
+static void bench_emit_storm(bench_buf *b, uint32_t *rng, int cols, int rows) {
+    static const char glyphs[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789#@%&*+=-";
+    uint32_t base = bench_rand(rng);
+    for (int y = 0; y < rows; ++y) {
+        bench_buf_printf(b, "\x1b[%d;1H", y + 1);
+        for (int x = 0; x < cols; ++x) {
+            if ((x & 7) == 0) {
+                uint32_t r = bench_rand(rng);
+                bench_buf_printf(b, "\x1b[%s38;5;%u;48;5;%um", (r & 1) ? "1;" : "0;", 16 + r % 216, 232 + (r >> 8) % 24);
+            }
+            bench_buf_reserve(b, 1);
+            b->data[b->len++] = glyphs[(base + (uint32_t)(x * 7 + y * 13)) % (sizeof(glyphs) - 1)];
+        }
+    }
+    bench_buf_printf(b, "\x1b[0m");
+}
+
+// btop-like screen: a box-drawn frame around a scrolling braille area graph,
+// recoloured per row, plus a block-element meter line underneath.
+static void bench_emit_braille(bench_buf *b, uint32_t *rng, int cols, int rows, unsigned char *history,
+                               int history_len) {
+    // Random walk in dot units; two samples per braille cell column.
+    int graph_rows = rows - 4 > 1 ? rows - 4 : 1;
+    int max_dots = graph_rows * 4;
+    int last = history[history_len - 1];
+    int step = (int)(bench_rand(rng) % 9) - 4;
+    int next = last + step;
+    if (next < 0) next = 0;
+    if (next > 255) next = 255;
+    memmove(history, history + 1, (size_t)(history_len - 1));
+    history[history_len - 1] = (unsigned char)next;
+
+    int inner = cols - 2 > 1 ? cols - 2 : 1;
+    bench_buf_printf(b, "\x1b[H\x1b[38;5;245m");
+    bench_buf_put_cp(b, 0x250C);
+    bench_buf_printf(b, "\x1b[1;38;5;252m cpu \x1b[0;38;5;245m");
+    for (int x = 5; x < inner; ++x) bench_buf_put_cp(b, 0x2500);
+    bench_buf_put_cp(b, 0x2510);
+    static const uint8_t left_bits[4] = {0x40, 0x04, 0x02, 0x01};
+    static const uint8_t right_bits[4] = {0x80, 0x20, 0x10, 0x08};
+    static const uint8_t heat[] = {196, 202, 208, 214, 220, 226, 190, 154, 118, 82, 46};
+    for (int y = 0; y < graph_rows; ++y) {
+        int row_bottom_dot = (graph_rows - 1 - y) * 4;
+        bench_buf_printf(b, "\x1b[%d;1H\x1b[38;5;245m", y + 2);
+        bench_buf_put_cp(b, 0x2502);
+        bench_buf_printf(b, "\x1b[38;5;%um", heat[y * (int)sizeof(heat) / graph_rows]);
+        for (int x = 0; x < inner; ++x) {
+            int hl = history[history_len - 2 * inner + 2 * x] * max_dots / 255;
+            int hr = history[history_len - 2 * inner + 2 * x + 1] * max_dots / 255;
+            uint32_t cp = 0x2800;
+            for (int d = 0; d < 4; ++d) {
+                if (hl > row_bottom_dot + d) cp |= left_bits[d];
+                if (hr > row_bottom_dot + d) cp |= right_bits[d];
+            }
+            bench_buf_put_cp(b, cp);
+        }
+        bench_buf_printf(b, "\x1b[38;5;245m");
+        bench_buf_put_cp(b, 0x2502);
+    }
+    bench_buf_printf(b, "\x1b[%d;1H", graph_rows + 2);
+    bench_buf_put_cp(b, 0x2514);
+    for (int x = 0; x < inner; ++x) bench_buf_put_cp(b, 0x2500);
+    bench_buf_put_cp(b, 0x2518);
+    int pct = history[history_len - 1] * 100 / 255;
+    int bar = (inner - 12) > 0 ? inner - 12 : 0;
+    bench_buf_printf(b, "\x1b[%d;1H\x1b[0m CPU %3d%% ", graph_rows + 3, pct);
+    for (int x = 0; x < bar; ++x) {
+        int eighths = pct * bar * 8 / 100 - x * 8;
+        if (eighths <= 0) bench_buf_put_cp(b, ' ');
+        else if (eighths >= 8) bench_buf_put_cp(b, 0x2588);
+        else bench_buf_put_cp(b, 0x2590 - (uint32_t)eighths);
+    }
+}
+
+static uint64_t bench_now_ns(void) {
+    return stats_now_ns();
+}
+
+int bench_emit(const char *workload, volatile sig_atomic_t *stop_flag) {
+    int kind = -1;
+    for (int i = 0; i < BENCH_TERM_WORKLOAD_COUNT; ++i) {
+        if (workload && !strcmp(workload, bench_term_workload_names[i])) kind = i;
+    }
+    if (kind < 0) {
+        fprintf(stderr, "Unknown bench workload '%s' (expected logs, storm or braille)\n", workload ? workload : "");
+        return 1;
+    }
+    int hz = kind == BENCH_TERM_LOGS ? BENCH_LOGS_HZ : kind == BENCH_TERM_STORM ? BENCH_STORM_HZ : BENCH_BRAILLE_HZ;
+    uint64_t period_ns = 1000000000ull / (uint64_t)hz;
+    uint32_t rng = 0x9E3779B9u ^ (uint32_t)kind;
+    unsigned char *history = NULL;
+    int history_len = 0;
+    bench_buf buf = {0};
+    bench_buf_printf(&buf, "\x1b[?25l\x1b[2J");
+    uint64_t deadline = bench_now_ns();
+    for (unsigned long tick = 0; !*stop_flag; ++tick) {
+        int cols, rows;
+        bench_term_size(&cols, &rows);
+        if (kind == BENCH_TERM_LOGS) {
+            bench_emit_logs(&buf, &rng, tick);
+        } else if (kind == BENCH_TERM_STORM) {
+            bench_emit_storm(&buf, &rng, cols, rows);
+        } else {
+            if (history_len < 2 * cols) {
+                unsigned char *next = realloc(history, (size_t)(2 * cols));
+                if (!next) break;
+                memmove(next + (2 * cols - history_len), next, (size_t)history_len);
+                memset(next, history_len ? next[2 * cols - history_len] : 128, (size_t)(2 * cols - history_len));
+                history = next;
+                history_len = 2 * cols;
+            }
+            bench_emit_braille(&buf, &rng, cols, rows, history, history_len);
+        }
+        if (!bench_buf_flush(&buf)) break;
+        // Pace against an absolute clock; when the pane back-pressures us, drop the
+        // missed ticks instead of bursting to catch up.
+        deadline += period_ns;
+        uint64_t now = bench_now_ns();
+        if (now > deadline + period_ns) deadline = now;
+        struct timespec ts = {
+            .tv_sec = (time_t)(deadline / 1000000000ull),
+            .tv_nsec = (long)(deadline % 1000000000ull),
+        };
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR && !*stop_flag) {}
+    }
+    free(history);
+    free(buf.data);
+    return 0;
+}
+
+// --- Measurement ------------------------------------------------------------
+
+static void bench_mpv_drops(const options_t *opt, const media_ctx *pane_media, long long *vo, long long *decoder) {
+    *vo = 0;
+    *decoder = 0;
+    if (!pane_media) return;
+    for (int i = 0; i < opt->pane_count; ++i) {
+        if (!pane_media[i].mpv) continue;
+        int64_t v = 0;
+        if (mpv_get_property(pane_media[i].mpv, "frame-drop-count", MPV_FORMAT_INT64, &v) >= 0) *vo += v;
+        v = 0;
+        if (mpv_get_property(pane_media[i].mpv, "decoder-frame-drop-count", MPV_FORMAT_INT64, &v) >= 0) *decoder += v;
+    }
+}
+
+static double bench_usage_cpu_sec(const struct rusage *ru) {
+    return (double)ru->ru_utime.tv_sec + (double)ru->ru_utime.tv_usec / 1e6 +
+           (double)ru->ru_stime.tv_sec + (double)ru->ru_stime.tv_usec / 1e6;
+}
+
+void bench_init(bench_ctx *b, const options_t *opt) {
+    memset(b, 0, sizeof(*b));
+    if (opt->bench_sec <= 0) return;
+    b->active = true;
+    uint64_t now = bench_now_ns();
+    b->warmup_end_ns = now + (uint64_t)(BENCH_WARMUP_SEC * 1e9);
+    b->end_ns = b->warmup_end_ns + (uint64_t)opt->bench_sec * 1000000000ull;
+}
+
+uint64_t bench_wait_deadline_ns(const bench_ctx *b, uint64_t deadline_ns) {
+    if (!b->active) return deadline_ns;
+    uint64_t phase_end = b->measuring ? b->end_ns : b->warmup_end_ns;
+    return deadline_ns < phase_end ? deadline_ns : phase_end;
+}
+
+bool bench_tick(bench_ctx *b, const options_t *opt, const media_ctx *pane_media, const runtime_state *rt) {
+    if (!b->active) return false;
+    uint64_t now = bench_now_ns();
+    if (!b->measuring && now >= b->warmup_end_ns) {
+        b->measuring = true;
+        b->measure_start_ns = now;
+        b->end_ns = now + (b->end_ns - b->warmup_end_ns);
+        b->last_frame_end_ns = 0;
+        b->start_presented = rt->presented_frames;
+        b->start_idle = rt->idle_frames;
+        b->start_partial = rt->partial_frames;
+        bench_mpv_drops(opt, pane_media, &b->start_vo_drops, &b->start_decoder_drops);
+        getrusage(RUSAGE_SELF, &b->start_usage);
+        b->start_allocs = stats_thread_allocs();
+        b->start_term_rows = rt->stats.term_rows_total;
+        glyph_cache_get_stats(&b->start_glyphs);
+    }
+    return b->measuring && now >= b->end_ns;
+}
+
+void bench_record_frame(bench_ctx *b, uint64_t frame_start_ns) {
+    if (!b->measuring) return;
+    uint64_t now = bench_now_ns();
+    stats_hist_add(&b->frame_time, now > frame_start_ns ? (now - frame_start_ns) / 1000u : 0);
+    if (b->last_frame_end_ns) stats_hist_add(&b->frame_interval, (now - b->last_frame_end_ns) / 1000u);
+    b->last_frame_end_ns = now;
+    b->frames++;
+}
+
+static void bench_write_hist(FILE *f, const char *name, const stats_hist *h, bool last) {
+    fprintf(f, "  \"%s\": {\"count\": %llu, \"mean_us\": %llu, \"p50_us\": %llu, \"p90_us\": %llu, "
+               "\"p95_us\": %llu, \"p99_us\": %llu, \"max_us\": %llu}%s\n",
+            name, (unsigned long long)h->count,
+            (unsigned long long)(h->count ? h->sum_us / h->count : 0),
+            (unsigned long long)stats_hist_percentile_us(h, 50.0),
+            (unsigned long long)stats_hist_percentile_us(h, 90.0),
+            (unsigned long long)stats_hist_percentile_us(h, 95.0),
+            (unsigned long long)stats_hist_percentile_us(h, 99.0),
+            (unsigned long long)h->max_us, last ? "" : ",");
+}
+
+bool bench_write_report(const bench_ctx *b, const options_t *opt, const media_ctx *pane_media,
+                        const runtime_state *rt, const drm_ctx *d) {
+    if (!b->active) return true;
+    uint64_t now = bench_now_ns();
+    uint64_t allocs = stats_thread_allocs();
+    double elapsed = b->measuring && now > b->measure_start_ns ? (double)(now - b->measure_start_ns) / 1e9 : 0.0;
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    double cpu_sec = b->measuring ? bench_usage_cpu_sec(&usage) - bench_usage_cpu_sec(&b->start_usage) : 0.0;
+    long long vo_drops = 0, decoder_drops = 0;
+    bench_mpv_drops(opt, pane_media, &vo_drops, &decoder_drops);
+    if (b->measuring) {
+        vo_drops -= b->start_vo_drops;
+        decoder_drops -= b->start_decoder_drops;
+    }
+    const char *renderer = (const char *)glGetString(GL_RENDERER);
+
+    FILE *f = opt->bench_out ? fopen(opt->bench_out, "w") : stdout;
+    if (!f) {
+        perror("bench-out");
+        return false;
+    }
+    fprintf(f, "{\n");
+    fprintf(f, "  \"config\": {\"duration_sec\": %d, \"warmup_sec\": %.1f, \"terminal_panes\": %d, "
+               "\"video_panes\": %d, \"video\": \"%dx%d@%d\", \"output\": \"%dx%d@%u\", \"headless\": %s, "
+               "\"term_renderer\": \"%s\", \"gl_renderer\": \"%s\"},\n",
+            opt->bench_sec, BENCH_WARMUP_SEC, opt->bench_terms, opt->bench_videos,
+            opt->bench_video_w, opt->bench_video_h, opt->bench_video_fps,
+            d->mode.hdisplay, d->mode.vdisplay, (unsigned)d->mode.vrefresh, d->headless ? "true" : "false",
+            opt->term_atlas ? "atlas" : "cpu", renderer ? renderer : "?");
+    fprintf(f, "  \"completed\": %s,\n", b->measuring && now >= b->end_ns ? "true" : "false");
+    fprintf(f, "  \"elapsed_sec\": %.3f,\n", elapsed);
+    fprintf(f, "  \"frames\": {\"rendered\": %llu, \"presented\": %llu, \"partial\": %llu, \"idle\": %llu},\n",
+            b->frames, rt->presented_frames - b->start_presented, rt->partial_frames - b->start_partial,
+            rt->idle_frames - b->start_idle);
+    fprintf(f, "  \"fps\": %.2f,\n", elapsed > 0.0 ? (double)b->frames / elapsed : 0.0);
+    bench_write_hist(f, "frame_time", &b->frame_time, false);
+    bench_write_hist(f, "frame_interval", &b->frame_interval, false);
+    fprintf(f, "  \"mpv_dropped_frames\": {\"vo\": %lld, \"decoder\": %lld},\n", vo_drops, decoder_drops);
+    if (stats_alloc_counting() && b->measuring) {
+        // Main-thread allocations only; mpv's decoder threads are not included.
+        fprintf(f, "  \"main_thread_allocs\": {\"total\": %llu, \"per_frame\": %.2f},\n",
+                (unsigned long long)(allocs - b->start_allocs),
+                b->frames ? (double)(allocs - b->start_allocs) / (double)b->frames : 0.0);
+    }
+    const stats_term_rows *rows = &rt->stats.term_rows_total;
+    unsigned long long upload_bytes = rows->upload_bytes - b->start_term_rows.upload_bytes;
+    fprintf(f, "  \"term_rows\": {\"rendered\": %llu, \"skipped\": %llu, \"upload_bytes\": %llu, "
+               "\"upload_bytes_per_frame\": %.0f},\n",
+            rows->rendered - b->start_term_rows.rendered, rows->skipped - b->start_term_rows.skipped, upload_bytes,
+            b->frames ? (double)upload_bytes / (double)b->frames : 0.0);
+    glyph_cache_stats glyphs;
+    glyph_cache_get_stats(&glyphs);
+    unsigned long long glyph_hits = glyphs.hits - b->start_glyphs.hits;
+    unsigned long long glyph_misses = glyphs.misses - b->start_glyphs.misses;
+    fprintf(f, "  \"glyph_cache\": {\"hits\": %llu, \"misses\": %llu, \"evictions\": %llu, \"fallbacks\": %llu, "
+               "\"missing\": %llu, \"hit_rate\": %.4f},\n",
+            glyph_hits, glyph_misses, glyphs.evictions - b->start_glyphs.evictions,
+            glyphs.fallbacks - b->start_glyphs.fallbacks, glyphs.missing - b->start_glyphs.missing,
+            glyph_hits + glyph_misses ? (double)glyph_hits / (double)(glyph_hits + glyph_misses) : 0.0);
+    fprintf(f, "  \"cpu\": {\"seconds\": %.3f, \"percent\": %.1f},\n", cpu_sec,
+            elapsed > 0.0 ? cpu_sec * 100.0 / elapsed : 0.0);
+    fprintf(f, "  \"peak_rss_kb\": %ld\n", usage.ru_maxrss);
+    fprintf(f, "}\n");
+    bool ok = !ferror(f);
+    if (f != stdout) {
+        if (fclose(f) != 0) ok = false;
+    } else {
+        fflush(f);
+    }
+    if (!ok) perror("bench-out");
+    return ok;
+}
@@ -0,0 +1,67 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/resource.h>
+
+#include "display.h"
+#include "glyph_cache.h"
+#include "media.h"
+#include "options.h"
+#include "runtime.h"
+#include "stats.h"
+
+// Built-in benchmark (--bench SEC). Options swap the configured panes for mpv
+// panes playing lavfi test sources and terminal panes running synthetic
+// workloads, which are this binary re-executed as `--bench-emit NAME`. After a
+// fixed warmup the loop is measured for SEC seconds and a JSON report is written.
+
+typedef enum {
+    BENCH_TERM_LOGS = 0,
+    BENCH_TERM_STORM,
+    BENCH_TERM_BRAILLE,
+    BENCH_TERM_WORKLOAD_COUNT
+} bench_term_workload;
+
+#define BENCH_WARMUP_SEC 1.0
+
+typedef struct {
+    bool active;
+    bool measuring;
+    uint64_t warmup_end_ns;
+    uint64_t end_ns;
+    uint64_t measure_start_ns;
+    uint64_t last_frame_end_ns;
+    stats_hist frame_time;
+    stats_hist frame_interval;
+    unsigned long long frames;
+    unsigned long long start_presented, start_idle, start_partial;
+    long long start_vo_drops, start_decoder_drops;
+    struct rusage start_usage;
+    uint64_t start_allocs;
+    stats_term_rows start_term_rows;
+    glyph_cache_stats start_glyphs;
+} bench_ctx;
+
+// Replace the configured panes with the benchmark's mpv test sources followed by
+// the synthetic terminal workloads. Returns false on allocation failure.
+bool bench_configure(options_t *opt);
+// Shell command for a terminal pane running the given synthetic workload.
+const char *bench_term_cmd(int workload);
+// av://lavfi:testsrc2 URL at the requested size and rate.
+const char *bench_video_url(int w, int h, int fps);
+// Entry point of the `--bench-emit NAME` child; writes the workload to stdout until stopped.
+int bench_emit(const char *workload, volatile sig_atomic_t *stop_flag);
+
+void bench_init(bench_ctx *b, const options_t *opt);
+// Clamp a runtime_wait() deadline so the warmup and measurement boundaries are not overslept.
+uint64_t bench_wait_deadline_ns(const bench_ctx *b, uint64_t deadline_ns);
+// Advance warmup/measure state once per loop iteration. Returns true when the run is over.
+bool bench_tick(bench_ctx *b, const options_t *opt, const media_ctx *pane_media, const runtime_state *rt);
+void bench_record_frame(bench_ctx *b, uint64_t frame_start_ns);
+bool bench_write_report(const bench_ctx *b, const options_t *opt, const media_ctx *pane_media,
+                        const runtime_state *rt, const drm_ctx *d);
+
+#endif
@@ -4,30 +4,22 @@
 
 typedef struct { uint8_t r, g, b; } rgb8;
 
-static inline rgb8 color_from_index(int idx) {
-    // Standard 0-15 ANSI
-    static const rgb8 ansi16[16] = {
-        {0,0,0},{128,0,0},{0,128,0},{128,128,0},{0,0,128},{128,0,128},{0,128,128},{192,192,192},
-        {128,128,128},{255,0,0},{0,255,0},{255,255,0},{0,0,255},{255,0,255},{0,255,255},{255,255,255}
-    };
-    if (idx < 0) idx = 7;
-    if (idx < 16) return ansi16[idx];
-    if (idx >= 16 && idx < 232) {
-        int c = idx - 16;
-        int r = c / 36; c %= 36;
-        int g = c / 6;  c %= 6;
-        int b = c;
-        rgb8 out = {
-            .r = (uint8_t)(r ? 55 + r * 40 : 0),
-            .g = (uint8_t)(g ? 55 + g * 40 : 0),
-            .b = (uint8_t)(b ? 55 + b * 40 : 0)
-        };
-        return out;
-    }
-    if (idx >= 232 && idx <= 255) {
-        uint8_t v = (uint8_t)(8 + (idx - 232) * 10);
-        return (rgb8){v,v,v};
-    }
-    return ansi16[7];
-}
+// 6x6x6 cube levels (0, 95, 135, 175, 215, 255) and the 24-step grey ramp.
+#define COLOR_CUBE_LEVEL(n) ((uint8_t)((n) ? 55 + (n) * 40 : 0))
+#define COLOR_CUBE_ENTRY(r, g, b) { COLOR_CUBE_LEVEL(r), COLOR_CUBE_LEVEL(g), COLOR_CUBE_LEVEL(b) }
+#define COLOR_CUBE_ROW(r, g) COLOR_CUBE_ENTRY(r, g, 0), COLOR_CUBE_ENTRY(r, g, 1), COLOR_CUBE_ENTRY(r, g, 2), \
+                             COLOR_CUBE_ENTRY(r, g, 3), COLOR_CUBE_ENTRY(r, g, 4), COLOR_CUBE_ENTRY(r, g, 5)
+#define COLOR_CUBE_PLANE(r) COLOR_CUBE_ROW(r, 0), COLOR_CUBE_ROW(r, 1), COLOR_CUBE_ROW(r, 2), \
+                            COLOR_CUBE_ROW(r, 3), COLOR_CUBE_ROW(r, 4), COLOR_CUBE_ROW(r, 5)
+#define COLOR_GREY_ENTRY(i) { (uint8_t)(8 + (i) * 10), (uint8_t)(8 + (i) * 10), (uint8_t)(8 + (i) * 10) }
+#define COLOR_GREY_QUAD(i) COLOR_GREY_ENTRY(i), COLOR_GREY_ENTRY((i) + 1), COLOR_GREY_ENTRY((i) + 2), COLOR_GREY_ENTRY((i) + 3)
 
+static const rgb8 color_palette[256] = {
+    // Standard 0-15 ANSI
+    {0,0,0},{128,0,0},{0,128,0},{128,128,0},{0,0,128},{128,0,128},{0,128,128},{192,192,192},
+    {128,128,128},{255,0,0},{0,255,0},{255,255,0},{0,0,255},{255,0,255},{0,255,255},{255,255,255},
+    COLOR_CUBE_PLANE(0), COLOR_CUBE_PLANE(1), COLOR_CUBE_PLANE(2),
+    COLOR_CUBE_PLANE(3), COLOR_CUBE_PLANE(4), COLOR_CUBE_PLANE(5),
+    COLOR_GREY_QUAD(0), COLOR_GREY_QUAD(4), COLOR_GREY_QUAD(8),
+    COLOR_GREY_QUAD(12), COLOR_GREY_QUAD(16), COLOR_GREY_QUAD(20),
+};
@@ -9,6 +9,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
 #include <drm_fourcc.h>
@@ -364,6 +365,41 @@ void display_gbm_init(gbm_ctx *g, int drm_fd, int w, int h, bool debug) {
     if (debug) fprintf(stderr, "GBM: device+surface created %dx%d, format=XRGB8888\n", w, h);
 }
 
+static bool display_egl_has_ext(const char *exts, const char *name) {
+    if (!exts || !name) return false;
+    size_t len = strlen(name);
+    for (const char *p = exts; (p = strstr(p, name)) != NULL; p += len) {
+        bool starts = p == exts || p[-1] == ' ';
+        bool ends = p[len] == ' ' || p[len] == '\0';
+        if (starts && ends) return true;
+    }
+    return false;
+}
+
+// Buffer age lets frame_render repaint only what changed since the back buffer was last
+// shown; partial_update/swap_buffers_with_damage pass those rects on to the driver.
+static void display_egl_init_damage_exts(egl_ctx *e, bool debug) {
+    const char *exts = eglQueryString(e->dpy, EGL_EXTENSIONS);
+    bool partial_update = display_egl_has_ext(exts, "EGL_KHR_partial_update");
+    e->has_buffer_age = partial_update || display_egl_has_ext(exts, "EGL_EXT_buffer_age");
+    e->set_damage_region = NULL;
+    e->swap_buffers_with_damage = NULL;
+    if (partial_update) {
+        e->set_damage_region = (PFNEGLSETDAMAGEREGIONKHRPROC)eglGetProcAddress("eglSetDamageRegionKHR");
+    }
+    if (display_egl_has_ext(exts, "EGL_KHR_swap_buffers_with_damage")) {
+        e->swap_buffers_with_damage =
+            (PFNEGLSWAPBUFFERSWITHDAMAGEKHRPROC)eglGetProcAddress("eglSwapBuffersWithDamageKHR");
+    } else if (display_egl_has_ext(exts, "EGL_EXT_swap_buffers_with_damage")) {
+        e->swap_buffers_with_damage =
+            (PFNEGLSWAPBUFFERSWITHDAMAGEKHRPROC)eglGetProcAddress("eglSwapBuffersWithDamageEXT");
+    }
+    if (debug) {
+        fprintf(stderr, "EGL damage: buffer_age=%d partial_update=%d swap_with_damage=%d\n",
+                e->has_buffer_age ? 1 : 0, e->set_damage_region ? 1 : 0, e->swap_buffers_with_damage ? 1 : 0);
+    }
+}
+
 void display_egl_init(egl_ctx *e, gbm_ctx *g, bool debug) {
     e->dpy = eglGetDisplay((EGLNativeDisplayType)g->dev);
     if (e->dpy == EGL_NO_DISPLAY) display_die("eglGetDisplay");
@@ -406,10 +442,122 @@ void display_egl_init(egl_ctx *e, gbm_ctx *g, bool debug) {
         const char *egl_vendor = eglQueryString(e->dpy, EGL_VENDOR);
         fprintf(stderr, "EGL initialized: version=%s, vendor=%s\n", egl_ver ? egl_ver : "?", egl_vendor ? egl_vendor : "?");
     }
+    display_egl_init_damage_exts(e, debug);
     eglSwapInterval(e->dpy, 1);
 }
 
+#define DISPLAY_HEADLESS_DEFAULT_HZ 60
+
+static uint64_t display_monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t display_headless_period_ns(const drm_ctx *d) {
+    int hz = d->mode.vrefresh > 0 ? (int)d->mode.vrefresh : DISPLAY_HEADLESS_DEFAULT_HZ;
+    return 1000000000ull / (uint64_t)hz;
+}
+
+void display_headless_init(drm_ctx *d, egl_ctx *e, int w, int h, int hz, bool debug) {
+    if (w <= 0 || h <= 0) {
+        fprintf(stderr, "Headless mode needs a size like --headless 1920x1080\n");
+        exit(1);
+    }
+    d->fd = -1;
+    d->headless = true;
+    d->mode.hdisplay = (uint16_t)w;
+    d->mode.vdisplay = (uint16_t)h;
+    d->mode.vrefresh = (uint32_t)(hz > 0 ? hz : DISPLAY_HEADLESS_DEFAULT_HZ);
+    snprintf(d->mode.name, sizeof(d->mode.name), "%dx%d", w, h);
+
+    // Prefer Mesa's surfaceless platform so no X/Wayland/GBM device is needed; llvmpipe is fine.
+    e->dpy = EGL_NO_DISPLAY;
+    PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (get_platform_display) e->dpy = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    if (e->dpy == EGL_NO_DISPLAY) e->dpy = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (e->dpy == EGL_NO_DISPLAY) display_die("eglGetDisplay (headless)");
+    if (!eglInitialize(e->dpy, NULL, NULL)) display_die("eglInitialize (headless)");
+    eglBindAPI(EGL_OPENGL_ES_API);
+    static const EGLint cfg_attribs[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_ES2_BIT,
+        EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8,
+        EGL_NONE
+    };
+    EGLint n = 0;
+    if (!eglChooseConfig(e->dpy, cfg_attribs, &e->cfg, 1, &n) || n < 1) display_die("eglChooseConfig (headless)");
+    static const EGLint ctx_attribs[] = {EGL_CONTEXT_CLIENT_VERSION, 2, EGL_NONE};
+    e->ctx = eglCreateContext(e->dpy, e->cfg, EGL_NO_CONTEXT, ctx_attribs);
+    if (e->ctx == EGL_NO_CONTEXT) display_die("eglCreateContext (headless)");
+    // The pbuffer stands in for the scanout surface so FBO 0 keeps working in frame_render.
+    const EGLint pbuf_attribs[] = {EGL_WIDTH, w, EGL_HEIGHT, h, EGL_NONE};
+    e->surf = eglCreatePbufferSurface(e->dpy, e->cfg, pbuf_attribs);
+    if (e->surf == EGL_NO_SURFACE) {
+        fprintf(stderr, "eglCreatePbufferSurface failed: %s\n", egl_err_str(eglGetError()));
+        display_die("eglCreatePbufferSurface");
+    }
+    if (!eglMakeCurrent(e->dpy, e->surf, e->surf, e->ctx)) display_die("eglMakeCurrent (headless)");
+    const char *renderer = (const char *)glGetString(GL_RENDERER);
+    const char *vendor = (const char *)glGetString(GL_VENDOR);
+    fprintf(stderr, "Headless %dx%d@%u: EGL/GL renderer: %s (%s)\n", w, h, (unsigned)d->mode.vrefresh,
+            renderer ? renderer : "?", vendor ? vendor : "?");
+    if (debug) {
+        const char *egl_ver = eglQueryString(e->dpy, EGL_VERSION);
+        const char *egl_vendor = eglQueryString(e->dpy, EGL_VENDOR);
+        fprintf(stderr, "EGL initialized: version=%s, vendor=%s\n", egl_ver ? egl_ver : "?", egl_vendor ? egl_vendor : "?");
+    }
+    display_egl_init_damage_exts(e, debug);
+}
+
+// Stands in for a vblank-synchronised flip: wait for the GPU like a scanout would,
+// then sleep to the next virtual vblank. Late frames skip to the following vblank
+// and are counted as missed, matching how a real flip would slip a refresh.
+static void display_headless_present(drm_ctx *d) {
+    glFinish();
+    uint64_t period = display_headless_period_ns(d);
+    uint64_t now = display_monotonic_ns();
+    if (d->headless_next_vblank_ns == 0) d->headless_next_vblank_ns = now + period;
+    if (now > d->headless_next_vblank_ns) {
+        uint64_t missed = (now - d->headless_next_vblank_ns) / period + 1;
+        d->headless_missed_vblanks += missed;
+        d->headless_next_vblank_ns += missed * period;
+    }
+    struct timespec ts = {
+        .tv_sec = (time_t)(d->headless_next_vblank_ns / 1000000000ull),
+        .tv_nsec = (long)(d->headless_next_vblank_ns % 1000000000ull),
+    };
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {}
+    d->headless_next_vblank_ns += period;
+    d->headless_presents++;
+}
+
+int display_egl_buffer_age(const egl_ctx *e) {
+    if (!e->has_buffer_age) return 0;
+    EGLint age = 0;
+    if (!eglQuerySurface(e->dpy, e->surf, EGL_BUFFER_AGE_EXT, &age)) return 0;
+    return age < 0 ? 0 : (int)age;
+}
+
+void display_egl_set_damage_region(const egl_ctx *e, const EGLint *rects, int rect_count) {
+    if (!e->set_damage_region || !rects || rect_count <= 0) return;
+    e->set_damage_region(e->dpy, e->surf, (EGLint *)rects, (EGLint)rect_count);
+}
+
+void display_egl_swap_buffers(const egl_ctx *e, const EGLint *rects, int rect_count) {
+    if (e->swap_buffers_with_damage && rects && rect_count > 0) {
+        e->swap_buffers_with_damage(e->dpy, e->surf, (EGLint *)rects, (EGLint)rect_count);
+        return;
+    }
+    eglSwapBuffers(e->dpy, e->surf);
+}
+
 void display_drm_set_mode(drm_ctx *d, gbm_ctx *g) {
+    if (d->headless) {
+        d->headless_next_vblank_ns = display_monotonic_ns() + display_headless_period_ns(d);
+        return;
+    }
     if (d->atomic.enabled) {
         g->bo = gbm_surface_lock_front_buffer(g->surface);
         if (!g->bo) display_die("gbm_surface_lock_front_buffer");
@@ -451,6 +599,10 @@ void display_drm_set_mode(drm_ctx *d, gbm_ctx *g) {
 }
 
 void display_page_flip(drm_ctx *d, gbm_ctx *g) {
+    if (d->headless) {
+        display_headless_present(d);
+        return;
+    }
     g->next_bo = gbm_surface_lock_front_buffer(g->surface);
     uint32_t fb = drm_fb_for_bo(d->fd, g->next_bo);
     if (d->atomic.enabled) {
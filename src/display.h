@@ -10,6 +10,7 @@
 #include <gbm.h>
 
 #include <EGL/egl.h>
+#include <EGL/eglext.h>
 
 #include "options.h"
 
@@ -29,6 +30,12 @@ typedef struct {
         struct { uint32_t crtc_id; } conn_props;
         struct { uint32_t fb_id, crtc_id, src_x, src_y, src_w, src_h, crtc_x, crtc_y, crtc_w, crtc_h, in_fence_fd; } plane_props;
     } atomic;
+    // Headless mode has no DRM device: fd stays -1, mode holds the virtual size and
+    // refresh, and page flips become a timed present against a virtual vblank clock.
+    bool headless;
+    uint64_t headless_next_vblank_ns;
+    unsigned long long headless_presents;
+    unsigned long long headless_missed_vblanks;
 } drm_ctx;
 
 typedef struct {
@@ -47,6 +54,9 @@ typedef struct {
     EGLConfig cfg;
     EGLContext ctx;
     EGLSurface surf;
+    bool has_buffer_age;
+    PFNEGLSETDAMAGEREGIONKHRPROC set_damage_region;
+    PFNEGLSWAPBUFFERSWITHDAMAGEKHRPROC swap_buffers_with_damage;
 } egl_ctx;
 
 int display_open_drm_card(void);
@@ -57,6 +67,10 @@ const char *display_conn_type_str(uint32_t type);
 void display_pick_connector_mode(drm_ctx *d, const options_t *opt, bool debug);
 void display_gbm_init(gbm_ctx *g, int drm_fd, int w, int h, bool debug);
 void display_egl_init(egl_ctx *e, gbm_ctx *g, bool debug);
+int display_egl_buffer_age(const egl_ctx *e);
+void display_egl_set_damage_region(const egl_ctx *e, const EGLint *rects, int rect_count);
+void display_egl_swap_buffers(const egl_ctx *e, const EGLint *rects, int rect_count);
+void display_headless_init(drm_ctx *d, egl_ctx *e, int w, int h, int hz, bool debug);
 void display_drm_set_mode(drm_ctx *d, gbm_ctx *g);
 void display_page_flip(drm_ctx *d, gbm_ctx *g);
 void display_on_page_flip(int fd, unsigned int sequence, unsigned int tv_sec, unsigned int tv_usec, void *user_data);
@@ -5,6 +5,17 @@
 #include <string.h>
 
 #include <fontconfig/fontconfig.h>
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+typedef struct {
+    bool loaded;
+    bool failed;
+    char *path;
+    int cell_w[KMS_FONT_METRICS_MAX_PX + 1];
+} font_metrics_table;
+
+static font_metrics_table g_font_metrics;
 
 char *kms_font_find_monospace(void) {
     if (!FcInit()) {
@@ -35,3 +46,117 @@ char *kms_font_find_monospace(void) {
     FcPatternDestroy(match);
     return out;
 }
+
+static bool font_chain_add(char **paths, int *count, int max, const FcChar8 *file) {
+    if (!file || *count >= max) return false;
+    for (int i = 0; i < *count; ++i) {
+        if (strcmp(paths[i], (const char *)file) == 0) return false;
+    }
+    char *dup = strdup((const char *)file);
+    if (!dup) return false;
+    paths[(*count)++] = dup;
+    return true;
+}
+
+static void font_chain_add_match(char **paths, int *count, int max, const char *name) {
+    FcPattern *pat = FcNameParse((const FcChar8 *)name);
+    if (!pat) return;
+    FcConfigSubstitute(NULL, pat, FcMatchPattern);
+    FcDefaultSubstitute(pat);
+    FcResult res;
+    FcPattern *match = FcFontMatch(NULL, pat, &res);
+    FcPatternDestroy(pat);
+    if (!match) return;
+    FcChar8 *file = NULL;
+    if (FcPatternGetString(match, FC_FILE, 0, &file) == FcResultMatch) font_chain_add(paths, count, max, file);
+    FcPatternDestroy(match);
+}
+
+int kms_font_find_fallbacks(char **paths, int max) {
+    static const char *const families[] = {
+        "monospace",
+        "monospace:lang=zh-cn",
+        "monospace:lang=ja",
+        "monospace:lang=ko",
+        "Symbols Nerd Font",
+        "symbol",
+        "emoji",
+        "sans-serif",
+    };
+    if (max <= 0 || !FcInit()) return 0;
+    int count = 0;
+    for (size_t i = 0; i < sizeof(families) / sizeof(families[0]); ++i) {
+        font_chain_add_match(paths, &count, max, families[i]);
+    }
+    // Fill the rest with the fonts that extend monospace's coverage.
+    FcPattern *pat = FcNameParse((const FcChar8 *)"monospace");
+    if (!pat) return count;
+    FcConfigSubstitute(NULL, pat, FcMatchPattern);
+    FcDefaultSubstitute(pat);
+    FcResult res;
+    FcFontSet *set = FcFontSort(NULL, pat, FcTrue, NULL, &res);
+    FcPatternDestroy(pat);
+    if (!set) return count;
+    for (int i = 0; i < set->nfont && count < max; ++i) {
+        FcChar8 *file = NULL;
+        if (FcPatternGetString(set->fonts[i], FC_FILE, 0, &file) == FcResultMatch) {
+            font_chain_add(paths, &count, max, file);
+        }
+    }
+    FcFontSetDestroy(set);
+    return count;
+}
+
+static int font_measure_advance(FT_Face face, int font_px) {
+    FT_Set_Pixel_Sizes(face, 0, (FT_UInt)font_px);
+    if (FT_Load_Char(face, 'M', FT_LOAD_DEFAULT)) return 0;
+    return (int)((face->glyph->advance.x + 31) / 64);
+}
+
+static bool font_metrics_load(font_metrics_table *t) {
+    if (t->loaded) return true;
+    if (t->failed) return false;
+    t->failed = true;
+    t->path = kms_font_find_monospace();
+    if (!t->path) return false;
+    FT_Library lib;
+    FT_Face face;
+    if (FT_Init_FreeType(&lib)) return false;
+    if (FT_New_Face(lib, t->path, 0, &face)) {
+        FT_Done_FreeType(lib);
+        return false;
+    }
+    for (int px = 1; px <= KMS_FONT_METRICS_MAX_PX; ++px) t->cell_w[px] = font_measure_advance(face, px);
+    FT_Done_Face(face);
+    FT_Done_FreeType(lib);
+    t->failed = false;
+    t->loaded = true;
+    return true;
+}
+
+bool kms_font_cell_metrics(int font_px, int *cell_w, int *cell_h) {
+    font_metrics_table *t = &g_font_metrics;
+    if (font_px <= 0) font_px = 18;
+    if (!font_metrics_load(t)) return false;
+
+    int cw = 0;
+    if (font_px <= KMS_FONT_METRICS_MAX_PX) {
+        cw = t->cell_w[font_px];
+    } else {
+        // Oversized requests are rare; measure them directly from the cached path.
+        FT_Library lib;
+        FT_Face face;
+        if (FT_Init_FreeType(&lib)) return false;
+        if (FT_New_Face(lib, t->path, 0, &face)) {
+            FT_Done_FreeType(lib);
+            return false;
+        }
+        cw = font_measure_advance(face, font_px);
+        FT_Done_Face(face);
+        FT_Done_FreeType(lib);
+    }
+    if (cw <= 0) return false;
+    if (cell_w) *cell_w = cw;
+    if (cell_h) *cell_h = font_px + 2;
+    return true;
+}
@@ -1,8 +1,21 @@
 #ifndef FONT_UTIL_H
 #define FONT_UTIL_H
 
+#include <stdbool.h>
+
 // Helper to locate a monospace font via fontconfig.
 // Returns a malloc'd path string that the caller must free, or NULL on failure.
 char *kms_font_find_monospace(void);
 
+// Ordered glyph fallback chain: the monospace font first, then the best matches
+// for CJK, symbol and emoji families, then whatever else fontconfig sorts after
+// monospace. Stores up to max malloc'd, de-duplicated paths and returns the count.
+int kms_font_find_fallbacks(char **paths, int max);
+
+// Process-wide monospace cell metrics. The first call resolves the font once and
+// measures every pixel size up to KMS_FONT_METRICS_MAX_PX; later calls are table
+// lookups. Returns false if no font could be loaded.
+#define KMS_FONT_METRICS_MAX_PX 256
+bool kms_font_cell_metrics(int font_px, int *cell_w, int *cell_h);
+
 #endif // FONT_UTIL_H
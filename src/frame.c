@@ -1,7 +1,9 @@
 #include "frame.h"
 
+#include <math.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <string.h>
 
 #include <GLES2/gl2.h>
 
@@ -11,25 +13,108 @@
 #include "osd.h"
 #include "term_pane.h"
 
+static char frame_osd_line[512];
+static bool frame_osd_active = false;
+static osd_ctx *frame_osd = NULL;
+static render_gl_rect frame_osd_last;  // logical rect the OSD covered last frame
+
+bool frame_update_osd_text(const options_t *opt, const runtime_state *rt, const ui_state *ui,
+                           media_ctx *pane_media, int pane_count) {
+    char line[sizeof(frame_osd_line)];
+    bool active = false;
+    line[0] = '\0';
+    if (!rt->direct_mode && !opt->no_osd && ui->show_osd) {
+        media_ctx *osd_media = NULL;
+        if (ui->focus >= 0 && ui->focus < pane_count) {
+            if (pane_media && pane_media[ui->focus].mpv_gl) {
+                osd_media = &pane_media[ui->focus];
+            } else if (pane_media && pane_media[ui->focus].shared) {
+                osd_media = &pane_media[pane_media[ui->focus].share_pane];
+            }
+        }
+        if (!osd_media && pane_media) {
+            for (int i = 0; i < pane_count; ++i) {
+                if (pane_media[i].mpv_gl) {
+                    osd_media = &pane_media[i];
+                    break;
+                }
+            }
+        }
+        if (osd_media && osd_media->mpv) {
+            // Kept current by media_handle_wakeup from mpv property changes.
+            memcpy(line, osd_media->osd_line, sizeof(line));
+            active = true;
+        }
+    }
+    bool changed = active != frame_osd_active || strcmp(line, frame_osd_line) != 0;
+    frame_osd_active = active;
+    memcpy(frame_osd_line, line, sizeof(frame_osd_line));
+    return changed;
+}
+
+static bool frame_rect_overlaps(const render_gl_rect *r, const pane_layout *lay) {
+    return r->w > 0 && r->h > 0 && r->x < lay->x + lay->w && lay->x < r->x + r->w &&
+           r->y < lay->y + lay->h && lay->y < r->y + r->h;
+}
+
+static bool frame_pane_shown(const options_t *opt, const ui_state *ui, int i) {
+    return !options_pane_hidden(opt, i) && (!ui->fullscreen || ui->fs_pane == i);
+}
+
+// A pane decoding for others renders while any pane showing its frames is shown.
+static bool frame_media_shown(const options_t *opt, const ui_state *ui, const media_ctx *pane_media,
+                              int pane_count, int i) {
+    if (frame_pane_shown(opt, ui, i)) return true;
+    for (int j = 0; j < pane_count && pane_media[i].share_count > 0; ++j) {
+        if (pane_media[j].shared && pane_media[j].share_pane == i && frame_pane_shown(opt, ui, j)) return true;
+    }
+    return false;
+}
+
+// Frames of a shared source keep the video's aspect and are no larger than the
+// biggest pane showing them needs; until the video size is known mpv letterboxes
+// into the source pane's size.
+static void frame_shared_target_size(const media_ctx *pane_media, const pane_layout *pane_layouts, int pane_count,
+                                     int i, int *w, int *h) {
+    int extent = 1;
+    for (int j = 0; j < pane_count; ++j) {
+        if (j != i && !(pane_media[j].shared && pane_media[j].share_pane == i)) continue;
+        if (pane_layouts[j].w > extent) extent = pane_layouts[j].w;
+        if (pane_layouts[j].h > extent) extent = pane_layouts[j].h;
+    }
+    const media_ctx *src = &pane_media[i];
+    if (src->video_w <= 0 || src->video_h <= 0) {
+        *w = pane_layouts[i].w < 1 ? 1 : pane_layouts[i].w;
+        *h = pane_layouts[i].h < 1 ? 1 : pane_layouts[i].h;
+        return;
+    }
+    int longest = src->video_w > src->video_h ? src->video_w : src->video_h;
+    double scale = longest > extent ? (double)extent / (double)longest : 1.0;
+    *w = (int)lround((double)src->video_w * scale);
+    *h = (int)lround((double)src->video_h * scale);
+    if (*w < 1) *w = 1;
+    if (*h < 1) *h = 1;
+}
+
 void frame_render(const options_t *opt, runtime_state *rt, render_gl_ctx *rg, media_ctx *m,
                   media_ctx *pane_media,
                   drm_ctx *d, gbm_ctx *g, egl_ctx *e, pane_runtime *panes, ui_state *ui,
                   const pane_layout *slot_layouts,
                   const pane_layout *pane_layouts, int pane_count,
                   int logical_w,
-                  int logical_h, int fb_w, int fb_h, int screen_w, int screen_h,
-                  const int *pane_font_px, bool use_mpv,
-                  const bool *pane_ready, bool debug,
+                  int logical_h, int fb_w, int fb_h,
+                  const int *pane_font_px, bool use_mpv, bool debug,
                   const char *snapshot_path, bool *snapshot_written) {
     (void)slot_layouts;
     bool has_pane_media = false;
     for (int i = 0; i < pane_count; ++i) {
-        if (pane_media && pane_media[i].mpv_gl) {
+        if (pane_media && (pane_media[i].mpv_gl || pane_media[i].shared)) {
             has_pane_media = true;
             break;
         }
     }
     if (snapshot_written) *snapshot_written = false;
+    uint64_t frame_start_ns = stats_now_ns();
 
     if (!has_pane_media && rt->direct_mode && (rt->direct_test_only || !use_mpv)) {
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
@@ -56,189 +141,264 @@ void frame_render(const options_t *opt, runtime_state *rt, render_gl_ctx *rg, me
         return;
     }
 
-    glBindFramebuffer(GL_FRAMEBUFFER, rg->rt_fbo);
-    glViewport(0, 0, logical_w, logical_h);
-    render_gl_clear_color(0.0f, 0.0f, 0.0f, 1.0f);
-    glBindFramebuffer(GL_FRAMEBUFFER, rg->rt_fbo);
-    render_gl_reset_state_2d();
-    glViewport(0, 0, logical_w, logical_h);
+    // Panes are drawn straight into the back buffer with the output rotation folded
+    // into their quads. The logical-size rt is only composed into when a snapshot has
+    // to be read back, or when the driver reports no buffer age and a retained copy is
+    // the only way to avoid redrawing every pane each frame.
+    render_view screen_view, rt_view;
+    render_view_init_screen(&screen_view, logical_w, logical_h, opt->rotation);
+    render_view_init_logical(&rt_view, logical_w, logical_h);
+    bool snapshot_frame = snapshot_path && snapshot_written && !rt->direct_mode;
+    bool compose_to_rt = snapshot_frame || !e->has_buffer_age;
+    int buffer_age = rt->direct_mode ? 0 : display_egl_buffer_age(e);
+    bool full_damage = rt->full_damage || rt->direct_mode || debug ||
+                       ui->ui_control || ui->layout_reinit_countdown > 0 ||
+                       opt->layout_mode == 6;
+    render_gl_damage damage;
+    render_gl_damage_reset(&damage);
+    damage.full = full_damage || (compose_to_rt && !rg->rt_valid);
 
     if (!rt->direct_mode) {
+        panes_sync_layout(panes, pane_layouts, pane_count, pane_font_px);
+        if (ui->layout_reinit_countdown > 0) ui->layout_reinit_countdown--;
+        // Bring mpv pane targets up to date first so their damage is known before the
+        // back buffer is touched.
+        for (int i = 0; i < pane_count; ++i) {
+            media_ctx *pane_ctx = NULL;
+            if (pane_media && pane_media[i].mpv_gl) pane_ctx = &pane_media[i];
+            if (!pane_ctx) continue;
+            if (!frame_media_shown(opt, ui, pane_media, pane_count, i)) continue;
+            int *pane_needs_render = rt->pane_mpv_needs_render ? &rt->pane_mpv_needs_render[i] : NULL;
+            int vw = pane_layouts[i].w;
+            int vh = pane_layouts[i].h;
+            if (vw < 1) vw = 1;
+            if (vh < 1) vh = 1;
+            if (pane_ctx->share_count > 0) {
+                frame_shared_target_size(pane_media, pane_layouts, pane_count, i, &vw, &vh);
+            }
+            bool pane_target_resized = render_gl_ensure_pane_video_rt(rg, i, vw, vh);
+            if (pane_target_resized && pane_needs_render) {
+                *pane_needs_render = 1;
+            }
+            if (!pane_needs_render || *pane_needs_render) {
+                uint64_t mpv_start_ns = stats_now_ns();
+                glBindFramebuffer(GL_FRAMEBUFFER, render_gl_pane_video_fbo(rg, i));
+                glDisable(GL_SCISSOR_TEST);
+                glDisable(GL_BLEND);
+                glDisable(GL_DITHER);
+                glDisable(GL_CULL_FACE);
+                glDisable(GL_DEPTH_TEST);
+                glViewport(0, 0, vw, vh);
+                render_gl_clear_color(0.0f, 0.0f, 0.0f, 1.0f);
+                int flip_y = 0;
+                mpv_opengl_fbo fbo = {.fbo = (int)render_gl_pane_video_fbo(rg, i), .w = vw, .h = vh, .internal_format = 0};
+                mpv_render_param params[] = {
+                    {MPV_RENDER_PARAM_OPENGL_FBO, &fbo},
+                    {MPV_RENDER_PARAM_FLIP_Y, &flip_y},
+                    {0}
+                };
+                mpv_render_context_render(pane_ctx->mpv_gl, params);
+                media_note_rendered(pane_ctx);
+                stats_record_pane(&rt->stats, i, STATS_PANE_MPV_RENDER, mpv_start_ns);
+                if (pane_needs_render) *pane_needs_render = 0;
+                rt->pane_damaged[i] = true;
+                for (int j = 0; j < pane_count && pane_ctx->share_count > 0; ++j) {
+                    if (pane_media[j].shared && pane_media[j].share_pane == i) rt->pane_damaged[j] = true;
+                }
+            }
+        }
+        for (int i = 0; i < pane_count; ++i) {
+            if (!rt->pane_damaged[i]) continue;
+            render_gl_damage_add_view(&damage, &screen_view, pane_layouts[i].x, pane_layouts[i].y,
+                                      pane_layouts[i].w, pane_layouts[i].h);
+        }
+    }
+
+    // The OSD is blended over the panes, so the panes beneath it are redrawn each frame it
+    // shows; where it was last frame is repainted too once it shrinks or goes away.
+    render_gl_rect osd_rects[2] = {{16, 16, 0, 0}, frame_osd_last};
+    if (!rt->direct_mode && frame_osd_active) {
+        if (!frame_osd) frame_osd = osd_create(opt->font_px ? opt->font_px : 20);
+        osd_set_text(frame_osd, frame_osd_line);
+        osd_layout(frame_osd, osd_rects[0].x, &screen_view, &osd_rects[0].w, &osd_rects[0].h);
+    }
+    frame_osd_last = osd_rects[0];
+    for (int k = 0; k < 2; ++k) {
+        render_gl_damage_add_view(&damage, &screen_view, osd_rects[k].x, osd_rects[k].y, osd_rects[k].w,
+                                  osd_rects[k].h);
+    }
+
+    // The back buffer still holds the frame from buffer_age swaps ago; repaint only what
+    // changed since then. Age 0 means its contents are undefined.
+    render_gl_damage region;
+    bool partial = render_gl_damage_repaint_region(rg, &damage, buffer_age, &region);
+    EGLint egl_rects[4 * RENDER_GL_MAX_DAMAGE_RECTS];
+    int egl_rect_count = 0;
+    if (partial) {
+        for (int i = 0; i < region.count; ++i) {
+            egl_rects[4 * i + 0] = region.rects[i].x;
+            egl_rects[4 * i + 1] = region.rects[i].y;
+            egl_rects[4 * i + 2] = region.rects[i].w;
+            egl_rects[4 * i + 3] = region.rects[i].h;
+        }
+        egl_rect_count = region.count;
+        display_egl_set_damage_region(e, egl_rects, egl_rect_count);
+    }
+
+    if (!rt->direct_mode) {
+        uint64_t stage_start_ns = stats_now_ns();
+        const render_view *view = compose_to_rt ? &rt_view : &screen_view;
+        bool clear_all = compose_to_rt ? damage.full : !partial;
+        glBindFramebuffer(GL_FRAMEBUFFER, compose_to_rt ? rg->rt_fbo : 0);
+        render_gl_reset_state_2d();
+        glViewport(0, 0, view->target_w, view->target_h);
+        if (clear_all) render_gl_clear_color(0.0f, 0.0f, 0.0f, 1.0f);
         if (debug) {
-            glBindFramebuffer(GL_FRAMEBUFFER, rg->rt_fbo);
-            render_gl_reset_state_2d();
-            glEnable(GL_SCISSOR_TEST);
             for (int i = 0; i < pane_count; ++i) {
                 float shade = 0.08f + 0.06f * (float)(i % 4);
-                glScissor(pane_layouts[i].x,
-                          logical_h - (pane_layouts[i].y + pane_layouts[i].h),
-                          pane_layouts[i].w, pane_layouts[i].h);
-                glClearColor(0.05f, 0.08f + shade, 0.12f + shade, 1.0f);
-                glClear(GL_COLOR_BUFFER_BIT);
+                render_gl_clear_rect(view, pane_layouts[i].x, pane_layouts[i].y,
+                                     pane_layouts[i].w, pane_layouts[i].h,
+                                     0.05f, 0.08f + shade, 0.12f + shade, 1.0f);
             }
-            glDisable(GL_SCISSOR_TEST);
         }
-        panes_sync_layout(panes, pane_layouts, pane_count, pane_font_px);
-        if (ui->layout_reinit_countdown > 0) ui->layout_reinit_countdown--;
+        // Nothing else repaints gaps between the panes beneath the OSD.
+        for (int k = 0; k < 2 && !clear_all; ++k) {
+            render_gl_clear_rect(view, osd_rects[k].x, osd_rects[k].y, osd_rects[k].w, osd_rects[k].h,
+                                 0.0f, 0.0f, 0.0f, 1.0f);
+        }
         for (int i = 0; i < pane_count; ++i) {
             bool pane_hidden = options_pane_hidden(opt, i);
             bool pane_visible = !pane_hidden && (!ui->fullscreen || ui->fs_pane == i);
-            media_ctx *pane_ctx = NULL;
-            int *pane_needs_render = NULL;
-            if (pane_media && pane_media[i].mpv_gl) {
-                pane_ctx = &pane_media[i];
-                pane_needs_render = rt->pane_mpv_needs_render ? &rt->pane_mpv_needs_render[i] : NULL;
+            if (!pane_visible) continue;
+            const pane_layout *lay = &pane_layouts[i];
+            // rt misses only this frame's damage; an aged back buffer misses the whole region.
+            bool redraw = clear_all ||
+                          (compose_to_rt ? rt->pane_damaged[i] || frame_rect_overlaps(&osd_rects[0], lay) ||
+                                               frame_rect_overlaps(&osd_rects[1], lay)
+                                         : render_gl_damage_intersects_view(&region, view, lay->x, lay->y,
+                                                                            lay->w, lay->h));
+            if (!redraw) continue;
+            if (pane_media && (pane_media[i].shared || pane_media[i].share_count > 0)) {
+                // Shared frames are unrotated and uncropped; place them per pane.
+                const media_ctx *pm = &pane_media[i];
+                int src = pm->shared ? pm->share_pane : i;
+                int tw = 0, th = 0;
+                render_gl_pane_video_size(rg, src, &tw, &th);
+                if (!clear_all) render_gl_clear_rect(view, lay->x, lay->y, lay->w, lay->h, 0.0f, 0.0f, 0.0f, 1.0f);
+                render_gl_draw_video_to_view(rg, render_gl_pane_video_tex(rg, src), tw, th, pm->share_rotate,
+                                             pm->share_panscan, lay->x, lay->y, lay->w, lay->h, view);
+                continue;
             }
-            if (pane_ctx && pane_ctx->mpv_gl) {
-                if (pane_visible) {
-                    int vw = pane_layouts[i].w;
-                    int vh = pane_layouts[i].h;
-                    if (vw < 1) vw = 1;
-                    if (vh < 1) vh = 1;
-                    bool pane_target_resized = render_gl_ensure_pane_video_rt(rg, i, vw, vh);
-                    if (pane_target_resized && pane_needs_render) {
-                        *pane_needs_render = 1;
-                    }
-                    GLuint pane_vid_fbo = render_gl_pane_video_fbo(rg, i);
-                    GLuint pane_vid_tex = render_gl_pane_video_tex(rg, i);
-                    if (!pane_needs_render || *pane_needs_render) {
-                        glBindFramebuffer(GL_FRAMEBUFFER, pane_vid_fbo);
-                        glDisable(GL_SCISSOR_TEST);
-                        glDisable(GL_BLEND);
-                        glDisable(GL_DITHER);
-                        glDisable(GL_CULL_FACE);
-                        glDisable(GL_DEPTH_TEST);
-                        glViewport(0, 0, vw, vh);
-                        render_gl_clear_color(0.0f, 0.0f, 0.0f, 1.0f);
-                        int flip_y = 0;
-                        mpv_opengl_fbo fbo = {.fbo = (int)pane_vid_fbo, .w = vw, .h = vh, .internal_format = 0};
-                        mpv_render_param params[] = {
-                            {MPV_RENDER_PARAM_OPENGL_FBO, &fbo},
-                            {MPV_RENDER_PARAM_FLIP_Y, &flip_y},
-                            {0}
-                        };
-                        mpv_render_context_render(pane_ctx->mpv_gl, params);
-                        if (pane_needs_render) *pane_needs_render = 0;
-                    }
-
-                    glBindFramebuffer(GL_FRAMEBUFFER, rg->rt_fbo);
-                    render_gl_reset_state_2d();
-                    glViewport(0, 0, logical_w, logical_h);
-                    render_gl_draw_tex_to_rt(rg, pane_vid_tex,
-                                             pane_layouts[i].x, pane_layouts[i].y, vw, vh, logical_w, logical_h);
-                }
+            if (pane_media && pane_media[i].mpv_gl) {
+                int vw = lay->w < 1 ? 1 : lay->w;
+                int vh = lay->h < 1 ? 1 : lay->h;
+                render_gl_draw_tex_to_view(rg, render_gl_pane_video_tex(rg, i), lay->x, lay->y, vw, vh, view);
                 continue;
             }
             if (opt->no_panes) continue;
             term_pane *tp = panes_get_term(panes, i);
             if (!tp) continue;
-            if (pane_ready[i]) (void)term_pane_poll(tp);
-            if (pane_visible) {
-                term_pane_render(tp, screen_w, screen_h);
-                if (debug) {
-                    fprintf(stderr, "Pane %d draw at %d,%d %dx%d\n", i + 1,
-                            pane_layouts[i].x, pane_layouts[i].y, pane_layouts[i].w, pane_layouts[i].h);
-                }
-                render_gl_check(debug, "after term_pane_render");
+            if (!clear_all) render_gl_clear_rect(view, lay->x, lay->y, lay->w, lay->h, 0.0f, 0.0f, 0.0f, 1.0f);
+            uint64_t term_start_ns = stats_now_ns();
+            term_pane_render(tp, view);
+            stats_record_pane(&rt->stats, i, STATS_PANE_TERM_RENDER, term_start_ns);
+            term_pane_counters rows;
+            term_pane_take_counters(tp, &rows);
+            stats_add_term_rows(&rt->stats, i, rows.rows_rendered, rows.rows_skipped, rows.upload_bytes);
+            if (debug) {
+                fprintf(stderr, "Pane %d draw at %d,%d %dx%d\n", i + 1, lay->x, lay->y, lay->w, lay->h);
             }
+            render_gl_check(debug, "after term_pane_render");
         }
-    }
+        stats_record(&rt->stats, STATS_STAGE_COMPOSE, stage_start_ns);
 
-    if (!rt->direct_mode && !opt->no_osd && ui->show_osd) {
-        media_ctx *osd_media = NULL;
-        if (ui->focus >= 0 && ui->focus < pane_count) {
-            if (pane_media && pane_media[ui->focus].mpv_gl) {
-                osd_media = &pane_media[ui->focus];
+        stage_start_ns = stats_now_ns();
+        if (frame_osd_active) {
+            render_gl_reset_state_2d();
+            glViewport(0, 0, view->target_w, view->target_h);
+            osd_draw(frame_osd, osd_rects[0].x, osd_rects[0].y, view);
+        }
+
+        if (ui->ui_control) {
+            static osd_ctx *osdcm = NULL;
+            if (!osdcm) osdcm = osd_create(opt->font_px ? opt->font_px : 20);
+            const char *layout_name = layout_mode_name(opt->layout_mode);
+            const char *help =
+                "Tab: focus cycle panes\n"
+                "o: toggle OSD\n"
+                "l/L: cycle layouts\n"
+                "r/R: rotate roles\n"
+                "t: swap focused pane with next\n"
+                "z: fullscreen focused pane\n"
+                "n: next fullscreen pane\n"
+                "p: previous fullscreen pane\n"
+                "c: cycle fullscreen panes\n"
+                "Arrows: resize splits (2x1/1x2/2over1/1over2)\n"
+                "f: force pane rebuild\n"
+                "Always: Ctrl+Q quit";
+            char cm_text[1024];
+            snprintf(cm_text, sizeof cm_text, "Control Mode (Ctrl+E)  Layout: %s\n%s", layout_name, help);
+            osd_set_text(osdcm, cm_text);
+            render_gl_reset_state_2d();
+            glViewport(0, 0, view->target_w, view->target_h);
+            osd_draw(osdcm, 16, 48, view);
+            int thickness = 4;
+            int focus_slot = ui->focus;
+            if (focus_slot < 0 || focus_slot >= pane_count) {
+                focus_slot = 0;
             }
+            const pane_layout *focus_layout = &pane_layouts[focus_slot];
+            render_gl_draw_border_rect(focus_layout->x, focus_layout->y, focus_layout->w, focus_layout->h,
+                                       thickness, view, 0.1f, 0.9f, 0.95f, 1.0f);
         }
-        if (!osd_media && pane_media) {
-            for (int i = 0; i < pane_count; ++i) {
-                if (pane_media[i].mpv_gl) {
-                    osd_media = &pane_media[i];
-                    break;
-                }
+        if (frame_osd_active || ui->ui_control) stats_record(&rt->stats, STATS_STAGE_OSD, stage_start_ns);
+
+        if (compose_to_rt) {
+            if (snapshot_frame) {
+                stage_start_ns = stats_now_ns();
+                *snapshot_written = render_gl_write_current_rgba_frame(snapshot_path, logical_w, logical_h);
+                stats_record(&rt->stats, STATS_STAGE_SNAPSHOT, stage_start_ns);
             }
+            rg->rt_valid = true;
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            glViewport(0, 0, fb_w, fb_h);
+            if (partial) {
+                render_gl_blit_rt_region_to_screen(rg, opt->rotation, &region);
+            } else {
+                render_gl_clear_color(0.f, 0.f, 0.f, 1.f);
+                render_gl_blit_rt_to_screen(rg, opt->rotation);
+            }
+        } else {
+            // Drawn around rt: its contents no longer match the screen.
+            rg->rt_valid = false;
         }
-        if (osd_media && osd_media->mpv) {
-        static osd_ctx *osd = NULL;
-        if (!osd) osd = osd_create(opt->font_px ? opt->font_px : 20);
-        int64_t pos = 0, count = 0;
-        int paused_flag = 0;
-        char *title = NULL;
-        mpv_get_property(osd_media->mpv, "playlist-pos", MPV_FORMAT_INT64, &pos);
-        mpv_get_property(osd_media->mpv, "playlist-count", MPV_FORMAT_INT64, &count);
-        mpv_get_property(osd_media->mpv, "pause", MPV_FORMAT_FLAG, &paused_flag);
-        title = mpv_get_property_string(osd_media->mpv, "media-title");
-        char line[512];
-        snprintf(line, sizeof line, "%s %lld/%lld - %s",
-                 paused_flag ? "Paused" : "Playing",
-                 (long long)(pos + 1), (long long)count,
-                 title ? title : "(no title)");
-        if (title) mpv_free(title);
-        osd_set_text(osd, line);
-        glBindFramebuffer(GL_FRAMEBUFFER, rg->rt_fbo);
-        render_gl_reset_state_2d();
-        glViewport(0, 0, logical_w, logical_h);
-        osd_draw(osd, 16, 16, logical_w, logical_h);
+    } else {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        if (snapshot_path && snapshot_written) {
+            *snapshot_written = render_gl_write_current_rgba_frame(snapshot_path, fb_w, fb_h);
         }
     }
 
-    if (!rt->direct_mode && ui->ui_control) {
-        static osd_ctx *osdcm = NULL;
-        if (!osdcm) osdcm = osd_create(opt->font_px ? opt->font_px : 20);
-        const char *layout_name = layout_mode_name(opt->layout_mode);
-        const char *help =
-            "Tab: focus cycle panes\n"
-            "o: toggle OSD\n"
-            "l/L: cycle layouts\n"
-            "r/R: rotate roles\n"
-            "t: swap focused pane with next\n"
-            "z: fullscreen focused pane\n"
-            "n: next fullscreen pane\n"
-            "p: previous fullscreen pane\n"
-            "c: cycle fullscreen panes\n"
-            "Arrows: resize splits (2x1/1x2/2over1/1over2)\n"
-            "f: force pane rebuild\n"
-            "Always: Ctrl+Q quit";
-        char cm_text[1024];
-        snprintf(cm_text, sizeof cm_text, "Control Mode (Ctrl+E)  Layout: %s\n%s", layout_name, help);
-        osd_set_text(osdcm, cm_text);
-        glBindFramebuffer(GL_FRAMEBUFFER, rg->rt_fbo);
-        render_gl_reset_state_2d();
-        glViewport(0, 0, logical_w, logical_h);
-        osd_draw(osdcm, 16, 48, logical_w, logical_h);
-        int bx = 0, by = 0, bw = 0, bh = 0;
-        int thickness = 4;
-        int focus_slot = ui->focus;
-        if (focus_slot < 0 || focus_slot >= pane_count) {
-            focus_slot = 0;
-        }
-        const pane_layout *focus_layout = &pane_layouts[focus_slot];
-        bx = focus_layout->x;
-        by = focus_layout->y;
-        bw = focus_layout->w;
-        bh = focus_layout->h;
-        render_gl_draw_border_rect(bx, by, bw, bh, thickness, logical_w, logical_h, 0.1f, 0.9f, 0.95f, 1.0f);
-    }
-
-    if (snapshot_path && snapshot_written && !rt->direct_mode) {
-        *snapshot_written = render_gl_write_current_rgba_frame(snapshot_path, logical_w, logical_h);
-    }
-
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    if (!rt->direct_mode) {
-        glViewport(0, 0, fb_w, fb_h);
-        render_gl_clear_color(0.f, 0.f, 0.f, 1.f);
-        render_gl_blit_rt_to_screen(rg, opt->rotation);
-    }
-    if (snapshot_path && snapshot_written && rt->direct_mode) {
-        *snapshot_written = render_gl_write_current_rgba_frame(snapshot_path, fb_w, fb_h);
+    // Swap damage is this frame's change only, not the age-expanded repaint region.
+    if (partial) {
+        egl_rect_count = 0;
+        for (int i = 0; i < damage.count; ++i) {
+            egl_rects[4 * i + 0] = damage.rects[i].x;
+            egl_rects[4 * i + 1] = damage.rects[i].y;
+            egl_rects[4 * i + 2] = damage.rects[i].w;
+            egl_rects[4 * i + 3] = damage.rects[i].h;
+        }
+        egl_rect_count = damage.count;
     }
-
-    eglSwapBuffers(e->dpy, e->surf);
+    uint64_t swap_start_ns = stats_now_ns();
+    display_egl_swap_buffers(e, egl_rects, egl_rect_count);
+    render_gl_damage_push(rg, &damage);
     if (opt->use_atomic && opt->gl_finish) glFinish();
+    stats_record(&rt->stats, STATS_STAGE_SWAP, swap_start_ns);
     render_gl_check(debug, "after eglSwapBuffers");
+    uint64_t flip_start_ns = stats_now_ns();
     display_page_flip(d, g);
+    stats_record(&rt->stats, STATS_STAGE_PAGE_FLIP, flip_start_ns);
     if (use_mpv && m->mpv_gl) {
         mpv_render_context_report_swap(m->mpv_gl);
     }
@@ -249,6 +409,13 @@ void frame_render(const options_t *opt, runtime_state *rt, render_gl_ctx *rg, me
             }
         }
     }
-    if (use_mpv) rt->mpv_needs_render = 1;
+    // Presented: only a new mpv update callback or other damage schedules the next frame.
+    rt->mpv_needs_render = 0;
+    rt->scene_dirty = false;
+    rt->full_damage = false;
+    for (int i = 0; i < pane_count; ++i) rt->pane_damaged[i] = false;
+    if (partial) rt->partial_frames++;
+    rt->presented_frames++;
     rt->frame++;
+    stats_record(&rt->stats, STATS_STAGE_FRAME, frame_start_ns);
 }
@@ -11,15 +11,18 @@
 #include "runtime.h"
 #include "ui.h"
 
+// Refresh the cached OSD line from the focused media pane. Returns true when the
+// visible OSD text changed since the last call.
+bool frame_update_osd_text(const options_t *opt, const runtime_state *rt, const ui_state *ui,
+                           media_ctx *pane_media, int pane_count);
 void frame_render(const options_t *opt, runtime_state *rt, render_gl_ctx *rg, media_ctx *m,
                   media_ctx *pane_media,
                   drm_ctx *d, gbm_ctx *g, egl_ctx *e, pane_runtime *panes, ui_state *ui,
                   const pane_layout *slot_layouts,
                   const pane_layout *pane_layouts, int pane_count,
                   int logical_w,
-                  int logical_h, int fb_w, int fb_h, int screen_w, int screen_h,
-                  const int *pane_font_px, bool use_mpv,
-                  const bool *pane_ready, bool debug,
+                  int logical_h, int fb_w, int fb_h,
+                  const int *pane_font_px, bool use_mpv, bool debug,
                   const char *snapshot_path, bool *snapshot_written);
 
 #endif
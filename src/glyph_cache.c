@@ -0,0 +1,388 @@
+#define _POSIX_C_SOURCE 200809L
+#include "glyph_cache.h"
+#include "font_util.h"
+#include "glyph_synth.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#define GLYPH_ASCII_COUNT 128
+// Pinned slots: ASCII, then the procedural box/block range, then braille.
+#define GLYPH_PIN_BOX (GLYPH_ASCII_COUNT)
+#define GLYPH_PIN_BRAILLE (GLYPH_PIN_BOX + (int)(GLYPH_SYNTH_BOX_LAST - GLYPH_SYNTH_BOX_FIRST) + 1)
+#define GLYPH_PIN_COUNT (GLYPH_PIN_BRAILLE + (int)(GLYPH_SYNTH_BRAILLE_LAST - GLYPH_SYNTH_BRAILLE_FIRST) + 1)
+#define GLYPH_CACHE_BUCKETS (GLYPH_CACHE_CAP * 2)
+#define GLYPH_NONE (-1)
+// Lock-free hits are added to the shared counter in batches of this size.
+#define GLYPH_HIT_BATCH 256
+// Faces in the fallback chain, the monospace face included.
+#define GLYPH_MAX_FACES 16
+
+// Stands in for a pinned codepoint no face can render.
+static const glyph_bitmap g_glyph_missing;
+
+struct glyph_font {
+    // faces[0] is the monospace face; fallbacks are opened on first need.
+    FT_Face faces[GLYPH_MAX_FACES];
+    uint32_t faces_failed;
+    int px_size;
+    unsigned id;
+    int refs;
+    int advance, ascender;
+    int cell_h;
+    // Published once rendered and never evicted, so reads need no lock.
+    _Atomic(const glyph_bitmap *) pinned[GLYPH_PIN_COUNT];
+    glyph_bitmap pinned_store[GLYPH_PIN_COUNT];
+    glyph_font *next;
+};
+
+typedef struct {
+    glyph_font *font; // NULL while the entry is free
+    uint32_t cp;
+    bool missing;     // memoized miss: no face could render cp
+    int hash_next;    // bucket chain, or the free list
+    int lru_prev, lru_next;
+    glyph_bitmap gb;
+} glyph_entry;
+
+// Everything below the lock is guarded by it, including all FreeType calls.
+static struct {
+    pthread_mutex_t lock;
+    bool ready;
+    bool failed;
+    FT_Library lib;
+    char *paths[GLYPH_MAX_FACES];
+    int path_count;
+    glyph_font *fonts;
+    unsigned next_font_id;
+    glyph_entry entries[GLYPH_CACHE_CAP];
+    int buckets[GLYPH_CACHE_BUCKETS];
+    int lru_head, lru_tail; // most and least recently used
+    int free_head;
+    int count;
+    unsigned long long hits, misses, evictions;
+    unsigned long long fallbacks, missing;
+} g_glyphs = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+static atomic_ullong g_glyph_fast_hits;
+static _Thread_local unsigned g_glyph_fast_pending;
+
+static bool glyph_cache_init_locked(void) {
+    if (g_glyphs.ready) return true;
+    if (g_glyphs.failed) return false;
+    g_glyphs.failed = true;
+    g_glyphs.path_count = kms_font_find_fallbacks(g_glyphs.paths, GLYPH_MAX_FACES);
+    if (!g_glyphs.path_count) {
+        fprintf(stderr, "glyph cache: fontconfig monospace not found\n");
+        return false;
+    }
+    if (FT_Init_FreeType(&g_glyphs.lib)) {
+        fprintf(stderr, "glyph cache: FT_Init_FreeType failed\n");
+        return false;
+    }
+    for (int i = 0; i < GLYPH_CACHE_BUCKETS; i++) g_glyphs.buckets[i] = GLYPH_NONE;
+    for (int i = 0; i < GLYPH_CACHE_CAP; i++) {
+        g_glyphs.entries[i].hash_next = i + 1 < GLYPH_CACHE_CAP ? i + 1 : GLYPH_NONE;
+    }
+    g_glyphs.free_head = 0;
+    g_glyphs.lru_head = g_glyphs.lru_tail = GLYPH_NONE;
+    g_glyphs.failed = false;
+    g_glyphs.ready = true;
+    return true;
+}
+
+static int glyph_pin_slot(uint32_t cp) {
+    if (cp < GLYPH_ASCII_COUNT) return (int)cp;
+    if (cp >= GLYPH_SYNTH_BOX_FIRST && cp <= GLYPH_SYNTH_BOX_LAST) return GLYPH_PIN_BOX + (int)(cp - GLYPH_SYNTH_BOX_FIRST);
+    if (cp >= GLYPH_SYNTH_BRAILLE_FIRST && cp <= GLYPH_SYNTH_BRAILLE_LAST) {
+        return GLYPH_PIN_BRAILLE + (int)(cp - GLYPH_SYNTH_BRAILLE_FIRST);
+    }
+    return -1;
+}
+
+static int glyph_bucket(const glyph_font *font, uint32_t cp) {
+    uint32_t h = cp * 2654435761u ^ font->id * 0x9e3779b9u;
+    return (int)((h ^ (h >> 15)) & (GLYPH_CACHE_BUCKETS - 1));
+}
+
+static FT_Face glyph_face_locked(glyph_font *font, int i) {
+    if (font->faces[i]) return font->faces[i];
+    if (font->faces_failed & (1u << i)) return NULL;
+    FT_Face face;
+    if (FT_New_Face(g_glyphs.lib, g_glyphs.paths[i], 0, &face)) {
+        font->faces_failed |= 1u << i;
+        return NULL;
+    }
+    // Bitmap-only faces (colour emoji strikes) have no size to match the cell.
+    if (FT_Set_Pixel_Sizes(face, 0, (FT_UInt)font->px_size)) {
+        FT_Done_Face(face);
+        font->faces_failed |= 1u << i;
+        return NULL;
+    }
+    font->faces[i] = face;
+    return face;
+}
+
+static bool glyph_render_index_locked(FT_Face face, FT_UInt index, uint32_t cp, glyph_bitmap *g) {
+    if (FT_Load_Glyph(face, index, FT_LOAD_RENDER)) return false;
+    FT_GlyphSlot slot = face->glyph;
+    const FT_Bitmap *src = &slot->bitmap;
+    if (src->pixel_mode != FT_PIXEL_MODE_GRAY && src->pixel_mode != FT_PIXEL_MODE_MONO) return false;
+    size_t sz = (size_t)src->width * src->rows;
+    unsigned char *bitmap = NULL;
+    if (sz) {
+        bitmap = malloc(sz);
+        if (!bitmap) return false;
+        for (unsigned y = 0; y < src->rows; ++y) {
+            const unsigned char *row = src->buffer + (ptrdiff_t)y * src->pitch;
+            unsigned char *dst = bitmap + (size_t)y * src->width;
+            if (src->pixel_mode == FT_PIXEL_MODE_GRAY) {
+                memcpy(dst, row, src->width);
+            } else {
+                for (unsigned x = 0; x < src->width; ++x) dst[x] = (row[x >> 3] & (0x80 >> (x & 7))) ? 255 : 0;
+            }
+        }
+    }
+    g->codepoint = cp;
+    g->w = (int)src->width;
+    g->h = (int)src->rows;
+    g->bearing_x = slot->bitmap_left;
+    g->bearing_y = slot->bitmap_top;
+    g->advance = (int)((slot->advance.x + 31) / 64);
+    g->bitmap = bitmap;
+    return true;
+}
+
+// Procedural glyphs fill the whole cell: left edge at the pen, top at the cell top.
+static bool glyph_synth_locked(const glyph_font *font, uint32_t cp, glyph_bitmap *g) {
+    int w = font->advance, h = font->cell_h;
+    if (w <= 0 || h <= 0) return false;
+    unsigned char *bitmap = calloc((size_t)w * h, 1);
+    if (!bitmap) return false;
+    glyph_synth_render(cp, w, h, bitmap);
+    *g = (glyph_bitmap){ .codepoint = cp, .w = w, .h = h, .bearing_x = 0, .bearing_y = font->ascender,
+                         .advance = w, .bitmap = bitmap };
+    return true;
+}
+
+// Render cp from the first face in the fallback chain that maps it. Codepoints
+// no face maps get the monospace face's .notdef box, as before the chain
+// existed. Returns false if nothing renders; callers memoize both outcomes.
+static bool glyph_render_locked(glyph_font *font, uint32_t cp, glyph_bitmap *g) {
+    // Beyond Unicode, e.g. libvterm's (uint32_t)-1 marking a wide cell's right half.
+    if (cp > 0x10FFFF) return false;
+    if (glyph_synth_covers(cp)) return glyph_synth_locked(font, cp, g);
+    for (int i = 0; i < g_glyphs.path_count; ++i) {
+        FT_Face face = glyph_face_locked(font, i);
+        FT_UInt index = face ? FT_Get_Char_Index(face, cp) : 0;
+        if (index && glyph_render_index_locked(face, index, cp, g)) {
+            if (i > 0) g_glyphs.fallbacks++;
+            return true;
+        }
+    }
+    g_glyphs.missing++;
+    return glyph_render_index_locked(font->faces[0], 0, cp, g);
+}
+
+static void glyph_lru_unlink(int idx) {
+    glyph_entry *e = &g_glyphs.entries[idx];
+    if (e->lru_prev != GLYPH_NONE) g_glyphs.entries[e->lru_prev].lru_next = e->lru_next;
+    else g_glyphs.lru_head = e->lru_next;
+    if (e->lru_next != GLYPH_NONE) g_glyphs.entries[e->lru_next].lru_prev = e->lru_prev;
+    else g_glyphs.lru_tail = e->lru_prev;
+}
+
+static void glyph_lru_push_front(int idx) {
+    glyph_entry *e = &g_glyphs.entries[idx];
+    e->lru_prev = GLYPH_NONE;
+    e->lru_next = g_glyphs.lru_head;
+    if (g_glyphs.lru_head != GLYPH_NONE) g_glyphs.entries[g_glyphs.lru_head].lru_prev = idx;
+    g_glyphs.lru_head = idx;
+    if (g_glyphs.lru_tail == GLYPH_NONE) g_glyphs.lru_tail = idx;
+}
+
+// Unlink an entry from its chain and the LRU list and return it to the free list.
+static void glyph_entry_remove(int idx) {
+    glyph_entry *e = &g_glyphs.entries[idx];
+    int *link = &g_glyphs.buckets[glyph_bucket(e->font, e->cp)];
+    while (*link != idx) link = &g_glyphs.entries[*link].hash_next;
+    *link = e->hash_next;
+    glyph_lru_unlink(idx);
+    free(e->gb.bitmap);
+    memset(e, 0, sizeof(*e));
+    e->hash_next = g_glyphs.free_head;
+    g_glyphs.free_head = idx;
+    g_glyphs.count--;
+}
+
+static glyph_entry *glyph_lookup_locked(glyph_font *font, uint32_t cp) {
+    int bucket = glyph_bucket(font, cp);
+    for (int idx = g_glyphs.buckets[bucket]; idx != GLYPH_NONE; idx = g_glyphs.entries[idx].hash_next) {
+        glyph_entry *e = &g_glyphs.entries[idx];
+        if (e->font == font && e->cp == cp) {
+            glyph_lru_unlink(idx);
+            glyph_lru_push_front(idx);
+            g_glyphs.hits++;
+            return e;
+        }
+    }
+    g_glyphs.misses++;
+    glyph_bitmap g = {0};
+    bool missing = !glyph_render_locked(font, cp, &g);
+    if (g_glyphs.free_head == GLYPH_NONE) {
+        glyph_entry_remove(g_glyphs.lru_tail);
+        g_glyphs.evictions++;
+    }
+    int idx = g_glyphs.free_head;
+    glyph_entry *e = &g_glyphs.entries[idx];
+    g_glyphs.free_head = e->hash_next;
+    e->font = font;
+    e->cp = cp;
+    e->missing = missing;
+    e->gb = g;
+    e->hash_next = g_glyphs.buckets[bucket];
+    g_glyphs.buckets[bucket] = idx;
+    glyph_lru_push_front(idx);
+    g_glyphs.count++;
+    return e;
+}
+
+static bool glyph_scratch_copy(glyph_scratch *s, const glyph_bitmap *g) {
+    size_t sz = (size_t)g->w * g->h;
+    if (sz > s->cap) {
+        unsigned char *grown = realloc(s->glyph.bitmap, sz);
+        if (!grown) return false;
+        s->glyph.bitmap = grown;
+        s->cap = sz;
+    }
+    unsigned char *bitmap = s->glyph.bitmap;
+    s->glyph = *g;
+    s->glyph.bitmap = bitmap;
+    if (sz) memcpy(bitmap, g->bitmap, sz);
+    return true;
+}
+
+const glyph_bitmap *glyph_cache_get(glyph_font *font, uint32_t cp, glyph_scratch *scratch) {
+    if (!font) return NULL;
+    int slot = glyph_pin_slot(cp);
+    if (slot >= 0) {
+        const glyph_bitmap *g = atomic_load_explicit(&font->pinned[slot], memory_order_acquire);
+        if (g) {
+            if (++g_glyph_fast_pending >= GLYPH_HIT_BATCH) {
+                atomic_fetch_add_explicit(&g_glyph_fast_hits, g_glyph_fast_pending, memory_order_relaxed);
+                g_glyph_fast_pending = 0;
+            }
+            return g == &g_glyph_missing ? NULL : g;
+        }
+    }
+    const glyph_bitmap *out = NULL;
+    pthread_mutex_lock(&g_glyphs.lock);
+    if (slot >= 0) {
+        // Another thread may have rendered it since the unlocked check.
+        out = atomic_load_explicit(&font->pinned[slot], memory_order_relaxed);
+        if (out) {
+            g_glyphs.hits++;
+        } else {
+            g_glyphs.misses++;
+            out = glyph_render_locked(font, cp, &font->pinned_store[slot]) ? &font->pinned_store[slot] : &g_glyph_missing;
+            atomic_store_explicit(&font->pinned[slot], out, memory_order_release);
+        }
+        if (out == &g_glyph_missing) out = NULL;
+    } else {
+        glyph_entry *e = glyph_lookup_locked(font, cp);
+        if (e && !e->missing && glyph_scratch_copy(scratch, &e->gb)) out = &scratch->glyph;
+    }
+    pthread_mutex_unlock(&g_glyphs.lock);
+    return out;
+}
+
+void glyph_scratch_free(glyph_scratch *scratch) {
+    if (!scratch) return;
+    free(scratch->glyph.bitmap);
+    memset(scratch, 0, sizeof(*scratch));
+}
+
+glyph_font *glyph_font_acquire(int px_size) {
+    glyph_font *font = NULL;
+    pthread_mutex_lock(&g_glyphs.lock);
+    if (!glyph_cache_init_locked()) goto out;
+    for (font = g_glyphs.fonts; font; font = font->next) {
+        if (font->px_size == px_size) {
+            font->refs++;
+            goto out;
+        }
+    }
+    font = calloc(1, sizeof(*font));
+    if (!font) goto out;
+    font->px_size = px_size;
+    if (FT_New_Face(g_glyphs.lib, g_glyphs.paths[0], 0, &font->faces[0])) {
+        fprintf(stderr, "glyph cache: FT_New_Face failed for %s\n", g_glyphs.paths[0]);
+        free(font);
+        font = NULL;
+        goto out;
+    }
+    FT_Set_Pixel_Sizes(font->faces[0], 0, (FT_UInt)px_size);
+    font->id = ++g_glyphs.next_font_id;
+    font->refs = 1;
+    // Cell width comes from 'M', as the terminal grid has always measured it.
+    FT_Face face = font->faces[0];
+    if (!FT_Load_Char(face, 'M', FT_LOAD_RENDER)) font->advance = (int)((face->glyph->advance.x + 31) / 64);
+    font->ascender = (int)((face->size->metrics.ascender + 31) / 64);
+    font->cell_h = px_size + 2; // the terminal grid's leading, as in kms_font_cell_metrics()
+    font->next = g_glyphs.fonts;
+    g_glyphs.fonts = font;
+out:
+    pthread_mutex_unlock(&g_glyphs.lock);
+    return font;
+}
+
+void glyph_font_release(glyph_font *font) {
+    if (!font) return;
+    pthread_mutex_lock(&g_glyphs.lock);
+    if (--font->refs > 0) {
+        pthread_mutex_unlock(&g_glyphs.lock);
+        return;
+    }
+    for (int idx = g_glyphs.lru_head; idx != GLYPH_NONE; ) {
+        int next = g_glyphs.entries[idx].lru_next;
+        if (g_glyphs.entries[idx].font == font) glyph_entry_remove(idx);
+        idx = next;
+    }
+    for (glyph_font **link = &g_glyphs.fonts; *link; link = &(*link)->next) {
+        if (*link == font) {
+            *link = font->next;
+            break;
+        }
+    }
+    for (int i = 0; i < GLYPH_MAX_FACES; i++) {
+        if (font->faces[i]) FT_Done_Face(font->faces[i]);
+    }
+    pthread_mutex_unlock(&g_glyphs.lock);
+    for (int i = 0; i < GLYPH_PIN_COUNT; i++) {
+        if (atomic_load(&font->pinned[i]) == &font->pinned_store[i]) free(font->pinned_store[i].bitmap);
+    }
+    free(font);
+}
+
+void glyph_font_metrics(const glyph_font *font, int *advance, int *ascender) {
+    if (advance) *advance = font ? font->advance : 0;
+    if (ascender) *ascender = font ? font->ascender : 0;
+}
+
+void glyph_cache_get_stats(glyph_cache_stats *out) {
+    pthread_mutex_lock(&g_glyphs.lock);
+    out->hits = g_glyphs.hits;
+    out->misses = g_glyphs.misses;
+    out->evictions = g_glyphs.evictions;
+    out->fallbacks = g_glyphs.fallbacks;
+    out->missing = g_glyphs.missing;
+    out->entries = g_glyphs.count;
+    pthread_mutex_unlock(&g_glyphs.lock);
+    out->hits += atomic_load_explicit(&g_glyph_fast_hits, memory_order_relaxed) + g_glyph_fast_pending;
+}
@@ -0,0 +1,60 @@
+#ifndef GLYPH_CACHE_H
+#define GLYPH_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Process-wide glyph cache shared by every terminal pane and the OSD. The
+// fontconfig fallback chain (monospace, then CJK/symbol/emoji families) is
+// resolved once; each face is opened once per pixel size (a glyph_font) and each
+// glyph is rendered once per (font, codepoint) from the first face mapping it.
+// Failures are cached too, so a repeated miss is a lookup, not a FreeType call. ASCII glyphs live in a direct-indexed
+// table per font and are never evicted; everything else shares a fixed pool of
+// GLYPH_CACHE_CAP entries with hash chains and an LRU list, so lookups, inserts
+// and evictions are O(1). Safe to use from the pane worker threads.
+
+#define GLYPH_CACHE_CAP 4096
+
+typedef struct {
+    uint32_t codepoint;
+    int w, h, bearing_x, bearing_y, advance;
+    unsigned char *bitmap; // 8-bit alpha, NULL when the glyph is empty
+} glyph_bitmap;
+
+// Caller-owned copy of a glyph that another thread may evict. Reused (and
+// grown) across lookups; release with glyph_scratch_free().
+typedef struct {
+    glyph_bitmap glyph;
+    size_t cap;
+} glyph_scratch;
+
+typedef struct glyph_font glyph_font;
+
+typedef struct {
+    unsigned long long hits;
+    unsigned long long misses;
+    unsigned long long evictions;
+    unsigned long long fallbacks; // rendered from a face after monospace
+    unsigned long long missing;   // mapped by no face in the chain
+    int entries;
+} glyph_cache_stats;
+
+// Reference the face at px_size, opening it on first use. NULL if no monospace
+// font could be loaded.
+glyph_font *glyph_font_acquire(int px_size);
+void glyph_font_release(glyph_font *font);
+// Advance of 'M' and the ascender, in pixels.
+void glyph_font_metrics(const glyph_font *font, int *advance, int *ascender);
+
+// Rendered glyph for cp, or NULL if no face in the chain can render it. ASCII results
+// stay valid while the font is referenced; other glyphs are copied into
+// *scratch and stay valid until its next use.
+const glyph_bitmap *glyph_cache_get(glyph_font *font, uint32_t cp, glyph_scratch *scratch);
+void glyph_scratch_free(glyph_scratch *scratch);
+
+// Totals since start. Hits on the lock-free ASCII path are folded in per thread
+// in batches, so other threads' most recent few hundred may not show yet.
+void glyph_cache_get_stats(glyph_cache_stats *out);
+
+#endif
@@ -0,0 +1,264 @@
+#include "glyph_synth.h"
+
+#include <math.h>
+#include <stddef.h>
+
+enum { LINE_NONE, LINE_LIGHT, LINE_HEAVY, LINE_DOUBLE };
+
+// Line weight of each arm of a box-drawing character: left, up, right, down.
+#define BOX(l, u, r, d) (uint8_t)((l) | (u) << 2 | (r) << 4 | (d) << 6)
+#define BOX_ARM(arms, shift) (((arms) >> (shift)) & 3)
+
+// Zero marks the dashed, rounded and diagonal forms, which are drawn separately.
+static const uint8_t box_arms[0x80] = {
+    BOX(1,0,1,0), BOX(2,0,2,0), BOX(0,1,0,1), BOX(0,2,0,2), 0, 0, 0, 0,
+    0, 0, 0, 0, BOX(0,0,1,1), BOX(0,0,2,1), BOX(0,0,1,2), BOX(0,0,2,2),
+    BOX(1,0,0,1), BOX(2,0,0,1), BOX(1,0,0,2), BOX(2,0,0,2), BOX(0,1,1,0), BOX(0,1,2,0), BOX(0,2,1,0), BOX(0,2,2,0),
+    BOX(1,1,0,0), BOX(2,1,0,0), BOX(1,2,0,0), BOX(2,2,0,0), BOX(0,1,1,1), BOX(0,1,2,1), BOX(0,2,1,1), BOX(0,1,1,2),
+    BOX(0,2,1,2), BOX(0,2,2,1), BOX(0,1,2,2), BOX(0,2,2,2), BOX(1,1,0,1), BOX(2,1,0,1), BOX(1,2,0,1), BOX(1,1,0,2),
+    BOX(1,2,0,2), BOX(2,2,0,1), BOX(2,1,0,2), BOX(2,2,0,2), BOX(1,0,1,1), BOX(2,0,1,1), BOX(1,0,2,1), BOX(2,0,2,1),
+    BOX(1,0,1,2), BOX(2,0,1,2), BOX(1,0,2,2), BOX(2,0,2,2), BOX(1,1,1,0), BOX(2,1,1,0), BOX(1,1,2,0), BOX(2,1,2,0),
+    BOX(1,2,1,0), BOX(2,2,1,0), BOX(1,2,2,0), BOX(2,2,2,0), BOX(1,1,1,1), BOX(2,1,1,1), BOX(1,1,2,1), BOX(2,1,2,1),
+    BOX(1,2,1,1), BOX(1,1,1,2), BOX(1,2,1,2), BOX(2,2,1,1), BOX(1,2,2,1), BOX(2,1,1,2), BOX(1,1,2,2), BOX(2,2,2,1),
+    BOX(2,1,2,2), BOX(2,2,1,2), BOX(1,2,2,2), BOX(2,2,2,2), 0, 0, 0, 0,
+    BOX(3,0,3,0), BOX(0,3,0,3), BOX(0,0,3,1), BOX(0,0,1,3), BOX(0,0,3,3), BOX(3,0,0,1), BOX(1,0,0,3), BOX(3,0,0,3),
+    BOX(0,1,3,0), BOX(0,3,1,0), BOX(0,3,3,0), BOX(3,1,0,0), BOX(1,3,0,0), BOX(3,3,0,0), BOX(0,1,3,1), BOX(0,3,1,3),
+    BOX(0,3,3,3), BOX(3,1,0,1), BOX(1,3,0,3), BOX(3,3,0,3), BOX(3,0,3,1), BOX(1,0,1,3), BOX(3,0,3,3), BOX(3,1,3,0),
+    BOX(1,3,1,0), BOX(3,3,3,0), BOX(3,1,3,1), BOX(1,3,1,3), BOX(3,3,3,3), 0, 0, 0,
+    0, 0, 0, 0, BOX(1,0,0,0), BOX(0,1,0,0), BOX(0,0,1,0), BOX(0,0,0,1),
+    BOX(2,0,0,0), BOX(0,2,0,0), BOX(0,0,2,0), BOX(0,0,0,2), BOX(1,0,2,0), BOX(0,1,0,2), BOX(2,0,1,0), BOX(0,2,0,1),
+};
+
+// Quadrant masks for U+2596-U+259F: upper left, upper right, lower left, lower right.
+enum { QUAD_UL = 1, QUAD_UR = 2, QUAD_LL = 4, QUAD_LR = 8 };
+static const uint8_t block_quads[10] = {
+    QUAD_LL, QUAD_LR, QUAD_UL, QUAD_UL | QUAD_LL | QUAD_LR, QUAD_UL | QUAD_LR,
+    QUAD_UL | QUAD_UR | QUAD_LL, QUAD_UL | QUAD_UR | QUAD_LR, QUAD_UR, QUAD_UR | QUAD_LL, QUAD_UR | QUAD_LL | QUAD_LR,
+};
+
+typedef struct {
+    unsigned char *alpha;
+    int w, h;
+    int light, heavy;
+} synth_cell;
+
+static void synth_rect(const synth_cell *c, int x0, int y0, int x1, int y1, unsigned char a) {
+    if (x0 < 0) x0 = 0;
+    if (y0 < 0) y0 = 0;
+    if (x1 > c->w) x1 = c->w;
+    if (y1 > c->h) y1 = c->h;
+    for (int y = y0; y < y1; ++y) {
+        unsigned char *row = c->alpha + (size_t)y * c->w;
+        for (int x = x0; x < x1; ++x) {
+            if (row[x] < a) row[x] = a;
+        }
+    }
+}
+
+// Axis-agnostic rectangle: along runs with the arm, across is the other axis.
+static void synth_bar(const synth_cell *c, bool vertical, int along0, int along1, int across0, int across1) {
+    if (vertical) synth_rect(c, across0, along0, across1, along1, 255);
+    else synth_rect(c, along0, across0, along1, across1, 255);
+}
+
+static int synth_thickness(const synth_cell *c, int type) {
+    return type == LINE_HEAVY ? c->heavy : type == LINE_NONE ? 0 : c->light;
+}
+
+// Start of a centred band of thickness t, and of the two strokes of a double line.
+static int band_lo(int len, int t) { return (len - t) / 2; }
+static int double_lo(const synth_cell *c, int len) { return (len - 3 * c->light) / 2; }
+static int double_hi(const synth_cell *c, int len) { return double_lo(c, len) + 2 * c->light; }
+
+// One arm of a box-drawing character. neg is true for the left and up arms.
+// opposite is the arm across the centre on the same axis; perp_neg/perp_pos the
+// arms of the other axis on the up/left and down/right sides.
+static void synth_arm(const synth_cell *c, bool vertical, bool neg, int type, int opposite, int perp_neg, int perp_pos) {
+    int len = vertical ? c->h : c->w;    // along the arm
+    int cross = vertical ? c->w : c->h;  // across the arm
+    int light = c->light;
+    if (type != LINE_DOUBLE) {
+        int t = synth_thickness(c, type);
+        int stop_neg, stop_pos; // the arm covers [0, stop_neg) or [stop_pos, len)
+        if (perp_neg == LINE_DOUBLE || perp_pos == LINE_DOUBLE) {
+            if (perp_neg == LINE_DOUBLE && perp_pos == LINE_DOUBLE && !opposite) {
+                // Butt against the near stroke of a double line running through.
+                stop_neg = double_lo(c, len) + light;
+                stop_pos = double_hi(c, len);
+            } else if (perp_neg == LINE_DOUBLE && perp_pos == LINE_DOUBLE) {
+                stop_neg = band_lo(len, t) + t;
+                stop_pos = band_lo(len, t);
+            } else {
+                // The double line ends here, so reach across both of its strokes.
+                stop_neg = double_hi(c, len) + light;
+                stop_pos = double_lo(c, len);
+            }
+        } else {
+            int tp = t;
+            if (synth_thickness(c, perp_neg) > tp) tp = synth_thickness(c, perp_neg);
+            if (synth_thickness(c, perp_pos) > tp) tp = synth_thickness(c, perp_pos);
+            stop_neg = band_lo(len, tp) + tp;
+            stop_pos = band_lo(len, tp);
+        }
+        int across = band_lo(cross, t);
+        if (neg) synth_bar(c, vertical, 0, stop_neg, across, across + t);
+        else synth_bar(c, vertical, stop_pos, len, across, across + t);
+        return;
+    }
+    for (int s = 0; s < 2; ++s) {
+        int p = s ? perp_pos : perp_neg, other = s ? perp_neg : perp_pos;
+        int stop_neg, stop_pos;
+        if (p == LINE_DOUBLE) {
+            // Inner corner: stop at the perpendicular double's near stroke.
+            stop_neg = double_lo(c, len) + light;
+            stop_pos = double_hi(c, len);
+        } else if (p != LINE_NONE) {
+            int tp = synth_thickness(c, p);
+            stop_neg = band_lo(len, tp) + tp;
+            stop_pos = band_lo(len, tp);
+        } else if (other == LINE_DOUBLE) {
+            // Outer corner: run to the far stroke of the perpendicular double.
+            stop_neg = double_hi(c, len) + light;
+            stop_pos = double_lo(c, len);
+        } else if (other != LINE_NONE) {
+            int tp = synth_thickness(c, other);
+            stop_neg = band_lo(len, tp) + tp;
+            stop_pos = band_lo(len, tp);
+        } else {
+            stop_neg = stop_pos = len / 2;
+        }
+        int across = s ? double_hi(c, cross) : double_lo(c, cross);
+        if (neg) synth_bar(c, vertical, 0, stop_neg, across, across + light);
+        else synth_bar(c, vertical, stop_pos, len, across, across + light);
+    }
+}
+
+static void synth_dashes(const synth_cell *c, bool vertical, int n, int type) {
+    int len = vertical ? c->h : c->w;
+    int t = synth_thickness(c, type);
+    int across = band_lo(vertical ? c->w : c->h, t);
+    int gap = len / (4 * n);
+    if (gap < 1) gap = 1;
+    for (int i = 0; i < n; ++i) {
+        int s = i * len / n, e = (i + 1) * len / n;
+        synth_bar(c, vertical, s + gap / 2, e - (gap - gap / 2), across, across + t);
+    }
+}
+
+static unsigned char synth_coverage(double dist, double half) {
+    double cov = half + 0.5 - dist;
+    if (cov <= 0.0) return 0;
+    if (cov >= 1.0) return 255;
+    return (unsigned char)(cov * 255.0 + 0.5);
+}
+
+// Rounded corner joining the arms on the sx (+1 right, -1 left) and sy (+1 down, -1 up) sides.
+static void synth_arc(const synth_cell *c, int sx, int sy) {
+    int lx = band_lo(c->w, c->light), ly = band_lo(c->h, c->light);
+    double cx = lx + c->light / 2.0, cy = ly + c->light / 2.0;
+    double r = cx < cy ? cx : cy;
+    double ax = cx + sx * r, ay = cy + sy * r;
+    for (int y = 0; y < c->h; ++y) {
+        for (int x = 0; x < c->w; ++x) {
+            double px = x + 0.5, py = y + 0.5;
+            if ((px - ax) * sx > 0.0 || (py - ay) * sy > 0.0) continue;
+            unsigned char a = synth_coverage(fabs(hypot(px - ax, py - ay) - r), c->light / 2.0);
+            unsigned char *dst = c->alpha + (size_t)y * c->w + x;
+            if (*dst < a) *dst = a;
+        }
+    }
+    int ex = (int)lround(ax), ey = (int)lround(ay);
+    if (sx > 0) synth_rect(c, ex, ly, c->w, ly + c->light, 255);
+    else synth_rect(c, 0, ly, ex, ly + c->light, 255);
+    if (sy > 0) synth_rect(c, lx, ey, lx + c->light, c->h, 255);
+    else synth_rect(c, lx, 0, lx + c->light, ey, 255);
+}
+
+// Line from corner to corner; rising runs bottom-left to top-right.
+static void synth_diagonal(const synth_cell *c, bool rising) {
+    double len = hypot(c->w, c->h);
+    for (int y = 0; y < c->h; ++y) {
+        for (int x = 0; x < c->w; ++x) {
+            double px = x + 0.5, py = rising ? c->h - (y + 0.5) : y + 0.5;
+            unsigned char a = synth_coverage(fabs(px * c->h - py * c->w) / len, c->light / 2.0);
+            unsigned char *dst = c->alpha + (size_t)y * c->w + x;
+            if (*dst < a) *dst = a;
+        }
+    }
+}
+
+static void synth_box(const synth_cell *c, uint32_t cp) {
+    switch (cp) {
+    case 0x2504: case 0x2505: synth_dashes(c, false, 3, cp == 0x2505 ? LINE_HEAVY : LINE_LIGHT); return;
+    case 0x2506: case 0x2507: synth_dashes(c, true, 3, cp == 0x2507 ? LINE_HEAVY : LINE_LIGHT); return;
+    case 0x2508: case 0x2509: synth_dashes(c, false, 4, cp == 0x2509 ? LINE_HEAVY : LINE_LIGHT); return;
+    case 0x250A: case 0x250B: synth_dashes(c, true, 4, cp == 0x250B ? LINE_HEAVY : LINE_LIGHT); return;
+    case 0x254C: case 0x254D: synth_dashes(c, false, 2, cp == 0x254D ? LINE_HEAVY : LINE_LIGHT); return;
+    case 0x254E: case 0x254F: synth_dashes(c, true, 2, cp == 0x254F ? LINE_HEAVY : LINE_LIGHT); return;
+    case 0x256D: synth_arc(c, 1, 1); return;
+    case 0x256E: synth_arc(c, -1, 1); return;
+    case 0x256F: synth_arc(c, -1, -1); return;
+    case 0x2570: synth_arc(c, 1, -1); return;
+    case 0x2571: synth_diagonal(c, true); return;
+    case 0x2572: synth_diagonal(c, false); return;
+    case 0x2573: synth_diagonal(c, true); synth_diagonal(c, false); return;
+    default: break;
+    }
+    uint8_t arms = box_arms[cp - 0x2500];
+    int l = BOX_ARM(arms, 0), u = BOX_ARM(arms, 2), r = BOX_ARM(arms, 4), d = BOX_ARM(arms, 6);
+    if (l) synth_arm(c, false, true, l, r, u, d);
+    if (r) synth_arm(c, false, false, r, l, u, d);
+    if (u) synth_arm(c, true, true, u, d, l, r);
+    if (d) synth_arm(c, true, false, d, u, l, r);
+}
+
+// Pixel offset of the n-th eighth of len.
+static int eighth(int len, int n) { return (len * n + 4) / 8; }
+
+static void synth_block(const synth_cell *c, uint32_t cp) {
+    int w = c->w, h = c->h;
+    if (cp == 0x2580) synth_rect(c, 0, 0, w, h / 2, 255);
+    else if (cp <= 0x2588) synth_rect(c, 0, h - eighth(h, (int)(cp - 0x2580)), w, h, 255);
+    else if (cp <= 0x258F) synth_rect(c, 0, 0, eighth(w, (int)(0x2590 - cp)), h, 255);
+    else if (cp == 0x2590) synth_rect(c, w / 2, 0, w, h, 255);
+    else if (cp <= 0x2593) synth_rect(c, 0, 0, w, h, (unsigned char)(64 * (cp - 0x2590)));
+    else if (cp == 0x2594) synth_rect(c, 0, 0, w, eighth(h, 1), 255);
+    else if (cp == 0x2595) synth_rect(c, w - eighth(w, 1), 0, w, h, 255);
+    else {
+        uint8_t q = block_quads[cp - 0x2596];
+        int mx = w / 2, my = h / 2;
+        if (q & QUAD_UL) synth_rect(c, 0, 0, mx, my, 255);
+        if (q & QUAD_UR) synth_rect(c, mx, 0, w, my, 255);
+        if (q & QUAD_LL) synth_rect(c, 0, my, mx, h, 255);
+        if (q & QUAD_LR) synth_rect(c, mx, my, w, h, 255);
+    }
+}
+
+// Dots 1-3 and 7 fill the left column top to bottom, 4-6 and 8 the right.
+static void synth_braille(const synth_cell *c, uint32_t cp) {
+    static const uint8_t dot_col[8] = {0, 0, 0, 1, 1, 1, 0, 1};
+    static const uint8_t dot_row[8] = {0, 1, 2, 0, 1, 2, 3, 3};
+    unsigned bits = cp - GLYPH_SYNTH_BRAILLE_FIRST;
+    int sub_w = c->w / 2, sub_h = c->h / 4;
+    int dot = (sub_w < sub_h ? sub_w : sub_h) * 3 / 5;
+    if (dot < 1) dot = 1;
+    for (int i = 0; i < 8; ++i) {
+        if (!(bits & (1u << i))) continue;
+        int x0 = dot_col[i] * c->w / 2, x1 = (dot_col[i] + 1) * c->w / 2;
+        int y0 = dot_row[i] * c->h / 4, y1 = (dot_row[i] + 1) * c->h / 4;
+        int dx = x0 + (x1 - x0 - dot) / 2, dy = y0 + (y1 - y0 - dot) / 2;
+        synth_rect(c, dx, dy, dx + dot, dy + dot, 255);
+    }
+}
+
+bool glyph_synth_render(uint32_t cp, int w, int h, unsigned char *alpha) {
+    if (!glyph_synth_covers(cp) || w <= 0 || h <= 0) return false;
+    synth_cell c = { .alpha = alpha, .w = w, .h = h };
+    c.light = (w + 5) / 12;
+    if (c.light < 1) c.light = 1;
+    c.heavy = c.light * 2;
+    if (cp >= GLYPH_SYNTH_BRAILLE_FIRST) synth_braille(&c, cp);
+    else if (cp >= 0x2580) synth_block(&c, cp);
+    else synth_box(&c, cp);
+    return true;
+}
@@ -0,0 +1,26 @@
+#ifndef GLYPH_SYNTH_H
+#define GLYPH_SYNTH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Procedural cell glyphs: box drawing (U+2500-U+257F), block elements and
+// shades (U+2580-U+259F) and the 256 braille patterns (U+2800-U+28FF) are drawn
+// straight to exact cell-sized coverage bitmaps, so they line up across cells
+// and do not depend on what the font covers.
+
+#define GLYPH_SYNTH_BOX_FIRST 0x2500u
+#define GLYPH_SYNTH_BOX_LAST 0x259Fu
+#define GLYPH_SYNTH_BRAILLE_FIRST 0x2800u
+#define GLYPH_SYNTH_BRAILLE_LAST 0x28FFu
+
+static inline bool glyph_synth_covers(uint32_t cp) {
+    return (cp >= GLYPH_SYNTH_BOX_FIRST && cp <= GLYPH_SYNTH_BOX_LAST) ||
+           (cp >= GLYPH_SYNTH_BRAILLE_FIRST && cp <= GLYPH_SYNTH_BRAILLE_LAST);
+}
+
+// Draw cp into a zeroed w*h 8-bit coverage buffer. Returns false if cp is not
+// one of the procedural glyphs.
+bool glyph_synth_render(uint32_t cp, int w, int h, unsigned char *alpha);
+
+#endif
@@ -1,17 +1,18 @@
+#define _POSIX_C_SOURCE 200809L
 #include "layout.h"
 
 #include <ctype.h>
 #include <stdlib.h>
 #include <string.h>
 
-typedef struct split_tree_node {
+struct split_tree_node {
     bool leaf;
     int role;
     bool split_rows;
     int pct;
     struct split_tree_node *first;
     struct split_tree_node *second;
-} split_tree_node;
+};
 
 static int clamp_split_pct(int split_pct) {
     if (split_pct <= 0) split_pct = 50;
@@ -242,37 +243,25 @@ static void ordered_roles_from_perm(const int *perm, int role_count, int *ordere
     }
 }
 
-static int visible_ordered_roles(const char *split_tree_spec, const int *perm,
+static int visible_ordered_roles(const split_tree_node *tree, const int *perm,
                                  const bool *role_visible, int role_count,
-                                 int *ordered_roles) {
+                                 mosaic_layout *layout) {
+    int *ordered_roles = layout->ordered_roles;
+    bool *seen = layout->role_seen;
     int ordered_count = 0;
-    bool *seen = calloc((size_t)role_count, sizeof(*seen));
-    if (!seen) return 0;
-
-    if (split_tree_spec && *split_tree_spec) {
-        split_tree_node *tree = NULL;
-        if (split_tree_parse(split_tree_spec, &tree)) {
-            split_tree_node *translated = split_tree_translate_legacy_roles(tree, role_count);
-            if (translated) {
-                split_tree_collect_roles(translated, role_count, ordered_roles, &ordered_count, seen);
-                split_tree_destroy(translated);
-            }
-            split_tree_destroy(tree);
-        }
-    }
+    memset(seen, 0, (size_t)role_count * sizeof(*seen));
+
+    if (tree) split_tree_collect_roles(tree, role_count, ordered_roles, &ordered_count, seen);
 
     if (ordered_count < role_count) {
-        int *perm_roles = calloc((size_t)role_count, sizeof(*perm_roles));
-        if (perm_roles) {
-            ordered_roles_from_perm(perm, role_count, perm_roles);
-            for (int i = 0; i < role_count; ++i) {
-                int role = perm_roles[i];
-                if (role >= 0 && role < role_count && !seen[role]) {
-                    ordered_roles[ordered_count++] = role;
-                    seen[role] = true;
-                }
+        int *perm_roles = layout->perm_roles;
+        ordered_roles_from_perm(perm, role_count, perm_roles);
+        for (int i = 0; i < role_count; ++i) {
+            int role = perm_roles[i];
+            if (role >= 0 && role < role_count && !seen[role]) {
+                ordered_roles[ordered_count++] = role;
+                seen[role] = true;
             }
-            free(perm_roles);
         }
     }
 
@@ -281,7 +270,6 @@ static int visible_ordered_roles(const char *split_tree_spec, const int *perm,
         int role = ordered_roles[i];
         if (role_visible[role]) ordered_roles[visible_count++] = role;
     }
-    free(seen);
     return visible_count;
 }
 
@@ -407,16 +395,53 @@ static void build_visible_slots(int screen_w, int screen_h, int mode,
 
 bool mosaic_layout_init(mosaic_layout *layout, int role_count) {
     memset(layout, 0, sizeof(*layout));
-    layout->role_layouts = calloc((size_t)role_count, sizeof(*layout->role_layouts));
-    layout->role_count = layout->role_layouts ? role_count : 0;
-    return layout->role_layouts != NULL;
+    size_t n = role_count > 0 ? (size_t)role_count : 1;
+    layout->role_layouts = calloc(n, sizeof(*layout->role_layouts));
+    layout->role_visible = calloc(n, sizeof(*layout->role_visible));
+    layout->role_seen = calloc(n, sizeof(*layout->role_seen));
+    layout->ordered_roles = calloc(n, sizeof(*layout->ordered_roles));
+    layout->perm_roles = calloc(n, sizeof(*layout->perm_roles));
+    layout->slots = calloc(n, sizeof(*layout->slots));
+    if (!layout->role_layouts || !layout->role_visible || !layout->role_seen ||
+        !layout->ordered_roles || !layout->perm_roles || !layout->slots) {
+        mosaic_layout_destroy(layout);
+        return false;
+    }
+    layout->role_count = role_count;
+    return true;
 }
 
 void mosaic_layout_destroy(mosaic_layout *layout) {
     if (!layout) return;
     free(layout->role_layouts);
-    layout->role_layouts = NULL;
-    layout->role_count = 0;
+    free(layout->role_visible);
+    free(layout->role_seen);
+    free(layout->ordered_roles);
+    free(layout->perm_roles);
+    free(layout->slots);
+    free(layout->tree_spec);
+    split_tree_destroy(layout->tree);
+    memset(layout, 0, sizeof(*layout));
+}
+
+// Return the role-validated split tree for spec, or NULL when there is none or
+// it does not parse. The result is cached against the spec text.
+static const split_tree_node *mosaic_layout_tree(mosaic_layout *layout, const char *spec, int role_count) {
+    if (!spec || !*spec) return NULL;
+    if (layout->tree_spec && layout->tree_role_count == role_count && !strcmp(layout->tree_spec, spec)) {
+        return layout->tree;
+    }
+    free(layout->tree_spec);
+    split_tree_destroy(layout->tree);
+    layout->tree = NULL;
+    layout->tree_spec = strdup(spec);
+    layout->tree_role_count = role_count;
+    split_tree_node *parsed = NULL;
+    if (split_tree_parse(spec, &parsed)) {
+        layout->tree = split_tree_translate_legacy_roles(parsed, role_count);
+        split_tree_destroy(parsed);
+    }
+    return layout->tree;
 }
 
 void compute_mosaic_layout(int screen_w, int screen_h, int layout_mode,
@@ -434,8 +459,8 @@ void compute_mosaic_layout(int screen_w, int screen_h, int layout_mode,
     int split_pct = clamp_split_pct(pane_split_pct);
     int col_pct = clamp_col_pct(right_frac_pct);
     int role_count = pane_count;
-    bool *role_visible = calloc((size_t)role_count, sizeof(*role_visible));
-    if (!role_visible) return;
+    if (role_count > out->role_count) role_count = out->role_count;
+    bool *role_visible = out->role_visible;
     int visible_count = 0;
     int first_visible_role = -1;
     for (int role = 0; role < role_count; ++role) {
@@ -450,45 +475,27 @@ void compute_mosaic_layout(int screen_w, int screen_h, int layout_mode,
         }
     }
 
-    if (visible_count == role_count && split_tree_spec && *split_tree_spec) {
-        split_tree_node *tree = NULL;
-        if (split_tree_parse(split_tree_spec, &tree)) {
-            split_tree_node *translated = split_tree_translate_legacy_roles(tree, role_count);
-            if (translated) {
-                split_tree_apply(translated,
-                                 (pane_layout){ .x = 0, .y = 0, .w = screen_w, .h = screen_h },
-                                 out->role_layouts, role_count);
-                if (fullscreen) {
-                    pane_layout full = { .x = 0, .y = 0, .w = screen_w, .h = screen_h };
-                    int target_role = fs_pane >= 0 && fs_pane < role_count ? fs_pane : KMS_MOSAIC_SLOT_PANE_A;
-                    if (role_visible[target_role]) out->role_layouts[target_role] = full;
-                }
-                split_tree_destroy(translated);
-                split_tree_destroy(tree);
-                free(role_visible);
-                return;
-            }
-            split_tree_destroy(tree);
+    const split_tree_node *tree = mosaic_layout_tree(out, split_tree_spec, role_count);
+    if (visible_count == role_count && tree) {
+        split_tree_apply(tree,
+                         (pane_layout){ .x = 0, .y = 0, .w = screen_w, .h = screen_h },
+                         out->role_layouts, role_count);
+        if (fullscreen) {
+            pane_layout full = { .x = 0, .y = 0, .w = screen_w, .h = screen_h };
+            int target_role = fs_pane >= 0 && fs_pane < role_count ? fs_pane : KMS_MOSAIC_SLOT_PANE_A;
+            if (role_visible[target_role]) out->role_layouts[target_role] = full;
         }
+        return;
     }
 
     if (visible_count > 0) {
-        int *ordered_roles = calloc((size_t)role_count, sizeof(*ordered_roles));
-        pane_layout *slots = calloc((size_t)visible_count, sizeof(*slots));
-        if (!ordered_roles || !slots) {
-            free(ordered_roles);
-            free(slots);
-            free(role_visible);
-            return;
-        }
-        int ordered_visible_count = visible_ordered_roles(split_tree_spec, perm, role_visible, role_count, ordered_roles);
-        build_visible_slots(screen_w, screen_h, mode, split_pct, col_pct, rotation, overlay_swap, ordered_visible_count, slots);
+        int ordered_visible_count = visible_ordered_roles(tree, perm, role_visible, role_count, out);
+        build_visible_slots(screen_w, screen_h, mode, split_pct, col_pct, rotation, overlay_swap,
+                            ordered_visible_count, out->slots);
         for (int index = 0; index < ordered_visible_count; ++index) {
-            int role = ordered_roles[index];
-            out->role_layouts[role] = slots[index];
+            int role = out->ordered_roles[index];
+            out->role_layouts[role] = out->slots[index];
         }
-        free(ordered_roles);
-        free(slots);
     }
 
     if (fullscreen) {
@@ -498,5 +505,4 @@ void compute_mosaic_layout(int screen_w, int screen_h, int layout_mode,
             out->role_layouts[target_role] = full;
         }
     }
-    free(role_visible);
 }
@@ -6,11 +6,25 @@
 #include "options.h"
 #include "term_pane.h"
 
+typedef struct split_tree_node split_tree_node;
+
 typedef struct {
     pane_layout *role_layouts;
     int role_count;
+    // Scratch sized for role_count so a retained layout recomputes without allocating.
+    bool *role_visible;
+    bool *role_seen;
+    int *ordered_roles;
+    int *perm_roles;
+    pane_layout *slots;
+    // Parsed split tree, reparsed only when the spec text or pane count changes.
+    char *tree_spec;
+    int tree_role_count;
+    split_tree_node *tree;
 } mosaic_layout;
 
+// Allocate the layout and its scratch once; compute_mosaic_layout() can then run
+// every frame without touching the heap.
 bool mosaic_layout_init(mosaic_layout *layout, int role_count);
 void mosaic_layout_destroy(mosaic_layout *layout);
 void compute_mosaic_layout(int screen_w, int screen_h, int layout_mode,
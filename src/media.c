@@ -4,10 +4,12 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <math.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/eventfd.h>
 #include <sys/stat.h>
 #include <time.h>
 #include <unistd.h>
@@ -15,12 +17,13 @@
 #include <EGL/egl.h>
 #include <GLES2/gl2.h>
 
+// The callback context is the eventfd itself rather than the media_ctx, so the
+// context stays valid when a media_ctx is copied into another slot.
 static void media_update_wakeup(void *ctx) {
-    media_ctx *m = (media_ctx *)ctx;
-    if (!m) return;
-    char one = 'x';
-    if (m->wakeup_fd[1] >= 0) {
-        ssize_t n = write(m->wakeup_fd[1], &one, 1);
+    int fd = (int)(intptr_t)ctx;
+    uint64_t one = 1;
+    if (fd >= 0) {
+        ssize_t n = write(fd, &one, sizeof(one));
         if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
             perror("media wakeup write");
         }
@@ -67,6 +70,12 @@ static void media_free_owned_node(mpv_node *node) {
     node->u.list = NULL;
 }
 
+static uint64_t media_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
 static void media_log_timestamp(char *buf, size_t buf_size) {
     if (!buf || buf_size == 0) return;
     struct timespec ts;
@@ -145,6 +154,16 @@ static void media_apply_option_list(media_ctx *m, const char *const *opts, int c
     }
 }
 
+static bool media_user_set(const options_t *opt, const pane_media_config *pane_media, const char *key) {
+    for (int i = 0; i < opt->n_mpv_opts; i++) {
+        if (media_key_matches(opt->mpv_opts[i], key)) return true;
+    }
+    for (int i = 0; pane_media && i < pane_media->n_mpv_opts; i++) {
+        if (media_key_matches(pane_media->mpv_opts[i], key)) return true;
+    }
+    return false;
+}
+
 static void media_apply_options(media_ctx *m, const options_t *opt, const pane_media_config *pane_media) {
     bool user_set_hwdec = false;
     bool user_set_vsync = false;
@@ -291,11 +310,144 @@ static void media_load_inputs_source(media_ctx *m, const options_t *opt, const p
     }
 }
 
+// Display size of the decoded video, with its rotation metadata applied, for
+// panes that draw it themselves (shared decoding).
+static void media_read_video_size(media_ctx *m) {
+    int64_t w = 0, h = 0, rotate = 0;
+    if (mpv_get_property(m->mpv, "video-params/dw", MPV_FORMAT_INT64, &w) < 0 ||
+        mpv_get_property(m->mpv, "video-params/dh", MPV_FORMAT_INT64, &h) < 0 || w <= 0 || h <= 0) {
+        return;
+    }
+    mpv_get_property(m->mpv, "video-params/rotate", MPV_FORMAT_INT64, &rotate);
+    m->video_w = (int)(rotate % 180 == 90 ? h : w);
+    m->video_h = (int)(rotate % 180 == 90 ? w : h);
+}
+
+// Reply id of the standby deck's rewind; its PLAYBACK_RESTART only counts after it.
+#define MEDIA_REPLY_CUE_SEEK 1
+
+// Point the standby deck at the entry after the active one, paused on its first
+// frame. restart rewinds it when it already sits on that entry, as the deck that
+// just finished does with a two-entry playlist. The deck is ready once the
+// PLAYBACK_RESTART of that load or seek arrives.
+static void media_deck_cue(media_ctx *m, bool restart) {
+    if (!m->standby_mpv) return;
+    int64_t pos = -1, count = 0, standby_pos = -1;
+    mpv_get_property(m->mpv, "playlist-pos", MPV_FORMAT_INT64, &pos);
+    mpv_get_property(m->mpv, "playlist-count", MPV_FORMAT_INT64, &count);
+    if (pos < 0 || count < 2) return;
+    int64_t next = (pos + 1) % count;
+    int yes = 1;
+    mpv_set_property(m->standby_mpv, "pause", MPV_FORMAT_FLAG, &yes);
+    mpv_get_property(m->standby_mpv, "playlist-pos", MPV_FORMAT_INT64, &standby_pos);
+    if (standby_pos != next) {
+        m->standby_ready = false;
+        m->standby_cued = false;
+        mpv_set_property(m->standby_mpv, "playlist-pos", MPV_FORMAT_INT64, &next);
+    } else if (restart) {
+        m->standby_ready = false;
+        m->standby_cued = false;
+        const char *cmd[] = {"seek", "0", "absolute", NULL};
+        mpv_command_async(m->standby_mpv, MEDIA_REPLY_CUE_SEEK, cmd);
+    } else {
+        return;
+    }
+    // Frames the deck drew before the cue must not mark the new entry as decoded.
+    mpv_render_context_update(m->standby_gl);
+}
+
+// Track the observed OSD properties; false for any other property.
+static bool media_osd_property(media_osd_state *osd, const mpv_event_property *prop) {
+    if (!strcmp(prop->name, "media-title")) {
+        const char *title = prop->format == MPV_FORMAT_STRING ? *(char **)prop->data : NULL;
+        snprintf(osd->title, sizeof(osd->title), "%s", title ? title : "");
+    } else if (!strcmp(prop->name, "pause")) {
+        osd->paused = prop->format == MPV_FORMAT_FLAG && *(int *)prop->data;
+    } else if (!strcmp(prop->name, "playlist-pos")) {
+        osd->pos = prop->format == MPV_FORMAT_INT64 ? *(int64_t *)prop->data : 0;
+    } else if (!strcmp(prop->name, "playlist-count")) {
+        osd->count = prop->format == MPV_FORMAT_INT64 ? *(int64_t *)prop->data : 0;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static void media_osd_format(media_ctx *m) {
+    snprintf(m->osd_line, sizeof(m->osd_line), "%s %lld/%lld - %s",
+             m->osd.paused ? "Paused" : "Playing",
+             (long long)(m->osd.pos + 1), (long long)m->osd.count,
+             m->osd.title[0] ? m->osd.title : "(no title)");
+}
+
+static void media_skip_release(media_ctx *m);
+static void media_skip_engage(media_ctx *m);
+
+// The active deck reached the end of its entry. Hand over to the standby deck if
+// its first frame is ready, otherwise advance the active deck as mpv would.
+static void media_deck_switch(media_ctx *m, bool debug, int *mpv_needs_render) {
+    m->switch_last_ns = m->last_render_ns ? m->last_render_ns : media_now_ns();
+    if (!m->standby_ready) {
+        if (debug) fprintf(stderr, "mpv: standby deck not ready, advancing in place\n");
+        const char *cmd[] = {"playlist-next", "force", NULL};
+        mpv_command_async(m->mpv, 0, cmd);
+        return;
+    }
+    // Off screen under HIDDEN_VIDEO_SKIP (the only hidden policy that keeps
+    // playing into a switch), keyframe-only decoding moves to the incoming deck.
+    bool skipping = m->hidden && !m->hidden_paused && m->hidden_policy == HIDDEN_VIDEO_SKIP;
+    if (skipping) media_skip_release(m);
+    mpv_handle *mpv = m->mpv;
+    mpv_render_context *mpv_gl = m->mpv_gl;
+    m->mpv = m->standby_mpv;
+    m->mpv_gl = m->standby_gl;
+    m->standby_mpv = mpv;
+    m->standby_gl = mpv_gl;
+    m->standby_ready = false;
+    m->standby_cued = false;
+    media_osd_state osd = m->osd;
+    m->osd = m->standby_osd;
+    m->standby_osd = osd;
+    media_osd_format(m);
+    if (skipping) media_skip_engage(m);
+    int no = 0;
+    mpv_set_property(m->mpv, "pause", MPV_FORMAT_FLAG, &no);
+    *mpv_needs_render = 1;
+    if (m->share_count > 0) media_read_video_size(m);
+    media_deck_cue(m, true);
+}
+
+static void media_handle_standby_events(media_ctx *m, bool debug) {
+    for (;;) {
+        mpv_event *ev = mpv_wait_event(m->standby_mpv, 0);
+        if (!ev || ev->event_id == MPV_EVENT_NONE) break;
+        if (ev->event_id == MPV_EVENT_LOG_MESSAGE) {
+            mpv_event_log_message *lm = ev->data;
+            if (debug) fprintf(stderr, "mpv standby[%s]: %s", lm->prefix, lm->text);
+        } else if (ev->event_id == MPV_EVENT_START_FILE) {
+            m->standby_ready = false;
+            m->standby_cued = true;
+        } else if (ev->event_id == MPV_EVENT_COMMAND_REPLY && ev->reply_userdata == MEDIA_REPLY_CUE_SEEK) {
+            m->standby_cued = ev->error >= 0;
+        } else if (ev->event_id == MPV_EVENT_PLAYBACK_RESTART && m->standby_cued) {
+            m->standby_ready = true;
+            m->standby_cued = false;
+        } else if (ev->event_id == MPV_EVENT_FILE_LOADED) {
+            // Its own copy of the playlist may have arrived after the active deck's.
+            media_deck_cue(m, false);
+        } else if (ev->event_id == MPV_EVENT_PROPERTY_CHANGE) {
+            media_osd_property(&m->standby_osd, ev->data);
+        }
+    }
+}
+
 void media_handle_wakeup(media_ctx *m, bool debug, int *mpv_needs_render) {
     uint64_t tmp;
-    while (read(m->wakeup_fd[0], &tmp, sizeof(tmp)) > 0) {}
+    if (read(m->wakeup_fd, &tmp, sizeof(tmp)) < 0 && errno != EAGAIN) perror("media wakeup read");
+    if (m->standby_mpv) media_handle_standby_events(m, debug);
+    mpv_handle *active = m->mpv;
     for (;;) {
-        mpv_event *ev = mpv_wait_event(m->mpv, 0);
+        mpv_event *ev = mpv_wait_event(active, 0);
         if (!ev || ev->event_id == MPV_EVENT_NONE) break;
         if (ev->event_id == MPV_EVENT_LOG_MESSAGE) {
             mpv_event_log_message *lm = ev->data;
@@ -313,6 +465,8 @@ void media_handle_wakeup(media_ctx *m, bool debug, int *mpv_needs_render) {
         } else if (ev->event_id == MPV_EVENT_FILE_LOADED) {
             if (debug) fprintf(stderr, "mpv: FILE_LOADED\n");
             media_log_event(m, "FILE_LOADED", -1, NULL, NULL);
+            // Keep the standby deck one entry ahead, also after playlist jumps.
+            media_deck_cue(m, false);
             *mpv_needs_render = 1;
         } else if (ev->event_id == MPV_EVENT_VIDEO_RECONFIG) {
             if (debug) fprintf(stderr, "mpv: VIDEO_RECONFIG\n");
@@ -320,11 +474,23 @@ void media_handle_wakeup(media_ctx *m, bool debug, int *mpv_needs_render) {
                 fprintf(m->mpv_out, "VIDEO_RECONFIG\n");
                 fflush(m->mpv_out);
             }
+            m->tier_stale = true;
+            if (m->share_count > 0) media_read_video_size(m);
             *mpv_needs_render = 1;
         } else if (ev->event_id == MPV_EVENT_END_FILE) {
             mpv_event_end_file *end_file = ev->data;
             if (debug) fprintf(stderr, "mpv: END_FILE\n");
             media_log_event(m, "END_FILE", -1, NULL, end_file);
+        } else if (ev->event_id == MPV_EVENT_PROPERTY_CHANGE) {
+            mpv_event_property *prop = ev->data;
+            if (media_osd_property(&m->osd, prop)) {
+                media_osd_format(m);
+            } else if (m->standby_mpv && prop->format == MPV_FORMAT_FLAG && !strcmp(prop->name, "eof-reached") &&
+                       *(int *)prop->data) {
+                media_log_event(m, "DECK_SWITCH", -1, NULL, NULL);
+                media_deck_switch(m, debug, mpv_needs_render);
+                if (m->mpv != active) break;
+            }
         }
     }
     int flags = mpv_render_context_update(m->mpv_gl);
@@ -332,6 +498,22 @@ void media_handle_wakeup(media_ctx *m, bool debug, int *mpv_needs_render) {
         *mpv_needs_render = 1;
         if (debug) fprintf(stderr, "mpv: UPDATE_FRAME\n");
     }
+    // Events left on the deck that just went to standby belong to the old entry.
+    if (m->mpv != active) media_handle_standby_events(m, debug);
+}
+
+void media_note_rendered(media_ctx *m) {
+    uint64_t now_ns = media_now_ns();
+    if (m->switch_last_ns) {
+        double gap_ms = (double)(now_ns - m->switch_last_ns) / 1e6;
+        fprintf(stderr, "mpv: playlist transition, %.1f ms from last frame to first frame\n", gap_ms);
+        if (m->mpv_out) {
+            fprintf(m->mpv_out, "TRANSITION gap_ms=%.1f deck=%s\n", gap_ms, m->standby_mpv ? "dual" : "single");
+            fflush(m->mpv_out);
+        }
+        m->switch_last_ns = 0;
+    }
+    m->last_render_ns = now_ns;
 }
 
 void media_handle_playlist_fifo(media_ctx *m, char *pfifo_buf, int *pfifo_len) {
@@ -344,6 +526,7 @@ void media_handle_playlist_fifo(media_ctx *m, char *pfifo_buf, int *pfifo_len) {
         while ((nl = strchr(start, '\n')) != NULL) {
             *nl = '\0';
             mpv_append_line(m->mpv, start);
+            if (m->standby_mpv) mpv_append_line(m->standby_mpv, start);
             start = nl + 1;
         }
         *pfifo_len = (int)(pfifo_buf + *pfifo_len - start);
@@ -358,6 +541,188 @@ void media_handle_playlist_fifo(media_ctx *m, char *pfifo_buf, int *pfifo_len) {
     }
 }
 
+static void media_get_string(mpv_handle *mpv, const char *name, char *buf, size_t size) {
+    char *value = mpv_get_property_string(mpv, name);
+    snprintf(buf, size, "%s", value ? value : "");
+    if (value) mpv_free(value);
+}
+
+// Move the off-screen time since hidden_since_ns into the suspend counters.
+static void media_account_hidden(media_ctx *m, uint64_t now_ns) {
+    if (!m->hidden || now_ns <= m->hidden_since_ns) return;
+    uint64_t elapsed_ns = now_ns - m->hidden_since_ns;
+    unsigned long long frames = 0;
+    if (m->hidden_paused) {
+        m->suspend_ns += elapsed_ns;
+        m->suspend_ns_total += elapsed_ns;
+        frames = (unsigned long long)(m->hidden_fps * (double)elapsed_ns / 1e9 + 0.5);
+    } else if (m->hidden_policy == HIDDEN_VIDEO_SKIP) {
+        int64_t drops = m->hidden_drops;
+        mpv_get_property(m->mpv, "decoder-frame-drop-count", MPV_FORMAT_INT64, &drops);
+        if (drops > m->hidden_drops) frames = (unsigned long long)(drops - m->hidden_drops);
+        m->hidden_drops = drops;
+    }
+    m->suspend_frames += frames;
+    m->suspend_frames_total += frames;
+    m->hidden_since_ns = now_ns;
+}
+
+// HIDDEN_VIDEO_SKIP on the active deck: nothing presents the pane's frames, so
+// playback falls behind and mpv's decoder-side frame dropping kicks in; restrict
+// it to keyframes and count drops from here on.
+static void media_skip_engage(media_ctx *m) {
+    m->hidden_drops = 0;
+    mpv_get_property(m->mpv, "decoder-frame-drop-count", MPV_FORMAT_INT64, &m->hidden_drops);
+    mpv_set_property_string(m->mpv, "framedrop", "decoder+vo");
+    mpv_set_property_string(m->mpv, "vd-lavc-framedrop", "nonkey");
+}
+
+// Account the active deck's drops and give it back the saved frame dropping.
+static void media_skip_release(media_ctx *m) {
+    media_account_hidden(m, media_now_ns());
+    mpv_set_property_string(m->mpv, "framedrop", m->hidden_framedrop);
+    mpv_set_property_string(m->mpv, "vd-lavc-framedrop", m->hidden_vd_framedrop);
+}
+
+bool media_set_visible(media_ctx *m, bool visible, hidden_video_t policy) {
+    if (!m || !m->mpv || visible != m->hidden) return false;
+    uint64_t now_ns = media_now_ns();
+    if (visible) {
+        if (m->hidden_paused) {
+            media_account_hidden(m, now_ns);
+            int no = 0;
+            mpv_set_property(m->mpv, "pause", MPV_FORMAT_FLAG, &no);
+        } else if (m->hidden_policy == HIDDEN_VIDEO_SKIP) {
+            media_skip_release(m);
+        } else {
+            media_account_hidden(m, now_ns);
+        }
+        m->hidden = false;
+        m->hidden_paused = false;
+        return true;
+    }
+    m->hidden = true;
+    m->hidden_policy = policy;
+    m->hidden_since_ns = now_ns;
+    m->hidden_fps = 0.0;
+    if (mpv_get_property(m->mpv, "estimated-vf-fps", MPV_FORMAT_DOUBLE, &m->hidden_fps) < 0) {
+        mpv_get_property(m->mpv, "container-fps", MPV_FORMAT_DOUBLE, &m->hidden_fps);
+    }
+    if (policy == HIDDEN_VIDEO_PAUSE) {
+        // Leave a pause the user asked for alone, both now and when shown again.
+        int paused = 0;
+        mpv_get_property(m->mpv, "pause", MPV_FORMAT_FLAG, &paused);
+        if (!paused) {
+            int yes = 1;
+            m->hidden_paused = mpv_set_property(m->mpv, "pause", MPV_FORMAT_FLAG, &yes) >= 0;
+        }
+    } else if (policy == HIDDEN_VIDEO_SKIP) {
+        // Both decks start from the same options, so these are restored on
+        // whichever deck is active when the pane is shown again.
+        media_get_string(m->mpv, "framedrop", m->hidden_framedrop, sizeof(m->hidden_framedrop));
+        media_get_string(m->mpv, "vd-lavc-framedrop", m->hidden_vd_framedrop, sizeof(m->hidden_vd_framedrop));
+        media_skip_engage(m);
+    }
+    return false;
+}
+
+void media_take_suspended(media_ctx *m, uint64_t *suspend_ns, unsigned long long *frames) {
+    *suspend_ns = 0;
+    *frames = 0;
+    if (!m || !m->mpv) return;
+    media_account_hidden(m, media_now_ns());
+    *suspend_ns = m->suspend_ns;
+    *frames = m->suspend_frames;
+    m->suspend_ns = 0;
+    m->suspend_frames = 0;
+}
+
+// What each tier changes. Below FULL the source is shown much smaller than it
+// is decoded, so loop filter accuracy, scaler quality and full frame rate buy
+// little; LOW also asks adaptive streams for their lowest rendition.
+static const struct {
+    const char *name;
+    const char *skiploopfilter;
+    bool cheap_scalers;
+    int fps_cap;
+    const char *hls_bitrate;
+} media_tiers[MEDIA_TIER_COUNT] = {
+    [MEDIA_TIER_FULL] = { "full", "default", false, 0, "max" },
+    [MEDIA_TIER_REDUCED] = { "reduced", "nonref", true, 30, "max" },
+    [MEDIA_TIER_LOW] = { "low", "all", true, 15, "min" },
+};
+
+static const char *const media_scaler_props[3] = { "scale", "dscale", "cscale" };
+
+const char *media_tier_name(media_tier tier) {
+    return tier >= 0 && tier < MEDIA_TIER_COUNT ? media_tiers[tier].name : "full";
+}
+
+// Linear scale factor from the video's display size to the target, by area so
+// rotation does not matter. Unknown until the first frame is decoded.
+static double media_target_scale(media_ctx *m, int w, int h) {
+    int64_t vw = 0, vh = 0;
+    if (mpv_get_property(m->mpv, "video-params/dw", MPV_FORMAT_INT64, &vw) < 0 ||
+        mpv_get_property(m->mpv, "video-params/dh", MPV_FORMAT_INT64, &vh) < 0 || vw <= 0 || vh <= 0) {
+        return 0.0;
+    }
+    return sqrt((double)w * (double)h / ((double)vw * (double)vh));
+}
+
+static void media_apply_tier(const media_ctx *m, mpv_handle *mpv, media_tier prev, media_tier tier) {
+    if (!m->tier_user_loopfilter) {
+        mpv_set_property_string(mpv, "vd-lavc-skiploopfilter", media_tiers[tier].skiploopfilter);
+    }
+    if (!m->tier_user_scalers && media_tiers[tier].cheap_scalers != media_tiers[prev].cheap_scalers) {
+        for (int i = 0; i < 3; ++i) {
+            if (media_tiers[tier].cheap_scalers) {
+                mpv_set_property_string(mpv, media_scaler_props[i], "bilinear");
+            } else if (m->tier_scalers[i][0]) {
+                mpv_set_property_string(mpv, media_scaler_props[i], m->tier_scalers[i]);
+            }
+        }
+    }
+    if (media_tiers[tier].fps_cap != media_tiers[prev].fps_cap) {
+        if (media_tiers[prev].fps_cap) {
+            const char *cmd[] = {"vf", "remove", "@kms-tier", NULL};
+            mpv_command_async(mpv, 0, cmd);
+        }
+        if (media_tiers[tier].fps_cap) {
+            char filter[48];
+            snprintf(filter, sizeof(filter), "@kms-tier:fps=%d", media_tiers[tier].fps_cap);
+            const char *cmd[] = {"vf", "add", filter, NULL};
+            mpv_command_async(mpv, 0, cmd);
+        }
+    }
+    if (!m->tier_user_hls) mpv_set_property_string(mpv, "hls-bitrate", media_tiers[tier].hls_bitrate);
+}
+
+bool media_update_tier(media_ctx *m, int w, int h, bool loaded) {
+    if (!m || !m->mpv || w < 1 || h < 1) return false;
+    double scale = media_target_scale(m, w, h);
+    if (scale <= 0.0) return false;
+    m->tier_stale = false;
+    media_tier tier = scale >= 0.67 ? MEDIA_TIER_FULL : scale >= 0.34 ? MEDIA_TIER_REDUCED : MEDIA_TIER_LOW;
+    if (loaded && tier < MEDIA_TIER_LOW) tier++;
+    if (tier == m->tier) return false;
+    media_tier prev = m->tier;
+    m->tier = tier;
+    if (!m->tier_user_scalers && media_tiers[tier].cheap_scalers && !media_tiers[prev].cheap_scalers) {
+        for (int i = 0; i < 3; ++i) {
+            media_get_string(m->mpv, media_scaler_props[i], m->tier_scalers[i], sizeof(m->tier_scalers[i]));
+        }
+    }
+    media_apply_tier(m, m->mpv, prev, tier);
+    // A dual-deck pane's standby deck takes over with the same settings.
+    if (m->standby_mpv) media_apply_tier(m, m->standby_mpv, prev, tier);
+    if (m->mpv_out) {
+        fprintf(m->mpv_out, "TIER %s target=%dx%d scale=%.2f%s\n", media_tiers[tier].name, w, h, scale,
+                loaded ? " loaded" : "");
+        fflush(m->mpv_out);
+    }
+    return true;
+}
+
 bool media_should_use(const options_t *opt) {
     if (!opt || opt->no_video) return false;
     if (opt->video_count > 0 || opt->playlist_path || opt->playlist_ext) return true;
@@ -370,29 +735,68 @@ bool media_should_use_pane(const pane_media_config *pane_media) {
     return false;
 }
 
-static bool media_init_source(media_ctx *m, const options_t *opt, const pane_media_config *pane_media, bool debug) {
-    if (!m || !opt) return false;
-    memset(m, 0, sizeof(*m));
-    m->wakeup_fd[0] = -1;
-    m->wakeup_fd[1] = -1;
-    m->playlist_fifo_fd = -1;
-    m->playlist_fifo_path = pane_media ? pane_media->playlist_fifo : opt->playlist_fifo;
+static bool media_str_eq(const char *a, const char *b) {
+    return a == b || (a && b && !strcmp(a, b));
+}
 
-    if (pane_media) {
-        if (!media_should_use_pane(pane_media)) return false;
-    } else if (!media_should_use(opt)) {
+bool media_pane_sources_match(const options_t *opt, const pane_media_config *a, const pane_media_config *b) {
+    if (!opt || !media_should_use_pane(a) || !media_should_use_pane(b)) return false;
+    // Each instance would shuffle on its own; keep them separate.
+    if (opt->shuffle) return false;
+    if (!media_str_eq(a->playlist_path, b->playlist_path) || !media_str_eq(a->playlist_ext, b->playlist_ext) ||
+        !media_str_eq(a->playlist_fifo, b->playlist_fifo) || !media_str_eq(a->mpv_out_path, b->mpv_out_path) ||
+        a->dual_deck != b->dual_deck || a->video_count != b->video_count || a->n_mpv_opts != b->n_mpv_opts) {
         return false;
     }
-    const char *disable_env = getenv("KMS_MPV_DISABLE");
-    if (disable_env && (*disable_env == '1' || *disable_env == 'y' || *disable_env == 'Y')) {
-        fprintf(stderr, "Debug: KMS_MPV_DISABLE set; skipping mpv setup.\n");
-        return false;
+    for (int i = 0; i < a->video_count; ++i) {
+        const video_item *va = &a->videos[i];
+        const video_item *vb = &b->videos[i];
+        if (!media_str_eq(va->path, vb->path) || va->nopts != vb->nopts) return false;
+        for (int j = 0; j < va->nopts; ++j) {
+            if (!media_str_eq(va->opts[j], vb->opts[j])) return false;
+        }
     }
+    for (int i = 0; i < a->n_mpv_opts; ++i) {
+        if (!media_str_eq(a->mpv_opts[i], b->mpv_opts[i])) return false;
+    }
+    // With these set through mpv options mpv would crop or rotate every pane alike.
+    return !media_user_set(opt, a, "video-rotate") && !media_user_set(opt, a, "panscan") &&
+           !media_user_set(opt, a, "keepaspect");
+}
 
-    if (pipe2(m->wakeup_fd, O_NONBLOCK | O_CLOEXEC) < 0) {
-        perror("pipe2");
-        exit(1);
+static void media_share_geometry(media_ctx *m, const options_t *opt, const pane_media_config *pane_media) {
+    int rotate = (pane_media && pane_media->video_rotate >= 0) ? pane_media->video_rotate : opt->video_rotate;
+    const char *panscan = (pane_media && pane_media->panscan) ? pane_media->panscan : opt->panscan;
+    m->share_rotate = rotate > 0 ? rotate % 360 : 0;
+    m->share_panscan = panscan ? strtof(panscan, NULL) : 0.0f;
+    if (m->share_panscan < 0.0f) m->share_panscan = 0.0f;
+    if (m->share_panscan > 1.0f) m->share_panscan = 1.0f;
+}
+
+void media_init_shared(media_ctx *m, media_ctx *source, int source_pane, const options_t *opt,
+                       const pane_media_config *pane_media) {
+    if (!m || !source || !source->mpv || !opt) return;
+    memset(m, 0, sizeof(*m));
+    m->wakeup_fd = -1;
+    m->playlist_fifo_fd = -1;
+    m->shared = true;
+    m->share_pane = source_pane;
+    media_share_geometry(m, opt, pane_media);
+    if (source->share_count++ == 0) {
+        mpv_set_property_string(source->mpv, "video-rotate", "0");
+        mpv_set_property_string(source->mpv, "panscan", "0");
+        if (source->standby_mpv) {
+            mpv_set_property_string(source->standby_mpv, "video-rotate", "0");
+            mpv_set_property_string(source->standby_mpv, "panscan", "0");
+        }
+        media_read_video_size(source);
     }
+}
+
+// Create an mpv instance and render context in m->mpv / m->mpv_gl and queue the
+// pane's inputs. Both decks of a dual-deck pane share the wakeup eventfd.
+static void media_create_deck(media_ctx *m, const options_t *opt, const pane_media_config *pane_media, bool debug,
+                              bool dual_deck, bool standby) {
     m->mpv = mpv_create();
     if (!m->mpv) {
         fprintf(stderr, "mpv_create failed\n");
@@ -403,6 +807,13 @@ static bool media_init_source(media_ctx *m, const options_t *opt, const pane_med
     const char *glver = (const char *)glGetString(GL_VERSION);
     if (glver && strstr(glver, "OpenGL ES")) mpv_set_option_string(m->mpv, "opengl-es", "yes");
     media_apply_options(m, opt, pane_media);
+    if (dual_deck) {
+        // Entries never advance on their own: the deck pauses on its last frame
+        // and the other deck, already holding the next entry, takes over.
+        mpv_set_option_string(m->mpv, "keep-open", "always");
+        mpv_set_option_string(m->mpv, "prefetch-playlist", "no");
+        if (standby) mpv_set_option_string(m->mpv, "pause", "yes");
+    }
     if (debug) mpv_request_log_messages(m->mpv, "debug");
     if (mpv_initialize(m->mpv) < 0) {
         fprintf(stderr, "mpv_initialize failed\n");
@@ -421,10 +832,59 @@ static bool media_init_source(media_ctx *m, const options_t *opt, const pane_med
         fprintf(stderr, "mpv_render_context_create failed\n");
         exit(1);
     }
-    mpv_render_context_set_update_callback(m->mpv_gl, media_update_wakeup, m);
-    mpv_set_wakeup_callback(m->mpv, media_update_wakeup, m);
+    mpv_render_context_set_update_callback(m->mpv_gl, media_update_wakeup, (void *)(intptr_t)m->wakeup_fd);
+    mpv_set_wakeup_callback(m->mpv, media_update_wakeup, (void *)(intptr_t)m->wakeup_fd);
+    if (dual_deck) mpv_observe_property(m->mpv, 0, "eof-reached", MPV_FORMAT_FLAG);
+    // The OSD line is rebuilt from these instead of being polled per frame.
+    mpv_observe_property(m->mpv, 0, "media-title", MPV_FORMAT_STRING);
+    mpv_observe_property(m->mpv, 0, "pause", MPV_FORMAT_FLAG);
+    mpv_observe_property(m->mpv, 0, "playlist-pos", MPV_FORMAT_INT64);
+    mpv_observe_property(m->mpv, 0, "playlist-count", MPV_FORMAT_INT64);
 
     media_load_inputs_source(m, opt, pane_media);
+}
+
+static bool media_init_source(media_ctx *m, const options_t *opt, const pane_media_config *pane_media, bool debug) {
+    if (!m || !opt) return false;
+    memset(m, 0, sizeof(*m));
+    m->wakeup_fd = -1;
+    m->playlist_fifo_fd = -1;
+    m->playlist_fifo_path = pane_media ? pane_media->playlist_fifo : opt->playlist_fifo;
+    media_share_geometry(m, opt, pane_media);
+
+    if (pane_media) {
+        if (!media_should_use_pane(pane_media)) return false;
+    } else if (!media_should_use(opt)) {
+        return false;
+    }
+    const char *disable_env = getenv("KMS_MPV_DISABLE");
+    if (disable_env && (*disable_env == '1' || *disable_env == 'y' || *disable_env == 'Y')) {
+        fprintf(stderr, "Debug: KMS_MPV_DISABLE set; skipping mpv setup.\n");
+        return false;
+    }
+
+    m->wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m->wakeup_fd < 0) {
+        perror("eventfd");
+        exit(1);
+    }
+    m->tier_user_scalers = media_user_set(opt, pane_media, "scale") || media_user_set(opt, pane_media, "dscale") ||
+                           media_user_set(opt, pane_media, "cscale");
+    m->tier_user_loopfilter = media_user_set(opt, pane_media, "vd-lavc-skiploopfilter");
+    m->tier_user_hls = media_user_set(opt, pane_media, "hls-bitrate");
+    bool dual_deck = pane_media && pane_media->dual_deck;
+    if (dual_deck && opt->shuffle) {
+        fprintf(stderr, "warning: --pane-dual-deck ignored with --shuffle (the decks would shuffle differently)\n");
+        dual_deck = false;
+    }
+    if (dual_deck) {
+        // Built first so the active deck ends up in m->mpv.
+        media_create_deck(m, opt, pane_media, debug, true, true);
+        m->standby_mpv = m->mpv;
+        m->standby_gl = m->mpv_gl;
+    }
+    media_create_deck(m, opt, pane_media, debug, dual_deck, false);
+    media_osd_format(m);
 
     const char *mpv_out_path = pane_media ? pane_media->mpv_out_path : opt->mpv_out_path;
     if (mpv_out_path) {
@@ -449,17 +909,26 @@ bool media_init_pane(media_ctx *m, const options_t *opt, const pane_media_config
 
 void media_shutdown(media_ctx *m) {
     if (!m) return;
+    if (m->mpv) media_account_hidden(m, media_now_ns());
+    if (m->suspend_ns_total || m->suspend_frames_total) {
+        fprintf(stderr, "mpv: decoding suspended for %.1f s off screen, ~%llu frames not decoded\n",
+                (double)m->suspend_ns_total / 1e9, m->suspend_frames_total);
+        m->suspend_ns_total = 0;
+        m->suspend_frames_total = 0;
+    }
     if (m->mpv_gl) mpv_render_context_free(m->mpv_gl);
     m->mpv_gl = NULL;
     if (m->mpv) mpv_terminate_destroy(m->mpv);
     m->mpv = NULL;
+    if (m->standby_gl) mpv_render_context_free(m->standby_gl);
+    m->standby_gl = NULL;
+    if (m->standby_mpv) mpv_terminate_destroy(m->standby_mpv);
+    m->standby_mpv = NULL;
     if (m->mpv_out) fclose(m->mpv_out);
     m->mpv_out = NULL;
     if (m->playlist_fifo_fd >= 0) close(m->playlist_fifo_fd);
     m->playlist_fifo_fd = -1;
     m->playlist_fifo_path = NULL;
-    if (m->wakeup_fd[0] >= 0) close(m->wakeup_fd[0]);
-    if (m->wakeup_fd[1] >= 0) close(m->wakeup_fd[1]);
-    m->wakeup_fd[0] = -1;
-    m->wakeup_fd[1] = -1;
+    if (m->wakeup_fd >= 0) close(m->wakeup_fd);
+    m->wakeup_fd = -1;
 }
@@ -2,6 +2,7 @@
 #define MEDIA_H
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 
 #include <mpv/client.h>
@@ -9,21 +10,98 @@
 
 #include "options.h"
 
+// Decode quality tiers, picked per pane from how far its video is scaled down
+// and from system load (media_update_tier).
+typedef enum {
+    MEDIA_TIER_FULL = 0,
+    MEDIA_TIER_REDUCED,
+    MEDIA_TIER_LOW,
+    MEDIA_TIER_COUNT
+} media_tier;
+
+// Playback state shown on the OSD, kept current from mpv property-change events.
+typedef struct {
+    char title[256];            // media-title, empty while mpv has none
+    int64_t pos, count;         // playlist-pos and playlist-count
+    bool paused;
+} media_osd_state;
+
 typedef struct {
     mpv_handle *mpv;
     mpv_render_context *mpv_gl;
-    int wakeup_fd[2];
+    int wakeup_fd;  // eventfd bumped by mpv wakeup and render-update callbacks
     FILE *mpv_out;
     int playlist_fifo_fd;
     const char *playlist_fifo_path;
+    // Off-screen state (media_set_visible).
+    bool hidden;
+    hidden_video_t hidden_policy;
+    bool hidden_paused;         // pause set by us, undone when shown
+    char hidden_framedrop[32];  // values restored after HIDDEN_VIDEO_SKIP
+    char hidden_vd_framedrop[32];
+    uint64_t hidden_since_ns;   // start of the not yet accounted hidden time
+    double hidden_fps;
+    int64_t hidden_drops;       // decoder-frame-drop-count at hidden_since_ns
+    uint64_t suspend_ns, suspend_ns_total;
+    unsigned long long suspend_frames, suspend_frames_total;
+    // Quality tier state (media_update_tier).
+    media_tier tier;
+    bool tier_stale;            // video size changed since the tier was picked
+    bool tier_user_scalers;     // the user's mpv options own these settings
+    bool tier_user_loopfilter;
+    bool tier_user_hls;
+    char tier_scalers[3][32];   // scale, dscale, cscale as configured
+    // Dual-deck mode (--pane-dual-deck): a second instance holds the next
+    // playlist entry paused on its first frame and takes over at end of file.
+    mpv_handle *standby_mpv;
+    mpv_render_context *standby_gl;
+    bool standby_ready;         // first frame of the cued entry is decoded
+    bool standby_cued;          // the cue's load or seek started; its PLAYBACK_RESTART marks it ready
+    uint64_t last_render_ns;    // latest frame rendered from the active deck
+    uint64_t switch_last_ns;    // outgoing deck's last frame, while a switch is pending
+    // Shared decoding: panes showing the same source sample the frames of the
+    // first such pane instead of running their own mpv instance.
+    bool shared;                // this pane has no decoder of its own
+    int share_pane;             // pane index of the decoding pane when shared
+    int share_count;            // other panes sampling this pane's frames
+    int share_rotate;           // video-rotate and panscan applied by the compositor
+    float share_panscan;
+    int video_w, video_h;       // decoded display size, 0 until known
+    // OSD line of the active deck, rebuilt when an observed property changes.
+    media_osd_state osd, standby_osd;
+    char osd_line[512];
 } media_ctx;
 
 bool media_should_use(const options_t *opt);
 bool media_should_use_pane(const pane_media_config *pane_media);
 bool media_init(media_ctx *m, const options_t *opt, bool debug);
 bool media_init_pane(media_ctx *m, const options_t *opt, const pane_media_config *pane_media, bool debug);
+// True when two panes load the same inputs with the same decode options, so one
+// decoder can feed both. Rotation and panscan may differ.
+bool media_pane_sources_match(const options_t *opt, const pane_media_config *a, const pane_media_config *b);
+// Make m sample the frames of source (pane source_pane) instead of decoding. The
+// source then renders unrotated and uncropped; each pane applies its own
+// rotation and panscan when drawing.
+void media_init_shared(media_ctx *m, media_ctx *source, int source_pane, const options_t *opt,
+                       const pane_media_config *pane_media);
 void media_handle_wakeup(media_ctx *m, bool debug, int *mpv_needs_render);
 void media_handle_playlist_fifo(media_ctx *m, char *pfifo_buf, int *pfifo_len);
+// Follow the pane on and off screen. Off screen, PAUSE pauses playback and picks
+// up at the same frame when shown again, SKIP keeps the clock running but lets
+// the decoder drop everything but keyframes, and RUN keeps decoding. Returns
+// true when the pane has just become visible and its target needs a render.
+bool media_set_visible(media_ctx *m, bool visible, hidden_video_t policy);
+// Re-pick the pane's tier for a w x h target and apply it if it changed. The
+// scalers, frame-rate cap and stream bitrate change at once; skipping the loop
+// filter takes effect when mpv next opens a decoder (next file or loop). Returns
+// true when the tier changed.
+bool media_update_tier(media_ctx *m, int w, int h, bool loaded);
+const char *media_tier_name(media_tier tier);
+// Call after rendering the pane's video; logs the gap across a deck switch.
+void media_note_rendered(media_ctx *m);
+// Time spent paused off screen and frames left undecoded since the last call,
+// the current off-screen stretch included.
+void media_take_suspended(media_ctx *m, uint64_t *suspend_ns, unsigned long long *frames);
 void media_shutdown(media_ctx *m);
 
 #endif
@@ -49,6 +49,25 @@ const char *visibility_mode_name(visibility_mode_t mode) {
     }
 }
 
+hidden_video_t parse_hidden_video(const char *s) {
+    if (!s) return HIDDEN_VIDEO_DEFAULT;
+    if (!strcmp(s, "pause")) return HIDDEN_VIDEO_PAUSE;
+    if (!strcmp(s, "skip")) return HIDDEN_VIDEO_SKIP;
+    if (!strcmp(s, "run")) return HIDDEN_VIDEO_RUN;
+    return HIDDEN_VIDEO_DEFAULT;
+}
+
+const char *hidden_video_name(hidden_video_t mode) {
+    switch (mode) {
+        case HIDDEN_VIDEO_SKIP: return "skip";
+        case HIDDEN_VIDEO_RUN: return "run";
+        case HIDDEN_VIDEO_PAUSE:
+        case HIDDEN_VIDEO_DEFAULT:
+        default:
+            return "pause";
+    }
+}
+
 int parse_layout_mode(const char *s) {
     if (!s) return -1;
     if (!strcmp(s, "stack") || !strcmp(s, "stack3")) return 0;
@@ -179,20 +198,27 @@ static bool options_ensure_pane_capacity(options_t *opt, int pane_count) {
     const char **next = malloc((size_t)pane_count * sizeof(*next));
     if (!next) return false;
     pane_media_config *next_media = malloc((size_t)pane_count * sizeof(*next_media));
-    if (!next_media) {
+    int *next_fps = malloc((size_t)pane_count * sizeof(*next_fps));
+    if (!next_media || !next_fps) {
         free(next);
+        free(next_media);
+        free(next_fps);
         return false;
     }
     if (opt->pane_cmds) memcpy(next, opt->pane_cmds, (size_t)old_cap * sizeof(*next));
     if (opt->pane_media) memcpy(next_media, opt->pane_media, (size_t)old_cap * sizeof(*next_media));
+    if (opt->pane_max_fps) memcpy(next_fps, opt->pane_max_fps, (size_t)old_cap * sizeof(*next_fps));
     free(opt->pane_cmds);
     free(opt->pane_media);
+    free(opt->pane_max_fps);
     opt->pane_cmds = next;
     opt->pane_media = next_media;
+    opt->pane_max_fps = next_fps;
     opt->pane_cap = pane_count;
     for (int i = old_cap; i < pane_count; ++i) {
         opt->pane_cmds[i] = NULL;
         opt->pane_media[i] = (pane_media_config){ .video_rotate = -1 };
+        opt->pane_max_fps[i] = 0;
     }
     return true;
 }
@@ -245,8 +271,10 @@ static void options_promote_legacy_panes(options_t *opt) {
     }
     memmove(&opt->pane_cmds[1], &opt->pane_cmds[0], (size_t)old_count * sizeof(*opt->pane_cmds));
     memmove(&opt->pane_media[1], &opt->pane_media[0], (size_t)old_count * sizeof(*opt->pane_media));
+    memmove(&opt->pane_max_fps[1], &opt->pane_max_fps[0], (size_t)old_count * sizeof(*opt->pane_max_fps));
     opt->pane_cmds[0] = NULL;
     opt->pane_media[0] = (pane_media_config){ .video_rotate = -1 };
+    opt->pane_max_fps[0] = 0;
 }
 
 static bool options_roles_string_has_legacy_hint(const char *roles) {
@@ -267,6 +295,8 @@ static bool options_pane_media_has_payload(const pane_media_config *pane_media)
            pane_media->mpv_out_path != NULL ||
            pane_media->panscan != NULL ||
            pane_media->video_rotate >= 0 ||
+           pane_media->hidden_video != HIDDEN_VIDEO_DEFAULT ||
+           pane_media->dual_deck ||
            pane_media->n_mpv_opts > 0;
 }
 
@@ -344,6 +374,15 @@ bool options_pane_hidden(const options_t *opt, int pane_index) {
     return false;
 }
 
+hidden_video_t options_pane_hidden_video(const options_t *opt, int pane_index) {
+    hidden_video_t mode = HIDDEN_VIDEO_DEFAULT;
+    if (opt && opt->pane_media && pane_index >= 0 && pane_index < opt->pane_count) {
+        mode = opt->pane_media[pane_index].hidden_video;
+    }
+    if (mode == HIDDEN_VIDEO_DEFAULT && opt) mode = opt->hidden_video;
+    return mode == HIDDEN_VIDEO_DEFAULT ? HIDDEN_VIDEO_PAUSE : mode;
+}
+
 void push_video(options_t *opt, const char *path) {
     if (opt->video_count == opt->video_cap) {
         int ncap = opt->video_cap ? opt->video_cap * 2 : 8;
@@ -578,6 +617,8 @@ static void print_usage(const char *exe) {
         "  --mode WxH[@Hz]         Mode like 1920x1080@60. Default: preferred.\n"
         "  --rotate 0|90|180|270   Presentation rotation (affects layout orientation).\n"
         "  --font-size PX          Terminal font pixel size (default 18).\n"
+        "  --term-renderer MODE    Terminal rendering: cpu (default) or atlas (GPU glyph atlas).\n"
+        "  --term-threads          Parse and rasterize each terminal pane on its own thread (cpu renderer).\n"
         "  --right-frac PCT        Right column width percentage (default 33).\n"
         "  --video-frac PCT        Override: video width percentage.\n"
         "  --pane-split PCT        Top row height percentage for split layouts (default 50).\n"
@@ -587,6 +628,8 @@ static void print_usage(const char *exe) {
         "  --pane-c \"CMD\"           Command for Pane C.\n"
         "  --pane-d \"CMD\"           Command for Pane D.\n"
         "  --pane N \"CMD\"           Command for pane index N (1-based).\n"
+        "  --pane-max-fps N FPS     Update terminal pane N at most FPS times a second\n"
+        "                           (output is batched in between; 0 = every frame).\n"
         "  --pane-media N           Make pane index N an mpv/media pane.\n"
         "  --pane-playlist N FILE   Playlist for media pane N.\n"
         "  --pane-playlist-extended N FILE\n"
@@ -599,6 +642,16 @@ static void print_usage(const char *exe) {
         "  --pane-video-rotate N D Per-pane pass-through to mpv video-rotate.\n"
         "  --pane-panscan N VAL    Per-pane pass-through to mpv panscan.\n"
         "  --visibility-mode MODE  Visual pane filter: neither, no-video, or no-terminal.\n"
+        "  --hidden-video MODE     Media panes off screen: pause (default), skip (decode\n"
+        "                           keyframes only) or run (decode, just don't draw).\n"
+        "  --pane-hidden-video N MODE\n"
+        "                           Off-screen policy for media pane N.\n"
+        "  --pane-dual-deck N      Preroll the next playlist entry on a second mpv instance\n"
+        "                           so media pane N switches without a gap.\n"
+        "  --no-video-tiers        Decode every media pane at full quality, however small\n"
+        "                           it is shown or loaded the system is.\n"
+        "  --no-shared-decode      Give every media pane its own decoder, even when\n"
+        "                           several panes play the same source.\n"
         "  --pane-model MODEL      Pane indexing model: unified (default) or legacy.\n"
         "  --split-tree SPEC        Explicit split-tree layout override.\n"
         "  --layout M              stack | row | 2x1 | 1x2 | 2over1 | 1over2 | overlay\n"
@@ -633,6 +686,14 @@ static void print_usage(const char *exe) {
         "  --smooth                Apply a sensible playback preset.\n"
         "  --gl-test               Render a diagnostic GL gradient and exit.\n"
         "  --diag                  Print GL/driver diagnostics and exit.\n"
+        "  --headless WxH[@Hz]     Render offscreen (EGL pbuffer, no DRM/KMS) at a virtual refresh (default 60).\n"
+        "  --bench SEC             Run a synthetic benchmark for SEC seconds and print a JSON report.\n"
+        "  --bench-terms N         Synthetic terminal panes: logs, redraw storm, braille (default 3).\n"
+        "  --bench-videos M        mpv panes playing av://lavfi:testsrc2 (default 1).\n"
+        "  --bench-video WxH[@FPS] Test source size and rate (default 1280x720@30).\n"
+        "  --bench-out FILE        Write the benchmark report to FILE instead of stdout.\n"
+        "  --stats-file FILE       Periodically write per-stage frame timing percentiles as JSON.\n"
+        "  --stats-interval-ms MS  Stats file update interval (default 1000).\n"
         "  --debug                 Verbose logging.\n\n"
         "Defaults and notes:\n"
         "  - OSD is off by default (toggle in Control Mode with 'o').\n"
@@ -663,11 +724,16 @@ int options_parse_cli(options_t *opt, int argc, char **argv, int *debug) {
         fprintf(stderr, "Failed to allocate option storage.\n");
         return 1;
     }
+    opt->bench_terms = -1;
+    opt->bench_videos = -1;
     const char *cfg = NULL;
     for (int i = 1; i < argc; ++i) {
         if (!strcmp(argv[i], "--config") && i + 1 < argc) {
-            cfg = argv[i + 1];
-            break;
+            if (!cfg) cfg = argv[i + 1];
+            ++i;
+        } else if (!strcmp(argv[i], "--no-config") || !strcmp(argv[i], "--bench")) {
+            // Benchmarks must not pick up whatever config happens to be on the box.
+            opt->no_config = true;
         }
     }
     if (!cfg) {
@@ -714,10 +780,19 @@ int options_parse_cli(options_t *opt, int argc, char **argv, int *debug) {
         else if (!strcmp(argv[i], "--playlist-extended") && i + 1 < argc) opt->playlist_ext = argv[++i];
         else if (!strcmp(argv[i], "--playlist-fifo") && i + 1 < argc) opt->playlist_fifo = argv[++i];
         else if (!strcmp(argv[i], "--mpv-out") && i + 1 < argc) opt->mpv_out_path = argv[++i];
+        else if (!strcmp(argv[i], "--stats-file") && i + 1 < argc) opt->stats_path = argv[++i];
+        else if (!strcmp(argv[i], "--stats-interval-ms") && i + 1 < argc) opt->stats_interval_ms = atoi(argv[++i]);
         else if (!strcmp(argv[i], "--connector") && i + 1 < argc) opt->connector_opt = argv[++i];
         else if (!strcmp(argv[i], "--mode") && i + 1 < argc) parse_mode(argv[++i], &opt->mode_w, &opt->mode_h, &opt->mode_hz);
         else if (!strcmp(argv[i], "--rotate") && i + 1 < argc) opt->rotation = parse_rot(argv[++i]);
         else if (!strcmp(argv[i], "--font-size") && i + 1 < argc) opt->font_px = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--term-renderer") && i + 1 < argc) {
+            const char *mode = argv[++i];
+            if (!strcmp(mode, "atlas") || !strcmp(mode, "gpu")) opt->term_atlas = true;
+            else if (!strcmp(mode, "cpu")) opt->term_atlas = false;
+            else fprintf(stderr, "Warning: unknown --term-renderer '%s' (using cpu).\n", mode);
+        }
+        else if (!strcmp(argv[i], "--term-threads")) opt->term_threads = true;
         else if (!strcmp(argv[i], "--right-frac") && i + 1 < argc) opt->right_frac_pct = atoi(argv[++i]);
         else if (!strcmp(argv[i], "--video-frac") && i + 1 < argc) opt->video_frac_pct = atoi(argv[++i]);
         else if (!strcmp(argv[i], "--pane-split") && i + 1 < argc) opt->pane_split_pct = atoi(argv[++i]);
@@ -756,6 +831,19 @@ int options_parse_cli(options_t *opt, int argc, char **argv, int *debug) {
                 opt->pane_cmds[pane_index] = pane_cmd;
             }
         }
+        else if (!strcmp(argv[i], "--pane-max-fps") && i + 2 < argc) {
+            int pane_index = atoi(argv[++i]) - 1;
+            int fps = atoi(argv[++i]);
+            if (pane_index >= 0) {
+                if (pane_index + 1 > opt->pane_count) opt->pane_count = pane_index + 1;
+                if (!options_ensure_pane_capacity(opt, opt->pane_count) ||
+                    !options_ensure_role_capacity(opt, options_role_count(opt))) {
+                    fprintf(stderr, "Failed to allocate pane storage.\n");
+                    return 1;
+                }
+                opt->pane_max_fps[pane_index] = fps > 0 ? fps : 0;
+            }
+        }
         else if (!strcmp(argv[i], "--pane-media") && i + 1 < argc) {
             int pane_index = atoi(argv[++i]) - 1;
             if (pane_index >= 0) {
@@ -866,6 +954,33 @@ int options_parse_cli(options_t *opt, int argc, char **argv, int *debug) {
                 opt->pane_media[pane_index].video_rotate = video_rotate;
             }
         }
+        else if (!strcmp(argv[i], "--pane-hidden-video") && i + 2 < argc) {
+            int pane_index = atoi(argv[++i]) - 1;
+            hidden_video_t hidden_video = parse_hidden_video(argv[++i]);
+            if (pane_index >= 0) {
+                if (pane_index + 1 > opt->pane_count) opt->pane_count = pane_index + 1;
+                if (!options_ensure_pane_capacity(opt, opt->pane_count) ||
+                    !options_ensure_role_capacity(opt, options_role_count(opt))) {
+                    fprintf(stderr, "Failed to allocate pane storage.\n");
+                    return 1;
+                }
+                opt->pane_media[pane_index].enabled = true;
+                opt->pane_media[pane_index].hidden_video = hidden_video;
+            }
+        }
+        else if (!strcmp(argv[i], "--pane-dual-deck") && i + 1 < argc) {
+            int pane_index = atoi(argv[++i]) - 1;
+            if (pane_index >= 0) {
+                if (pane_index + 1 > opt->pane_count) opt->pane_count = pane_index + 1;
+                if (!options_ensure_pane_capacity(opt, opt->pane_count) ||
+                    !options_ensure_role_capacity(opt, options_role_count(opt))) {
+                    fprintf(stderr, "Failed to allocate pane storage.\n");
+                    return 1;
+                }
+                opt->pane_media[pane_index].enabled = true;
+                opt->pane_media[pane_index].dual_deck = true;
+            }
+        }
         else if (!strcmp(argv[i], "--pane-panscan") && i + 2 < argc) {
             int pane_index = atoi(argv[++i]) - 1;
             const char *panscan = argv[++i];
@@ -886,8 +1001,23 @@ int options_parse_cli(options_t *opt, int argc, char **argv, int *debug) {
         else if (!strcmp(argv[i], "--visibility-mode") && i + 1 < argc) {
             opt->visibility_mode = parse_visibility_mode(argv[++i]);
         }
+        else if (!strcmp(argv[i], "--hidden-video") && i + 1 < argc) {
+            opt->hidden_video = parse_hidden_video(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--no-video-tiers")) opt->no_video_tiers = true;
+        else if (!strcmp(argv[i], "--no-shared-decode")) opt->no_shared_decode = true;
         else if (!strcmp(argv[i], "--diag")) opt->diag = true;
         else if (!strcmp(argv[i], "--gl-test")) opt->gl_test = true;
+        else if (!strcmp(argv[i], "--bench") && i + 1 < argc) opt->bench_sec = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--bench-terms") && i + 1 < argc) opt->bench_terms = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--bench-videos") && i + 1 < argc) opt->bench_videos = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--bench-video") && i + 1 < argc) {
+            parse_mode(argv[++i], &opt->bench_video_w, &opt->bench_video_h, &opt->bench_video_fps);
+        }
+        else if (!strcmp(argv[i], "--bench-out") && i + 1 < argc) opt->bench_out = argv[++i];
+        else if (!strcmp(argv[i], "--headless") && i + 1 < argc) {
+            parse_mode(argv[++i], &opt->headless_w, &opt->headless_h, &opt->headless_hz);
+        }
         else if (!strcmp(argv[i], "--no-config")) opt->no_config = true;
         else if (!strcmp(argv[i], "--smooth")) opt->smooth = true;
         else if (!strcmp(argv[i], "--split-tree") && i + 1 < argc) opt->split_tree_spec = argv[++i];
@@ -1002,6 +1132,8 @@ void save_config(const options_t *opt, const char *path) {
     if (opt->mode_w || opt->mode_h) fprintf(f, "--mode %dx%d@%d\n", opt->mode_w, opt->mode_h, opt->mode_hz);
     if (opt->rotation) fprintf(f, "--rotate %d\n", (int)opt->rotation);
     if (opt->font_px) fprintf(f, "--font-size %d\n", opt->font_px);
+    if (opt->term_atlas) fprintf(f, "--term-renderer atlas\n");
+    if (opt->term_threads) fprintf(f, "--term-threads\n");
     const char *lay_str = layout_mode_name(opt->layout_mode);
     fprintf(f, "--layout %s\n", lay_str);
     if (opt->split_tree_spec && *opt->split_tree_spec) fprintf(f, "--split-tree '%s'\n", opt->split_tree_spec);
@@ -1020,6 +1152,9 @@ void save_config(const options_t *opt, const char *path) {
         if (!opt->pane_cmds[i]) continue;
         fprintf(f, "--pane %d '%s'\n", i + 1, opt->pane_cmds[i]);
     }
+    for (int i = 0; i < opt->pane_count; ++i) {
+        if (opt->pane_max_fps[i] > 0) fprintf(f, "--pane-max-fps %d %d\n", i + 1, opt->pane_max_fps[i]);
+    }
     for (int i = 0; i < opt->pane_count; ++i) {
         const pane_media_config *pm = &opt->pane_media[i];
         if (!pm->enabled) continue;
@@ -1030,12 +1165,21 @@ void save_config(const options_t *opt, const char *path) {
         if (pm->mpv_out_path) fprintf(f, "--pane-mpv-out %d '%s'\n", i + 1, pm->mpv_out_path);
         if (pm->video_rotate >= 0) fprintf(f, "--pane-video-rotate %d %d\n", i + 1, pm->video_rotate);
         if (pm->panscan) fprintf(f, "--pane-panscan %d '%s'\n", i + 1, pm->panscan);
+        if (pm->hidden_video != HIDDEN_VIDEO_DEFAULT) {
+            fprintf(f, "--pane-hidden-video %d %s\n", i + 1, hidden_video_name(pm->hidden_video));
+        }
+        if (pm->dual_deck) fprintf(f, "--pane-dual-deck %d\n", i + 1);
         for (int vi = 0; vi < pm->video_count; ++vi) fprintf(f, "--pane-video %d '%s'\n", i + 1, pm->videos[vi].path);
         for (int oi = 0; oi < pm->n_mpv_opts; ++oi) fprintf(f, "--pane-mpv-opt %d '%s'\n", i + 1, pm->mpv_opts[oi]);
     }
     if (opt->visibility_mode != VISIBILITY_MODE_NEITHER) {
         fprintf(f, "--visibility-mode %s\n", visibility_mode_name(opt->visibility_mode));
     }
+    if (opt->hidden_video != HIDDEN_VIDEO_DEFAULT) {
+        fprintf(f, "--hidden-video %s\n", hidden_video_name(opt->hidden_video));
+    }
+    if (opt->no_video_tiers) fprintf(f, "--no-video-tiers\n");
+    if (opt->no_shared_decode) fprintf(f, "--no-shared-decode\n");
     if (opt->no_video) fprintf(f, "--no-video\n");
     if (opt->shuffle) fprintf(f, "--shuffle\n");
     for (int i = 0; i < opt->n_mpv_opts; i++) fprintf(f, "--mpv-opt '%s'\n", opt->mpv_opts[i]);
@@ -1043,6 +1187,8 @@ void save_config(const options_t *opt, const char *path) {
     if (opt->playlist_ext) fprintf(f, "--playlist-extended '%s'\n", opt->playlist_ext);
     if (opt->playlist_fifo) fprintf(f, "--playlist-fifo '%s'\n", opt->playlist_fifo);
     if (opt->mpv_out_path) fprintf(f, "--mpv-out '%s'\n", opt->mpv_out_path);
+    if (opt->stats_path) fprintf(f, "--stats-file '%s'\n", opt->stats_path);
+    if (opt->stats_interval_ms) fprintf(f, "--stats-interval-ms %d\n", opt->stats_interval_ms);
     for (int i = 0; i < opt->video_count; i++) {
         const video_item *vi = &opt->videos[i];
         fprintf(f, "--video '%s'\n", vi->path);
@@ -1051,6 +1197,32 @@ void save_config(const options_t *opt, const char *path) {
     fclose(f);
 }
 
+// Drop every configured pane, root video source and layout override, leaving
+// pane_count empty panes for a caller that builds its own scene (e.g. --bench).
+bool options_reset_panes(options_t *opt, int pane_count) {
+    if (pane_count < 1) pane_count = 1;
+    if (!options_ensure_pane_capacity(opt, pane_count) || !options_ensure_role_capacity(opt, pane_count)) return false;
+    for (int i = 0; i < opt->pane_cap; ++i) {
+        free(opt->pane_media[i].videos);
+        free(opt->pane_media[i].mpv_opts);
+        opt->pane_media[i] = (pane_media_config){ .video_rotate = -1 };
+        opt->pane_cmds[i] = NULL;
+        opt->pane_max_fps[i] = 0;
+    }
+    for (int i = 0; i < opt->role_cap; ++i) opt->roles[i] = i;
+    opt->pane_count = pane_count;
+    opt->pane_a_cmd = opt->pane_b_cmd = opt->pane_c_cmd = opt->pane_d_cmd = NULL;
+    opt->video_path = NULL;
+    opt->video_count = 0;
+    opt->playlist_path = opt->playlist_ext = opt->playlist_fifo = NULL;
+    opt->mpv_out_path = NULL;
+    opt->split_tree_spec = NULL;
+    opt->roles_set = false;
+    opt->no_panes = false;
+    opt->no_video = false;
+    return true;
+}
+
 void options_destroy(options_t *opt) {
     if (!opt) return;
     free(opt->pane_cmds);
@@ -1061,9 +1233,11 @@ void options_destroy(options_t *opt) {
         }
     }
     free(opt->pane_media);
+    free(opt->pane_max_fps);
     free(opt->roles);
     opt->pane_cmds = NULL;
     opt->pane_media = NULL;
+    opt->pane_max_fps = NULL;
     opt->roles = NULL;
     opt->pane_cap = 0;
     opt->role_cap = 0;
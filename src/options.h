@@ -11,6 +11,14 @@ typedef enum {
     VISIBILITY_MODE_NO_VIDEO,
     VISIBILITY_MODE_NO_TERMINAL,
 } visibility_mode_t;
+// What a media pane's decoder does while the pane is off screen. DEFAULT on a
+// pane defers to --hidden-video, and to PAUSE there.
+typedef enum {
+    HIDDEN_VIDEO_DEFAULT = 0,
+    HIDDEN_VIDEO_PAUSE,
+    HIDDEN_VIDEO_SKIP,
+    HIDDEN_VIDEO_RUN,
+} hidden_video_t;
 
 enum {
     KMS_MOSAIC_DEFAULT_PANE_COUNT = 2,
@@ -40,6 +48,8 @@ typedef struct {
     const char *mpv_out_path;
     const char *panscan;
     int video_rotate;
+    hidden_video_t hidden_video;
+    bool dual_deck;
     const char **mpv_opts;
     int n_mpv_opts;
     int cap_mpv_opts;
@@ -63,6 +73,7 @@ typedef struct {
     const char *split_tree_spec;
     const char **pane_cmds;
     pane_media_config *pane_media;
+    int *pane_max_fps; // terminal update rate cap per pane, 0 = every frame
     int pane_cap;
     const char *pane_a_cmd;
     const char *pane_b_cmd;
@@ -73,8 +84,17 @@ typedef struct {
     bool no_video;
     bool no_panes;
     visibility_mode_t visibility_mode;
+    hidden_video_t hidden_video;
+    bool no_video_tiers;
+    bool no_shared_decode;
     bool gl_test;
     bool diag;
+    int headless_w, headless_h, headless_hz;
+    int bench_sec;
+    int bench_terms;
+    int bench_videos;
+    int bench_video_w, bench_video_h, bench_video_fps;
+    const char *bench_out;
     bool loop_file;
     bool loop_playlist;
     bool shuffle;
@@ -86,6 +106,8 @@ typedef struct {
     bool smooth;
     bool atomic_nonblock;
     bool gl_finish;
+    bool term_atlas;
+    bool term_threads;
     bool use_atomic;
     int layout_mode;
     int fs_cycle_sec;
@@ -101,12 +123,18 @@ typedef struct {
     bool save_config_default;
     const char *mpv_out_path;
     const char *playlist_fifo;
+    const char *stats_path;
+    int stats_interval_ms;
 } options_t;
 
 void parse_mode(const char *s, int *w, int *h, int *hz);
 rotation_t parse_rot(const char *s);
 visibility_mode_t parse_visibility_mode(const char *s);
 const char *visibility_mode_name(visibility_mode_t mode);
+hidden_video_t parse_hidden_video(const char *s);
+const char *hidden_video_name(hidden_video_t mode);
+// The policy in effect for a pane, per-pane setting first.
+hidden_video_t options_pane_hidden_video(const options_t *opt, int pane_index);
 int parse_layout_mode(const char *s);
 const char *layout_mode_name(int mode);
 bool parse_roles_string(const char *s, int *roles, int role_count);
@@ -120,6 +148,7 @@ void parse_playlist_ext(options_t *opt, const char *file);
 void mpv_append_line(mpv_handle *mpv, const char *line);
 char **tokenize_file(const char *path, int *argc_out);
 int options_parse_cli(options_t *opt, int argc, char **argv, int *debug);
+bool options_reset_panes(options_t *opt, int pane_count);
 void options_destroy(options_t *opt);
 const char *default_config_path(void);
 void save_config(const options_t *opt, const char *path);
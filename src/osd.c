@@ -1,6 +1,6 @@
 #define _GNU_SOURCE
 #include "osd.h"
-#include "font_util.h"
+#include "glyph_cache.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -9,20 +9,20 @@
 #include <EGL/egl.h>
 #include <GLES2/gl2.h>
 
-#include <fontconfig/fontconfig.h>
-#include <ft2build.h>
-#include FT_FREETYPE_H
-
 typedef struct {
-    FT_Library ftlib;
-    FT_Face face;
+    glyph_font *face; // shared with the terminal panes (glyph_cache.c)
+    glyph_scratch scratch;
     int px_size;
     int baseline;
 } font_ctx;
 
 struct osd_ctx {
     font_ctx font;
-    char *text;
+    char *text; size_t text_cap; bool has_text;
+    // Grow-only wrap/raster buffers; the texture is only rebuilt when the text or wrap width changes.
+    char *wrapped; size_t wrapped_cap;
+    unsigned char *rgba; size_t rgba_cap;
+    bool tex_valid; int tex_wrap_w;
     GLuint tex; int tw, th; // texture of rendered text
 };
 
@@ -32,109 +32,143 @@ static void die_local(const char *msg) {
 }
 
 static void font_init(font_ctx *f, int px_size) {
-    if (FT_Init_FreeType(&f->ftlib)) die_local("FT_Init_FreeType");
-    char *path = kms_font_find_monospace();
-    if (!path) die_local("fontconfig monospace not found");
-    if (FT_New_Face(f->ftlib, path, 0, &f->face)) die_local("FT_New_Face");
-    free(path);
-    FT_Set_Pixel_Sizes(f->face, 0, px_size);
+    f->face = glyph_font_acquire(px_size);
+    if (!f->face) die_local("no monospace font");
     f->px_size = px_size;
-    f->baseline = (f->face->size->metrics.ascender + 31) / 64;
+    glyph_font_metrics(f->face, NULL, &f->baseline);
 }
 
 static void font_destroy(font_ctx *f) {
-    if (f->face) FT_Done_Face(f->face);
-    if (f->ftlib) FT_Done_FreeType(f->ftlib);
+    glyph_scratch_free(&f->scratch);
+    glyph_font_release(f->face);
+}
+
+static const glyph_bitmap *font_glyph(font_ctx *f, unsigned char ch) {
+    return glyph_cache_get(f->face, ch, &f->scratch);
+}
+
+static bool osd_reserve(void **buf, size_t *cap, size_t need) {
+    if (need <= *cap) return true;
+    size_t next = *cap ? *cap : 64;
+    while (next < need) next *= 2;
+    void *grown = realloc(*buf, next);
+    if (!grown) return false;
+    *buf = grown; *cap = next;
+    return true;
 }
 
-static void render_text_to_rgba(font_ctx *f, const char *text, unsigned char **out, int *w, int *h) {
+static bool render_text_to_rgba(font_ctx *f, const char *text, unsigned char **buf, size_t *cap, int *w, int *h) {
     // First pass: measure
     int pen_x = 0; int max_w = 0; int line_h = f->px_size + 6; int lines = 1;
     for (const unsigned char *p=(const unsigned char*)text; *p; ++p) {
         if (*p=='\n'){ if (pen_x>max_w) max_w=pen_x; pen_x=0; lines++; continue; }
-        if (FT_Load_Char(f->face, *p, FT_LOAD_RENDER)) continue;
-        pen_x += (f->face->glyph->advance.x + 31)/64;
+        const glyph_bitmap *g = font_glyph(f, *p);
+        if (!g) continue;
+        pen_x += g->advance;
     }
     if (pen_x>max_w) max_w=pen_x;
     *w = max_w ? max_w : 1; *h = lines * line_h;
-    size_t sz = (size_t)(*w) * (*h) * 4; unsigned char *buf = calloc(sz,1);
+    size_t sz = (size_t)(*w) * (*h) * 4;
+    if (!osd_reserve((void **)buf, cap, sz)) return false;
+    memset(*buf, 0, sz);
     // Second pass: render
     int x=0,y=0; for (const unsigned char *p=(const unsigned char*)text; *p; ++p){
         if (*p=='\n'){ x=0; y+=line_h; continue; }
-        if (FT_Load_Char(f->face, *p, FT_LOAD_RENDER)) continue;
-        FT_GlyphSlot g = f->face->glyph;
-        int gx = x + g->bitmap_left;
-        int gy = y + f->baseline - g->bitmap_top;
-        for (int yy=0; yy<(int)g->bitmap.rows; yy++){
+        const glyph_bitmap *g = font_glyph(f, *p);
+        if (!g) continue;
+        int gx = x + g->bearing_x;
+        int gy = y + f->baseline - g->bearing_y;
+        for (int yy=0; yy<g->h; yy++){
             int py = gy + yy; if (py<0 || py>=*h) continue;
-            for (int xx=0; xx<(int)g->bitmap.width; xx++){
+            for (int xx=0; xx<g->w; xx++){
                 int px = gx + xx; if (px<0 || px>=*w) continue;
-                unsigned char a = g->bitmap.buffer[yy*g->bitmap.width + xx];
-                unsigned char *dst = &buf[(size_t)(py * (*w) + px) * 4];
+                unsigned char a = g->bitmap[yy*g->w + xx];
+                unsigned char *dst = &(*buf)[(size_t)(py * (*w) + px) * 4];
                 // white text with alpha
                 dst[0] = 255; dst[1] = 255; dst[2] = 255; dst[3] = a;
             }
         }
-        x += (g->advance.x + 31)/64;
+        x += g->advance;
     }
-    *out = buf;
+    return true;
 }
 
-static int glyph_advance_px(font_ctx *f, unsigned char ch){ if (FT_Load_Char(f->face, ch, FT_LOAD_RENDER)) return f->px_size/2; return (f->face->glyph->advance.x + 31)/64; }
+static int glyph_advance_px(font_ctx *f, unsigned char ch){ const glyph_bitmap *g = font_glyph(f, ch); return g ? g->advance : f->px_size/2; }
 
-static char* wrap_text_to_width(font_ctx *f, const char *text, int max_width_px){
-    if (!text || max_width_px <= 0) return strdup(text?text:"");
-    size_t cap = strlen(text) * 2 + 64; char *out = malloc(cap); size_t oi=0;
+// Every word gains at most one break and spaces are replaced in place, so the
+// output never exceeds 2*len+1 bytes and can be reserved up front.
+static bool wrap_text_to_width(font_ctx *f, const char *text, int max_width_px, char **buf, size_t *cap){
+    size_t len = strlen(text);
+    if (!osd_reserve((void **)buf, cap, len * 2 + 1)) return false;
+    char *out = *buf; size_t oi=0;
+    if (max_width_px <= 0) { memcpy(out, text, len + 1); return true; }
     int line_w = 0;
     for (size_t i=0; text[i]; ){
-        if (text[i]=='\n'){ if (oi+1>=cap){cap*=2; out=realloc(out,cap);} out[oi++]='\n'; i++; line_w=0; continue; }
+        if (text[i]=='\n'){ out[oi++]='\n'; i++; line_w=0; continue; }
         // measure next word (including following space if present)
         int word_w = 0; size_t j=i; while (text[j] && text[j]!=' ' && text[j]!='\n'){ word_w += glyph_advance_px(f, (unsigned char)text[j]); j++; }
         int space_w = 0; int has_space = 0; if (text[j]==' '){ space_w = glyph_advance_px(f, ' '); has_space = 1; }
         if (line_w>0 && line_w + word_w > max_width_px){
             // wrap before word
-            if (oi+1>=cap){cap*=2; out=realloc(out,cap);} out[oi++]='\n'; line_w = 0;
+            out[oi++]='\n'; line_w = 0;
         }
         // copy word
-        while (i<j){ if (oi+1>=cap){cap*=2; out=realloc(out,cap);} out[oi++] = text[i++]; }
+        while (i<j){ out[oi++] = text[i++]; }
         line_w += word_w;
         // copy single space if any and doesn't overflow too badly
-        if (has_space){ if (line_w + space_w > max_width_px){ if (oi+1>=cap){cap*=2; out=realloc(out,cap);} out[oi++]='\n'; line_w=0; }
-            else { if (oi+1>=cap){cap*=2; out=realloc(out,cap);} out[oi++]=' '; line_w += space_w; j++; i=j; }
+        if (has_space){ if (line_w + space_w > max_width_px){ out[oi++]='\n'; line_w=0; }
+            else { out[oi++]=' '; line_w += space_w; j++; i=j; }
         }
     }
-    if (oi+1>=cap){cap*=2; out=realloc(out,cap);} out[oi]='\0'; return out;
+    out[oi]='\0'; return true;
 }
 
 osd_ctx* osd_create(int font_px){ osd_ctx* o = calloc(1,sizeof *o); font_init(&o->font, font_px>0?font_px:20); glGenTextures(1,&o->tex); return o; }
-void osd_destroy(osd_ctx* o){ if(!o) return; if(o->tex) glDeleteTextures(1,&o->tex); free(o->text); font_destroy(&o->font); free(o);} 
+void osd_destroy(osd_ctx* o){ if(!o) return; if(o->tex) glDeleteTextures(1,&o->tex); free(o->text); free(o->wrapped); free(o->rgba); font_destroy(&o->font); free(o);} 
 
-void osd_set_text(osd_ctx* o, const char *text){ if(!o) return; free(o->text); o->text = text?strdup(text):NULL; }
+void osd_set_text(osd_ctx* o, const char *text){
+    if(!o) return;
+    if (!text) { o->has_text = false; return; }
+    if (o->has_text && !strcmp(o->text, text)) return;
+    size_t len = strlen(text);
+    if (!osd_reserve((void **)&o->text, &o->text_cap, len + 1)) { o->has_text = false; return; }
+    memcpy(o->text, text, len + 1);
+    o->has_text = true;
+    o->tex_valid = false;
+}
 
 static GLuint osd_prog=0, osd_vbo=0; static GLint osd_u_tex=-1;
 static GLuint compile_shader_dbg(GLenum type, const char *src){ GLuint s=glCreateShader(type); glShaderSource(s,1,&src,NULL); glCompileShader(s); GLint ok; glGetShaderiv(s,GL_COMPILE_STATUS,&ok); if(!ok){ char log[512]; GLsizei ln=0; glGetShaderInfoLog(s,sizeof log,&ln,log); fprintf(stderr,"osd shader compile failed (%s): %.*s\nSource:\n%.*s\n", type==GL_VERTEX_SHADER?"vertex":"fragment", ln, log, 200, src); exit(1);} return s; }
 static void ensure_prog(void){ if(osd_prog) return; const char* vs="#version 100\n#ifdef GL_ES\nprecision mediump float;\nprecision mediump int;\n#endif\nattribute vec2 a_pos; attribute vec2 a_uv; varying vec2 v_uv; void main(){ v_uv=a_uv; gl_Position=vec4(a_pos,0,1);}"; const char* fs="#version 100\nprecision mediump float; varying vec2 v_uv; uniform sampler2D u_tex; void main(){ gl_FragColor=texture2D(u_tex,v_uv);}"; GLuint v=compile_shader_dbg(GL_VERTEX_SHADER,vs), f=compile_shader_dbg(GL_FRAGMENT_SHADER,fs); osd_prog=glCreateProgram(); glAttachShader(osd_prog,v); glAttachShader(osd_prog,f); glBindAttribLocation(osd_prog,0,"a_pos"); glBindAttribLocation(osd_prog,1,"a_uv"); glLinkProgram(osd_prog); osd_u_tex=glGetUniformLocation(osd_prog,"u_tex"); glGenBuffers(1,&osd_vbo);} 
 
-void osd_draw(osd_ctx* o, int x, int y, int fb_w, int fb_h){
-    if(!o||!o->text) return;
+bool osd_layout(osd_ctx* o, int x, const render_view *view, int *w_out, int *h_out){
+    if(!o||!o->has_text) return false;
+    int max_w = view->logical_w - x - 16; if (max_w < o->font.px_size*8) max_w = o->font.px_size*8;
+    if (!o->tex_valid || o->tex_wrap_w != max_w) {
+        int w=0,h=0;
+        if (!wrap_text_to_width(&o->font, o->text, max_w, &o->wrapped, &o->wrapped_cap)) return false;
+        if (!render_text_to_rgba(&o->font, o->wrapped, &o->rgba, &o->rgba_cap, &w, &h)) return false;
+        if(w<=0||h<=0) return false;
+        glBindTexture(GL_TEXTURE_2D, o->tex);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexImage2D(GL_TEXTURE_2D,0,GL_RGBA,w,h,0,GL_RGBA,GL_UNSIGNED_BYTE,o->rgba);
+        o->tw = w; o->th = h;
+        o->tex_valid = true; o->tex_wrap_w = max_w;
+    }
+    *w_out = o->tw; *h_out = o->th;
+    return true;
+}
+
+void osd_draw(osd_ctx* o, int x, int y, const render_view *view){
+    int w=0,h=0;
+    if(!osd_layout(o, x, view, &w, &h)) return;
     ensure_prog();
-    unsigned char *rgba=NULL; int w=0,h=0;
-    int max_w = fb_w - x - 16; if (max_w < o->font.px_size*8) max_w = o->font.px_size*8;
-    char *wrapped = wrap_text_to_width(&o->font, o->text, max_w);
-    render_text_to_rgba(&o->font, wrapped, &rgba, &w, &h);
-    free(wrapped);
-    if(w<=0||h<=0){ free(rgba); return; }
-    glBindTexture(GL_TEXTURE_2D, o->tex);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-    glTexImage2D(GL_TEXTURE_2D,0,GL_RGBA,w,h,0,GL_RGBA,GL_UNSIGNED_BYTE,rgba);
-    free(rgba);
-    float L = (2.0f * x / fb_w) - 1.0f; float R = (2.0f * (x + w) / fb_w) - 1.0f;
-    float T = 1.0f - (2.0f * y / fb_h); float B = 1.0f - (2.0f * (y + h) / fb_h);
-    float verts[] = { L,B, 0,0,  R,B, 1,0,  R,T, 1,1,  L,B, 0,0,  R,T, 1,1,  L,T, 0,1 };
+    float verts[24];
+    render_view_quad(view, (float)x, (float)y, (float)w, (float)h, 0.f, 0.f, 1.f, 1.f, verts);
     glUseProgram(osd_prog);
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, o->tex);
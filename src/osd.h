@@ -1,6 +1,8 @@
 #pragma once
 #include <stdbool.h>
 
+#include "render_view.h"
+
 typedef struct osd_ctx osd_ctx;
 
 // Create OSD with given pixel font size
@@ -10,6 +12,10 @@ void osd_destroy(osd_ctx* o);
 // Set text content to display (UTF-8)
 void osd_set_text(osd_ctx* o, const char *text);
 
-// Draw at pixel position (x,y) in the logical render target of size (fb_w, fb_h)
-void osd_draw(osd_ctx* o, int x, int y, int fb_w, int fb_h);
+// Lay the text out for drawing at x in view and report its size in logical
+// pixels; false when there is nothing to draw
+bool osd_layout(osd_ctx* o, int x, const render_view *view, int *w, int *h);
+
+// Draw at logical pixel position (x,y), mapped onto the bound framebuffer by view
+void osd_draw(osd_ctx* o, int x, int y, const render_view *view);
 
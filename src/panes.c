@@ -35,27 +35,38 @@ static const char *panes_slot_name(int slot) {
     }
 }
 
+static bool panes_font_fits(int px, const pane_layout *lay, int min_cols, int min_rows,
+                            int *cell_w, int *cell_h) {
+    if (!term_measure_cell(px, cell_w, cell_h)) return false;
+    return lay->w / *cell_w >= min_cols && lay->h / *cell_h >= min_rows;
+}
+
+// Cell metrics grow monotonically with pixel size, so the largest size that still
+// fits min_cols x min_rows can be binary searched over the memoized metrics table.
 static int panes_fit_font_px(int requested, const pane_layout *lay, int min_cols, int min_rows,
                              int *cell_w, int *cell_h) {
     int font_px = requested;
     *cell_w = 8;
     *cell_h = 16;
     term_measure_cell(font_px, cell_w, cell_h);
-    for (int px = font_px; px >= 10; --px) {
-        int cw, ch;
-        if (!term_measure_cell(px, &cw, &ch)) break;
-        int cols_fit = lay->w / cw;
-        int rows_fit = lay->h / ch;
-        if (cols_fit >= min_cols && rows_fit >= min_rows) {
-            font_px = px;
-            *cell_w = cw;
-            *cell_h = ch;
-            break;
-        }
-        if (px == 10) {
-            font_px = px;
+    if (requested < 10) return font_px;
+
+    int cw, ch;
+    if (!term_measure_cell(10, &cw, &ch)) return font_px;
+    font_px = 10;
+    *cell_w = cw;
+    *cell_h = ch;
+    int lo = 10;
+    int hi = requested;
+    while (lo <= hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (panes_font_fits(mid, lay, min_cols, min_rows, &cw, &ch)) {
+            font_px = mid;
             *cell_w = cw;
             *cell_h = ch;
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
         }
     }
     return font_px;
@@ -79,6 +90,8 @@ void panes_create(pane_runtime *panes, const options_t *opt, const pane_layout *
     int *font_sizes = calloc((size_t)panes->count, sizeof(*font_sizes));
     if (!font_sizes) return;
     panes->count = opt->pane_count;
+    term_pane_set_render_mode(opt->term_atlas ? TERM_RENDER_ATLAS : TERM_RENDER_CPU);
+    term_pane_set_threaded(opt->term_threads);
 
     panes_compute_font_sizes(opt, layouts, panes->count, font_sizes);
     for (int i = 0; i < panes->count; ++i) {
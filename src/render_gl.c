@@ -1,6 +1,7 @@
 #include "render_gl.h"
 
 #include <errno.h>
+#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -29,28 +30,30 @@ void render_gl_check(bool debug, const char *stage) {
     }
 }
 
-void render_gl_draw_border_rect(int x, int y, int w, int h, int thickness, int fb_w, int fb_h,
+static void render_gl_scissor_view(const render_view *view, int x, int y, int w, int h) {
+    int sx = 0, sy = 0, sw = 0, sh = 0;
+    render_view_rect(view, x, y, w, h, &sx, &sy, &sw, &sh);
+    glScissor(sx, sy, sw, sh);
+}
+
+void render_gl_draw_border_rect(int x, int y, int w, int h, int thickness, const render_view *view,
                                 float r, float g, float b, float a) {
-    (void)fb_w;
     if (w <= 0 || h <= 0 || thickness <= 0) return;
     if (thickness > w / 2) thickness = w / 2;
     if (thickness > h / 2) thickness = h / 2;
+    if (x < 0) x = 0;
+    if (y < 0) y = 0;
     glEnable(GL_SCISSOR_TEST);
     glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
     glClearColor(r, g, b, a);
 
-    int sx = x;
-    int sy = fb_h - (y + h);
-    if (sx < 0) sx = 0;
-    if (sy < 0) sy = 0;
-
-    glScissor(sx, sy + h - thickness, w, thickness);
+    render_gl_scissor_view(view, x, y, w, thickness);
     glClear(GL_COLOR_BUFFER_BIT);
-    glScissor(sx, sy, w, thickness);
+    render_gl_scissor_view(view, x, y + h - thickness, w, thickness);
     glClear(GL_COLOR_BUFFER_BIT);
-    glScissor(sx, sy, thickness, h);
+    render_gl_scissor_view(view, x, y, thickness, h);
     glClear(GL_COLOR_BUFFER_BIT);
-    glScissor(sx + w - thickness, sy, thickness, h);
+    render_gl_scissor_view(view, x + w - thickness, y, thickness, h);
     glClear(GL_COLOR_BUFFER_BIT);
     glDisable(GL_SCISSOR_TEST);
 }
@@ -170,6 +173,7 @@ void render_gl_ensure_rt(render_gl_ctx *ctx, int w, int h) {
         exit(1);
     }
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    ctx->rt_valid = false;
 }
 
 void render_gl_ensure_video_rt(render_gl_ctx *ctx, int w, int h) {
@@ -234,7 +238,15 @@ GLuint render_gl_pane_video_tex(const render_gl_ctx *ctx, int pane_index) {
     return ctx->pane_vid_texs[pane_index];
 }
 
-void render_gl_blit_rt_to_screen(render_gl_ctx *ctx, rotation_t rot) {
+void render_gl_pane_video_size(const render_gl_ctx *ctx, int pane_index, int *w, int *h) {
+    *w = 0;
+    *h = 0;
+    if (!ctx || pane_index < 0 || pane_index >= ctx->pane_vid_cap) return;
+    *w = ctx->pane_vid_ws[pane_index];
+    *h = ctx->pane_vid_hs[pane_index];
+}
+
+static void render_gl_bind_rt_blit(render_gl_ctx *ctx, rotation_t rot) {
     render_gl_ensure_blit_prog(ctx);
     glUseProgram(ctx->blit_prog);
     glActiveTexture(GL_TEXTURE0);
@@ -260,9 +272,116 @@ void render_gl_blit_rt_to_screen(render_gl_ctx *ctx, rotation_t rot) {
     glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void *)0);
     glEnableVertexAttribArray(1);
     glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void *)(2 * sizeof(float)));
+}
+
+void render_gl_blit_rt_to_screen(render_gl_ctx *ctx, rotation_t rot) {
+    render_gl_bind_rt_blit(ctx, rot);
     glDrawArrays(GL_TRIANGLES, 0, 6);
 }
 
+// Same fullscreen quad as render_gl_blit_rt_to_screen, scissored to each damaged screen rect.
+void render_gl_blit_rt_region_to_screen(render_gl_ctx *ctx, rotation_t rot, const render_gl_damage *region) {
+    if (!region || region->full) {
+        render_gl_blit_rt_to_screen(ctx, rot);
+        return;
+    }
+    if (region->count <= 0) return;
+    render_gl_bind_rt_blit(ctx, rot);
+    glEnable(GL_SCISSOR_TEST);
+    for (int i = 0; i < region->count; ++i) {
+        const render_gl_rect *r = &region->rects[i];
+        glScissor(r->x, r->y, r->w, r->h);
+        glDrawArrays(GL_TRIANGLES, 0, 6);
+    }
+    glDisable(GL_SCISSOR_TEST);
+}
+
+void render_gl_clear_rect(const render_view *view, int x, int y, int w, int h, float r, float g, float b, float a) {
+    if (w <= 0 || h <= 0) return;
+    glEnable(GL_SCISSOR_TEST);
+    render_gl_scissor_view(view, x, y, w, h);
+    glClearColor(r, g, b, a);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glDisable(GL_SCISSOR_TEST);
+}
+
+void render_gl_damage_reset(render_gl_damage *dmg) {
+    dmg->count = 0;
+    dmg->full = false;
+}
+
+void render_gl_damage_add_rect(render_gl_damage *dmg, int x, int y, int w, int h) {
+    if (dmg->full || w <= 0 || h <= 0) return;
+    for (int i = 0; i < dmg->count; ++i) {
+        const render_gl_rect *r = &dmg->rects[i];
+        if (x >= r->x && y >= r->y && x + w <= r->x + r->w && y + h <= r->y + r->h) return;
+    }
+    if (dmg->count < RENDER_GL_MAX_DAMAGE_RECTS) {
+        dmg->rects[dmg->count++] = (render_gl_rect){.x = x, .y = y, .w = w, .h = h};
+        return;
+    }
+    // Out of slots: collapse everything into one bounding box rather than dropping damage.
+    int x0 = x, y0 = y, x1 = x + w, y1 = y + h;
+    for (int i = 0; i < dmg->count; ++i) {
+        const render_gl_rect *r = &dmg->rects[i];
+        if (r->x < x0) x0 = r->x;
+        if (r->y < y0) y0 = r->y;
+        if (r->x + r->w > x1) x1 = r->x + r->w;
+        if (r->y + r->h > y1) y1 = r->y + r->h;
+    }
+    dmg->rects[0] = (render_gl_rect){.x = x0, .y = y0, .w = x1 - x0, .h = y1 - y0};
+    dmg->count = 1;
+}
+
+// Records a logical rect (top-left origin, as in pane_layout) as the target rect the
+// view maps it to.
+void render_gl_damage_add_view(render_gl_damage *dmg, const render_view *view, int x, int y, int w, int h) {
+    if (x < 0) { w += x; x = 0; }
+    if (y < 0) { h += y; y = 0; }
+    if (x + w > view->logical_w) w = view->logical_w - x;
+    if (y + h > view->logical_h) h = view->logical_h - y;
+    if (w <= 0 || h <= 0) return;
+    int sx = 0, sy = 0, sw = 0, sh = 0;
+    render_view_rect(view, x, y, w, h, &sx, &sy, &sw, &sh);
+    render_gl_damage_add_rect(dmg, sx, sy, sw, sh);
+}
+
+bool render_gl_damage_intersects_view(const render_gl_damage *dmg, const render_view *view,
+                                      int x, int y, int w, int h) {
+    if (dmg->full) return true;
+    int sx = 0, sy = 0, sw = 0, sh = 0;
+    render_view_rect(view, x, y, w, h, &sx, &sy, &sw, &sh);
+    for (int i = 0; i < dmg->count; ++i) {
+        const render_gl_rect *r = &dmg->rects[i];
+        if (sx < r->x + r->w && r->x < sx + sw && sy < r->y + r->h && r->y < sy + sh) return true;
+    }
+    return false;
+}
+
+// A back buffer of age N last held the frame from N swaps ago, so it is missing this
+// frame's damage plus that of the N-1 frames presented since. Returns false when the
+// whole screen has to be repainted.
+bool render_gl_damage_repaint_region(const render_gl_ctx *ctx, const render_gl_damage *current, int buffer_age,
+                                     render_gl_damage *region) {
+    if (current->full || buffer_age <= 0 || buffer_age - 1 > ctx->damage_history_count) return false;
+    *region = *current;
+    for (int i = 0; i < buffer_age - 1; ++i) {
+        const render_gl_damage *past = &ctx->damage_history[i];
+        if (past->full) return false;
+        for (int j = 0; j < past->count; ++j) {
+            const render_gl_rect *r = &past->rects[j];
+            render_gl_damage_add_rect(region, r->x, r->y, r->w, r->h);
+        }
+    }
+    return true;
+}
+
+void render_gl_damage_push(render_gl_ctx *ctx, const render_gl_damage *current) {
+    for (int i = RENDER_GL_DAMAGE_HISTORY - 1; i > 0; --i) ctx->damage_history[i] = ctx->damage_history[i - 1];
+    ctx->damage_history[0] = *current;
+    if (ctx->damage_history_count < RENDER_GL_DAMAGE_HISTORY) ctx->damage_history_count++;
+}
+
 void render_gl_draw_tex_fullscreen(render_gl_ctx *ctx, GLuint tex) {
     render_gl_ensure_blit_prog(ctx);
     glUseProgram(ctx->blit_prog);
@@ -280,17 +399,66 @@ void render_gl_draw_tex_fullscreen(render_gl_ctx *ctx, GLuint tex) {
     glDrawArrays(GL_TRIANGLES, 0, 6);
 }
 
-void render_gl_draw_tex_to_rt(render_gl_ctx *ctx, GLuint tex, int x, int y, int w, int h, int rt_w, int rt_h) {
+void render_gl_draw_tex_to_view(render_gl_ctx *ctx, GLuint tex, int x, int y, int w, int h,
+                                const render_view *view) {
+    render_gl_ensure_blit_prog(ctx);
+    glUseProgram(ctx->blit_prog);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, tex);
+    glUniform1i(ctx->blit_u_tex, 0);
+    float verts[24];
+    render_view_quad(view, (float)x, (float)y, (float)w, (float)h, 0.f, 0.f, 1.f, 1.f, verts);
+    glBindBuffer(GL_ARRAY_BUFFER, ctx->blit_vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STREAM_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void *)0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void *)(2 * sizeof(float)));
+    glDrawArrays(GL_TRIANGLES, 0, 6);
+}
+
+void render_gl_draw_video_to_view(render_gl_ctx *ctx, GLuint tex, int tex_w, int tex_h, int rotate, float panscan,
+                                  int x, int y, int w, int h, const render_view *view) {
+    if (tex_w <= 0 || tex_h <= 0 || w <= 0 || h <= 0) return;
+    int quarter = ((rotate + 45) / 90) & 3;
+    float sw = (float)(quarter & 1 ? tex_h : tex_w);
+    float sh = (float)(quarter & 1 ? tex_w : tex_h);
+    float fit = fminf((float)w / sw, (float)h / sh);
+    float fill = fmaxf((float)w / sw, (float)h / sh);
+    float dw = sw * (fit + panscan * (fill - fit));
+    float dh = sh * (fit + panscan * (fill - fit));
+    float dx = (float)x + ((float)w - dw) * 0.5f;
+    float dy = (float)y + ((float)h - dh) * 0.5f;
+    float qx0 = fmaxf((float)x, dx), qx1 = fminf((float)(x + w), dx + dw);
+    float qy0 = fmaxf((float)y, dy), qy1 = fminf((float)(y + h), dy + dh);
+    if (qx1 <= qx0 || qy1 <= qy0) return;
+
+    // Visible part of the rotated frame, (a, b) from its top-left corner, at the
+    // quad's lb, rb, rt, lb, rt, lt vertices.
+    float a0 = (qx0 - dx) / dw, a1 = (qx1 - dx) / dw;
+    float b0 = (qy0 - dy) / dh, b1 = (qy1 - dy) / dh;
+    const float corners[6][2] = { {a0, b1}, {a1, b1}, {a1, b0}, {a0, b1}, {a1, b0}, {a0, b0} };
+    float verts[24];
+    render_view_quad(view, qx0, qy0, qx1 - qx0, qy1 - qy0, 0.f, 0.f, 1.f, 1.f, verts);
+    for (int i = 0; i < 6; ++i) {
+        float a = corners[i][0], b = corners[i][1];
+        float s, t; // frame coordinates before rotation, t from the top
+        switch (quarter) {
+            case 1: s = b; t = 1.f - a; break;
+            case 2: s = 1.f - a; t = 1.f - b; break;
+            case 3: s = 1.f - b; t = a; break;
+            default: s = a; t = b; break;
+        }
+        // Pane video targets hold the frame bottom row first.
+        verts[4 * i + 2] = s;
+        verts[4 * i + 3] = 1.f - t;
+    }
+
     render_gl_ensure_blit_prog(ctx);
     glUseProgram(ctx->blit_prog);
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, tex);
     glUniform1i(ctx->blit_u_tex, 0);
-    const float l = (2.0f * x / rt_w) - 1.0f;
-    const float r = (2.0f * (x + w) / rt_w) - 1.0f;
-    const float t = 1.0f - (2.0f * y / rt_h);
-    const float b = 1.0f - (2.0f * (y + h) / rt_h);
-    const float verts[] = { l,b, 0,0,  r,b, 1,0,  r,t, 1,1,  l,b, 0,0,  r,t, 1,1,  l,t, 0,1 };
     glBindBuffer(GL_ARRAY_BUFFER, ctx->blit_vbo);
     glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STREAM_DRAW);
     glEnableVertexAttribArray(0);
@@ -370,6 +538,8 @@ void render_gl_destroy(render_gl_ctx *ctx) {
     }
     ctx->rt_w = 0;
     ctx->rt_h = 0;
+    ctx->rt_valid = false;
+    ctx->damage_history_count = 0;
     ctx->vid_w = 0;
     ctx->vid_h = 0;
     ctx->blit_u_tex = -1;
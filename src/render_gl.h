@@ -6,6 +6,21 @@
 #include <GLES2/gl2.h>
 
 #include "options.h"
+#include "render_view.h"
+
+#define RENDER_GL_MAX_DAMAGE_RECTS 16
+#define RENDER_GL_DAMAGE_HISTORY 4
+
+// Screen-space rects (GL window coordinates, bottom-left origin) touched by one frame.
+typedef struct {
+    int x, y, w, h;
+} render_gl_rect;
+
+typedef struct {
+    render_gl_rect rects[RENDER_GL_MAX_DAMAGE_RECTS];
+    int count;
+    bool full;
+} render_gl_damage;
 
 typedef struct {
     GLuint rt_fbo;
@@ -24,21 +39,41 @@ typedef struct {
     int *pane_vid_ws;
     int *pane_vid_hs;
     int pane_vid_cap;
+    bool rt_valid;
+    render_gl_damage damage_history[RENDER_GL_DAMAGE_HISTORY];
+    int damage_history_count;
 } render_gl_ctx;
 
 void render_gl_reset_state_2d(void);
 void render_gl_clear_color(float r, float g, float b, float a);
 void render_gl_check(bool debug, const char *stage);
-void render_gl_draw_border_rect(int x, int y, int w, int h, int thickness, int fb_w, int fb_h,
+void render_gl_draw_border_rect(int x, int y, int w, int h, int thickness, const render_view *view,
                                 float r, float g, float b, float a);
 void render_gl_ensure_rt(render_gl_ctx *ctx, int w, int h);
 void render_gl_ensure_video_rt(render_gl_ctx *ctx, int w, int h);
 bool render_gl_ensure_pane_video_rt(render_gl_ctx *ctx, int pane_index, int w, int h);
 GLuint render_gl_pane_video_fbo(const render_gl_ctx *ctx, int pane_index);
 GLuint render_gl_pane_video_tex(const render_gl_ctx *ctx, int pane_index);
+void render_gl_pane_video_size(const render_gl_ctx *ctx, int pane_index, int *w, int *h);
 void render_gl_blit_rt_to_screen(render_gl_ctx *ctx, rotation_t rot);
+void render_gl_blit_rt_region_to_screen(render_gl_ctx *ctx, rotation_t rot, const render_gl_damage *region);
+void render_gl_clear_rect(const render_view *view, int x, int y, int w, int h, float r, float g, float b, float a);
+void render_gl_damage_reset(render_gl_damage *dmg);
+void render_gl_damage_add_rect(render_gl_damage *dmg, int x, int y, int w, int h);
+void render_gl_damage_add_view(render_gl_damage *dmg, const render_view *view, int x, int y, int w, int h);
+bool render_gl_damage_intersects_view(const render_gl_damage *dmg, const render_view *view,
+                                      int x, int y, int w, int h);
+bool render_gl_damage_repaint_region(const render_gl_ctx *ctx, const render_gl_damage *current, int buffer_age,
+                                     render_gl_damage *region);
+void render_gl_damage_push(render_gl_ctx *ctx, const render_gl_damage *current);
 void render_gl_draw_tex_fullscreen(render_gl_ctx *ctx, GLuint tex);
-void render_gl_draw_tex_to_rt(render_gl_ctx *ctx, GLuint tex, int x, int y, int w, int h, int rt_w, int rt_h);
+void render_gl_draw_tex_to_view(render_gl_ctx *ctx, GLuint tex, int x, int y, int w, int h,
+                                const render_view *view);
+// Draw a tex_w x tex_h video frame into the logical rect the way mpv would:
+// rotated clockwise by rotate degrees (a multiple of 90), letterboxed, and with
+// panscan in [0, 1] cropping towards filling the rect. Bars are left untouched.
+void render_gl_draw_video_to_view(render_gl_ctx *ctx, GLuint tex, int tex_w, int tex_h, int rotate, float panscan,
+                                  int x, int y, int w, int h, const render_view *view);
 bool render_gl_write_current_rgba_frame(const char *path, int w, int h);
 void render_gl_destroy(render_gl_ctx *ctx);
 
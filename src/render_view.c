@@ -0,0 +1,76 @@
+#include "render_view.h"
+
+#include <stdbool.h>
+
+void render_view_init_logical(render_view *v, int logical_w, int logical_h) {
+    float sx = 2.0f / (float)logical_w, sy = 2.0f / (float)logical_h;
+    v->logical_w = logical_w;
+    v->logical_h = logical_h;
+    v->target_w = logical_w;
+    v->target_h = logical_h;
+    const float m[6] = { sx, 0.f, -1.f,  0.f, -sy, 1.f };
+    for (int i = 0; i < 6; ++i) v->m[i] = m[i];
+}
+
+// Matches render_gl_blit_rt_to_screen: the render target is presented flipped, then
+// rotated, so rotation 0 puts logical y at window y.
+void render_view_init_screen(render_view *v, int logical_w, int logical_h, int rotation_deg) {
+    float sx = 2.0f / (float)logical_w, sy = 2.0f / (float)logical_h;
+    bool swap = rotation_deg == 90 || rotation_deg == 270;
+    v->logical_w = logical_w;
+    v->logical_h = logical_h;
+    v->target_w = swap ? logical_h : logical_w;
+    v->target_h = swap ? logical_w : logical_h;
+    const float m0[6] =   { sx, 0.f, -1.f,  0.f, sy, -1.f };
+    const float m90[6] =  { 0.f, sy, -1.f,  -sx, 0.f, 1.f };
+    const float m180[6] = { -sx, 0.f, 1.f,  0.f, -sy, 1.f };
+    const float m270[6] = { 0.f, -sy, 1.f,  sx, 0.f, -1.f };
+    const float *m = m0;
+    if (rotation_deg == 90) m = m90;
+    else if (rotation_deg == 180) m = m180;
+    else if (rotation_deg == 270) m = m270;
+    for (int i = 0; i < 6; ++i) v->m[i] = m[i];
+}
+
+static void render_view_map(const render_view *v, float x, float y, float *nx, float *ny) {
+    *nx = v->m[0] * x + v->m[1] * y + v->m[2];
+    *ny = v->m[3] * x + v->m[4] * y + v->m[5];
+}
+
+void render_view_quad(const render_view *v, float x, float y, float w, float h,
+                      float u0, float v0, float u1, float v1, float verts[24]) {
+    float lbx, lby, rbx, rby, rtx, rty, ltx, lty;
+    render_view_map(v, x, y + h, &lbx, &lby);
+    render_view_map(v, x + w, y + h, &rbx, &rby);
+    render_view_map(v, x + w, y, &rtx, &rty);
+    render_view_map(v, x, y, &ltx, &lty);
+    const float q[24] = {
+        lbx,lby, u0,v0,
+        rbx,rby, u1,v0,
+        rtx,rty, u1,v1,
+        lbx,lby, u0,v0,
+        rtx,rty, u1,v1,
+        ltx,lty, u0,v1
+    };
+    for (int i = 0; i < 24; ++i) verts[i] = q[i];
+}
+
+static int render_view_px(float ndc, int size) {
+    float p = (ndc + 1.0f) * 0.5f * (float)size;
+    return p <= 0.0f ? 0 : (int)(p + 0.5f);
+}
+
+void render_view_rect(const render_view *v, int x, int y, int w, int h,
+                      int *out_x, int *out_y, int *out_w, int *out_h) {
+    float ax, ay, bx, by;
+    render_view_map(v, (float)x, (float)y, &ax, &ay);
+    render_view_map(v, (float)(x + w), (float)(y + h), &bx, &by);
+    int x0 = render_view_px(ax < bx ? ax : bx, v->target_w);
+    int x1 = render_view_px(ax < bx ? bx : ax, v->target_w);
+    int y0 = render_view_px(ay < by ? ay : by, v->target_h);
+    int y1 = render_view_px(ay < by ? by : ay, v->target_h);
+    *out_x = x0;
+    *out_y = y0;
+    *out_w = x1 - x0;
+    *out_h = y1 - y0;
+}
@@ -0,0 +1,25 @@
+#ifndef RENDER_VIEW_H
+#define RENDER_VIEW_H
+
+// Maps compositor coordinates (logical pixels, top-left origin, as in pane_layout)
+// onto the bound framebuffer: either the logical-size render target or the back
+// buffer with the output rotation folded in, so panes can be drawn straight to
+// the screen without a rotating blit.
+typedef struct {
+    int logical_w;
+    int logical_h;
+    int target_w;
+    int target_h;
+    float m[6]; // ndc = (m[0]*x + m[1]*y + m[2], m[3]*x + m[4]*y + m[5])
+} render_view;
+
+void render_view_init_logical(render_view *v, int logical_w, int logical_h);
+void render_view_init_screen(render_view *v, int logical_w, int logical_h, int rotation_deg);
+// Six (x, y, u, v) vertices; texture row v0 lands on the logical bottom edge (y + h).
+void render_view_quad(const render_view *v, float x, float y, float w, float h,
+                      float u0, float v0, float u1, float v1, float verts[24]);
+// Target pixel rect (GL window coordinates, bottom-left origin) covered by a logical rect.
+void render_view_rect(const render_view *v, int x, int y, int w, int h,
+                      int *out_x, int *out_y, int *out_w, int *out_h);
+
+#endif
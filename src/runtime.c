@@ -1,48 +1,133 @@
+#define _GNU_SOURCE
+
 #include "runtime.h"
 
+#include <errno.h>
 #include <fcntl.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/epoll.h>
+#include <sys/syscall.h>
+#include <sys/timerfd.h>
 #include <unistd.h>
 
 #include "term_pane.h"
 
 int runtime_pane_poll_index(int pane_index) {
-    return RUNTIME_POLL_BASE_COUNT + pane_index;
+    return RUNTIME_SRC_BASE_COUNT + pane_index;
 }
 
 int runtime_pane_media_poll_index(const options_t *opt, int pane_index) {
-    return RUNTIME_POLL_BASE_COUNT + opt->pane_count + pane_index;
+    return RUNTIME_SRC_BASE_COUNT + opt->pane_count + pane_index;
 }
 
 int runtime_pane_playlist_poll_index(const options_t *opt, int pane_index) {
-    return RUNTIME_POLL_BASE_COUNT + opt->pane_count + opt->pane_count + pane_index;
+    return RUNTIME_SRC_BASE_COUNT + opt->pane_count + opt->pane_count + pane_index;
+}
+
+int runtime_pane_child_poll_index(const options_t *opt, int pane_index) {
+    return RUNTIME_SRC_BASE_COUNT + 3 * opt->pane_count + pane_index;
+}
+
+bool runtime_source_ready(const runtime_state *rt, int source) {
+    if (source < 0 || source >= rt->source_count) return false;
+    return rt->sources[source].revents & (EPOLLIN | EPOLLERR | EPOLLHUP);
 }
 
 bool runtime_pane_ready(const runtime_state *rt, int pane_index) {
-    int poll_index = runtime_pane_poll_index(pane_index);
-    return rt->pfds[poll_index].revents & (POLLIN | POLLERR | POLLHUP);
+    return runtime_source_ready(rt, runtime_pane_poll_index(pane_index));
+}
+
+bool runtime_pane_throttled(const runtime_state *rt, int pane_index, uint64_t now_ns) {
+    return rt->pane_next_poll_ns[pane_index] > now_ns;
+}
+
+void runtime_pane_mark_polled(runtime_state *rt, const options_t *opt, int pane_index, uint64_t now_ns) {
+    int fps = opt->pane_max_fps[pane_index];
+    rt->pane_next_poll_ns[pane_index] = fps > 0 ? now_ns + 1000000000ull / (uint64_t)fps : 0;
 }
 
 bool runtime_pane_media_ready(const runtime_state *rt, const options_t *opt, int pane_index) {
-    int poll_index = runtime_pane_media_poll_index(opt, pane_index);
-    return rt->pfds[poll_index].revents & (POLLIN | POLLERR | POLLHUP);
+    return runtime_source_ready(rt, runtime_pane_media_poll_index(opt, pane_index));
 }
 
 bool runtime_pane_playlist_ready(const runtime_state *rt, const options_t *opt, int pane_index) {
-    int poll_index = runtime_pane_playlist_poll_index(opt, pane_index);
-    return rt->pfds[poll_index].revents & (POLLIN | POLLERR | POLLHUP);
+    return runtime_source_ready(rt, runtime_pane_playlist_poll_index(opt, pane_index));
+}
+
+bool runtime_pane_child_exited(const runtime_state *rt, const options_t *opt, const term_pane *tp, int pane_index) {
+    int child = runtime_pane_child_poll_index(opt, pane_index);
+    if (rt->sources[child].fd >= 0) return runtime_source_ready(rt, child);
+    // No pidfd (older kernel): fall back to the PTY hangup the exit usually causes.
+    // A worker thread owns the PTY and reports the hangup itself.
+    if (term_pane_pty_hung_up(tp)) return true;
+    return rt->sources[runtime_pane_poll_index(pane_index)].revents & EPOLLHUP;
+}
+
+// Point a source at fd. Unchanged fds are left alone unless force is set, which
+// callers use after closing and reopening a file that may get the same number back.
+static void runtime_watch(runtime_state *rt, int source, int fd, bool force) {
+    runtime_source *src = &rt->sources[source];
+    if (src->fd == fd && !force) return;
+    if (src->fd >= 0) epoll_ctl(rt->epoll_fd, EPOLL_CTL_DEL, src->fd, NULL);
+    src->fd = -1;
+    src->revents = 0;
+    if (fd < 0) return;
+    struct epoll_event ev = {.events = EPOLLIN, .data.u32 = (uint32_t)source};
+    if (epoll_ctl(rt->epoll_fd, EPOLL_CTL_ADD, fd, &ev) == 0 ||
+        (errno == EEXIST && epoll_ctl(rt->epoll_fd, EPOLL_CTL_MOD, fd, &ev) == 0)) {
+        src->fd = fd;
+    }
+}
+
+void runtime_forget_pane_fd(runtime_state *rt, int pane_index) {
+    runtime_watch(rt, runtime_pane_poll_index(pane_index), -1, false);
+}
+
+static int runtime_pidfd_open(pid_t pid) {
+#ifdef SYS_pidfd_open
+    return (int)syscall(SYS_pidfd_open, pid, 0);
+#else
+    (void)pid;
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+// Track the pane's child through a pidfd. Without pidfd support (pre-5.3 kernels)
+// exits are still noticed through the PTY hanging up.
+static void runtime_watch_child(runtime_state *rt, int source, pid_t pid) {
+    runtime_source *src = &rt->sources[source];
+    if (src->pid == pid) return;
+    int old_fd = src->fd;
+    runtime_watch(rt, source, -1, false);
+    if (old_fd >= 0) close(old_fd);
+    src->pid = pid;
+    if (pid <= 0) return;
+    int pidfd = runtime_pidfd_open(pid);
+    if (pidfd < 0) return;
+    fcntl(pidfd, F_SETFD, FD_CLOEXEC);
+    runtime_watch(rt, source, pidfd, false);
+    if (src->fd != pidfd) close(pidfd);
 }
 
 bool runtime_init(runtime_state *rt, const options_t *opt, bool use_mpv, const media_ctx *m, int drm_fd) {
     memset(rt, 0, sizeof(*rt));
-    rt->nfds = RUNTIME_POLL_BASE_COUNT + opt->pane_count + opt->pane_count + opt->pane_count;
-    rt->pfds = calloc((size_t)rt->nfds, sizeof(*rt->pfds));
-    if (!rt->pfds) return false;
+    rt->epoll_fd = -1;
+    rt->timer_fd = -1;
+    rt->source_count = RUNTIME_SRC_BASE_COUNT + 4 * opt->pane_count;
+    rt->sources = calloc((size_t)rt->source_count, sizeof(*rt->sources));
     rt->pane_mpv_needs_render = calloc((size_t)opt->pane_count, sizeof(*rt->pane_mpv_needs_render));
-    if (!rt->pane_mpv_needs_render) {
-        free(rt->pfds);
-        rt->pfds = NULL;
+    rt->pane_damaged = calloc((size_t)opt->pane_count, sizeof(*rt->pane_damaged));
+    rt->pane_next_poll_ns = calloc((size_t)opt->pane_count, sizeof(*rt->pane_next_poll_ns));
+    if (rt->sources) {
+        for (int i = 0; i < rt->source_count; ++i) rt->sources[i].fd = -1;
+        rt->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        rt->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    }
+    if (!rt->sources || rt->epoll_fd < 0 || rt->timer_fd < 0 || !rt->pane_mpv_needs_render || !rt->pane_damaged ||
+        !rt->pane_next_poll_ns || !stats_init(&rt->stats, opt->pane_count, opt->stats_path, opt->stats_interval_ms)) {
+        runtime_destroy(rt);
         return false;
     }
     rt->running = true;
@@ -58,53 +143,107 @@ bool runtime_init(runtime_state *rt, const options_t *opt, bool use_mpv, const m
     const char *dtest_env = getenv("KMS_MPV_DIRECT_TEST");
     rt->direct_test_only = (dtest_env && (*dtest_env == '1' || *dtest_env == 'y' || *dtest_env == 'Y'));
     rt->mpv_needs_render = 1;
+    rt->scene_dirty = true;
+    rt->full_damage = true;
     for (int i = 0; i < opt->pane_count; ++i) rt->pane_mpv_needs_render[i] = 1;
 
-    rt->pfds[RUNTIME_POLL_STDIN].fd = isatty(0) ? 0 : -1;
-    rt->pfds[RUNTIME_POLL_STDIN].events = POLLIN;
-    rt->pfds[RUNTIME_POLL_MPV_WAKEUP].fd = use_mpv ? m->wakeup_fd[0] : -1;
-    rt->pfds[RUNTIME_POLL_MPV_WAKEUP].events = POLLIN;
-    rt->pfds[RUNTIME_POLL_DRM].fd = drm_fd;
-    rt->pfds[RUNTIME_POLL_DRM].events = POLLIN;
-    rt->pfds[RUNTIME_POLL_PLAYLIST_FIFO].fd = m->playlist_fifo_fd;
-    rt->pfds[RUNTIME_POLL_PLAYLIST_FIFO].events = POLLIN;
-    for (int i = 0; i < opt->pane_count; ++i) {
-        rt->pfds[runtime_pane_poll_index(i)].events = POLLIN | POLLERR | POLLHUP;
-        rt->pfds[runtime_pane_media_poll_index(opt, i)].events = POLLIN | POLLERR | POLLHUP;
-        rt->pfds[runtime_pane_playlist_poll_index(opt, i)].events = POLLIN | POLLERR | POLLHUP;
-    }
+    runtime_watch(rt, RUNTIME_SRC_STDIN, isatty(0) ? 0 : -1, false);
+    runtime_watch(rt, RUNTIME_SRC_MPV_WAKEUP, use_mpv ? m->wakeup_fd : -1, false);
+    runtime_watch(rt, RUNTIME_SRC_DRM, drm_fd, false);
+    runtime_watch(rt, RUNTIME_SRC_PLAYLIST_FIFO, m->playlist_fifo_fd, false);
+    runtime_watch(rt, RUNTIME_SRC_TIMER, rt->timer_fd, false);
     fcntl(0, F_SETFL, O_NONBLOCK);
     return true;
 }
 
 void runtime_update_pane_fds(runtime_state *rt, const options_t *opt, const pane_runtime *panes,
                              const media_ctx *pane_media) {
+    uint64_t now_ns = stats_now_ns();
     for (int i = 0; i < opt->pane_count; ++i) {
-        rt->pfds[runtime_pane_poll_index(i)].fd =
-            opt->no_panes ? -1 : term_pane_get_fd(panes_get_term(panes, i));
-        rt->pfds[runtime_pane_media_poll_index(opt, i)].fd =
-            (pane_media && pane_media[i].mpv) ? pane_media[i].wakeup_fd[0] : -1;
-        rt->pfds[runtime_pane_playlist_poll_index(opt, i)].fd =
-            (pane_media && pane_media[i].playlist_fifo_fd >= 0) ? pane_media[i].playlist_fifo_fd : -1;
+        term_pane *tp = opt->no_panes ? NULL : panes_get_term(panes, i);
+        int child_source = runtime_pane_child_poll_index(opt, i);
+        pid_t pid = term_pane_get_child_pid(tp);
+        // A respawned child comes with a new PTY that can reuse the old fd number.
+        bool respawned = rt->sources[child_source].pid != pid;
+        int pty_fd = runtime_pane_throttled(rt, i, now_ns) ? -1 : term_pane_get_fd(tp);
+        runtime_watch(rt, runtime_pane_poll_index(i), pty_fd, respawned);
+        runtime_watch_child(rt, child_source, pid);
+        runtime_watch(rt, runtime_pane_media_poll_index(opt, i),
+                      (pane_media && pane_media[i].mpv) ? pane_media[i].wakeup_fd : -1, false);
+        runtime_watch(rt, runtime_pane_playlist_poll_index(opt, i),
+                      (pane_media && pane_media[i].playlist_fifo_fd >= 0) ? pane_media[i].playlist_fifo_fd : -1, false);
     }
 }
 
 void runtime_refresh_playlist_fd(runtime_state *rt, const media_ctx *m) {
-    rt->pfds[RUNTIME_POLL_PLAYLIST_FIFO].fd = m->playlist_fifo_fd;
+    runtime_watch(rt, RUNTIME_SRC_PLAYLIST_FIFO, m->playlist_fifo_fd, true);
 }
 
 void runtime_refresh_pane_playlist_fd(runtime_state *rt, const options_t *opt, const media_ctx *pane_media) {
     for (int i = 0; i < opt->pane_count; ++i) {
-        rt->pfds[runtime_pane_playlist_poll_index(opt, i)].fd =
-            (pane_media && pane_media[i].playlist_fifo_fd >= 0) ? pane_media[i].playlist_fifo_fd : -1;
+        runtime_watch(rt, runtime_pane_playlist_poll_index(opt, i),
+                      (pane_media && pane_media[i].playlist_fifo_fd >= 0) ? pane_media[i].playlist_fifo_fd : -1, true);
     }
 }
 
+void runtime_watch_snapshot_fd(runtime_state *rt, int fd) {
+    runtime_watch(rt, RUNTIME_SRC_SNAPSHOT, fd, false);
+}
+
+static void runtime_arm_timer(runtime_state *rt, uint64_t deadline_ns) {
+    if (rt->timer_deadline_ns == deadline_ns) return;
+    struct itimerspec its = {0};
+    if (deadline_ns != RUNTIME_NO_DEADLINE) {
+        its.it_value.tv_sec = (time_t)(deadline_ns / 1000000000ull);
+        its.it_value.tv_nsec = (long)(deadline_ns % 1000000000ull);
+    }
+    timerfd_settime(rt->timer_fd, TFD_TIMER_ABSTIME, &its, NULL);
+    rt->timer_deadline_ns = deadline_ns;
+}
+
+bool runtime_wait(runtime_state *rt, uint64_t deadline_ns) {
+    struct epoll_event events[64];
+    int timeout_ms = -1;
+    if (deadline_ns == 0) {
+        timeout_ms = 0;
+    } else {
+        runtime_arm_timer(rt, deadline_ns);
+    }
+    for (int i = 0; i < rt->source_count; ++i) rt->sources[i].revents = 0;
+    int n = epoll_wait(rt->epoll_fd, events, (int)(sizeof(events) / sizeof(events[0])), timeout_ms);
+    if (n < 0) return errno == EINTR;
+    for (int i = 0; i < n; ++i) {
+        uint32_t source = events[i].data.u32;
+        if (source < (uint32_t)rt->source_count) rt->sources[source].revents |= events[i].events;
+    }
+    if (rt->sources[RUNTIME_SRC_TIMER].revents) {
+        uint64_t expirations;
+        while (read(rt->timer_fd, &expirations, sizeof(expirations)) > 0) {}
+        // An expired absolute timer stays disarmed; make the next wait re-arm it.
+        rt->timer_deadline_ns = RUNTIME_NO_DEADLINE;
+    }
+    return true;
+}
+
 void runtime_destroy(runtime_state *rt) {
     if (!rt) return;
     free(rt->pane_mpv_needs_render);
     rt->pane_mpv_needs_render = NULL;
-    free(rt->pfds);
-    rt->pfds = NULL;
-    rt->nfds = 0;
+    free(rt->pane_damaged);
+    rt->pane_damaged = NULL;
+    free(rt->pane_next_poll_ns);
+    rt->pane_next_poll_ns = NULL;
+    stats_destroy(&rt->stats);
+    if (rt->sources) {
+        for (int i = 0; i < rt->source_count; ++i) {
+            if (rt->sources[i].pid > 0 && rt->sources[i].fd >= 0) close(rt->sources[i].fd);
+        }
+    }
+    free(rt->sources);
+    rt->sources = NULL;
+    rt->source_count = 0;
+    if (rt->timer_fd >= 0) close(rt->timer_fd);
+    rt->timer_fd = -1;
+    if (rt->epoll_fd >= 0) close(rt->epoll_fd);
+    rt->epoll_fd = -1;
 }
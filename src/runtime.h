@@ -1,22 +1,36 @@
 #ifndef RUNTIME_H
 #define RUNTIME_H
 
-#include <poll.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
 
 #include "media.h"
 #include "options.h"
 #include "panes.h"
+#include "stats.h"
 #include "ui.h"
 
+// Event sources registered once with the runtime epoll set. Pane sources follow
+// the fixed ones in blocks of pane_count: PTY, mpv wakeup, playlist FIFO, child pidfd.
 enum {
-    RUNTIME_POLL_STDIN = 0,
-    RUNTIME_POLL_MPV_WAKEUP,
-    RUNTIME_POLL_DRM,
-    RUNTIME_POLL_PLAYLIST_FIFO,
-    RUNTIME_POLL_BASE_COUNT
+    RUNTIME_SRC_STDIN = 0,
+    RUNTIME_SRC_MPV_WAKEUP,
+    RUNTIME_SRC_DRM,
+    RUNTIME_SRC_PLAYLIST_FIFO,
+    RUNTIME_SRC_TIMER,
+    RUNTIME_SRC_SNAPSHOT,
+    RUNTIME_SRC_BASE_COUNT
 };
 
+#define RUNTIME_NO_DEADLINE UINT64_MAX
+
+typedef struct {
+    int fd;            // registered fd, -1 when nothing is watched
+    pid_t pid;         // child behind a pidfd source
+    uint32_t revents;  // epoll events from the last runtime_wait
+} runtime_source;
+
 typedef struct {
     bool running;
     bool direct_mode;
@@ -26,21 +40,54 @@ typedef struct {
     int frame;
     int mpv_needs_render;
     int *pane_mpv_needs_render;
-    struct pollfd *pfds;
-    int nfds;
+    bool scene_dirty;
+    bool full_damage;
+    bool *pane_damaged;
+    int pane_poll_next; // round-robin start for budgeted PTY reads
+    uint64_t *pane_next_poll_ns; // earliest next poll of a --pane-max-fps pane
+    unsigned long long idle_frames;
+    unsigned long long presented_frames;
+    unsigned long long partial_frames;
+    stats_ctx stats;
+    int epoll_fd;
+    int timer_fd;
+    uint64_t timer_deadline_ns;
+    runtime_source *sources;
+    int source_count;
 } runtime_state;
 
 bool runtime_init(runtime_state *rt, const options_t *opt, bool use_mpv, const media_ctx *m, int drm_fd);
+// Keep pane registrations in step with the panes. Only changed fds or respawned
+// children touch the epoll set, so this is cheap to call every iteration. The
+// PTY of a rate-capped pane is left out until its next update is due, so output
+// waiting in it does not keep the level-triggered wait from sleeping.
 void runtime_update_pane_fds(runtime_state *rt, const options_t *opt, const pane_runtime *panes,
                              const media_ctx *pane_media);
+// Drop the pane's PTY from the epoll set. Call before anything that may close
+// it: once closed, its number can be reused by another pane's new PTY, and a
+// late EPOLL_CTL_DEL on that number would unregister the wrong pane.
+void runtime_forget_pane_fd(runtime_state *rt, int pane_index);
 void runtime_refresh_playlist_fd(runtime_state *rt, const media_ctx *m);
 void runtime_refresh_pane_playlist_fd(runtime_state *rt, const options_t *opt, const media_ctx *pane_media);
+// inotify fd of the snapshot request/lease directory, -1 when it is polled instead.
+void runtime_watch_snapshot_fd(runtime_state *rt, int fd);
+// Sleep until a source is ready or the CLOCK_MONOTONIC deadline passes (0 polls,
+// RUNTIME_NO_DEADLINE waits for events only). Returns false on a real epoll error.
+bool runtime_wait(runtime_state *rt, uint64_t deadline_ns);
+bool runtime_source_ready(const runtime_state *rt, int source);
 int runtime_pane_poll_index(int pane_index);
 int runtime_pane_media_poll_index(const options_t *opt, int pane_index);
 int runtime_pane_playlist_poll_index(const options_t *opt, int pane_index);
+int runtime_pane_child_poll_index(const options_t *opt, int pane_index);
 bool runtime_pane_ready(const runtime_state *rt, int pane_index);
+// The pane was updated within the last 1/--pane-max-fps seconds.
+bool runtime_pane_throttled(const runtime_state *rt, int pane_index, uint64_t now_ns);
+// Start the pane's --pane-max-fps interval after an update at now_ns.
+void runtime_pane_mark_polled(runtime_state *rt, const options_t *opt, int pane_index, uint64_t now_ns);
 bool runtime_pane_media_ready(const runtime_state *rt, const options_t *opt, int pane_index);
 bool runtime_pane_playlist_ready(const runtime_state *rt, const options_t *opt, int pane_index);
+// The pane's child exited (pidfd readable) or its PTY hung up; time to reap it.
+bool runtime_pane_child_exited(const runtime_state *rt, const options_t *opt, const term_pane *tp, int pane_index);
 void runtime_destroy(runtime_state *rt);
 
 #endif
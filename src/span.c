@@ -0,0 +1,224 @@
+#include "span.h"
+
+#include <stdlib.h>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define SPAN_HAVE_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define SPAN_HAVE_NEON 1
+#endif
+
+typedef struct {
+    const char *name;
+    void (*fill32)(uint32_t *dst, uint32_t px, int n);
+    void (*blend)(uint8_t *dst, const uint8_t *coverage, int n, uint32_t fg);
+} span_kernels;
+
+static inline uint8_t span_div255(unsigned x) {
+    return (uint8_t)((x + 1 + (x >> 8)) >> 8);
+}
+
+static void span_fill32_scalar(uint32_t *dst, uint32_t px, int n) {
+    for (int i = 0; i < n; ++i) dst[i] = px;
+}
+
+static void span_blend_scalar(uint8_t *dst, const uint8_t *coverage, int n, uint32_t fg) {
+    uint8_t fgb[4];
+    memcpy(fgb, &fg, sizeof(fgb));
+    for (int i = 0; i < n; ++i, dst += 4) {
+        unsigned a = coverage[i];
+        if (!a) continue;
+        dst[0] = span_div255(fgb[0] * a + dst[0] * (255 - a));
+        dst[1] = span_div255(fgb[1] * a + dst[1] * (255 - a));
+        dst[2] = span_div255(fgb[2] * a + dst[2] * (255 - a));
+        dst[3] = fgb[3];
+    }
+}
+
+#ifdef SPAN_HAVE_X86
+static void span_fill32_sse2(uint32_t *dst, uint32_t px, int n) {
+    __m128i v = _mm_set1_epi32((int)px);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) _mm_storeu_si128((__m128i *)(dst + i), v);
+    for (; i < n; ++i) dst[i] = px;
+}
+
+// The byte mask keeps coverage on the colour bytes; the alpha byte gets 255
+// where coverage is non-zero, so the same blend writes fg's alpha there.
+static inline __m128i span_weights_sse2(__m128i rep) {
+    const __m128i rgb_mask = _mm_set1_epi32(0x00ffffff);
+    __m128i nonzero = _mm_andnot_si128(_mm_cmpeq_epi8(rep, _mm_setzero_si128()), _mm_set1_epi8(-1));
+    return _mm_or_si128(_mm_and_si128(rep, rgb_mask), _mm_andnot_si128(rgb_mask, nonzero));
+}
+
+static inline __m128i span_div255_epi16_sse2(__m128i x) {
+    x = _mm_add_epi16(x, _mm_add_epi16(_mm_set1_epi16(1), _mm_srli_epi16(x, 8)));
+    return _mm_srli_epi16(x, 8);
+}
+
+static void span_blend_sse2(uint8_t *dst, const uint8_t *coverage, int n, uint32_t fg) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i c255 = _mm_set1_epi16(255);
+    const __m128i fg16 = _mm_unpacklo_epi8(_mm_set1_epi32((int)fg), zero);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        uint32_t cov4;
+        memcpy(&cov4, coverage + i, sizeof(cov4));
+        if (!cov4) continue;
+        __m128i rep = _mm_cvtsi32_si128((int)cov4);
+        rep = _mm_unpacklo_epi8(rep, rep);
+        rep = _mm_unpacklo_epi16(rep, rep);
+        __m128i w = span_weights_sse2(rep);
+        __m128i d = _mm_loadu_si128((const __m128i *)(dst + i * 4));
+        __m128i w_lo = _mm_unpacklo_epi8(w, zero), w_hi = _mm_unpackhi_epi8(w, zero);
+        __m128i d_lo = _mm_unpacklo_epi8(d, zero), d_hi = _mm_unpackhi_epi8(d, zero);
+        __m128i lo = _mm_add_epi16(_mm_mullo_epi16(fg16, w_lo), _mm_mullo_epi16(d_lo, _mm_sub_epi16(c255, w_lo)));
+        __m128i hi = _mm_add_epi16(_mm_mullo_epi16(fg16, w_hi), _mm_mullo_epi16(d_hi, _mm_sub_epi16(c255, w_hi)));
+        __m128i out = _mm_packus_epi16(span_div255_epi16_sse2(lo), span_div255_epi16_sse2(hi));
+        _mm_storeu_si128((__m128i *)(dst + i * 4), out);
+    }
+    span_blend_scalar(dst + i * 4, coverage + i, n - i, fg);
+}
+
+__attribute__((target("avx2")))
+static void span_fill32_avx2(uint32_t *dst, uint32_t px, int n) {
+    __m256i v = _mm256_set1_epi32((int)px);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) _mm256_storeu_si256((__m256i *)(dst + i), v);
+    // The tails are plain SSE; clear the upper halves first to avoid the transition penalty.
+    _mm256_zeroupper();
+    span_fill32_sse2(dst + i, px, n - i);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i span_div255_epi16_avx2(__m256i x) {
+    x = _mm256_add_epi16(x, _mm256_add_epi16(_mm256_set1_epi16(1), _mm256_srli_epi16(x, 8)));
+    return _mm256_srli_epi16(x, 8);
+}
+
+__attribute__((target("avx2")))
+static void span_blend_avx2(uint8_t *dst, const uint8_t *coverage, int n, uint32_t fg) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i c255 = _mm256_set1_epi16(255);
+    const __m256i rgb_mask = _mm256_set1_epi32(0x00ffffff);
+    const __m256i fg16 = _mm256_unpacklo_epi8(_mm256_set1_epi32((int)fg), zero);
+    // Shuffles run per 128-bit lane: the low lane spreads coverage 0..3, the high lane 4..7.
+    const __m256i spread = _mm256_setr_epi8(0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3,
+                                            4, 4, 4, 4, 5, 5, 5, 5, 6, 6, 6, 6, 7, 7, 7, 7);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint64_t cov8;
+        memcpy(&cov8, coverage + i, sizeof(cov8));
+        if (!cov8) continue;
+        __m256i rep = _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(_mm_cvtsi64_si128((long long)cov8)), spread);
+        __m256i nonzero = _mm256_xor_si256(_mm256_cmpeq_epi8(rep, zero), _mm256_set1_epi8(-1));
+        __m256i w = _mm256_or_si256(_mm256_and_si256(rep, rgb_mask), _mm256_andnot_si256(rgb_mask, nonzero));
+        __m256i d = _mm256_loadu_si256((const __m256i *)(dst + i * 4));
+        __m256i w_lo = _mm256_unpacklo_epi8(w, zero), w_hi = _mm256_unpackhi_epi8(w, zero);
+        __m256i d_lo = _mm256_unpacklo_epi8(d, zero), d_hi = _mm256_unpackhi_epi8(d, zero);
+        __m256i lo = _mm256_add_epi16(_mm256_mullo_epi16(fg16, w_lo),
+                                      _mm256_mullo_epi16(d_lo, _mm256_sub_epi16(c255, w_lo)));
+        __m256i hi = _mm256_add_epi16(_mm256_mullo_epi16(fg16, w_hi),
+                                      _mm256_mullo_epi16(d_hi, _mm256_sub_epi16(c255, w_hi)));
+        __m256i out = _mm256_packus_epi16(span_div255_epi16_avx2(lo), span_div255_epi16_avx2(hi));
+        _mm256_storeu_si256((__m256i *)(dst + i * 4), out);
+    }
+    _mm256_zeroupper();
+    span_blend_sse2(dst + i * 4, coverage + i, n - i, fg);
+}
+#endif
+
+#ifdef SPAN_HAVE_NEON
+static void span_fill32_neon(uint32_t *dst, uint32_t px, int n) {
+    uint32x4_t v = vdupq_n_u32(px);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) vst1q_u32(dst + i, v);
+    for (; i < n; ++i) dst[i] = px;
+}
+
+static inline uint8x8_t span_blend_channel_neon(uint8x8_t fg, uint8x8_t d, uint8x8_t c, uint8x8_t inv) {
+    uint16x8_t x = vmlal_u8(vmull_u8(fg, c), d, inv);
+    x = vaddq_u16(x, vaddq_u16(vdupq_n_u16(1), vshrq_n_u16(x, 8)));
+    return vshrn_n_u16(x, 8);
+}
+
+static void span_blend_neon(uint8_t *dst, const uint8_t *coverage, int n, uint32_t fg) {
+    uint8_t fgb[4];
+    memcpy(fgb, &fg, sizeof(fgb));
+    const uint8x8_t fr = vdup_n_u8(fgb[0]), fgc = vdup_n_u8(fgb[1]), fb = vdup_n_u8(fgb[2]), fa = vdup_n_u8(fgb[3]);
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint8x8_t c = vld1_u8(coverage + i);
+        if (!vget_lane_u64(vreinterpret_u64_u8(c), 0)) continue;
+        uint8x8_t inv = vsub_u8(vdup_n_u8(255), c);
+        uint8x8x4_t d = vld4_u8(dst + i * 4);
+        d.val[0] = span_blend_channel_neon(fr, d.val[0], c, inv);
+        d.val[1] = span_blend_channel_neon(fgc, d.val[1], c, inv);
+        d.val[2] = span_blend_channel_neon(fb, d.val[2], c, inv);
+        d.val[3] = vbsl_u8(vtst_u8(c, c), fa, d.val[3]);
+        vst4_u8(dst + i * 4, d);
+    }
+    span_blend_scalar(dst + i * 4, coverage + i, n - i, fg);
+}
+#endif
+
+static const span_kernels span_kernel_sets[] = {
+    { "scalar", span_fill32_scalar, span_blend_scalar },
+#ifdef SPAN_HAVE_X86
+    { "sse2", span_fill32_sse2, span_blend_sse2 },
+    { "avx2", span_fill32_avx2, span_blend_avx2 },
+#endif
+#ifdef SPAN_HAVE_NEON
+    { "neon", span_fill32_neon, span_blend_neon },
+#endif
+};
+
+static const span_kernels *span_active;
+
+static bool span_supported(const span_kernels *k) {
+#ifdef SPAN_HAVE_X86
+    if (!strcmp(k->name, "avx2")) return __builtin_cpu_supports("avx2");
+#endif
+    (void)k;
+    return true;
+}
+
+bool span_select(const char *name) {
+    int count = (int)(sizeof(span_kernel_sets) / sizeof(span_kernel_sets[0]));
+    for (int i = 0; i < count; ++i) {
+        if (!strcmp(span_kernel_sets[i].name, name) && span_supported(&span_kernel_sets[i])) {
+            span_active = &span_kernel_sets[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+// Sets are listed narrowest first, so the last supported one wins.
+static const span_kernels *span_kernels_get(void) {
+    if (span_active) return span_active;
+    const char *forced = getenv("KMS_MOSAIC_SPAN_KERNEL");
+    if (forced && *forced && span_select(forced)) return span_active;
+    int count = (int)(sizeof(span_kernel_sets) / sizeof(span_kernel_sets[0]));
+    for (int i = count - 1; i >= 0; --i) {
+        if (span_supported(&span_kernel_sets[i])) {
+            span_active = &span_kernel_sets[i];
+            break;
+        }
+    }
+    return span_active;
+}
+
+void span_fill32(uint32_t *dst, uint32_t px, int n) {
+    if (n > 0) span_kernels_get()->fill32(dst, px, n);
+}
+
+void span_blend_coverage(uint8_t *dst, const uint8_t *coverage, int n, uint32_t fg) {
+    if (n > 0) span_kernels_get()->blend(dst, coverage, n, fg);
+}
+
+const char *span_kernel_name(void) {
+    return span_kernels_get()->name;
+}
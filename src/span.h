@@ -0,0 +1,34 @@
+#ifndef SPAN_H
+#define SPAN_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+// Pixel span kernels for the CPU terminal surface (RGBA8, 4 bytes per pixel).
+// Each kernel has a scalar reference and SSE2/AVX2 (x86-64) or NEON (aarch64)
+// variants; the widest one the CPU supports is picked on first use. All
+// variants produce bit-identical output: the blend divides by 255 exactly via
+// (x + 1 + (x >> 8)) >> 8, which is exact for every product of two bytes.
+
+// Pack r, g, b, a into the in-memory RGBA byte order of the surface.
+static inline uint32_t span_pack_rgba(uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
+    uint8_t bytes[4] = { r, g, b, a };
+    uint32_t px;
+    memcpy(&px, bytes, sizeof(px));
+    return px;
+}
+
+// Set n pixels to px.
+void span_fill32(uint32_t *dst, uint32_t px, int n);
+// Blend fg over n pixels by the 8-bit coverage row: rgb = (fg*c + dst*(255-c)) / 255,
+// and the alpha byte becomes fg's alpha wherever c is non-zero.
+void span_blend_coverage(uint8_t *dst, const uint8_t *coverage, int n, uint32_t fg);
+
+// Kernel set in use ("scalar", "sse2", "avx2" or "neon").
+const char *span_kernel_name(void);
+// Force a kernel set by name; false if it is not built in or the CPU lacks it.
+// KMS_MOSAIC_SPAN_KERNEL in the environment does the same on first use.
+bool span_select(const char *name);
+
+#endif
@@ -0,0 +1,279 @@
+#define _GNU_SOURCE
+
+#include "stats.h"
+#include "glyph_cache.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define STATS_HIST_SUB (1 << STATS_HIST_SUB_BITS)
+
+static const char *const stats_stage_names[STATS_STAGE_COUNT] = {
+    [STATS_STAGE_POLL_WAIT] = "poll_wait",
+    [STATS_STAGE_INPUT] = "input",
+    [STATS_STAGE_RUNTIME_EVENTS] = "runtime_events",
+    [STATS_STAGE_PANE_POLL] = "pane_poll",
+    [STATS_STAGE_LAYOUT] = "layout",
+    [STATS_STAGE_COMPOSE] = "compose",
+    [STATS_STAGE_OSD] = "osd",
+    [STATS_STAGE_SNAPSHOT] = "snapshot",
+    [STATS_STAGE_SWAP] = "swap",
+    [STATS_STAGE_PAGE_FLIP] = "page_flip",
+    [STATS_STAGE_FRAME] = "frame",
+};
+
+static const char *const stats_pane_stage_names[STATS_PANE_STAGE_COUNT] = {
+    [STATS_PANE_TERM_POLL] = "term_poll",
+    [STATS_PANE_TERM_RENDER] = "term_render",
+    [STATS_PANE_MPV_RENDER] = "mpv_render",
+};
+
+uint64_t stats_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+#ifdef KMS_MOSAIC_ALLOC_STATS
+// Replace the allocator entry points with counting wrappers around glibc's own
+// implementation. free() is left alone; glibc's free accepts these blocks.
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+static _Thread_local uint64_t stats_allocs;
+
+void *malloc(size_t size) {
+    stats_allocs++;
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size) {
+    stats_allocs++;
+    return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+    stats_allocs++;
+    return __libc_realloc(ptr, size);
+}
+
+uint64_t stats_thread_allocs(void) {
+    return stats_allocs;
+}
+
+bool stats_alloc_counting(void) {
+    return true;
+}
+#else
+uint64_t stats_thread_allocs(void) {
+    return 0;
+}
+
+bool stats_alloc_counting(void) {
+    return false;
+}
+#endif
+
+static double stats_now_sec(void) {
+    return (double)stats_now_ns() / 1e9;
+}
+
+static int stats_bucket(uint64_t us) {
+    if (us < STATS_HIST_SUB) return (int)us;
+    int msb = 63 - __builtin_clzll(us);
+    int idx = ((msb - STATS_HIST_SUB_BITS + 1) << STATS_HIST_SUB_BITS) +
+              (int)((us >> (msb - STATS_HIST_SUB_BITS)) & (STATS_HIST_SUB - 1));
+    return idx < STATS_HIST_BUCKETS ? idx : STATS_HIST_BUCKETS - 1;
+}
+
+static uint64_t stats_bucket_upper_us(int idx) {
+    if (idx < STATS_HIST_SUB) return (uint64_t)idx;
+    int msb = (idx >> STATS_HIST_SUB_BITS) + STATS_HIST_SUB_BITS - 1;
+    uint64_t sub = (uint64_t)(idx & (STATS_HIST_SUB - 1));
+    return ((STATS_HIST_SUB + sub + 1) << (msb - STATS_HIST_SUB_BITS)) - 1;
+}
+
+void stats_hist_add(stats_hist *h, uint64_t us) {
+    h->buckets[stats_bucket(us)]++;
+    h->count++;
+    h->sum_us += us;
+    if (us > h->max_us) h->max_us = us;
+}
+
+// Upper bound of the bucket holding the pct-th sample, clamped to the exact max.
+uint64_t stats_hist_percentile_us(const stats_hist *h, double pct) {
+    if (h->count == 0) return 0;
+    uint64_t rank = (uint64_t)((double)h->count * pct / 100.0 + 0.999999);
+    if (rank < 1) rank = 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < STATS_HIST_BUCKETS; ++i) {
+        seen += h->buckets[i];
+        if (seen >= rank) {
+            // The last bucket also holds everything past the histogram's range.
+            if (i == STATS_HIST_BUCKETS - 1) return h->max_us;
+            uint64_t upper = stats_bucket_upper_us(i);
+            return upper < h->max_us ? upper : h->max_us;
+        }
+    }
+    return h->max_us;
+}
+
+bool stats_init(stats_ctx *s, int pane_count, const char *path, int interval_ms) {
+    memset(s, 0, sizeof(*s));
+    if (pane_count > 0) {
+        s->pane_stages = calloc((size_t)pane_count * STATS_PANE_STAGE_COUNT, sizeof(*s->pane_stages));
+        s->pane_term_rows = calloc((size_t)pane_count, sizeof(*s->pane_term_rows));
+        s->pane_video_suspend = calloc((size_t)pane_count, sizeof(*s->pane_video_suspend));
+        if (!s->pane_stages || !s->pane_term_rows || !s->pane_video_suspend) {
+            stats_destroy(s);
+            return false;
+        }
+    }
+    s->pane_count = pane_count;
+    s->path = path;
+    s->interval_sec = (interval_ms > 0 ? interval_ms : 1000) / 1000.0;
+    s->window_start_sec = stats_now_sec();
+    s->next_write_sec = s->window_start_sec + s->interval_sec;
+    return true;
+}
+
+void stats_destroy(stats_ctx *s) {
+    if (!s) return;
+    free(s->pane_stages);
+    free(s->pane_term_rows);
+    free(s->pane_video_suspend);
+    s->pane_stages = NULL;
+    s->pane_term_rows = NULL;
+    s->pane_video_suspend = NULL;
+    s->pane_count = 0;
+}
+
+void stats_record(stats_ctx *s, stats_stage stage, uint64_t start_ns) {
+    uint64_t now = stats_now_ns();
+    stats_hist_add(&s->stages[stage], now > start_ns ? (now - start_ns) / 1000u : 0);
+}
+
+void stats_record_pane(stats_ctx *s, int pane_index, stats_pane_stage stage, uint64_t start_ns) {
+    if (!s->pane_stages || pane_index < 0 || pane_index >= s->pane_count) return;
+    uint64_t now = stats_now_ns();
+    stats_hist_add(&s->pane_stages[pane_index * STATS_PANE_STAGE_COUNT + stage],
+                   now > start_ns ? (now - start_ns) / 1000u : 0);
+}
+
+void stats_add_term_rows(stats_ctx *s, int pane_index, unsigned long long rendered,
+                         unsigned long long skipped, unsigned long long upload_bytes) {
+    s->term_rows_total.rendered += rendered;
+    s->term_rows_total.skipped += skipped;
+    s->term_rows_total.upload_bytes += upload_bytes;
+    if (!s->pane_term_rows || pane_index < 0 || pane_index >= s->pane_count) return;
+    stats_term_rows *rows = &s->pane_term_rows[pane_index];
+    rows->rendered += rendered;
+    rows->skipped += skipped;
+    rows->upload_bytes += upload_bytes;
+}
+
+void stats_add_video_suspend(stats_ctx *s, int pane_index, uint64_t paused_ns, unsigned long long frames) {
+    if (!s->pane_video_suspend || pane_index < 0 || pane_index >= s->pane_count) return;
+    s->pane_video_suspend[pane_index].paused_ns += paused_ns;
+    s->pane_video_suspend[pane_index].frames += frames;
+}
+
+void stats_record_allocs(stats_ctx *s, uint64_t *mark) {
+    if (!stats_alloc_counting()) return;
+    uint64_t now = stats_thread_allocs();
+    stats_hist_add(&s->loop_allocs, now - *mark);
+    *mark = now;
+}
+
+static void stats_write_hist(FILE *f, const char *name, const stats_hist *h, bool last) {
+    fprintf(f, "    \"%s\": {\"count\": %llu, \"mean_us\": %llu, \"p50_us\": %llu, \"p95_us\": %llu, "
+               "\"p99_us\": %llu, \"max_us\": %llu}%s\n",
+            name, (unsigned long long)h->count,
+            (unsigned long long)(h->count ? h->sum_us / h->count : 0),
+            (unsigned long long)stats_hist_percentile_us(h, 50.0),
+            (unsigned long long)stats_hist_percentile_us(h, 95.0),
+            (unsigned long long)stats_hist_percentile_us(h, 99.0),
+            (unsigned long long)h->max_us, last ? "" : ",");
+}
+
+static bool stats_write_file(const stats_ctx *s, double now, unsigned long long presented_frames,
+                             unsigned long long idle_frames, unsigned long long partial_frames) {
+    char tmp_path[4096];
+    int tmp_len = snprintf(tmp_path, sizeof(tmp_path), "%s.tmp.%ld", s->path, (long)getpid());
+    if (tmp_len <= 0 || (size_t)tmp_len >= sizeof(tmp_path)) return false;
+    FILE *f = fopen(tmp_path, "w");
+    if (!f) return false;
+    fprintf(f, "{\n  \"interval_sec\": %.3f,\n", now - s->window_start_sec);
+    fprintf(f, "  \"frames_total\": {\"presented\": %llu, \"idle\": %llu, \"partial\": %llu},\n",
+            presented_frames, idle_frames, partial_frames);
+    if (stats_alloc_counting()) {
+        const stats_hist *a = &s->loop_allocs;
+        fprintf(f, "  \"allocs_per_loop\": {\"count\": %llu, \"mean\": %.2f, \"p50\": %llu, \"p99\": %llu, "
+                   "\"max\": %llu},\n",
+                (unsigned long long)a->count, a->count ? (double)a->sum_us / (double)a->count : 0.0,
+                (unsigned long long)stats_hist_percentile_us(a, 50.0),
+                (unsigned long long)stats_hist_percentile_us(a, 99.0), (unsigned long long)a->max_us);
+    }
+    glyph_cache_stats glyphs;
+    glyph_cache_get_stats(&glyphs);
+    fprintf(f, "  \"glyph_cache\": {\"hits\": %llu, \"misses\": %llu, \"evictions\": %llu, \"fallbacks\": %llu, "
+               "\"missing\": %llu, \"entries\": %d},\n",
+            glyphs.hits, glyphs.misses, glyphs.evictions, glyphs.fallbacks, glyphs.missing, glyphs.entries);
+    fprintf(f, "  \"stages\": {\n");
+    for (int i = 0; i < STATS_STAGE_COUNT; ++i) {
+        stats_write_hist(f, stats_stage_names[i], &s->stages[i], i == STATS_STAGE_COUNT - 1);
+    }
+    fprintf(f, "  },\n  \"panes\": [\n");
+    for (int p = 0; p < s->pane_count; ++p) {
+        fprintf(f, "   {\n    \"pane\": %d,\n", p + 1);
+        const stats_term_rows *rows = &s->pane_term_rows[p];
+        fprintf(f, "    \"term_rows\": {\"rendered\": %llu, \"skipped\": %llu, \"upload_bytes\": %llu},\n",
+                rows->rendered, rows->skipped, rows->upload_bytes);
+        const stats_video_suspend *suspend = &s->pane_video_suspend[p];
+        fprintf(f, "    \"video_hidden\": {\"paused_sec\": %.3f, \"frames_not_decoded\": %llu},\n",
+                (double)suspend->paused_ns / 1e9, suspend->frames);
+        for (int i = 0; i < STATS_PANE_STAGE_COUNT; ++i) {
+            stats_write_hist(f, stats_pane_stage_names[i], &s->pane_stages[p * STATS_PANE_STAGE_COUNT + i],
+                             i == STATS_PANE_STAGE_COUNT - 1);
+        }
+        fprintf(f, "   }%s\n", p == s->pane_count - 1 ? "" : ",");
+    }
+    fprintf(f, "  ]\n}\n");
+    bool ok = !ferror(f);
+    if (fclose(f) != 0) ok = false;
+    if (ok && rename(tmp_path, s->path) != 0) ok = false;
+    if (!ok) {
+        fprintf(stderr, "stats write failed for %s: %s\n", s->path, strerror(errno));
+        remove(tmp_path);
+    }
+    return ok;
+}
+
+bool stats_write_due(const stats_ctx *s) {
+    return s->path && stats_now_sec() >= s->next_write_sec;
+}
+
+bool stats_maybe_write(stats_ctx *s, unsigned long long presented_frames, unsigned long long idle_frames,
+                       unsigned long long partial_frames) {
+    if (!s->path) return false;
+    double now = stats_now_sec();
+    if (now < s->next_write_sec) return false;
+    bool ok = stats_write_file(s, now, presented_frames, idle_frames, partial_frames);
+    memset(s->stages, 0, sizeof(s->stages));
+    memset(&s->loop_allocs, 0, sizeof(s->loop_allocs));
+    if (s->pane_stages) {
+        memset(s->pane_stages, 0, (size_t)s->pane_count * STATS_PANE_STAGE_COUNT * sizeof(*s->pane_stages));
+    }
+    if (s->pane_term_rows) memset(s->pane_term_rows, 0, (size_t)s->pane_count * sizeof(*s->pane_term_rows));
+    if (s->pane_video_suspend) {
+        memset(s->pane_video_suspend, 0, (size_t)s->pane_count * sizeof(*s->pane_video_suspend));
+    }
+    s->window_start_sec = now;
+    s->next_write_sec = now + s->interval_sec;
+    return ok;
+}
@@ -0,0 +1,97 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Per-stage loop timing. Every sample is a CLOCK_MONOTONIC delta dropped into a
+// fixed log-linear histogram (8 buckets per power of two, ~12% resolution from
+// 1 us to 16 s), so recording is a clock read and an increment and can stay on.
+// When a stats file is configured the window is written out as JSON and reset
+// every interval.
+
+typedef enum {
+    STATS_STAGE_POLL_WAIT = 0,
+    STATS_STAGE_INPUT,
+    STATS_STAGE_RUNTIME_EVENTS,
+    STATS_STAGE_PANE_POLL,
+    STATS_STAGE_LAYOUT,
+    STATS_STAGE_COMPOSE,
+    STATS_STAGE_OSD,
+    STATS_STAGE_SNAPSHOT,
+    STATS_STAGE_SWAP,
+    STATS_STAGE_PAGE_FLIP,
+    STATS_STAGE_FRAME,
+    STATS_STAGE_COUNT
+} stats_stage;
+
+typedef enum {
+    STATS_PANE_TERM_POLL = 0,
+    STATS_PANE_TERM_RENDER,
+    STATS_PANE_MPV_RENDER,
+    STATS_PANE_STAGE_COUNT
+} stats_pane_stage;
+
+#define STATS_HIST_SUB_BITS 3
+#define STATS_HIST_MAX_LOG2 24
+#define STATS_HIST_BUCKETS ((STATS_HIST_MAX_LOG2 - STATS_HIST_SUB_BITS + 2) << STATS_HIST_SUB_BITS)
+
+typedef struct {
+    uint32_t buckets[STATS_HIST_BUCKETS];
+    uint64_t count;
+    uint64_t sum_us;
+    uint64_t max_us;
+} stats_hist;
+
+// Terminal row work: rows rendered, damaged rows skipped as unchanged, bytes uploaded.
+typedef struct {
+    unsigned long long rendered;
+    unsigned long long skipped;
+    unsigned long long upload_bytes;
+} stats_term_rows;
+
+// Decoding a media pane avoided while off screen: time paused and frames not decoded.
+typedef struct {
+    uint64_t paused_ns;
+    unsigned long long frames;
+} stats_video_suspend;
+
+typedef struct {
+    stats_hist stages[STATS_STAGE_COUNT];
+    stats_hist loop_allocs; // heap allocations per loop iteration (ALLOC_STATS builds)
+    stats_hist *pane_stages;
+    stats_term_rows *pane_term_rows; // per pane, current window
+    stats_term_rows term_rows_total; // all panes since start
+    stats_video_suspend *pane_video_suspend; // per pane, current window
+    int pane_count;
+    const char *path;
+    double interval_sec;
+    double window_start_sec;
+    double next_write_sec;
+} stats_ctx;
+
+uint64_t stats_now_ns(void);
+// Heap allocations (malloc/calloc/realloc) made by the calling thread so far.
+// Only counted in builds with -DKMS_MOSAIC_ALLOC_STATS (make ALLOC_STATS=1),
+// which interposes glibc's allocator; stats_alloc_counting() reports which.
+uint64_t stats_thread_allocs(void);
+bool stats_alloc_counting(void);
+bool stats_init(stats_ctx *s, int pane_count, const char *path, int interval_ms);
+void stats_destroy(stats_ctx *s);
+void stats_hist_add(stats_hist *h, uint64_t us);
+uint64_t stats_hist_percentile_us(const stats_hist *h, double pct);
+// Record the time elapsed since start_ns (from stats_now_ns) against a stage.
+void stats_record(stats_ctx *s, stats_stage stage, uint64_t start_ns);
+void stats_record_pane(stats_ctx *s, int pane_index, stats_pane_stage stage, uint64_t start_ns);
+void stats_add_term_rows(stats_ctx *s, int pane_index, unsigned long long rendered,
+                         unsigned long long skipped, unsigned long long upload_bytes);
+void stats_add_video_suspend(stats_ctx *s, int pane_index, uint64_t paused_ns, unsigned long long frames);
+// Record the allocations made since *mark (from stats_thread_allocs) and move the mark forward.
+void stats_record_allocs(stats_ctx *s, uint64_t *mark);
+// A stats file is configured and the next stats_maybe_write() will write it.
+bool stats_write_due(const stats_ctx *s);
+// Write and reset the current window once the interval has passed. Returns true if written.
+bool stats_maybe_write(stats_ctx *s, unsigned long long presented_frames, unsigned long long idle_frames,
+                       unsigned long long partial_frames);
+
+#endif
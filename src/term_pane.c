@@ -1,17 +1,24 @@
 #define _GNU_SOURCE
 #include "term_pane.h"
 #include "font_util.h"
+#include "glyph_cache.h"
 #include "color.h"
+#include "span.h"
+#include "term_rows.h"
 
 #include <assert.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <poll.h>
+#include <pthread.h>
 #include <signal.h>
+#include <stdatomic.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/eventfd.h>
 #include <sys/ioctl.h>
 #ifdef __linux__
 #include <sys/prctl.h>
@@ -19,52 +26,48 @@
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <termios.h>
+#include <time.h>
 #include <unistd.h>
 
 #include <EGL/egl.h>
 #include <GLES2/gl2.h>
 
-#include <fontconfig/fontconfig.h>
-#include <ft2build.h>
-#include FT_FREETYPE_H
-
-#define TERM_PANE_MAX_DIRTY_RANGES 16
-
-typedef struct {
-    uint32_t codepoint;
-    int w, h, bearing_x, bearing_y, advance;
-    unsigned char *bitmap; // 8-bit alpha
-} glyph_bitmap;
+// Atlas renderer: one shared A8 atlas of glyph tiles one or two cells wide
+// (double-width glyphs), packed in shelves of equal cell height, plus a
+// per-pane RGBA grid of 3 texels per cell (atlas tile origin, fg, bg).
+#define TERM_ATLAS_SIZE 2048
+#define TERM_ATLAS_MAX_SHELVES 128
+#define TERM_ATLAS_CACHE_CAP 8192
+#define TERM_GRID_TEXELS_PER_CELL 3
+// Bytes a pane worker parses between attempts to publish a snapshot.
+#define TERM_PANE_WORKER_READ_BYTES (64 * 1024)
 
 typedef struct {
-    uint32_t cp;
-    glyph_bitmap gb;
-    uint64_t last_used;
-    int used;
-} glyph_cache_entry;
-
-typedef struct {
-    FT_Library ftlib;
-    FT_Face face;
+    glyph_font *face; // shared face and glyph cache (glyph_cache.c)
     int px_size;
     int cell_w, cell_h, baseline;
-    // Bounded glyph cache with open addressing and simple LRU eviction.
-    glyph_cache_entry *cache;
-    int cache_cap;
-    int cache_count;
-    uint64_t cache_tick;
+    glyph_scratch scratch; // copies of evictable glyphs for this pane's renderer
 } font_ctx;
 
 typedef struct {
     GLuint tex;
     int tex_w, tex_h;
     bool dirty;
-    int dirty_y0, dirty_y1;
-    struct { int y0, y1; } dirty_ranges[TERM_PANE_MAX_DIRTY_RANGES];
-    int dirty_count;
     uint8_t *pixels; // RGBA8
 } pane_tex;
 
+// Surface rows handed from a pane worker to the render thread. The worker fills
+// it while the state is FREE and flips it to READY; the render thread uploads
+// the rows and flips it back, so neither side ever waits on the other.
+enum { PANE_SNAPSHOT_FREE = 0, PANE_SNAPSHOT_READY = 1 };
+
+typedef struct {
+    uint8_t *pixels; // same layout as the surface
+    uint64_t *rows;  // surface rows to upload
+    int ring_row;
+    term_pane_counters counters;
+} pane_snapshot;
+
 struct term_pane {
     pane_layout layout;
     VTerm *vt;
@@ -77,120 +80,128 @@ struct term_pane {
     pane_tex surface;
     uint8_t alpha;
     bool pending_full_rebuild;
-    struct { int start_row, end_row; } pending_dirty[TERM_PANE_MAX_DIRTY_RANGES];
-    int pending_dirty_count;
+    // Per-row damage state, sized to layout.rows: bits for terminal rows waiting
+    // to be rendered and surface rows waiting to be uploaded, and a hash of the
+    // cells each surface row was last rendered from (0 = unknown).
+    uint64_t *pending_rows;
+    uint64_t *upload_rows;
+    uint64_t *row_hash;
+    int row_state_rows;
+    term_pane_counters counters; // render thread: uploads, plus rows taken from raster
+    term_pane_counters raster;   // rows counted by the thread that renders them
+    VTermScreenCell *row_cells; // grow-only scratch row for update_damaged_rows
+    int row_cells_cap;
+    // The surface is a ring of terminal rows: terminal row 0 lives at surface
+    // row ring_row, so a full-screen scroll only moves the origin.
+    int ring_row;
+    // Fast-forward under flood: rows stay pending while input is still queued,
+    // until flood_render_ns passes or the pane is drawn.
+    bool render_deferred;
+    uint64_t flood_render_ns;
+    // Synchronized update (DEC mode 2026): nothing is rendered while
+    // sync_active; sync_deadline_ns (0 = none) forces held-back damage out.
+    bool sync_active;
+    uint64_t sync_deadline_ns;
+    int sync_scan; // bytes of CSI ? 2026 matched so far, across reads
+
+    // Worker mode (term_pane_set_threaded): the worker owns the PTY, VTerm and
+    // surface; the render thread only sees the snapshot and the texture.
+    bool threaded;
+    bool worker_running;
+    pthread_t worker;
+    atomic_bool worker_stop;
+    int wake_fd;  // render thread -> worker: stop requested or snapshot returned
+    int ready_fd; // worker -> main loop: snapshot published or PTY hung up
+    atomic_bool pty_hung_up; // worker saw the PTY hang up; cleared by respawn
+    atomic_int snapshot_state;
+    pane_snapshot snapshot;
+    bool snapshot_claimed;  // READY snapshot the main loop has damaged the pane for
+    int shown_ring_row;     // ring origin of the rows in the texture
+    int published_ring_row; // worker: ring origin of the last published snapshot
 
     int use_shell_cmd;
     char *shell_cmd;
     char **argv_dup;
+
+    unsigned atlas_generation;
 };
 
+typedef struct {
+    uint32_t cp;
+    int px;
+    int width; // cells the tile spans
+    int x, y;
+    int used;
+} atlas_entry;
+
+typedef struct {
+    GLuint tex;
+    struct { int y, h, x; } shelves[TERM_ATLAS_MAX_SHELVES];
+    int shelf_count;
+    int next_y;
+    atlas_entry *entries;
+    int entry_count;
+    unsigned generation;
+    uint8_t *scratch;
+    uint8_t *coverage;
+    size_t scratch_cap;
+    int users;
+} glyph_atlas;
+
+static term_render_mode g_render_mode = TERM_RENDER_CPU;
+static glyph_atlas g_atlas;
+static bool g_threaded;
+
+void term_pane_set_render_mode(term_render_mode mode) {
+    g_render_mode = mode;
+}
+
+term_render_mode term_pane_get_render_mode(void) {
+    return g_render_mode;
+}
+
+void term_pane_set_threaded(bool threaded) {
+    if (threaded && g_render_mode != TERM_RENDER_CPU) {
+        fprintf(stderr, "term: --term-threads needs the cpu renderer; panes stay on the main thread\n");
+        threaded = false;
+    }
+    // Pick the span kernels here so workers never race on the lazy selection.
+    if (threaded) (void)span_kernel_name();
+    g_threaded = threaded;
+}
+
 static void die(const char *msg) {
     perror(msg);
     exit(1);
 }
 
-static void glyph_bitmap_reset(glyph_bitmap *g) {
-    if (!g) return;
-    free(g->bitmap);
-    memset(g, 0, sizeof(*g));
-}
-
 static void font_init(font_ctx *f, int px_size) {
-    if (FT_Init_FreeType(&f->ftlib)) die("FT_Init_FreeType");
-    char *path = kms_font_find_monospace();
-    if (!path) die("fontconfig monospace not found");
-    if (FT_New_Face(f->ftlib, path, 0, &f->face)) die("FT_New_Face");
-    free(path);
-    FT_Set_Pixel_Sizes(f->face, 0, px_size);
+    f->face = glyph_font_acquire(px_size);
+    if (!f->face) die("glyph_font_acquire");
     f->px_size = px_size;
-    // Measure cell from 'M'
-    FT_Load_Char(f->face, 'M', FT_LOAD_RENDER);
-    f->cell_w = (f->face->glyph->advance.x + 31) / 64; // 26.6 to int
+    int advance = 0, ascender = 0;
+    glyph_font_metrics(f->face, &advance, &ascender);
+    f->cell_w = advance;
     f->cell_h = px_size + 2; // add small leading
-    f->baseline = (f->face->size->metrics.ascender + 31) / 64;
-    f->cache_cap = 2048;
-    f->cache = calloc((size_t)f->cache_cap, sizeof(*f->cache));
-    f->cache_count = 0;
-    f->cache_tick = 0;
+    f->baseline = ascender;
 }
 
 static void font_destroy(font_ctx *f) {
-    if (f->cache) {
-        for (int i=0; i<f->cache_cap; i++) {
-            if (f->cache[i].used) glyph_bitmap_reset(&f->cache[i].gb);
-        }
-        free(f->cache);
-    }
-    if (f->face) FT_Done_Face(f->face);
-    if (f->ftlib) FT_Done_FreeType(f->ftlib);
+    glyph_scratch_free(&f->scratch);
+    glyph_font_release(f->face);
+    f->face = NULL;
 }
 
 static uint32_t glyph_hash(uint32_t cp) {
     return cp * 2654435761u;
 }
 
-static glyph_cache_entry *find_glyph_slot(font_ctx *f, uint32_t cp, int *empty_idx_out) {
-    if (empty_idx_out) *empty_idx_out = -1;
-    if (!f->cache || f->cache_cap <= 0) return NULL;
-    uint32_t mask = (uint32_t)(f->cache_cap - 1);
-    uint32_t idx = glyph_hash(cp) & mask;
-    for (int probe = 0; probe < f->cache_cap; probe++) {
-        glyph_cache_entry *entry = &f->cache[(idx + (uint32_t)probe) & mask];
-        if (!entry->used) {
-            if (empty_idx_out && *empty_idx_out < 0) {
-                *empty_idx_out = (int)(((idx + (uint32_t)probe) & mask));
-            }
-            return NULL;
-        }
-        if (entry->cp == cp) return entry;
-    }
-    return NULL;
-}
-
-static int find_lru_slot(font_ctx *f) {
-    int lru_idx = 0;
-    uint64_t lru_tick = UINT64_MAX;
-    for (int i = 0; i < f->cache_cap; i++) {
-        glyph_cache_entry *entry = &f->cache[i];
-        if (!entry->used) return i;
-        if (entry->last_used < lru_tick) {
-            lru_tick = entry->last_used;
-            lru_idx = i;
-        }
-    }
-    return lru_idx;
-}
-
-static glyph_bitmap* get_glyph(font_ctx *f, uint32_t cp) {
-    int empty_idx = -1;
-    glyph_cache_entry *entry = find_glyph_slot(f, cp, &empty_idx);
-    if (entry) {
-        entry->last_used = ++f->cache_tick;
-        return &entry->gb;
-    }
-    if (FT_Load_Char(f->face, cp, FT_LOAD_RENDER)) return NULL;
-    FT_GlyphSlot slot = f->face->glyph;
-    int idx = empty_idx >= 0 ? empty_idx : find_lru_slot(f);
-    entry = &f->cache[idx];
-    if (!entry->used) f->cache_count++;
-    else glyph_bitmap_reset(&entry->gb);
-    entry->cp = cp;
-    entry->used = 1;
-    entry->last_used = ++f->cache_tick;
-    glyph_bitmap *g = &entry->gb;
-    g->codepoint = cp;
-    g->w = slot->bitmap.width; g->h = slot->bitmap.rows;
-    g->bearing_x = slot->bitmap_left; g->bearing_y = slot->bitmap_top;
-    g->advance = (slot->advance.x + 31)/64;
-    size_t sz = (size_t)g->w * g->h; g->bitmap = malloc(sz);
-    memcpy(g->bitmap, slot->bitmap.buffer, sz);
-    return g;
+static const glyph_bitmap *get_glyph(font_ctx *f, uint32_t cp) {
+    return glyph_cache_get(f->face, cp, &f->scratch);
 }
 
 static void pane_tex_init(pane_tex *t, int w, int h) {
     t->tex_w = w; t->tex_h = h; t->dirty = true;
-    t->dirty_y0 = 0; t->dirty_y1 = h; t->dirty_count = 1; t->dirty_ranges[0].y0 = 0; t->dirty_ranges[0].y1 = h;
     glGenTextures(1, &t->tex);
     glBindTexture(GL_TEXTURE_2D, t->tex);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
@@ -207,27 +218,33 @@ static void pane_tex_destroy(pane_tex *t) {
     memset(t, 0, sizeof(*t));
 }
 
+// Surface row (in terminal rows) that holds terminal row `row`.
+static int pane_ring_row(const term_pane *tp, int row) {
+    return term_rows_ring_row(tp->ring_row, row, tp->layout.rows);
+}
+
+static void pane_row_state_init(term_pane *tp) {
+    int rows = tp->layout.rows;
+    if (tp->row_state_rows < rows) {
+        uint64_t *pending = realloc(tp->pending_rows, term_rows_words(rows) * sizeof(*pending));
+        if (pending) tp->pending_rows = pending;
+        uint64_t *upload = realloc(tp->upload_rows, term_rows_words(rows) * sizeof(*upload));
+        if (upload) tp->upload_rows = upload;
+        uint64_t *hash = realloc(tp->row_hash, (size_t)rows * sizeof(*hash));
+        if (hash) tp->row_hash = hash;
+        if (!pending || !upload || !hash) die("realloc");
+    }
+    tp->row_state_rows = rows;
+    memset(tp->pending_rows, 0, term_rows_words(rows) * sizeof(*tp->pending_rows));
+    memset(tp->upload_rows, 0, term_rows_words(rows) * sizeof(*tp->upload_rows));
+    memset(tp->row_hash, 0, (size_t)rows * sizeof(*tp->row_hash));
+}
+
 static void pane_add_pending_rows(term_pane *tp, int start_row, int end_row) {
     if (!tp || tp->pending_full_rebuild) return;
     if (start_row < 0) start_row = 0;
-    if (end_row > tp->layout.rows) end_row = tp->layout.rows;
-    if (start_row >= end_row) return;
-    for (int i = 0; i < tp->pending_dirty_count; i++) {
-        int cur_start = tp->pending_dirty[i].start_row;
-        int cur_end = tp->pending_dirty[i].end_row;
-        if (end_row < cur_start || start_row > cur_end) continue;
-        if (start_row < cur_start) tp->pending_dirty[i].start_row = start_row;
-        if (end_row > cur_end) tp->pending_dirty[i].end_row = end_row;
-        return;
-    }
-    if (tp->pending_dirty_count >= TERM_PANE_MAX_DIRTY_RANGES) {
-        tp->pending_full_rebuild = true;
-        tp->pending_dirty_count = 0;
-        return;
-    }
-    tp->pending_dirty[tp->pending_dirty_count].start_row = start_row;
-    tp->pending_dirty[tp->pending_dirty_count].end_row = end_row;
-    tp->pending_dirty_count++;
+    if (end_row > tp->row_state_rows) end_row = tp->row_state_rows;
+    for (int y = start_row; y < end_row; y++) term_rows_set(tp->pending_rows, y);
 }
 
 static int pane_damage_cb(VTermRect rect, void *user) {
@@ -236,8 +253,11 @@ static int pane_damage_cb(VTermRect rect, void *user) {
     return 1;
 }
 
+static bool pane_scroll_surface(term_pane *tp, VTermRect dest, VTermRect src);
+
 static int pane_moverect_cb(VTermRect dest, VTermRect src, void *user) {
     term_pane *tp = user;
+    if (pane_scroll_surface(tp, dest, src)) return 1;
     pane_add_pending_rows(tp, src.start_row, src.end_row);
     pane_add_pending_rows(tp, dest.start_row, dest.end_row);
     return 1;
@@ -249,7 +269,6 @@ static int pane_resize_cb(int rows, int cols, void *user) {
     term_pane *tp = user;
     if (!tp) return 1;
     tp->pending_full_rebuild = true;
-    tp->pending_dirty_count = 0;
     return 1;
 }
 
@@ -312,21 +331,10 @@ static void ensure_pane_program(void) {
 }
 
 static void draw_textured_quad(GLuint tex, int x, int y, int w, int h,
-                               float u1, float v1, int fb_w, int fb_h) {
+                               float v0, float u1, float v1, const render_view *view) {
     ensure_pane_program();
-    // Convert to NDC
-    float L = (2.0f * x / fb_w) - 1.0f;
-    float R = (2.0f * (x + w) / fb_w) - 1.0f;
-    float T = 1.0f - (2.0f * y / fb_h);
-    float B = 1.0f - (2.0f * (y + h) / fb_h);
-    float verts[] = {
-        L,B, 0,0,
-        R,B, u1,0,
-        R,T, u1,v1,
-        L,B, 0,0,
-        R,T, u1,v1,
-        L,T, 0,v1
-    };
+    float verts[24];
+    render_view_quad(view, (float)x, (float)y, (float)w, (float)h, 0.f, v0, u1, v1, verts);
     glUseProgram(pane_program);
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, tex);
@@ -343,6 +351,101 @@ static void draw_textured_quad(GLuint tex, int x, int y, int w, int h,
     glDisable(GL_BLEND);
 }
 
+// Grid shader for the atlas renderer: each fragment finds its cell, reads the
+// three grid texels and mixes bg/fg by the atlas coverage of that cell pixel.
+static GLuint atlas_program = 0;
+static GLint u_atlas_grid = -1, u_atlas_tex = -1, u_atlas_cell = -1;
+static GLint u_atlas_grid_size = -1, u_atlas_size = -1, u_atlas_alpha = -1, u_atlas_ring_row = -1;
+
+static void ensure_atlas_program(void) {
+    if (atlas_program) return;
+    ensure_pane_program();
+    const char *vs =
+        "#version 100\n"
+        "attribute vec2 a_pos;\n"
+        "attribute vec2 a_uv;\n"
+        "varying vec2 v_px;\n"
+        "void main(){ v_px=a_uv; gl_Position=vec4(a_pos,0.0,1.0);}";
+    const char *fs =
+        "#version 100\n"
+        "#ifdef GL_FRAGMENT_PRECISION_HIGH\n"
+        "precision highp float;\n"
+        "#else\n"
+        "precision mediump float;\n"
+        "#endif\n"
+        "varying vec2 v_px;\n"
+        "uniform sampler2D u_grid;\n"
+        "uniform sampler2D u_atlas;\n"
+        "uniform vec2 u_cell;\n"
+        "uniform vec2 u_grid_size;\n"
+        "uniform float u_atlas_size;\n"
+        "uniform float u_alpha;\n"
+        "uniform float u_ring_row;\n"
+        "void main(){\n"
+        "  vec2 cell = floor(v_px / u_cell);\n"
+        "  vec2 inner = floor(v_px - cell * u_cell);\n"
+        "  float gx = cell.x * 3.0;\n"
+        "  float gy = (mod(cell.y + u_ring_row, u_grid_size.y) + 0.5) / u_grid_size.y;\n"
+        "  vec4 g = texture2D(u_grid, vec2((gx + 0.5) / u_grid_size.x, gy));\n"
+        "  vec4 fg = texture2D(u_grid, vec2((gx + 1.5) / u_grid_size.x, gy));\n"
+        "  vec4 bg = texture2D(u_grid, vec2((gx + 2.5) / u_grid_size.x, gy));\n"
+        "  float cov = 0.0;\n"
+        "  if (g.a < 0.5) {\n"
+        "    vec2 origin = floor(g.rb * 255.0 + 0.5) + floor(g.ga * 255.0 + 0.5) * 256.0;\n"
+        "    cov = texture2D(u_atlas, (origin + inner + 0.5) / u_atlas_size).r;\n"
+        "  }\n"
+        "  gl_FragColor = vec4(mix(bg.rgb, fg.rgb, cov), u_alpha);\n"
+        "}";
+    GLuint vs_id = compile_shader(GL_VERTEX_SHADER, vs);
+    GLuint fs_id = compile_shader(GL_FRAGMENT_SHADER, fs);
+    atlas_program = glCreateProgram();
+    glAttachShader(atlas_program, vs_id);
+    glAttachShader(atlas_program, fs_id);
+    glBindAttribLocation(atlas_program, 0, "a_pos");
+    glBindAttribLocation(atlas_program, 1, "a_uv");
+    glLinkProgram(atlas_program);
+    GLint ok=0; glGetProgramiv(atlas_program, GL_LINK_STATUS, &ok);
+    if (!ok) { fprintf(stderr, "atlas link error\n"); exit(1); }
+    u_atlas_grid = glGetUniformLocation(atlas_program, "u_grid");
+    u_atlas_tex = glGetUniformLocation(atlas_program, "u_atlas");
+    u_atlas_cell = glGetUniformLocation(atlas_program, "u_cell");
+    u_atlas_grid_size = glGetUniformLocation(atlas_program, "u_grid_size");
+    u_atlas_size = glGetUniformLocation(atlas_program, "u_atlas_size");
+    u_atlas_alpha = glGetUniformLocation(atlas_program, "u_alpha");
+    u_atlas_ring_row = glGetUniformLocation(atlas_program, "u_ring_row");
+}
+
+static void draw_atlas_grid(const term_pane *tp, const render_view *view) {
+    ensure_atlas_program();
+    const pane_layout *lay = &tp->layout;
+    float pw = (float)lay->w, ph = (float)lay->h;
+    // Same orientation as draw_textured_quad: grid row 0 sits at the B edge.
+    float verts[24];
+    render_view_quad(view, (float)lay->x, (float)lay->y, pw, ph, 0.f, 0.f, pw, ph, verts);
+    glUseProgram(atlas_program);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, g_atlas.tex);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, tp->surface.tex);
+    glUniform1i(u_atlas_grid, 0);
+    glUniform1i(u_atlas_tex, 1);
+    glUniform2f(u_atlas_cell, (float)tp->font.cell_w, (float)tp->font.cell_h);
+    glUniform2f(u_atlas_grid_size, (float)tp->surface.tex_w, (float)tp->surface.tex_h);
+    glUniform1f(u_atlas_size, (float)TERM_ATLAS_SIZE);
+    glUniform1f(u_atlas_alpha, tp->alpha / 255.0f);
+    glUniform1f(u_atlas_ring_row, (float)tp->shown_ring_row);
+    glBindBuffer(GL_ARRAY_BUFFER, pane_vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STREAM_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4*sizeof(float), (void*)0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4*sizeof(float), (void*)(2*sizeof(float)));
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glDrawArrays(GL_TRIANGLES, 0, 6);
+    glDisable(GL_BLEND);
+}
+
 static void set_pty_winsize(int pty_fd, int cols, int rows) {
     struct winsize ws = { .ws_col = (unsigned short)cols, .ws_row = (unsigned short)rows };
     ioctl(pty_fd, TIOCSWINSZ, &ws);
@@ -431,161 +534,46 @@ static char **dup_argv(char *const argv[]){
 
 static void free_argv(char **argv){ if(!argv) return; for (size_t i=0; argv[i]; i++) free(argv[i]); free(argv); }
 
-static int sattr_to_rgb_idx(const VTermScreenCell *cell, int is_fg) {
+// Resolve a cell colour to 24-bit RGB: truecolor cells keep their exact value,
+// indexed ones go through the constant xterm palette.
+static rgb8 cell_rgb(const VTermScreenCell *cell, int is_fg) {
     VTermColor c = is_fg ? cell->fg : cell->bg;
     // libvterm represents default fg/bg as distinct enum values
     if (c.type == VTERM_COLOR_DEFAULT_FG || c.type == VTERM_COLOR_DEFAULT_BG)
-        return is_fg ? 7 : 0; // white fg / black bg defaults
-    if (c.type == VTERM_COLOR_INDEXED) return c.indexed.idx;
-    if (c.type == VTERM_COLOR_RGB) {
-        // Find closest in 256 palette
-        int best_idx = 15; int best_d = 1<<30;
-        for (int i=0;i<256;i++){
-            rgb8 cc = color_from_index(i);
-            int dr = (int)cc.r - c.rgb.red;
-            int dg = (int)cc.g - c.rgb.green;
-            int db = (int)cc.b - c.rgb.blue;
-            int d = dr*dr+dg*dg+db*db;
-            if (d<best_d){best_d=d;best_idx=i;}
-        }
-        return best_idx;
-    }
-    return is_fg ? 7 : 0;
-}
-
-// Helpers to draw simple box-drawing lines into the pane texture
-static void draw_h_line(pane_tex *tex, int y, int xstart, int xend,
-                        int x0, int x1, int y0, int y1,
-                        int thickness, rgb8 fgc, uint8_t alpha) {
-    if (xstart > xend) { int t = xstart; xstart = xend; xend = t; }
-    if (y < y0) y = y0;
-    if (y >= y1) y = y1 - 1;
-    for (int ty = y - thickness/2; ty <= y + thickness/2; ty++) {
-        if (ty < y0 || ty >= y1) continue;
-        int xs = xstart < x0 ? x0 : xstart;
-        int xe = xend   > x1 ? x1 : xend;
-        if (xs < 0) xs = 0;
-        if (xe > tex->tex_w) xe = tex->tex_w;
-        if (xs >= xe) continue;
-        uint8_t *row = tex->pixels + (size_t)ty * tex->tex_w * 4 + xs * 4;
-        for (int x = xs; x < xe && x < tex->tex_w; x++) {
-            row[0] = fgc.r; row[1] = fgc.g; row[2] = fgc.b; row[3] = alpha; row += 4;
-        }
-    }
+        return color_palette[is_fg ? 7 : 0]; // white fg / black bg defaults
+    if (c.type == VTERM_COLOR_INDEXED) return color_palette[c.indexed.idx];
+    if (c.type == VTERM_COLOR_RGB) return (rgb8){ c.rgb.red, c.rgb.green, c.rgb.blue };
+    return color_palette[is_fg ? 7 : 0];
 }
 
-static void draw_v_line(pane_tex *tex, int x, int ystart, int yend,
-                        int x0, int x1, int y0, int y1,
-                        int thickness, rgb8 fgc, uint8_t alpha) {
-    if (ystart > yend) { int t = ystart; ystart = yend; yend = t; }
-    if (x < x0) x = x0;
-    if (x >= x1) x = x1 - 1;
-    int ys = ystart < y0 ? y0 : ystart;
-    int ye = yend   > y1 ? y1 : yend;
-    if (ys < 0) ys = 0;
-    if (ye > tex->tex_h) ye = tex->tex_h;
-    for (int y = ys; y < ye && y < tex->tex_h; y++) {
-        for (int tx = x - thickness/2; tx <= x + thickness/2; tx++) {
-            if (tx < x0 || tx >= x1) continue;
-            if (tx < 0 || tx >= tex->tex_w) continue;
-            uint8_t *p = tex->pixels + (size_t)y * tex->tex_w * 4 + tx * 4;
-            p[0] = fgc.r; p[1] = fgc.g; p[2] = fgc.b; p[3] = alpha;
-        }
-    }
+static void fill_rect_px(pane_tex *tex, int x0, int y0, int w, int h, uint32_t px) {
+    for (int y = y0; y < y0 + h; y++) span_fill32((uint32_t *)tex->pixels + (size_t)y * tex->tex_w + x0, px, w);
 }
 
-static void composite_cell(term_pane *tp, int cx, int cy, const VTermScreenCell *cell) {
-    font_ctx *font = &tp->font;
-    pane_tex *tex = &tp->surface;
-    uint8_t alpha = tp->alpha;
-    // Fill background
-    int x0 = cx * font->cell_w;
-    int y0 = cy * font->cell_h;
+static uint32_t cell_bg_px(const VTermScreenCell *cell, uint8_t alpha) {
+    rgb8 bgc = cell_rgb(cell, 0);
+    return span_pack_rgba(bgc.r, bgc.g, bgc.b, alpha);
+}
+
+// Draw the cell's glyph over an already filled background.
+static void composite_cell_fg(font_ctx *font, pane_tex *tex, uint8_t alpha, int x0, int y0,
+                              const VTermScreenCell *cell) {
     int x1 = x0 + font->cell_w;
     int y1 = y0 + font->cell_h;
-    rgb8 bgc = color_from_index(sattr_to_rgb_idx(cell, 0));
-    for (int y=y0; y<y1; y++) {
-        uint8_t *row = tex->pixels + (size_t)y * tex->tex_w * 4 + x0 * 4;
-        for (int x=x0; x<x1; x++) {
-            row[0]=bgc.r; row[1]=bgc.g; row[2]=bgc.b; row[3]=alpha; row+=4;
-        }
-    }
-    // Foreground glyphs (support wide=1 only; treat wide as '?')
     uint32_t cp = cell->chars[0];
     if (cp == 0) return;
-    // Handle Unicode box-drawing with simple vector lines for clarity
-    if (cp >= 0x2500 && cp <= 0x257F) {
-        rgb8 fgc = color_from_index(sattr_to_rgb_idx(cell, 1));
-        int thickness = font->cell_h / 8; if (thickness < 1) thickness = 1; if (thickness > 2) thickness = 2;
-        int cxm = (x0 + x1) / 2; // center x
-        int cym = (y0 + y1) / 2; // center y
-        switch (cp) {
-            case 0x2500: case 0x2501: // ─
-                draw_h_line(tex, cym, x0+1, x1-1, x0, x1, y0, y1, thickness, fgc, alpha); return;
-            case 0x2502: case 0x2503: // │
-                draw_v_line(tex, cxm, y0+1, y1-1, x0, x1, y0, y1, thickness, fgc, alpha); return;
-            case 0x250C: // ┌
-                draw_h_line(tex, cym, x0+1, cxm, x0, x1, y0, y1, thickness, fgc, alpha); draw_v_line(tex, cxm, y0+1, cym, x0, x1, y0, y1, thickness, fgc, alpha); return;
-            case 0x2510: // ┐
-                draw_h_line(tex, cym, cxm, x1-1, x0, x1, y0, y1, thickness, fgc, alpha); draw_v_line(tex, cxm, y0+1, cym, x0, x1, y0, y1, thickness, fgc, alpha); return;
-            case 0x2514: // └
-                draw_h_line(tex, cym, x0+1, cxm, x0, x1, y0, y1, thickness, fgc, alpha); draw_v_line(tex, cxm, cym, y1-1, x0, x1, y0, y1, thickness, fgc, alpha); return;
-            case 0x2518: // ┘
-                draw_h_line(tex, cym, cxm, x1-1, x0, x1, y0, y1, thickness, fgc, alpha); draw_v_line(tex, cxm, cym, y1-1, x0, x1, y0, y1, thickness, fgc, alpha); return;
-            case 0x253C: // ┼
-                draw_h_line(tex, cym, x0+1, x1-1, x0, x1, y0, y1, thickness, fgc, alpha); draw_v_line(tex, cxm, y0+1, y1-1, x0, x1, y0, y1, thickness, fgc, alpha); return;
-            case 0x252C: // ┬
-                draw_h_line(tex, cym, x0+1, x1-1, x0, x1, y0, y1, thickness, fgc, alpha); draw_v_line(tex, cxm, y0+1, cym, x0, x1, y0, y1, thickness, fgc, alpha); return;
-            case 0x2534: // ┴
-                draw_h_line(tex, cym, x0+1, x1-1, x0, x1, y0, y1, thickness, fgc, alpha); draw_v_line(tex, cxm, cym, y1-1, x0, x1, y0, y1, thickness, fgc, alpha); return;
-            case 0x251C: // ├
-                draw_h_line(tex, cym, x0+1, cxm, x0, x1, y0, y1, thickness, fgc, alpha); draw_v_line(tex, cxm, y0+1, y1-1, x0, x1, y0, y1, thickness, fgc, alpha); return;
-            case 0x2524: // ┤
-                draw_h_line(tex, cym, cxm, x1-1, x0, x1, y0, y1, thickness, fgc, alpha); draw_v_line(tex, cxm, y0+1, y1-1, x0, x1, y0, y1, thickness, fgc, alpha); return;
-            // Mixed single/double joins: approximate by drawing both segments slightly thicker
-            case 0x256B: // ╋ (thick cross)
-            case 0x256A: // ╊
-            case 0x256D: // ╭
-            case 0x256E: // ╮
-            case 0x256F: // ╯
-            case 0x2570: // ╰
-            case 0x2523: // ┣
-            case 0x252B: // ┫
-            case 0x2533: // ┳
-            case 0x253B: // ┻
-            case 0x254B: // ╋
-                { int t2 = thickness+1; if (t2>3) t2=3; draw_h_line(tex, cym, x0+1, x1-1, x0, x1, y0, y1, t2, fgc, alpha); draw_v_line(tex, cxm, y0+1, y1-1, x0, x1, y0, y1, t2, fgc, alpha); return; }
-            case 0x2550: // double ─
-            { int t2 = thickness+1; if (t2>3) t2=3; draw_h_line(tex, cym, x0+1, x1-1, x0, x1, y0, y1, t2, fgc, alpha); return; }
-            case 0x2551: // double │
-            { int t2 = thickness+1; if (t2>3) t2=3; draw_v_line(tex, cxm, y0+1, y1-1, x0, x1, y0, y1, t2, fgc, alpha); return; }
-            case 0x2554: // double ┌
-            { int t2 = thickness+1; if (t2>3) t2=3; draw_h_line(tex, cym, x0+1, cxm, x0, x1, y0, y1, t2, fgc, alpha); draw_v_line(tex, cxm, y0+1, cym, x0, x1, y0, y1, t2, fgc, alpha); return; }
-            case 0x2557: // double ┐
-            { int t2 = thickness+1; if (t2>3) t2=3; draw_h_line(tex, cym, cxm, x1-1, x0, x1, y0, y1, t2, fgc, alpha); draw_v_line(tex, cxm, y0+1, cym, x0, x1, y0, y1, t2, fgc, alpha); return; }
-            case 0x255A: // double └
-            { int t2 = thickness+1; if (t2>3) t2=3; draw_h_line(tex, cym, x0+1, cxm, x0, x1, y0, y1, t2, fgc, alpha); draw_v_line(tex, cxm, cym, y1-1, x0, x1, y0, y1, t2, fgc, alpha); return; }
-            case 0x255D: // double ┘
-            { int t2 = thickness+1; if (t2>3) t2=3; draw_h_line(tex, cym, cxm, x1-1, x0, x1, y0, y1, t2, fgc, alpha); draw_v_line(tex, cxm, cym, y1-1, x0, x1, y0, y1, t2, fgc, alpha); return; }
-            case 0x256C: // double ┼
-            { int t2 = thickness+1; if (t2>3) t2=3; draw_h_line(tex, cym, x0+1, x1-1, x0, x1, y0, y1, t2, fgc, alpha); draw_v_line(tex, cxm, y0+1, y1-1, x0, x1, y0, y1, t2, fgc, alpha); return; }
-            case 0x2566: // double ┬
-            { int t2 = thickness+1; if (t2>3) t2=3; draw_h_line(tex, cym, x0+1, x1-1, x0, x1, y0, y1, t2, fgc, alpha); draw_v_line(tex, cxm, y0+1, cym, x0, x1, y0, y1, t2, fgc, alpha); return; }
-            case 0x2569: // double ┴
-            { int t2 = thickness+1; if (t2>3) t2=3; draw_h_line(tex, cym, x0+1, x1-1, x0, x1, y0, y1, t2, fgc, alpha); draw_v_line(tex, cxm, cym, y1-1, x0, x1, y0, y1, t2, fgc, alpha); return; }
-            case 0x2560: // double ├
-            { int t2 = thickness+1; if (t2>3) t2=3; draw_h_line(tex, cym, x0+1, cxm, x0, x1, y0, y1, t2, fgc, alpha); draw_v_line(tex, cxm, y0+1, y1-1, x0, x1, y0, y1, t2, fgc, alpha); return; }
-            case 0x2563: // double ┤
-            { int t2 = thickness+1; if (t2>3) t2=3; draw_h_line(tex, cym, cxm, x1-1, x0, x1, y0, y1, t2, fgc, alpha); draw_v_line(tex, cxm, y0+1, y1-1, x0, x1, y0, y1, t2, fgc, alpha); return; }
-            default:
-                // Fallback to ASCII-like minimal rendering
-                draw_h_line(tex, cym, x0+1, x1-1, x0, x1, y0, y1, thickness, fgc, alpha); return;
-        }
-    }
-    glyph_bitmap *g = get_glyph(font, cp);
+    // Box drawing, blocks and braille come back as procedural cell-sized glyphs.
+    const glyph_bitmap *g = get_glyph(font, cp);
     if (!g) return;
-    rgb8 fgc = color_from_index(sattr_to_rgb_idx(cell, 1));
-    int gx = x0 + (font->cell_w - g->w)/2 + g->bearing_x;
+    // Double-width glyphs (CJK, most fallback symbols) span the continuation
+    // cell too, whose background a row composite has already filled.
+    if (cell->width > 1) {
+        x1 = x0 + font->cell_w * cell->width;
+        if (x1 > tex->tex_w) x1 = tex->tex_w;
+    }
+    rgb8 fgc = cell_rgb(cell, 1);
+    uint32_t fg_px = span_pack_rgba(fgc.r, fgc.g, fgc.b, alpha);
+    int gx = x0 + (x1 - x0 - g->w)/2 + g->bearing_x;
     int gy = y0 + font->baseline - g->bearing_y;
     // Clip horizontally to avoid negative pointer math when bearing_x shifts left
     int clip_x0 = gx < x0 ? x0 : gx;
@@ -596,44 +584,323 @@ static void composite_cell(term_pane *tp, int cx, int cy, const VTermScreenCell
             int xx0 = clip_x0 - gx; // start within glyph bitmap
             int xx1 = clip_x1 - gx; // end within glyph bitmap
             uint8_t *row = tex->pixels + (size_t)py * tex->tex_w * 4 + clip_x0 * 4;
-            for (int xx=xx0; xx<xx1; xx++) {
-                uint8_t a = g->bitmap[yy*g->w + xx];
-                if (a) {
-                    uint8_t *p = row + (xx - xx0)*4;
-                    p[0] = (uint8_t)((fgc.r * a + p[0]*(255-a))/255);
-                    p[1] = (uint8_t)((fgc.g * a + p[1]*(255-a))/255);
-                    p[2] = (uint8_t)((fgc.b * a + p[2]*(255-a))/255);
-                    p[3] = alpha;
-                }
+            span_blend_coverage(row, g->bitmap + yy * g->w + xx0, xx1 - xx0, fg_px);
+        }
+    }
+}
+
+static void composite_cell_px(font_ctx *font, pane_tex *tex, uint8_t alpha, int x0, int y0,
+                              const VTermScreenCell *cell) {
+    fill_rect_px(tex, x0, y0, font->cell_w, font->cell_h, cell_bg_px(cell, alpha));
+    composite_cell_fg(font, tex, alpha, x0, y0, cell);
+}
+
+static void composite_cell(term_pane *tp, int cx, int cy, const VTermScreenCell *cell) {
+    composite_cell_px(&tp->font, &tp->surface, tp->alpha,
+                      cx * tp->font.cell_w, pane_ring_row(tp, cy) * tp->font.cell_h, cell);
+}
+
+// Composite a whole terminal row: runs of cells sharing a background become one
+// fill per pixel row, then glyphs are blended on top.
+static void composite_row(term_pane *tp, int cy, const VTermScreenCell *cells, int cols) {
+    font_ctx *font = &tp->font;
+    int y0 = pane_ring_row(tp, cy) * font->cell_h;
+    for (int run_start = 0; run_start < cols; ) {
+        uint32_t bg = cell_bg_px(&cells[run_start], tp->alpha);
+        int run_end = run_start + 1;
+        while (run_end < cols && cell_bg_px(&cells[run_end], tp->alpha) == bg) run_end++;
+        fill_rect_px(&tp->surface, run_start * font->cell_w, y0, (run_end - run_start) * font->cell_w, font->cell_h, bg);
+        run_start = run_end;
+    }
+    for (int cx = 0; cx < cols; cx++) {
+        if (cells[cx].chars[0]) composite_cell_fg(font, &tp->surface, tp->alpha, cx * font->cell_w, y0, &cells[cx]);
+    }
+}
+
+static void atlas_reset(glyph_atlas *a) {
+    if (a->entries) memset(a->entries, 0, (size_t)TERM_ATLAS_CACHE_CAP * sizeof(*a->entries));
+    a->entry_count = 0;
+    a->shelf_count = 0;
+    a->next_y = 0;
+    a->generation++;
+}
+
+static void atlas_acquire(void) {
+    glyph_atlas *a = &g_atlas;
+    if (a->users++ > 0) return;
+    a->entries = calloc(TERM_ATLAS_CACHE_CAP, sizeof(*a->entries));
+    if (!a->entries) die("calloc atlas");
+    glGenTextures(1, &a->tex);
+    glBindTexture(GL_TEXTURE_2D, a->tex);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE, TERM_ATLAS_SIZE, TERM_ATLAS_SIZE, 0,
+                 GL_LUMINANCE, GL_UNSIGNED_BYTE, NULL);
+    atlas_reset(a);
+}
+
+static void atlas_release(void) {
+    glyph_atlas *a = &g_atlas;
+    if (a->users <= 0 || --a->users > 0) return;
+    if (a->tex) glDeleteTextures(1, &a->tex);
+    free(a->entries);
+    free(a->scratch);
+    free(a->coverage);
+    unsigned generation = a->generation;
+    memset(a, 0, sizeof(*a));
+    a->generation = generation;
+}
+
+static bool atlas_alloc_tile(glyph_atlas *a, int w, int h, int *x_out, int *y_out) {
+    for (int i = 0; i < a->shelf_count; i++) {
+        if (a->shelves[i].h != h || a->shelves[i].x + w > TERM_ATLAS_SIZE) continue;
+        *x_out = a->shelves[i].x;
+        *y_out = a->shelves[i].y;
+        a->shelves[i].x += w;
+        return true;
+    }
+    if (a->shelf_count >= TERM_ATLAS_MAX_SHELVES || a->next_y + h > TERM_ATLAS_SIZE) return false;
+    int idx = a->shelf_count++;
+    a->shelves[idx].y = a->next_y;
+    a->shelves[idx].h = h;
+    a->shelves[idx].x = w;
+    a->next_y += h;
+    *x_out = 0;
+    *y_out = a->shelves[idx].y;
+    return true;
+}
+
+// Rasterize one glyph as a coverage tile width cells wide, reusing the CPU cell
+// compositor (white on black) so box drawing and glyph placement match exactly.
+static bool atlas_upload_tile(glyph_atlas *a, font_ctx *font, uint32_t cp, int width, int x, int y) {
+    int tile_w = font->cell_w * width;
+    size_t px_count = (size_t)tile_w * font->cell_h;
+    if (px_count > a->scratch_cap) {
+        uint8_t *scratch = realloc(a->scratch, px_count * 4);
+        uint8_t *coverage = realloc(a->coverage, px_count);
+        if (scratch) a->scratch = scratch;
+        if (coverage) a->coverage = coverage;
+        if (!scratch || !coverage) return false;
+        a->scratch_cap = px_count;
+    }
+    pane_tex tile = { .tex_w = tile_w, .tex_h = font->cell_h, .pixels = a->scratch };
+    // The background fill covers the first cell only.
+    memset(a->scratch, 0, px_count * 4);
+    VTermScreenCell cell;
+    memset(&cell, 0, sizeof(cell));
+    cell.chars[0] = cp;
+    cell.width = (char)width;
+    cell.fg.type = VTERM_COLOR_INDEXED;
+    cell.fg.indexed.idx = 15;
+    cell.bg.type = VTERM_COLOR_INDEXED;
+    cell.bg.indexed.idx = 0;
+    composite_cell_px(font, &tile, 255, 0, 0, &cell);
+    for (size_t i = 0; i < px_count; i++) a->coverage[i] = a->scratch[i * 4];
+    glBindTexture(GL_TEXTURE_2D, a->tex);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, tile_w, font->cell_h,
+                    GL_LUMINANCE, GL_UNSIGNED_BYTE, a->coverage);
+    return true;
+}
+
+static bool atlas_lookup(font_ctx *font, uint32_t cp, int width, int *x_out, int *y_out) {
+    glyph_atlas *a = &g_atlas;
+    if (!a->entries) return false;
+    if (a->entry_count >= TERM_ATLAS_CACHE_CAP * 3 / 4) atlas_reset(a);
+    uint32_t mask = TERM_ATLAS_CACHE_CAP - 1;
+    uint32_t idx = (glyph_hash(cp) ^ ((uint32_t)font->px_size * 40503u) ^ ((uint32_t)width << 20)) & mask;
+    atlas_entry *entry = NULL;
+    for (uint32_t probe = 0; probe < TERM_ATLAS_CACHE_CAP; probe++) {
+        atlas_entry *e = &a->entries[(idx + probe) & mask];
+        if (!e->used) { entry = e; break; }
+        if (e->cp == cp && e->px == font->px_size && e->width == width) {
+            *x_out = e->x;
+            *y_out = e->y;
+            return true;
+        }
+    }
+    if (!entry) return false;
+    int x = 0, y = 0;
+    if (!atlas_alloc_tile(a, font->cell_w * width, font->cell_h, &x, &y)) {
+        // Full: start over. Panes notice the generation bump and rebuild their grids.
+        atlas_reset(a);
+        if (!atlas_alloc_tile(a, font->cell_w * width, font->cell_h, &x, &y)) return false;
+        entry = &a->entries[idx];
+    }
+    if (!atlas_upload_tile(a, font, cp, width, x, y)) return false;
+    entry->cp = cp;
+    entry->px = font->px_size;
+    entry->width = width;
+    entry->x = x;
+    entry->y = y;
+    entry->used = 1;
+    a->entry_count++;
+    *x_out = x;
+    *y_out = y;
+    return true;
+}
+
+// Atlas tile of the cell's glyph, as wide as the cell. False for blank cells
+// and libvterm's continuation cells (chars[0] == -1).
+static bool grid_lookup(term_pane *tp, const VTermScreenCell *cell, int *ax, int *ay) {
+    uint32_t cp = cell->chars[0];
+    if (cp == 0 || cp == ' ' || cp == (uint32_t)-1) return false;
+    int width = cell->width > 1 ? 2 : 1;
+    return atlas_lookup(&tp->font, cp, width, ax, ay);
+}
+
+// Store one grid cell: the atlas origin it samples (when has_tile), the glyph
+// colour from fg_cell and the background from bg_cell.
+static void grid_store(term_pane *tp, int cx, int cy, bool has_tile, int ax, int ay,
+                       const VTermScreenCell *fg_cell, const VTermScreenCell *bg_cell) {
+    pane_tex *grid = &tp->surface;
+    uint8_t *p = grid->pixels + ((size_t)pane_ring_row(tp, cy) * grid->tex_w + (size_t)cx * TERM_GRID_TEXELS_PER_CELL) * 4;
+    if (has_tile) {
+        p[0] = (uint8_t)(ax & 0xff); p[1] = (uint8_t)(ax >> 8);
+        p[2] = (uint8_t)(ay & 0xff); p[3] = (uint8_t)(ay >> 8);
+    } else {
+        // High byte of y can never reach 0xff inside the atlas: marks a blank cell.
+        p[0] = 0; p[1] = 0; p[2] = 0; p[3] = 0xff;
+    }
+    rgb8 fgc = cell_rgb(fg_cell, 1);
+    rgb8 bgc = cell_rgb(bg_cell, 0);
+    p[4] = fgc.r; p[5] = fgc.g; p[6] = fgc.b; p[7] = 0xff;
+    p[8] = bgc.r; p[9] = bgc.g; p[10] = bgc.b; p[11] = 0xff;
+}
+
+static void grid_store_cell(term_pane *tp, int cx, int cy, const VTermScreenCell *cell) {
+    int ax = 0, ay = 0;
+    bool has_tile = grid_lookup(tp, cell, &ax, &ay);
+    grid_store(tp, cx, cy, has_tile, ax, ay, cell, cell);
+}
+
+static void pane_emit_cell(term_pane *tp, int cx, int cy, const VTermScreenCell *cell) {
+    if (g_render_mode == TERM_RENDER_ATLAS) grid_store_cell(tp, cx, cy, cell);
+    else composite_cell(tp, cx, cy, cell);
+}
+
+static void pane_emit_row(term_pane *tp, int cy, const VTermScreenCell *cells) {
+    if (g_render_mode == TERM_RENDER_ATLAS) {
+        int cols = tp->layout.cols;
+        for (int cx = 0; cx < cols; cx++) {
+            const VTermScreenCell *cell = &cells[cx];
+            int ax = 0, ay = 0;
+            bool has_tile = grid_lookup(tp, cell, &ax, &ay);
+            grid_store(tp, cx, cy, has_tile, ax, ay, cell, cell);
+            // A double-width tile's right half goes to the continuation cell, in the
+            // wide glyph's colour over that cell's own background, as on the CPU path.
+            if (cell->width > 1 && cx + 1 < cols) {
+                cx++;
+                grid_store(tp, cx, cy, has_tile, ax + tp->font.cell_w, ay, cell, &cells[cx]);
             }
         }
+    } else {
+        composite_row(tp, cy, cells, tp->layout.cols);
     }
-    // cached glyph owned by font, no free
 }
 
-static void rebuild_surface(term_pane *tp) {
-    // Re-render entire screen to CPU buffer
-    if (tp->vts) vterm_screen_flush_damage(tp->vts);
-    tp->surface.dirty = true;
-    tp->surface.dirty_y0 = 0;
-    tp->surface.dirty_y1 = tp->surface.tex_h;
-    tp->surface.dirty_ranges[0].y0 = 0;
-    tp->surface.dirty_ranges[0].y1 = tp->surface.tex_h;
-    tp->surface.dirty_count = 1;
-    for (int y=0; y<tp->layout.rows; y++) {
+static bool pane_reserve_row_cells(term_pane *tp) {
+    if (tp->row_cells_cap >= tp->layout.cols) return true;
+    VTermScreenCell *grown = realloc(tp->row_cells, (size_t)tp->layout.cols * sizeof(*grown));
+    if (!grown) return false;
+    tp->row_cells = grown;
+    tp->row_cells_cap = tp->layout.cols;
+    return true;
+}
+
+// Fetch terminal row y into the pane's grow-only row buffer. NULL on allocation failure.
+static VTermScreenCell *pane_fetch_row(term_pane *tp, int y) {
+    if (!pane_reserve_row_cells(tp)) return NULL;
+    for (int x = 0; x < tp->layout.cols; x++) {
+        memset(&tp->row_cells[x], 0, sizeof(tp->row_cells[x]));
+        vterm_screen_get_cell(tp->vts, (VTermPos){.row = y, .col = x}, &tp->row_cells[x]);
+    }
+    return tp->row_cells;
+}
+
+// Surface rows per terminal row: pixel rows for the CPU surface, one grid row for the atlas.
+static int pane_surface_row_unit(const term_pane *tp) {
+    return g_render_mode == TERM_RENDER_ATLAS ? 1 : tp->font.cell_h;
+}
+
+// The snapshot mirrors the surface; a fresh surface starts from an empty,
+// FREE snapshot and a texture that already shows ring row 0.
+static void pane_snapshot_init(term_pane *tp) {
+    pane_snapshot *snap = &tp->snapshot;
+    free(snap->pixels);
+    free(snap->rows);
+    snap->pixels = calloc((size_t)tp->surface.tex_w * tp->surface.tex_h * 4, 1);
+    snap->rows = calloc(term_rows_words(tp->layout.rows), sizeof(*snap->rows));
+    if (!snap->pixels || !snap->rows) die("calloc");
+    snap->ring_row = 0;
+    memset(&snap->counters, 0, sizeof(snap->counters));
+    atomic_store(&tp->snapshot_state, PANE_SNAPSHOT_FREE);
+    tp->snapshot_claimed = false;
+    tp->shown_ring_row = 0;
+    tp->published_ring_row = 0;
+}
+
+static void pane_surface_init(term_pane *tp) {
+    tp->ring_row = 0;
+    pane_row_state_init(tp);
+    if (g_render_mode == TERM_RENDER_ATLAS) {
+        pane_tex_init(&tp->surface, tp->layout.cols * TERM_GRID_TEXELS_PER_CELL, tp->layout.rows);
+    } else {
+        pane_tex_init(&tp->surface, tp->layout.cols * tp->font.cell_w, tp->layout.rows * tp->font.cell_h);
+    }
+    if (tp->threaded) pane_snapshot_init(tp);
+}
+
+// Hash of a fetched row. Cells are zeroed before vterm_screen_get_cell fills
+// them, so hashing the raw bytes is stable; 0 is reserved for "unknown".
+static uint64_t pane_row_hash(const VTermScreenCell *cells, int cols) {
+    return term_rows_hash(cells, (size_t)cols * sizeof(*cells));
+}
+
+static void mark_surface_dirty_rows(term_pane *tp, int start_row, int end_row);
+
+// Render terminal row y unless the surface row already holds the same cells.
+static void pane_render_row(term_pane *tp, int y, bool force) {
+    int surface_row = pane_ring_row(tp, y);
+    VTermScreenCell *cells = pane_fetch_row(tp, y);
+    if (!cells) {
         for (int x=0; x<tp->layout.cols; x++) {
             VTermScreenCell cell; memset(&cell,0,sizeof cell);
             vterm_screen_get_cell(tp->vts, (VTermPos){.row=y,.col=x}, &cell);
-            composite_cell(tp, x, y, &cell);
+            pane_emit_cell(tp, x, y, &cell);
+        }
+        tp->row_hash[surface_row] = 0;
+    } else {
+        if (!term_rows_update_hash(tp->row_hash, surface_row, pane_row_hash(cells, tp->layout.cols), force)) {
+            tp->raster.rows_skipped++;
+            return;
         }
+        pane_emit_row(tp, y, cells);
     }
+    tp->raster.rows_rendered++;
+    mark_surface_dirty_rows(tp, y, y + 1);
+}
+
+static void rebuild_surface(term_pane *tp) {
+    // Re-render entire screen to CPU buffer
+    if (tp->vts) vterm_screen_flush_damage(tp->vts);
+    tp->atlas_generation = g_atlas.generation;
+    for (int y=0; y<tp->layout.rows; y++) pane_render_row(tp, y, true);
     tp->pending_full_rebuild = false;
-    tp->pending_dirty_count = 0;
+    memset(tp->pending_rows, 0, term_rows_words(tp->row_state_rows) * sizeof(*tp->pending_rows));
 }
 
+static bool pane_worker_pause(term_pane *tp);
+static void pane_worker_resume(term_pane *tp, bool paused);
+static void pane_worker_init(term_pane *tp);
+
 void term_pane_reset_screen(term_pane *tp, int hard) {
     if (!tp || !tp->vts) return;
+    bool paused = pane_worker_pause(tp);
     vterm_screen_reset(tp->vts, hard ? 1 : 0);
+    pane_worker_resume(tp, paused);
 }
 
 term_pane* term_pane_create(const pane_layout *layout, int font_px, const char *cmd, char *const argv[]) {
@@ -643,6 +910,7 @@ term_pane* term_pane_create(const pane_layout *layout, int font_px, const char *
     tp->use_shell_cmd = 0;
     tp->shell_cmd = NULL;
     tp->argv_dup = dup_argv(argv);
+    tp->threaded = g_threaded;
     // Font
     font_init(&tp->font, font_px > 0 ? font_px : 18);
     tp->alpha = 255;
@@ -673,12 +941,12 @@ term_pane* term_pane_create(const pane_layout *layout, int font_px, const char *
     set_pty_winsize(tp->pty_master, tp->layout.cols, tp->layout.rows);
 
     // Texture surface
-    int tex_w = tp->layout.cols * tp->font.cell_w;
-    int tex_h = tp->layout.rows * tp->font.cell_h;
-    pane_tex_init(&tp->surface, tex_w, tex_h);
+    if (g_render_mode == TERM_RENDER_ATLAS) atlas_acquire();
+    pane_surface_init(tp);
 
     // Prime screen empty so blank lines render before the child emits output.
     rebuild_surface(tp);
+    if (tp->threaded) pane_worker_init(tp);
     return tp;
 }
 
@@ -690,6 +958,7 @@ term_pane* term_pane_create_cmd(const pane_layout *layout, int font_px, const ch
     tp->use_shell_cmd = 1;
     tp->shell_cmd = strdup(shell_cmd);
     tp->argv_dup = NULL;
+    tp->threaded = g_threaded;
     tp->layout.cols = (tp->layout.w + tp->font.cell_w - 1) / tp->font.cell_w;
     tp->layout.rows = (tp->layout.h + tp->font.cell_h - 1) / tp->font.cell_h;
     if (tp->layout.cols < 10) tp->layout.cols = 10;
@@ -705,31 +974,44 @@ term_pane* term_pane_create_cmd(const pane_layout *layout, int font_px, const ch
     tp->child_pid = spawn_pty_shell(shell_cmd, &tp->pty_master);
     fcntl(tp->pty_master, F_SETFL, O_NONBLOCK);
     set_pty_winsize(tp->pty_master, tp->layout.cols, tp->layout.rows);
-    int tex_w = tp->layout.cols * tp->font.cell_w;
-    int tex_h = tp->layout.rows * tp->font.cell_h;
-    pane_tex_init(&tp->surface, tex_w, tex_h);
+    if (g_render_mode == TERM_RENDER_ATLAS) atlas_acquire();
+    pane_surface_init(tp);
 
     // Prime screen empty so blank lines render before the child emits output.
     rebuild_surface(tp);
+    if (tp->threaded) pane_worker_init(tp);
     return tp;
 }
 
 void term_pane_destroy(term_pane *tp) {
     if (!tp) return;
+    pane_worker_pause(tp);
+    if (tp->threaded) {
+        close(tp->wake_fd);
+        close(tp->ready_fd);
+    }
     if (tp->child_pid > 0) {
         term_pane_terminate_process_group(tp->child_pid, true);
         tp->child_pid = -1;
     }
     if (tp->pty_master>=0) close(tp->pty_master);
     pane_tex_destroy(&tp->surface);
+    if (g_render_mode == TERM_RENDER_ATLAS) atlas_release();
     font_destroy(&tp->font);
     if (tp->vt) vterm_free(tp->vt);
     if (tp->shell_cmd) free(tp->shell_cmd);
     if (tp->argv_dup) free_argv(tp->argv_dup);
+    free(tp->row_cells);
+    free(tp->pending_rows);
+    free(tp->upload_rows);
+    free(tp->row_hash);
+    free(tp->snapshot.pixels);
+    free(tp->snapshot.rows);
     free(tp);
 }
 
 void term_pane_resize(term_pane *tp, const pane_layout *layout) {
+    bool paused = pane_worker_pause(tp);
     pane_tex old = tp->surface; tp->surface = (pane_tex){0};
     tp->layout = *layout;
     int cols = (tp->layout.w + tp->font.cell_w - 1) / tp->font.cell_w;
@@ -745,8 +1027,7 @@ void term_pane_resize(term_pane *tp, const pane_layout *layout) {
     vterm_set_size(tp->vt, rows, cols);
     set_pty_winsize(tp->pty_master, cols, rows);
     if (tp->child_pid > 0) kill(tp->child_pid, SIGWINCH);
-    int new_w = cols*tp->font.cell_w, new_h = rows*tp->font.cell_h;
-    pane_tex_init(&tp->surface, new_w, new_h);
+    pane_surface_init(tp);
     if (old.pixels) {
         int copy_w = old.tex_w < tp->surface.tex_w ? old.tex_w : tp->surface.tex_w;
         int copy_h = old.tex_h < tp->surface.tex_h ? old.tex_h : tp->surface.tex_h;
@@ -765,108 +1046,375 @@ void term_pane_resize(term_pane *tp, const pane_layout *layout) {
      * populated rather than showing transparent regions until the application
      * outputs more text. */
     rebuild_surface(tp);
+    pane_worker_resume(tp, paused);
 }
 
+// Queue terminal rows for upload; the bits are kept in surface (ring) order.
 static void mark_surface_dirty_rows(term_pane *tp, int start_row, int end_row) {
     if (!tp) return;
     if (start_row < 0) start_row = 0;
-    if (end_row > tp->layout.rows) end_row = tp->layout.rows;
+    if (end_row > tp->row_state_rows) end_row = tp->row_state_rows;
     if (start_row >= end_row) return;
-    int y0 = start_row * tp->font.cell_h;
-    int y1 = end_row * tp->font.cell_h;
-    if (tp->surface.dirty_count < TERM_PANE_MAX_DIRTY_RANGES) {
-        int idx = tp->surface.dirty_count++;
-        tp->surface.dirty_ranges[idx].y0 = y0;
-        tp->surface.dirty_ranges[idx].y1 = y1;
-    } else {
-        tp->surface.dirty_count = 1;
-        tp->surface.dirty_ranges[0].y0 = 0;
-        tp->surface.dirty_ranges[0].y1 = tp->surface.tex_h;
+    for (int y = start_row; y < end_row; y++) term_rows_set(tp->upload_rows, pane_ring_row(tp, y));
+    tp->surface.dirty = true;
+}
+
+// Apply a full-width vertical moverect to pixels that are already rendered
+// instead of re-rendering both rectangles. Scrolling the whole screen only
+// rotates the ring; a scroll region moves its surface rows, which are then
+// re-uploaded. Damage still pending inside the moved block travels with it.
+// Returns false for moves that have to be re-rendered.
+static bool pane_scroll_surface(term_pane *tp, VTermRect dest, VTermRect src) {
+    if (!tp || !tp->surface.pixels) return false;
+    // The surface must keep the last complete screen until the update ends.
+    if (tp->sync_active) return false;
+    int rows = tp->layout.rows;
+    int delta = dest.start_row - src.start_row;
+    if (delta == 0 || src.start_col != 0 || dest.start_col != 0) return false;
+    if (src.end_col < tp->layout.cols || dest.end_col < tp->layout.cols) return false;
+    if (src.start_row < 0 || dest.start_row < 0 || src.end_row > rows || dest.end_row > rows) return false;
+    if (tp->surface.tex_h != rows * pane_surface_row_unit(tp) || tp->row_state_rows != rows) return false;
+    if (tp->pending_full_rebuild) return true;
+
+    term_rows_move_bits(tp->pending_rows, src.start_row, src.end_row, delta);
+
+    int top = src.start_row < dest.start_row ? src.start_row : dest.start_row;
+    int bottom = src.end_row > dest.end_row ? src.end_row : dest.end_row;
+    if (top == 0 && bottom == rows) {
+        tp->ring_row = term_rows_scroll_ring(tp->ring_row, delta, rows);
+        return true;
     }
-    if (y0 < tp->surface.dirty_y0) tp->surface.dirty_y0 = y0;
-    if (y1 > tp->surface.dirty_y1) tp->surface.dirty_y1 = y1;
+    size_t row_bytes = (size_t)pane_surface_row_unit(tp) * tp->surface.tex_w * 4;
+    int n = src.end_row - src.start_row;
+    for (int i = 0; i < n; i++) {
+        int k = delta < 0 ? i : n - 1 - i;
+        int to = pane_ring_row(tp, dest.start_row + k), from = pane_ring_row(tp, src.start_row + k);
+        memcpy(tp->surface.pixels + (size_t)to * row_bytes, tp->surface.pixels + (size_t)from * row_bytes, row_bytes);
+        tp->row_hash[to] = tp->row_hash[from];
+    }
+    mark_surface_dirty_rows(tp, dest.start_row, dest.end_row);
+    return true;
 }
 
 static void update_damaged_rows(term_pane *tp) {
     if (!tp || !tp->vts) return;
-    VTermScreenCell *row_cells = calloc((size_t)tp->layout.cols, sizeof(*row_cells));
-    if (!row_cells) {
+    if (!pane_reserve_row_cells(tp)) {
         rebuild_surface(tp);
         return;
     }
-    tp->surface.dirty_count = 0;
-    tp->surface.dirty_y0 = tp->surface.tex_h;
-    tp->surface.dirty_y1 = 0;
-    for (int i = 0; i < tp->pending_dirty_count; i++) {
-        int start_row = tp->pending_dirty[i].start_row;
-        int end_row = tp->pending_dirty[i].end_row;
-        for (int y = start_row; y < end_row; y++) {
-            for (int x = 0; x < tp->layout.cols; x++) {
-                memset(&row_cells[x], 0, sizeof(row_cells[x]));
-                vterm_screen_get_cell(tp->vts, (VTermPos){.row = y, .col = x}, &row_cells[x]);
-            }
-            for (int x = 0; x < tp->layout.cols; x++) {
-                composite_cell(tp, x, y, &row_cells[x]);
+    // Upload bits accumulate until the next render, which also picks up rows
+    // moved by pane_scroll_surface.
+    size_t words = term_rows_words(tp->row_state_rows);
+    for (size_t w = 0; w < words; w++) {
+        uint64_t bits = tp->pending_rows[w];
+        tp->pending_rows[w] = 0;
+        while (bits) {
+            int y = (int)(w * 64) + __builtin_ctzll(bits);
+            bits &= bits - 1;
+            pane_render_row(tp, y, false);
+        }
+    }
+}
+
+static void term_pane_flush_damage(term_pane *tp) {
+    // Flush libvterm damage callbacks, then redraw only those rows.
+    if (tp->vts) vterm_screen_flush_damage(tp->vts);
+    if (tp->pending_full_rebuild) {
+        rebuild_surface(tp);
+    } else {
+        update_damaged_rows(tp);
+    }
+}
+
+static uint64_t term_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void pane_sync_set(term_pane *tp, bool active) {
+    if (active && !tp->sync_deadline_ns) {
+        // Timed from the oldest held-back output, so back-to-back updates cannot
+        // postpone rendering indefinitely.
+        tp->sync_deadline_ns = term_now_ns() + (uint64_t)TERM_PANE_SYNC_TIMEOUT_MS * 1000000ull;
+    }
+    tp->sync_active = active;
+}
+
+// Feed PTY output to libvterm, split at each CSI ? 2026 h/l so sync_active is
+// current when the callbacks for the bytes that follow run.
+static void pane_feed(term_pane *tp, const char *buf, size_t len) {
+    static const char sync_seq[] = "\x1b[?2026";
+    size_t start = 0;
+    for (size_t i = 0; i < len; i++) {
+        char c = buf[i];
+        if (tp->sync_scan == (int)sizeof(sync_seq) - 1) {
+            tp->sync_scan = 0;
+            if (c == 'h' || c == 'l') {
+                vterm_input_write(tp->vt, buf + start, i + 1 - start);
+                start = i + 1;
+                pane_sync_set(tp, c == 'h');
+                continue;
             }
         }
-        mark_surface_dirty_rows(tp, start_row, end_row);
+        if (c == sync_seq[tp->sync_scan]) tp->sync_scan++;
+        else tp->sync_scan = c == sync_seq[0] ? 1 : 0;
     }
-    tp->surface.dirty = tp->surface.dirty_count > 0;
-    tp->pending_dirty_count = 0;
-    free(row_cells);
+    if (start < len) vterm_input_write(tp->vt, buf + start, len - start);
 }
 
-bool term_pane_poll(term_pane *tp) {
-    bool changed = false;
+static void pane_sync_reset(term_pane *tp) {
+    tp->sync_active = false;
+    tp->sync_deadline_ns = 0;
+    tp->sync_scan = 0;
+}
+
+// Read at most max_bytes, stopping after the first read past deadline_ns, and
+// render the damage unless a flood is still queued or a synchronized update is
+// open. *hangup (optional) is set once the PTY reports EOF or an error.
+// Returns true if rows were rendered.
+static bool pane_pump(term_pane *tp, size_t max_bytes, uint64_t deadline_ns, bool *hangup) {
+    bool fed = false;
+    bool drained = false;
+    size_t total = 0;
     char buf[4096];
-    for(;;){
-        ssize_t n = read(tp->pty_master, buf, sizeof buf);
-        if (n <= 0) break;
+    while (total < max_bytes) {
+        size_t want = sizeof buf;
+        if (max_bytes - total < want) want = max_bytes - total;
+        ssize_t n = read(tp->pty_master, buf, want);
+        if (n <= 0) {
+            if (hangup && (n == 0 || (errno != EAGAIN && errno != EINTR))) *hangup = true;
+            drained = true;
+            break;
+        }
         // Feed program output into the terminal emulator
-        vterm_input_write(tp->vt, buf, (size_t)n);
-        changed = true;
+        pane_feed(tp, buf, (size_t)n);
+        total += (size_t)n;
+        fed = true;
+        if (deadline_ns != UINT64_MAX && term_now_ns() >= deadline_ns) break;
     }
-    // Check if child exited and respawn if needed
-    if (tp->child_pid > 0) {
-        int status=0; pid_t r = waitpid(tp->child_pid, &status, WNOHANG);
-        if (r == tp->child_pid) {
-            term_pane_respawn(tp);
-            changed = true;
-        }
+    uint64_t now_ns = term_now_ns();
+    bool sync_expired = tp->sync_deadline_ns && now_ns >= tp->sync_deadline_ns;
+    if (!fed && !tp->render_deferred && !sync_expired) return false;
+    if (tp->sync_active && !sync_expired) {
+        // Mid-update: collect the damage and keep showing the previous screen.
+        if (tp->vts) vterm_screen_flush_damage(tp->vts);
+        return false;
+    }
+    // An update that outlived its timeout is closed, as if the end had arrived.
+    tp->sync_active = false;
+    if (!drained) {
+        // Stopped on the budget; anything still queued is a burst in progress.
+        int queued = 0;
+        drained = ioctl(tp->pty_master, FIONREAD, &queued) != 0 || queued <= 0;
     }
-    if (changed) {
-        // Flush libvterm damage callbacks, then redraw only those rows.
+    if (!drained && now_ns < tp->flood_render_ns) {
+        // Intermediate screen of a flood: keep the damage and render a later state.
         if (tp->vts) vterm_screen_flush_damage(tp->vts);
-        if (tp->pending_full_rebuild) {
-            rebuild_surface(tp);
-        } else {
-            update_damaged_rows(tp);
-            if (tp->surface.dirty_count == 0) {
-                tp->surface.dirty = false;
+        tp->render_deferred = true;
+        return false;
+    }
+    tp->render_deferred = false;
+    tp->sync_deadline_ns = 0;
+    tp->flood_render_ns = now_ns + (uint64_t)TERM_PANE_FLOOD_RENDER_MS * 1000000ull;
+    term_pane_flush_damage(tp);
+    return true;
+}
+
+static void pane_event_signal(int fd) {
+    uint64_t one = 1;
+    ssize_t n = write(fd, &one, sizeof(one));
+    (void)n;
+}
+
+static void pane_event_drain(int fd) {
+    uint64_t count;
+    ssize_t n = read(fd, &count, sizeof(count));
+    (void)n;
+}
+
+// Worker side: copy the rows rendered since the last publish into a FREE
+// snapshot and hand it over. With the snapshot still READY the rows keep
+// accumulating in upload_rows and go out with the next one.
+static void pane_worker_publish(term_pane *tp) {
+    bool moved = tp->ring_row != tp->published_ring_row;
+    if (!tp->surface.dirty && !moved && !tp->raster.rows_rendered && !tp->raster.rows_skipped) return;
+    if (atomic_load_explicit(&tp->snapshot_state, memory_order_acquire) != PANE_SNAPSHOT_FREE) return;
+    pane_snapshot *snap = &tp->snapshot;
+    size_t row_bytes = (size_t)pane_surface_row_unit(tp) * tp->surface.tex_w * 4;
+    size_t words = term_rows_words(tp->row_state_rows);
+    for (size_t w = 0; w < words; w++) {
+        uint64_t bits = tp->upload_rows[w];
+        tp->upload_rows[w] = 0;
+        snap->rows[w] |= bits;
+        while (bits) {
+            size_t row = w * 64 + (size_t)__builtin_ctzll(bits);
+            bits &= bits - 1;
+            memcpy(snap->pixels + row * row_bytes, tp->surface.pixels + row * row_bytes, row_bytes);
+        }
+    }
+    snap->ring_row = tp->ring_row;
+    snap->counters.rows_rendered += tp->raster.rows_rendered;
+    snap->counters.rows_skipped += tp->raster.rows_skipped;
+    memset(&tp->raster, 0, sizeof(tp->raster));
+    tp->published_ring_row = tp->ring_row;
+    tp->surface.dirty = false;
+    atomic_store_explicit(&tp->snapshot_state, PANE_SNAPSHOT_READY, memory_order_release);
+    pane_event_signal(tp->ready_fd);
+}
+
+static void *pane_worker_main(void *arg) {
+    term_pane *tp = arg;
+    bool hangup = false;
+    while (!atomic_load(&tp->worker_stop)) {
+        pane_worker_publish(tp);
+        // After a hangup only the wake fd is watched until the child is respawned.
+        struct pollfd fds[2] = {
+            { .fd = tp->wake_fd, .events = POLLIN },
+            { .fd = hangup ? -1 : tp->pty_master, .events = POLLIN },
+        };
+        // An open synchronized update is forced out at its deadline even if the
+        // child goes quiet.
+        int timeout_ms = -1;
+        if (tp->sync_deadline_ns) {
+            uint64_t now_ns = term_now_ns();
+            timeout_ms = now_ns >= tp->sync_deadline_ns ? 0 : (int)((tp->sync_deadline_ns - now_ns + 999999) / 1000000);
+        }
+        int ready = poll(fds, 2, timeout_ms);
+        if (ready < 0) {
+            if (errno == EINTR) continue;
+            perror("term worker poll");
+            break;
+        }
+        if (fds[0].revents & POLLIN) pane_event_drain(tp->wake_fd);
+        if (fds[1].revents || ready == 0) {
+            bool had_hangup = hangup;
+            pane_pump(tp, TERM_PANE_WORKER_READ_BYTES, UINT64_MAX, &hangup);
+            // The main loop only watches ready_fd, so it learns of the exit from here.
+            if (hangup && !had_hangup) {
+                atomic_store(&tp->pty_hung_up, true);
+                pane_event_signal(tp->ready_fd);
             }
         }
     }
-    return changed;
+    return NULL;
+}
+
+static void pane_worker_start(term_pane *tp) {
+    atomic_store(&tp->worker_stop, false);
+    // Signals stay with the main thread.
+    sigset_t all, old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    int rc = pthread_create(&tp->worker, NULL, pane_worker_main, tp);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    if (rc == 0) {
+        tp->worker_running = true;
+        return;
+    }
+    fprintf(stderr, "term: pthread_create: %s; pane stays on the main thread\n", strerror(rc));
+    // Back to inline polling: the texture may lack rows of an unconsumed
+    // snapshot, so queue the whole surface for upload.
+    tp->threaded = false;
+    memset(tp->upload_rows, 0xff, term_rows_words(tp->row_state_rows) * sizeof(*tp->upload_rows));
+    tp->surface.dirty = true;
+    close(tp->wake_fd);
+    close(tp->ready_fd);
+}
+
+static void pane_worker_init(term_pane *tp) {
+    tp->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    tp->ready_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (tp->wake_fd < 0 || tp->ready_fd < 0) {
+        perror("eventfd");
+        if (tp->wake_fd >= 0) close(tp->wake_fd);
+        if (tp->ready_fd >= 0) close(tp->ready_fd);
+        tp->threaded = false;
+        return;
+    }
+    pane_worker_start(tp);
+}
+
+// Stop the worker so the calling (main) thread can touch pane state; returns
+// whether one was running, for pane_worker_resume.
+static bool pane_worker_pause(term_pane *tp) {
+    if (!tp->worker_running) return false;
+    atomic_store(&tp->worker_stop, true);
+    pane_event_signal(tp->wake_fd);
+    pthread_join(tp->worker, NULL);
+    tp->worker_running = false;
+    return true;
+}
+
+static void pane_worker_resume(term_pane *tp, bool paused) {
+    if (paused) pane_worker_start(tp);
+}
+
+bool term_pane_poll(term_pane *tp) {
+    return term_pane_poll_budget(tp, SIZE_MAX, UINT64_MAX);
+}
+
+bool term_pane_poll_budget(term_pane *tp, size_t max_bytes, uint64_t deadline_ns) {
+    if (tp->threaded) {
+        // The worker did the reading; claim a published snapshot for the next render.
+        pane_event_drain(tp->ready_fd);
+        if (atomic_load_explicit(&tp->snapshot_state, memory_order_acquire) != PANE_SNAPSHOT_READY) return false;
+        tp->snapshot_claimed = true;
+        return true;
+    }
+    return pane_pump(tp, max_bytes, deadline_ns, NULL);
+}
+
+bool term_pane_reap_child(term_pane *tp) {
+    if (!tp || tp->child_pid <= 0) return false;
+    int status = 0;
+    pid_t r = waitpid(tp->child_pid, &status, WNOHANG);
+    if (r != tp->child_pid) return false;
+    bool paused = pane_worker_pause(tp);
+    term_pane_respawn(tp);
+    term_pane_flush_damage(tp);
+    pane_worker_resume(tp, paused);
+    return true;
+}
+
+uint64_t term_pane_sync_deadline_ns(const term_pane *tp) {
+    if (!tp || tp->threaded) return 0;
+    return tp->sync_deadline_ns;
 }
 
 int term_pane_get_fd(const term_pane *tp) {
     if (!tp) return -1;
-    return tp->pty_master;
+    return tp->threaded ? tp->ready_fd : tp->pty_master;
+}
+
+pid_t term_pane_get_child_pid(const term_pane *tp) {
+    if (!tp) return -1;
+    return tp->child_pid;
+}
+
+bool term_pane_pty_hung_up(const term_pane *tp) {
+    return tp && tp->threaded && atomic_load(&tp->pty_hung_up);
 }
 
 void term_pane_force_rebuild(term_pane *tp) {
     if (!tp) return;
+    bool paused = pane_worker_pause(tp);
     if (tp->vts) vterm_screen_flush_damage(tp->vts);
     rebuild_surface(tp);
+    pane_worker_resume(tp, paused);
 }
 
 void term_pane_respawn(term_pane *tp) {
     if (!tp) return;
+    bool paused = pane_worker_pause(tp);
     if (tp->child_pid > 0) {
         term_pane_terminate_process_group(tp->child_pid, false);
         tp->child_pid = -1;
     }
     if (tp->pty_master>=0) { close(tp->pty_master); tp->pty_master = -1; }
+    atomic_store(&tp->pty_hung_up, false);
+    // The new child starts outside any synchronized update.
+    pane_sync_reset(tp);
     if (tp->use_shell_cmd) {
         tp->child_pid = spawn_pty_shell(tp->shell_cmd ? tp->shell_cmd : "/bin/sh", &tp->pty_master);
     } else {
@@ -883,46 +1431,102 @@ void term_pane_respawn(term_pane *tp) {
     vterm_set_size(tp->vt, rows, cols);
     set_pty_winsize(tp->pty_master, cols, rows);
     if (tp->child_pid > 0) kill(tp->child_pid, SIGWINCH);
+    pane_worker_resume(tp, paused);
 }
 
-void term_pane_render(term_pane *tp, int fb_w, int fb_h) {
+// One upload per run of consecutive queued surface rows; clears the bits.
+static void pane_upload_rows(term_pane *tp, uint64_t *rows, const uint8_t *pixels) {
+    int unit = pane_surface_row_unit(tp);
+    for (int row = 0; row < tp->row_state_rows; ) {
+        if (!term_rows_test(rows, row)) { row++; continue; }
+        int first = row;
+        while (row < tp->row_state_rows && term_rows_test(rows, row)) row++;
+        int y0 = first * unit;
+        int h = (row - first) * unit;
+        if (y0 + h > tp->surface.tex_h) h = tp->surface.tex_h - y0;
+        if (h <= 0) continue;
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, y0, tp->surface.tex_w, h,
+                       GL_RGBA, GL_UNSIGNED_BYTE,
+                       pixels + (size_t)y0 * tp->surface.tex_w * 4);
+        tp->counters.upload_bytes += (unsigned long long)h * tp->surface.tex_w * 4;
+    }
+    memset(rows, 0, term_rows_words(tp->row_state_rows) * sizeof(*rows));
+}
+
+void term_pane_render(term_pane *tp, const render_view *view) {
     // Upload pane pixels; keep simple and robust across layout changes
     glDisable(GL_SCISSOR_TEST);
     glDisable(GL_DEPTH_TEST);
     glDisable(GL_CULL_FACE);
     glDisable(GL_DITHER);
     glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
-    glViewport(0, 0, fb_w, fb_h);
+    glViewport(0, 0, view->target_w, view->target_h);
+    // An atlas reset invalidated tile origins referenced by this pane's grid.
+    if (g_render_mode == TERM_RENDER_ATLAS && tp->atlas_generation != g_atlas.generation) rebuild_surface(tp);
+    // Drawn mid-flood (another pane or the OSD changed): catch up on the deferred
+    // rows, unless they belong to an unfinished synchronized update.
+    if (!tp->threaded && tp->render_deferred && !tp->sync_active) {
+        tp->render_deferred = false;
+        term_pane_flush_damage(tp);
+    }
     glBindTexture(GL_TEXTURE_2D, tp->surface.tex);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-    if (tp->surface.dirty) {
-        int n = tp->surface.dirty_count;
-        if (n <= 0) n = 1;
-        for (int i=0; i<n; i++) {
-            int y0 = (i < tp->surface.dirty_count) ? tp->surface.dirty_ranges[i].y0 : 0;
-            int y1 = (i < tp->surface.dirty_count) ? tp->surface.dirty_ranges[i].y1 : tp->surface.tex_h;
-            if (y0 < 0) y0 = 0;
-            if (y1 > tp->surface.tex_h) y1 = tp->surface.tex_h;
-            if (y1 <= y0) continue;
-            int h = y1 - y0;
-            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, y0, tp->surface.tex_w, h,
-                           GL_RGBA, GL_UNSIGNED_BYTE,
-                           tp->surface.pixels + (size_t)y0 * tp->surface.tex_w * 4);
+    if (tp->threaded) {
+        // Upload the snapshot claimed by the last poll and hand it back to the worker.
+        if (tp->snapshot_claimed) {
+            pane_snapshot *snap = &tp->snapshot;
+            pane_upload_rows(tp, snap->rows, snap->pixels);
+            tp->shown_ring_row = snap->ring_row;
+            tp->counters.rows_rendered += snap->counters.rows_rendered;
+            tp->counters.rows_skipped += snap->counters.rows_skipped;
+            memset(&snap->counters, 0, sizeof(snap->counters));
+            tp->snapshot_claimed = false;
+            atomic_store_explicit(&tp->snapshot_state, PANE_SNAPSHOT_FREE, memory_order_release);
+            pane_event_signal(tp->wake_fd);
         }
+    } else {
+        if (tp->surface.dirty) pane_upload_rows(tp, tp->upload_rows, tp->surface.pixels);
+        tp->surface.dirty = false;
+        tp->shown_ring_row = tp->ring_row;
     }
-    tp->surface.dirty = false;
-    tp->surface.dirty_y0 = tp->surface.tex_h;
-    tp->surface.dirty_y1 = 0;
-    tp->surface.dirty_count = 0;
-    float u1 = 1.f, v1 = 1.f;
+    if (g_render_mode == TERM_RENDER_ATLAS) {
+        draw_atlas_grid(tp, view);
+        return;
+    }
+    float u1 = 1.f;
     if (tp->surface.tex_w > 0)
         u1 = (float)tp->layout.w / (float)tp->surface.tex_w;
-    if (tp->surface.tex_h > 0)
-        v1 = (float)tp->layout.h / (float)tp->surface.tex_h;
-    draw_textured_quad(tp->surface.tex, tp->layout.x, tp->layout.y,
-                       tp->layout.w, tp->layout.h, u1, v1, fb_w, fb_h);
+    if (tp->surface.tex_h <= 0) return;
+    // Terminal rows start at the ring origin; rows that wrapped to the top of
+    // the texture are drawn as a second quad below them.
+    float tex_h = (float)tp->surface.tex_h;
+    int ring_px = tp->shown_ring_row * tp->font.cell_h;
+    int top_h = tp->surface.tex_h - ring_px;
+    if (top_h > tp->layout.h) top_h = tp->layout.h;
+    draw_textured_quad(tp->surface.tex, tp->layout.x, tp->layout.y + tp->layout.h - top_h,
+                       tp->layout.w, top_h, ring_px / tex_h, u1, (ring_px + top_h) / tex_h, view);
+    if (top_h < tp->layout.h) {
+        int rest_h = tp->layout.h - top_h;
+        draw_textured_quad(tp->surface.tex, tp->layout.x, tp->layout.y,
+                           tp->layout.w, rest_h, 0.f, u1, rest_h / tex_h, view);
+    }
+}
+
+void term_pane_take_counters(term_pane *tp, term_pane_counters *out) {
+    if (!tp) {
+        memset(out, 0, sizeof(*out));
+        return;
+    }
+    // A worker's row counts arrive with its snapshots instead.
+    if (!tp->threaded) {
+        tp->counters.rows_rendered += tp->raster.rows_rendered;
+        tp->counters.rows_skipped += tp->raster.rows_skipped;
+        memset(&tp->raster, 0, sizeof(tp->raster));
+    }
+    *out = tp->counters;
+    memset(&tp->counters, 0, sizeof(tp->counters));
 }
 
 void term_pane_send_input(term_pane *tp, const char *buf, size_t len) {
@@ -932,28 +1536,14 @@ void term_pane_send_input(term_pane *tp, const char *buf, size_t len) {
 }
 
 bool term_measure_cell(int font_px, int *cell_w, int *cell_h) {
-    font_ctx f = {0};
-    if (font_px <= 0) font_px = 18;
-    // Initialize a temporary freetype face via fontconfig monospace
-    if (FT_Init_FreeType(&f.ftlib)) return false;
-    char *path = kms_font_find_monospace();
-    if (!path) { FT_Done_FreeType(f.ftlib); return false; }
-    if (FT_New_Face(f.ftlib, path, 0, &f.face)) { free(path); FT_Done_FreeType(f.ftlib); return false; }
-    free(path);
-    FT_Set_Pixel_Sizes(f.face, 0, font_px);
-    FT_Load_Char(f.face, 'M', FT_LOAD_RENDER);
-    int cw = (f.face->glyph->advance.x + 31) / 64;
-    int ch = font_px + 2;
-    FT_Done_Face(f.face);
-    FT_Done_FreeType(f.ftlib);
-    if (cell_w) *cell_w = cw;
-    if (cell_h) *cell_h = ch;
-    return true;
+    // Served from the process-wide metrics table so layout fitting never touches FreeType.
+    return kms_font_cell_metrics(font_px, cell_w, cell_h);
 }
 
 void term_pane_set_font_px(term_pane *tp, int font_px) {
     if (!tp) return;
     if (font_px <= 0) font_px = 18;
+    bool paused = pane_worker_pause(tp);
     // Recreate font
     font_destroy(&tp->font);
     font_init(&tp->font, font_px);
@@ -972,7 +1562,7 @@ void term_pane_set_font_px(term_pane *tp, int font_px) {
     if (tp->child_pid > 0) kill(tp->child_pid, SIGWINCH);
     // Recreate texture surface
     pane_tex old = tp->surface; tp->surface = (pane_tex){0};
-    pane_tex_init(&tp->surface, cols*tp->font.cell_w, rows*tp->font.cell_h);
+    pane_surface_init(tp);
     if (old.pixels) {
         int copy_w = old.tex_w < tp->surface.tex_w ? old.tex_w : tp->surface.tex_w;
         int copy_h = old.tex_h < tp->surface.tex_h ? old.tex_h : tp->surface.tex_h;
@@ -990,10 +1580,13 @@ void term_pane_set_font_px(term_pane *tp, int font_px) {
      * it reflects the current screen contents so the background is fully
      * drawn with the new dimensions. */
     rebuild_surface(tp);
+    pane_worker_resume(tp, paused);
 }
 
 void term_pane_set_alpha(term_pane *tp, uint8_t alpha) {
     if (!tp) return;
+    bool paused = pane_worker_pause(tp);
     tp->alpha = alpha;
     rebuild_surface(tp);
+    pane_worker_resume(tp, paused);
 }
@@ -1,10 +1,43 @@
 #pragma once
 #include <stdbool.h>
 #include <stdint.h>
+#include <sys/types.h>
 #include <vterm.h>
 
+#include "render_view.h"
+
 typedef struct term_pane term_pane;
 
+// How pane contents reach the GPU. CPU rasterizes every cell into an RGBA
+// surface; ATLAS uploads a small per-cell attribute grid and draws glyphs from
+// a shared atlas texture in a shader. Select before creating panes.
+typedef enum {
+    TERM_RENDER_CPU = 0,
+    TERM_RENDER_ATLAS = 1
+} term_render_mode;
+
+void term_pane_set_render_mode(term_render_mode mode);
+term_render_mode term_pane_get_render_mode(void);
+// Give panes created afterwards a worker thread that reads the PTY, runs
+// libvterm and rasterizes rows, publishing them as snapshots that
+// term_pane_poll() claims and term_pane_render() uploads; term_pane_get_fd()
+// then returns an eventfd that turns readable when a snapshot is published.
+// CPU renderer only; set after the render mode and before creating panes.
+void term_pane_set_threaded(bool threaded);
+
+#define TERM_PANE_FLOOD_RENDER_MS 33
+// Longest a synchronized update (DEC mode 2026) may hold back the screen.
+#define TERM_PANE_SYNC_TIMEOUT_MS 150
+
+// Row work done by a pane: rows rendered into its surface, damaged rows skipped
+// because their cells matched what the surface already showed, and texture
+// upload volume.
+typedef struct {
+    unsigned long long rows_rendered;
+    unsigned long long rows_skipped;
+    unsigned long long upload_bytes;
+} term_pane_counters;
+
 typedef struct {
     int x, y, w, h;      // pane rect in framebuffer pixels
     int cols, rows;      // terminal grid size
@@ -22,10 +55,32 @@ void term_pane_resize(term_pane *tp, const pane_layout *layout);
 
 // Pump PTY -> libvterm; returns true if screen content changed
 bool term_pane_poll(term_pane *tp);
+// Budgeted pump for the main loop: reads at most max_bytes and stops after the
+// first read past deadline_ns (CLOCK_MONOTONIC), leaving the rest in the PTY so
+// a flooding child blocks in write(). While a burst is still pending, damaged
+// rows are rendered at most every TERM_PANE_FLOOD_RENDER_MS (and before the pane
+// is drawn); the state at the end of the burst is always rendered.
+// Inside a synchronized update (CSI ? 2026 h ... CSI ? 2026 l) nothing is
+// rendered: the pane keeps showing the last complete screen and the batch is
+// applied at the end, or once TERM_PANE_SYNC_TIMEOUT_MS has passed.
+bool term_pane_poll_budget(term_pane *tp, size_t max_bytes, uint64_t deadline_ns);
+// CLOCK_MONOTONIC time at which a held-back synchronized update is forced out,
+// or 0 if none is pending. Poll the pane once it passes even if its fd is idle.
+// Always 0 with a worker thread, which keeps its own timeout.
+uint64_t term_pane_sync_deadline_ns(const term_pane *tp);
+// Reap an exited child and respawn it; returns true if it had exited.
+bool term_pane_reap_child(term_pane *tp);
 int term_pane_get_fd(const term_pane *tp);
+pid_t term_pane_get_child_pid(const term_pane *tp);
+// With a worker thread: the worker saw the PTY hang up since the child was
+// spawned. term_pane_get_fd() is then the worker's fd, which carries no EPOLLHUP.
+bool term_pane_pty_hung_up(const term_pane *tp);
 
 // Render cached screen to OpenGL (upload texture when dirty)
-void term_pane_render(term_pane *tp, int fb_w, int fb_h);
+void term_pane_render(term_pane *tp, const render_view *view);
+
+// Return the counters accumulated since the previous call and reset them.
+void term_pane_take_counters(term_pane *tp, term_pane_counters *out);
 
 // Send input bytes to the PTY (for interactive control)
 void term_pane_send_input(term_pane *tp, const char *buf, size_t len);
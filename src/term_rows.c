@@ -0,0 +1,39 @@
+#include "term_rows.h"
+
+#include <string.h>
+
+int term_rows_scroll_ring(int ring_row, int delta, int rows) {
+    if (rows <= 0) return 0;
+    return ((ring_row - delta) % rows + rows) % rows;
+}
+
+void term_rows_move_bits(uint64_t *bits, int start_row, int end_row, int delta) {
+    int n = end_row - start_row;
+    for (int i = 0; i < n; i++) {
+        int y = delta < 0 ? start_row + i : end_row - 1 - i;
+        if (term_rows_test(bits, y)) term_rows_set(bits, y + delta);
+    }
+}
+
+uint64_t term_rows_hash(const void *cells, size_t bytes) {
+    const unsigned char *p = cells;
+    size_t n = bytes;
+    uint64_t h = 0x9e3779b97f4a7c15ull ^ (uint64_t)n;
+    for (; n >= 8; n -= 8, p += 8) {
+        uint64_t w;
+        memcpy(&w, p, sizeof(w));
+        h = (h ^ w) * 0xff51afd7ed558ccdull;
+        h ^= h >> 32;
+    }
+    for (; n > 0; n--, p++) h = (h ^ *p) * 0x100000001b3ull;
+    h ^= h >> 29;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 32;
+    return h ? h : 1;
+}
+
+bool term_rows_update_hash(uint64_t *row_hash, int row, uint64_t hash, bool force) {
+    if (!force && row_hash[row] == hash) return false;
+    row_hash[row] = hash;
+    return true;
+}
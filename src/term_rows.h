@@ -0,0 +1,43 @@
+#ifndef TERM_ROWS_H
+#define TERM_ROWS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Row bookkeeping for terminal surfaces, kept free of GL and libvterm. Row sets
+// are bitmaps of 64-bit words. A surface is a ring of rows: terminal row r lives
+// in surface row (r + ring_row) % rows, so a full-screen scroll only moves the
+// ring origin instead of any pixels. Each surface row also keeps a hash of the
+// cells it shows, so damaged rows whose cells did not change are not redrawn.
+
+static inline size_t term_rows_words(int rows) {
+    return ((size_t)rows + 63) / 64;
+}
+
+static inline void term_rows_set(uint64_t *bits, int row) {
+    bits[row >> 6] |= 1ull << (row & 63);
+}
+
+static inline bool term_rows_test(const uint64_t *bits, int row) {
+    return (bits[row >> 6] >> (row & 63)) & 1u;
+}
+
+// Surface row that holds terminal row `row`.
+static inline int term_rows_ring_row(int ring_row, int row, int rows) {
+    return rows > 0 ? (row + ring_row) % rows : row;
+}
+
+// Ring origin after every row moves by delta (dest - src, so scrolling the
+// content up is negative). Always in [0, rows).
+int term_rows_scroll_ring(int ring_row, int delta, int rows);
+// A move of rows [start_row, end_row) by delta also marks each destination of a
+// marked source row. Bits are walked against the move so none is carried twice.
+void term_rows_move_bits(uint64_t *bits, int start_row, int end_row, int delta);
+// Hash of a row's cell bytes. Never 0, which marks a surface row whose content is unknown.
+uint64_t term_rows_hash(const void *cells, size_t bytes);
+// Record that surface row `row` now shows content hashing to hash. Returns false
+// when the row already shows it and force is not set, so it can be skipped.
+bool term_rows_update_hash(uint64_t *row_hash, int row, uint64_t hash, bool force);
+
+#endif
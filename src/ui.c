@@ -187,6 +187,8 @@ bool ui_handle_input(ui_state *ui, options_t *opt, const char *buf, ssize_t n,
                      bool use_mpv, term_pane *const *panes, mpv_handle *const *pane_mpv, int pane_count,
                      mpv_handle *mpv, bool *running, bool debug) {
     (void)mpv;
+    ui_state before = *ui;
+    int layout_mode = opt->layout_mode, right_frac_pct = opt->right_frac_pct, pane_split_pct = opt->pane_split_pct;
     for (ssize_t i = 0; i < n; i++) {
         unsigned char ch = (unsigned char)buf[i];
         if (ch == 0x05) ui->ui_control = !ui->ui_control;
@@ -309,5 +311,8 @@ bool ui_handle_input(ui_state *ui, options_t *opt, const char *buf, ssize_t n,
     }
 
     if (debug) fprintf(stderr, "Input: focus=%d ui_control=%d consumed=%d bytes=%zd\n", ui->focus, ui->ui_control ? 1 : 0, consumed ? 1 : 0, n);
-    return consumed;
+    return ui->focus != before.focus || ui->ui_control != before.ui_control || ui->show_osd != before.show_osd ||
+           ui->fullscreen != before.fullscreen || ui->fs_pane != before.fs_pane ||
+           ui->overlay_swap != before.overlay_swap || opt->layout_mode != layout_mode ||
+           opt->right_frac_pct != right_frac_pct || opt->pane_split_pct != pane_split_pct;
 }
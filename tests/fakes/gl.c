@@ -0,0 +1,77 @@
+// No-op GLES2 entry points for building renderers in tests without a GL context.
+// Shaders always compile and link, names count up, and texture uploads are
+// tallied so tests can see what a renderer sent to the GPU.
+
+#include <GLES2/gl2.h>
+
+#include <stdatomic.h>
+#include <stddef.h>
+
+static GLuint g_next_name = 1;
+static atomic_size_t g_upload_calls;
+static atomic_size_t g_upload_texels;
+
+size_t fake_gl_upload_calls(void) { return atomic_load(&g_upload_calls); }
+size_t fake_gl_upload_texels(void) { return atomic_load(&g_upload_texels); }
+
+static void gen_names(GLsizei n, GLuint *names) {
+    for (GLsizei i = 0; i < n; ++i) names[i] = g_next_name++;
+}
+
+void glActiveTexture(GLenum texture) { (void)texture; }
+void glAttachShader(GLuint program, GLuint shader) { (void)program; (void)shader; }
+void glBindAttribLocation(GLuint program, GLuint index, const GLchar *name) { (void)program; (void)index; (void)name; }
+void glBindBuffer(GLenum target, GLuint buffer) { (void)target; (void)buffer; }
+void glBindTexture(GLenum target, GLuint texture) { (void)target; (void)texture; }
+void glBlendFunc(GLenum sfactor, GLenum dfactor) { (void)sfactor; (void)dfactor; }
+void glBufferData(GLenum target, GLsizeiptr size, const void *data, GLenum usage) {
+    (void)target; (void)size; (void)data; (void)usage;
+}
+void glColorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha) {
+    (void)red; (void)green; (void)blue; (void)alpha;
+}
+void glCompileShader(GLuint shader) { (void)shader; }
+GLuint glCreateProgram(void) { return g_next_name++; }
+GLuint glCreateShader(GLenum type) { (void)type; return g_next_name++; }
+void glDeleteTextures(GLsizei n, const GLuint *textures) { (void)n; (void)textures; }
+void glDisable(GLenum cap) { (void)cap; }
+void glDrawArrays(GLenum mode, GLint first, GLsizei count) { (void)mode; (void)first; (void)count; }
+void glEnable(GLenum cap) { (void)cap; }
+void glEnableVertexAttribArray(GLuint index) { (void)index; }
+void glGenBuffers(GLsizei n, GLuint *buffers) { gen_names(n, buffers); }
+void glGenTextures(GLsizei n, GLuint *textures) { gen_names(n, textures); }
+void glGetProgramiv(GLuint program, GLenum pname, GLint *params) { (void)program; (void)pname; *params = GL_TRUE; }
+void glGetShaderInfoLog(GLuint shader, GLsizei bufSize, GLsizei *length, GLchar *infoLog) {
+    (void)shader;
+    if (length) *length = 0;
+    if (bufSize > 0) infoLog[0] = '\0';
+}
+void glGetShaderiv(GLuint shader, GLenum pname, GLint *params) { (void)shader; (void)pname; *params = GL_TRUE; }
+const GLubyte *glGetString(GLenum name) { (void)name; return (const GLubyte *)"OpenGL ES 2.0 fake"; }
+GLint glGetUniformLocation(GLuint program, const GLchar *name) { (void)program; (void)name; return 0; }
+void glLinkProgram(GLuint program) { (void)program; }
+void glPixelStorei(GLenum pname, GLint param) { (void)pname; (void)param; }
+void glShaderSource(GLuint shader, GLsizei count, const GLchar *const *string, const GLint *length) {
+    (void)shader; (void)count; (void)string; (void)length;
+}
+void glTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border,
+                  GLenum format, GLenum type, const void *pixels) {
+    (void)target; (void)level; (void)internalformat; (void)width; (void)height; (void)border;
+    (void)format; (void)type; (void)pixels;
+}
+void glTexParameteri(GLenum target, GLenum pname, GLint param) { (void)target; (void)pname; (void)param; }
+void glTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height,
+                     GLenum format, GLenum type, const void *pixels) {
+    (void)target; (void)level; (void)xoffset; (void)yoffset; (void)format; (void)type; (void)pixels;
+    atomic_fetch_add(&g_upload_calls, 1);
+    atomic_fetch_add(&g_upload_texels, (size_t)width * (size_t)height);
+}
+void glUniform1f(GLint location, GLfloat v0) { (void)location; (void)v0; }
+void glUniform1i(GLint location, GLint v0) { (void)location; (void)v0; }
+void glUniform2f(GLint location, GLfloat v0, GLfloat v1) { (void)location; (void)v0; (void)v1; }
+void glUseProgram(GLuint program) { (void)program; }
+void glVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride,
+                           const void *pointer) {
+    (void)index; (void)size; (void)type; (void)normalized; (void)stride; (void)pointer;
+}
+void glViewport(GLint x, GLint y, GLsizei width, GLsizei height) { (void)x; (void)y; (void)width; (void)height; }
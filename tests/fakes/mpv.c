@@ -0,0 +1,300 @@
+#define _POSIX_C_SOURCE 200809L
+
+// A scripted libmpv: properties are kept as strings, observed properties queue
+// a change event when set (and once when first observed), and async commands
+// are logged and answered with a successful COMMAND_REPLY. Other events are
+// queued by the test. Enough to drive media.c's event handling in tests.
+
+#include <mpv/render_gl.h>
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define FAKE_MPV_PROPS 64
+#define FAKE_MPV_EVENTS 64
+#define FAKE_MPV_HANDLES 8
+
+typedef struct {
+    char name[48];
+    char value[256];
+    bool set;
+} fake_prop;
+
+typedef struct {
+    char name[48];
+    mpv_format format;
+} fake_observed;
+
+typedef struct {
+    mpv_event_id event_id;
+    uint64_t reply_userdata;
+    // PROPERTY_CHANGE only.
+    char name[48];
+    mpv_format format;
+    char value[256];
+    bool set;
+} fake_change;
+
+struct mpv_handle {
+    fake_prop props[FAKE_MPV_PROPS];
+    int nprops;
+    fake_observed observed[FAKE_MPV_PROPS];
+    int nobserved;
+    fake_change queue[FAKE_MPV_EVENTS];
+    int head, tail;
+    char commands[1024];
+    char taken[1024];
+    void (*wakeup)(void *);
+    void *wakeup_ctx;
+    // Storage behind the event last returned by mpv_wait_event.
+    mpv_event event;
+    mpv_event_property property;
+    fake_change current;
+    char *string;
+    int flag;
+    int64_t int64;
+    double double_;
+};
+
+struct mpv_render_context {
+    uint64_t flags;
+};
+
+static mpv_handle *g_handles[FAKE_MPV_HANDLES];
+static int g_handle_count;
+static int g_property_reads;
+
+mpv_handle *fake_mpv_handle(int index) { return index < g_handle_count ? g_handles[index] : NULL; }
+int fake_mpv_property_reads(void) { return g_property_reads; }
+
+const char *fake_mpv_take_commands(mpv_handle *ctx) {
+    snprintf(ctx->taken, sizeof(ctx->taken), "%s", ctx->commands);
+    ctx->commands[0] = '\0';
+    return ctx->taken;
+}
+
+static fake_prop *prop_find(mpv_handle *ctx, const char *name, bool create) {
+    for (int i = 0; i < ctx->nprops; ++i) {
+        if (!strcmp(ctx->props[i].name, name)) return &ctx->props[i];
+    }
+    if (!create || ctx->nprops == FAKE_MPV_PROPS) return NULL;
+    fake_prop *p = &ctx->props[ctx->nprops++];
+    snprintf(p->name, sizeof(p->name), "%s", name);
+    return p;
+}
+
+static fake_change *queue_event(mpv_handle *ctx, mpv_event_id id, uint64_t reply_userdata) {
+    if ((ctx->tail + 1) % FAKE_MPV_EVENTS == ctx->head) return NULL;
+    fake_change *c = &ctx->queue[ctx->tail];
+    ctx->tail = (ctx->tail + 1) % FAKE_MPV_EVENTS;
+    memset(c, 0, sizeof(*c));
+    c->event_id = id;
+    c->reply_userdata = reply_userdata;
+    if (ctx->wakeup) ctx->wakeup(ctx->wakeup_ctx);
+    return c;
+}
+
+static void queue_change(mpv_handle *ctx, const fake_observed *o, const fake_prop *p) {
+    fake_change *c = queue_event(ctx, MPV_EVENT_PROPERTY_CHANGE, 0);
+    if (!c) return;
+    snprintf(c->name, sizeof(c->name), "%s", o->name);
+    c->format = o->format;
+    c->set = p && p->set;
+    snprintf(c->value, sizeof(c->value), "%s", c->set ? p->value : "");
+}
+
+static void prop_store(mpv_handle *ctx, const char *name, const char *value, bool notify) {
+    fake_prop *p = prop_find(ctx, name, true);
+    if (!p) return;
+    bool changed = p->set != (value != NULL) || (value && strcmp(p->value, value));
+    p->set = value != NULL;
+    snprintf(p->value, sizeof(p->value), "%s", value ? value : "");
+    if (!notify || !changed) return;
+    for (int i = 0; i < ctx->nobserved; ++i) {
+        if (!strcmp(ctx->observed[i].name, name)) queue_change(ctx, &ctx->observed[i], p);
+    }
+}
+
+void fake_mpv_change(mpv_handle *ctx, const char *name, const char *value) { prop_store(ctx, name, value, true); }
+void fake_mpv_event(mpv_handle *ctx, mpv_event_id id) { queue_event(ctx, id, 0); }
+
+static void log_command(mpv_handle *ctx, const char **args) {
+    size_t len = strlen(ctx->commands);
+    for (int i = 0; args[i]; ++i) {
+        len += snprintf(ctx->commands + len, sizeof(ctx->commands) - len, "%s%s", i ? " " : "", args[i]);
+        if (len >= sizeof(ctx->commands)) return;
+    }
+    snprintf(ctx->commands + len, sizeof(ctx->commands) - len, ";");
+}
+
+// Convert a stored value to format; false when it does not parse as one.
+static bool convert(const char *value, mpv_format format, char **string, int *flag, int64_t *int64, double *d) {
+    char *end = NULL;
+    switch (format) {
+        case MPV_FORMAT_STRING:
+        case MPV_FORMAT_OSD_STRING:
+            *string = (char *)value;
+            return true;
+        case MPV_FORMAT_FLAG:
+            *flag = !strcmp(value, "yes");
+            return *flag || !strcmp(value, "no");
+        case MPV_FORMAT_INT64:
+            *int64 = strtoll(value, &end, 10);
+            return end != value && !*end;
+        case MPV_FORMAT_DOUBLE:
+            *d = strtod(value, &end);
+            return end != value && !*end;
+        default:
+            return false;
+    }
+}
+
+mpv_handle *mpv_create(void) {
+    if (g_handle_count == FAKE_MPV_HANDLES) return NULL;
+    mpv_handle *ctx = calloc(1, sizeof(*ctx));
+    if (ctx) g_handles[g_handle_count++] = ctx;
+    return ctx;
+}
+
+int mpv_initialize(mpv_handle *ctx) { (void)ctx; return 0; }
+
+void mpv_terminate_destroy(mpv_handle *ctx) {
+    for (int i = 0; i < g_handle_count; ++i) {
+        if (g_handles[i] == ctx) g_handles[i] = NULL;
+    }
+    free(ctx);
+}
+
+const char *mpv_error_string(int error) { return error ? "error" : "success"; }
+void mpv_free(void *data) { free(data); }
+void mpv_free_node_contents(mpv_node *node) { (void)node; }
+
+int mpv_set_option_string(mpv_handle *ctx, const char *name, const char *data) {
+    prop_store(ctx, name, data, false);
+    return 0;
+}
+
+int mpv_command_async(mpv_handle *ctx, uint64_t reply_userdata, const char **args) {
+    log_command(ctx, args);
+    queue_event(ctx, MPV_EVENT_COMMAND_REPLY, reply_userdata);
+    return 0;
+}
+
+int mpv_command_string(mpv_handle *ctx, const char *args) {
+    (void)ctx; (void)args;
+    return 0;
+}
+
+int mpv_command_node_async(mpv_handle *ctx, uint64_t reply_userdata, mpv_node *args) {
+    (void)args;
+    queue_event(ctx, MPV_EVENT_COMMAND_REPLY, reply_userdata);
+    return 0;
+}
+
+int mpv_get_property(mpv_handle *ctx, const char *name, mpv_format format, void *data) {
+    g_property_reads++;
+    fake_prop *p = prop_find(ctx, name, false);
+    char *string;
+    int flag;
+    int64_t int64;
+    double d;
+    if (!p || !p->set || !convert(p->value, format, &string, &flag, &int64, &d)) return MPV_ERROR_PROPERTY_UNAVAILABLE;
+    if (format == MPV_FORMAT_STRING || format == MPV_FORMAT_OSD_STRING) *(char **)data = strdup(string);
+    else if (format == MPV_FORMAT_FLAG) *(int *)data = flag;
+    else if (format == MPV_FORMAT_INT64) *(int64_t *)data = int64;
+    else *(double *)data = d;
+    return 0;
+}
+
+char *mpv_get_property_string(mpv_handle *ctx, const char *name) {
+    char *value = NULL;
+    return mpv_get_property(ctx, name, MPV_FORMAT_STRING, &value) == 0 ? value : NULL;
+}
+
+int mpv_set_property(mpv_handle *ctx, const char *name, mpv_format format, void *data) {
+    char value[256];
+    if (format == MPV_FORMAT_STRING) snprintf(value, sizeof(value), "%s", *(char **)data);
+    else if (format == MPV_FORMAT_FLAG) snprintf(value, sizeof(value), "%s", *(int *)data ? "yes" : "no");
+    else if (format == MPV_FORMAT_INT64) snprintf(value, sizeof(value), "%lld", (long long)*(int64_t *)data);
+    else if (format == MPV_FORMAT_DOUBLE) snprintf(value, sizeof(value), "%g", *(double *)data);
+    else return -1;
+    prop_store(ctx, name, value, true);
+    return 0;
+}
+
+int mpv_set_property_string(mpv_handle *ctx, const char *name, const char *data) {
+    prop_store(ctx, name, data, true);
+    return 0;
+}
+
+int mpv_observe_property(mpv_handle *mpv, uint64_t reply_userdata, const char *name, mpv_format format) {
+    (void)reply_userdata;
+    if (mpv->nobserved == FAKE_MPV_PROPS) return -1;
+    fake_observed *o = &mpv->observed[mpv->nobserved++];
+    snprintf(o->name, sizeof(o->name), "%s", name);
+    o->format = format;
+    // Like libmpv, report the current value once.
+    queue_change(mpv, o, prop_find(mpv, name, false));
+    return 0;
+}
+
+int mpv_request_log_messages(mpv_handle *ctx, const char *min_level) {
+    (void)ctx; (void)min_level;
+    return 0;
+}
+
+mpv_event *mpv_wait_event(mpv_handle *ctx, double timeout) {
+    (void)timeout;
+    memset(&ctx->event, 0, sizeof(ctx->event));
+    if (ctx->head == ctx->tail) return &ctx->event;
+    ctx->current = ctx->queue[ctx->head];
+    ctx->head = (ctx->head + 1) % FAKE_MPV_EVENTS;
+    fake_change *c = &ctx->current;
+    ctx->event.event_id = c->event_id;
+    ctx->event.reply_userdata = c->reply_userdata;
+    if (c->event_id != MPV_EVENT_PROPERTY_CHANGE) return &ctx->event;
+    ctx->property.name = c->name;
+    ctx->property.format = MPV_FORMAT_NONE;
+    ctx->property.data = NULL;
+    if (c->set && convert(c->value, c->format, &ctx->string, &ctx->flag, &ctx->int64, &ctx->double_)) {
+        ctx->property.format = c->format;
+        if (c->format == MPV_FORMAT_STRING || c->format == MPV_FORMAT_OSD_STRING) ctx->property.data = &ctx->string;
+        else if (c->format == MPV_FORMAT_FLAG) ctx->property.data = &ctx->flag;
+        else if (c->format == MPV_FORMAT_INT64) ctx->property.data = &ctx->int64;
+        else ctx->property.data = &ctx->double_;
+    }
+    ctx->event.data = &ctx->property;
+    return &ctx->event;
+}
+
+void mpv_set_wakeup_callback(mpv_handle *ctx, void (*cb)(void *d), void *d) {
+    ctx->wakeup = cb;
+    ctx->wakeup_ctx = d;
+}
+
+int mpv_render_context_create(mpv_render_context **res, mpv_handle *mpv, mpv_render_param *params) {
+    (void)mpv; (void)params;
+    *res = calloc(1, sizeof(**res));
+    return *res ? 0 : -1;
+}
+
+void mpv_render_context_set_update_callback(mpv_render_context *ctx, mpv_render_update_fn callback, void *callback_ctx) {
+    (void)ctx; (void)callback; (void)callback_ctx;
+}
+
+uint64_t mpv_render_context_update(mpv_render_context *ctx) {
+    uint64_t flags = ctx->flags;
+    ctx->flags = 0;
+    return flags;
+}
+
+int mpv_render_context_render(mpv_render_context *ctx, mpv_render_param *params) {
+    (void)ctx; (void)params;
+    return 0;
+}
+
+void mpv_render_context_free(mpv_render_context *ctx) { free(ctx); }
+
+void fake_mpv_render_update(mpv_render_context *ctx, uint64_t flags) { ctx->flags |= flags; }
@@ -0,0 +1,130 @@
+#ifndef FAKE_MPV_CLIENT_H
+#define FAKE_MPV_CLIENT_H
+
+// The subset of the libmpv client API the media panes use, with libmpv's
+// layouts, backed by mpv.c so media.c can be built and driven in tests without
+// libmpv installed.
+
+#include <stdint.h>
+
+typedef struct mpv_handle mpv_handle;
+
+typedef enum {
+    MPV_ERROR_SUCCESS = 0,
+    MPV_ERROR_PROPERTY_UNAVAILABLE = -10,
+} mpv_error;
+
+typedef enum {
+    MPV_FORMAT_NONE = 0,
+    MPV_FORMAT_STRING = 1,
+    MPV_FORMAT_OSD_STRING = 2,
+    MPV_FORMAT_FLAG = 3,
+    MPV_FORMAT_INT64 = 4,
+    MPV_FORMAT_DOUBLE = 5,
+    MPV_FORMAT_NODE = 6,
+    MPV_FORMAT_NODE_ARRAY = 7,
+    MPV_FORMAT_NODE_MAP = 8,
+    MPV_FORMAT_BYTE_ARRAY = 9,
+} mpv_format;
+
+typedef struct mpv_node {
+    union {
+        char *string;
+        int flag;
+        int64_t int64;
+        double double_;
+        struct mpv_node_list *list;
+        struct mpv_byte_array *ba;
+    } u;
+    mpv_format format;
+} mpv_node;
+
+typedef struct mpv_node_list {
+    int num;
+    mpv_node *values;
+    char **keys;
+} mpv_node_list;
+
+typedef enum {
+    MPV_EVENT_NONE = 0,
+    MPV_EVENT_SHUTDOWN = 1,
+    MPV_EVENT_LOG_MESSAGE = 2,
+    MPV_EVENT_COMMAND_REPLY = 5,
+    MPV_EVENT_START_FILE = 6,
+    MPV_EVENT_END_FILE = 7,
+    MPV_EVENT_FILE_LOADED = 8,
+    MPV_EVENT_VIDEO_RECONFIG = 17,
+    MPV_EVENT_PLAYBACK_RESTART = 21,
+    MPV_EVENT_PROPERTY_CHANGE = 22,
+} mpv_event_id;
+
+typedef struct {
+    mpv_event_id event_id;
+    int error;
+    uint64_t reply_userdata;
+    void *data;
+} mpv_event;
+
+typedef struct {
+    const char *name;
+    mpv_format format;
+    void *data;
+} mpv_event_property;
+
+typedef struct {
+    const char *prefix;
+    const char *level;
+    const char *text;
+    int log_level;
+} mpv_event_log_message;
+
+typedef struct {
+    int64_t playlist_entry_id;
+} mpv_event_start_file;
+
+typedef enum {
+    MPV_END_FILE_REASON_EOF = 0,
+    MPV_END_FILE_REASON_STOP = 2,
+    MPV_END_FILE_REASON_QUIT = 3,
+    MPV_END_FILE_REASON_ERROR = 4,
+    MPV_END_FILE_REASON_REDIRECT = 5,
+} mpv_end_file_reason;
+
+typedef struct {
+    mpv_end_file_reason reason;
+    int error;
+    int64_t playlist_entry_id;
+    int64_t playlist_insert_id;
+    int playlist_insert_num_entries;
+} mpv_event_end_file;
+
+mpv_handle *mpv_create(void);
+int mpv_initialize(mpv_handle *ctx);
+void mpv_terminate_destroy(mpv_handle *ctx);
+const char *mpv_error_string(int error);
+void mpv_free(void *data);
+void mpv_free_node_contents(mpv_node *node);
+int mpv_set_option_string(mpv_handle *ctx, const char *name, const char *data);
+int mpv_command_async(mpv_handle *ctx, uint64_t reply_userdata, const char **args);
+int mpv_command_string(mpv_handle *ctx, const char *args);
+int mpv_command_node_async(mpv_handle *ctx, uint64_t reply_userdata, mpv_node *args);
+int mpv_get_property(mpv_handle *ctx, const char *name, mpv_format format, void *data);
+char *mpv_get_property_string(mpv_handle *ctx, const char *name);
+int mpv_set_property(mpv_handle *ctx, const char *name, mpv_format format, void *data);
+int mpv_set_property_string(mpv_handle *ctx, const char *name, const char *data);
+int mpv_observe_property(mpv_handle *mpv, uint64_t reply_userdata, const char *name, mpv_format format);
+int mpv_request_log_messages(mpv_handle *ctx, const char *min_level);
+mpv_event *mpv_wait_event(mpv_handle *ctx, double timeout);
+void mpv_set_wakeup_callback(mpv_handle *ctx, void (*cb)(void *d), void *d);
+
+// Test hooks: handles in creation order, a property change as if made by
+// playback (NULL makes it unavailable), an event without data as if sent by
+// playback, the synchronous property reads so far, and the commands sent to a
+// handle since the last call ("seek 0 absolute;playlist-next force;").
+mpv_handle *fake_mpv_handle(int index);
+void fake_mpv_change(mpv_handle *ctx, const char *name, const char *value);
+void fake_mpv_event(mpv_handle *ctx, mpv_event_id id);
+int fake_mpv_property_reads(void);
+const char *fake_mpv_take_commands(mpv_handle *ctx);
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef FAKE_MPV_RENDER_H
+#define FAKE_MPV_RENDER_H
+
+#include "client.h"
+
+typedef struct mpv_render_context mpv_render_context;
+
+typedef enum {
+    MPV_RENDER_PARAM_INVALID = 0,
+    MPV_RENDER_PARAM_API_TYPE = 1,
+    MPV_RENDER_PARAM_OPENGL_INIT_PARAMS = 2,
+    MPV_RENDER_PARAM_OPENGL_FBO = 3,
+    MPV_RENDER_PARAM_FLIP_Y = 4,
+    MPV_RENDER_PARAM_ADVANCED_CONTROL = 10,
+    MPV_RENDER_PARAM_BLOCK_FOR_TARGET_TIME = 12,
+    MPV_RENDER_PARAM_SKIP_RENDERING = 13,
+} mpv_render_param_type;
+
+#define MPV_RENDER_API_TYPE_OPENGL "opengl"
+
+typedef struct {
+    mpv_render_param_type type;
+    void *data;
+} mpv_render_param;
+
+typedef enum {
+    MPV_RENDER_UPDATE_FRAME = 1 << 0,
+} mpv_render_update_flag;
+
+typedef void (*mpv_render_update_fn)(void *cb_ctx);
+
+int mpv_render_context_create(mpv_render_context **res, mpv_handle *mpv, mpv_render_param *params);
+void mpv_render_context_set_update_callback(mpv_render_context *ctx, mpv_render_update_fn callback, void *callback_ctx);
+uint64_t mpv_render_context_update(mpv_render_context *ctx);
+int mpv_render_context_render(mpv_render_context *ctx, mpv_render_param *params);
+void mpv_render_context_free(mpv_render_context *ctx);
+
+// Test hook: flags the next mpv_render_context_update returns.
+void fake_mpv_render_update(mpv_render_context *ctx, uint64_t flags);
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef FAKE_MPV_RENDER_GL_H
+#define FAKE_MPV_RENDER_GL_H
+
+#include "render.h"
+
+typedef struct {
+    void *(*get_proc_address)(void *ctx, const char *name);
+    void *get_proc_address_ctx;
+} mpv_opengl_init_params;
+
+typedef struct {
+    int fbo;
+    int w, h;
+    int internal_format;
+} mpv_opengl_fbo;
+
+#endif
@@ -0,0 +1,167 @@
+// A tiny stand-in for libvterm: printable ASCII lands in a grid at the cursor,
+// \r and \n move it, the last line scrolls the grid up through the moverect
+// callback, and damage is collected until vterm_screen_flush_damage.
+
+#include "vterm.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct VTermState {
+    int unused;
+};
+
+struct VTermScreen {
+    VTerm *vt;
+    const VTermScreenCallbacks *cb;
+    void *user;
+};
+
+struct VTerm {
+    int rows, cols;
+    uint32_t *grid;
+    int row, col;
+    int damage_start, damage_end; // rows, empty when start >= end
+    VTermState state;
+    VTermScreen screen;
+};
+
+static atomic_size_t g_bytes_fed;
+static atomic_size_t g_main_writes;
+static pthread_t g_main_thread;
+static atomic_bool g_main_set;
+
+size_t fake_vterm_bytes_fed(void) { return atomic_load(&g_bytes_fed); }
+
+void fake_vterm_set_main_thread(void) {
+    g_main_thread = pthread_self();
+    atomic_store(&g_main_set, true);
+}
+
+size_t fake_vterm_main_thread_writes(void) { return atomic_load(&g_main_writes); }
+
+static void damage_rows(VTerm *vt, int start, int end) {
+    if (vt->damage_start >= vt->damage_end) {
+        vt->damage_start = start;
+        vt->damage_end = end;
+        return;
+    }
+    if (start < vt->damage_start) vt->damage_start = start;
+    if (end > vt->damage_end) vt->damage_end = end;
+}
+
+static void clear_grid(VTerm *vt) {
+    memset(vt->grid, 0, (size_t)vt->rows * (size_t)vt->cols * sizeof(*vt->grid));
+    vt->row = vt->col = 0;
+    damage_rows(vt, 0, vt->rows);
+}
+
+VTerm *vterm_new(int rows, int cols) {
+    VTerm *vt = calloc(1, sizeof(*vt));
+    vt->rows = rows;
+    vt->cols = cols;
+    vt->grid = calloc((size_t)rows * (size_t)cols, sizeof(*vt->grid));
+    vt->screen.vt = vt;
+    return vt;
+}
+
+void vterm_free(VTerm *vt) {
+    if (!vt) return;
+    free(vt->grid);
+    free(vt);
+}
+
+void vterm_set_utf8(VTerm *vt, int is_utf8) { (void)vt; (void)is_utf8; }
+
+static void newline(VTerm *vt) {
+    if (vt->row + 1 < vt->rows) {
+        vt->row++;
+        return;
+    }
+    // Pending damage is flushed first so it still refers to the rows before the move.
+    vterm_screen_flush_damage(&vt->screen);
+    size_t row_cells = (size_t)vt->cols;
+    memmove(vt->grid, vt->grid + row_cells, (size_t)(vt->rows - 1) * row_cells * sizeof(*vt->grid));
+    memset(vt->grid + (size_t)(vt->rows - 1) * row_cells, 0, row_cells * sizeof(*vt->grid));
+    const VTermScreenCallbacks *cb = vt->screen.cb;
+    VTermRect dest = {.start_row = 0, .end_row = vt->rows - 1, .start_col = 0, .end_col = vt->cols};
+    VTermRect src = {.start_row = 1, .end_row = vt->rows, .start_col = 0, .end_col = vt->cols};
+    if (!cb || !cb->moverect || !cb->moverect(dest, src, vt->screen.user)) damage_rows(vt, 0, vt->rows - 1);
+    damage_rows(vt, vt->rows - 1, vt->rows);
+}
+
+size_t vterm_input_write(VTerm *vt, const char *bytes, size_t len) {
+    if (atomic_load(&g_main_set) && pthread_equal(pthread_self(), g_main_thread)) atomic_fetch_add(&g_main_writes, 1);
+    atomic_fetch_add(&g_bytes_fed, len);
+    for (size_t i = 0; i < len; ++i) {
+        unsigned char c = (unsigned char)bytes[i];
+        if (c == '\r') {
+            vt->col = 0;
+        } else if (c == '\n') {
+            newline(vt);
+        } else if (c >= 0x20 && c < 0x7f) {
+            if (vt->col >= vt->cols) {
+                vt->col = 0;
+                newline(vt);
+            }
+            vt->grid[(size_t)vt->row * (size_t)vt->cols + (size_t)vt->col++] = c;
+            damage_rows(vt, vt->row, vt->row + 1);
+        }
+    }
+    return len;
+}
+
+void vterm_set_size(VTerm *vt, int rows, int cols) {
+    free(vt->grid);
+    vt->rows = rows;
+    vt->cols = cols;
+    vt->grid = calloc((size_t)rows * (size_t)cols, sizeof(*vt->grid));
+    clear_grid(vt);
+    const VTermScreenCallbacks *cb = vt->screen.cb;
+    if (cb && cb->resize) cb->resize(rows, cols, vt->screen.user);
+}
+
+void vterm_get_size(const VTerm *vt, int *rowsp, int *colsp) {
+    if (rowsp) *rowsp = vt->rows;
+    if (colsp) *colsp = vt->cols;
+}
+
+VTermState *vterm_obtain_state(VTerm *vt) { return &vt->state; }
+
+VTermScreen *vterm_obtain_screen(VTerm *vt) { return &vt->screen; }
+
+void vterm_screen_enable_altscreen(VTermScreen *screen, int altscreen) { (void)screen; (void)altscreen; }
+
+void vterm_screen_reset(VTermScreen *screen, int hard) {
+    (void)hard;
+    clear_grid(screen->vt);
+}
+
+void vterm_screen_flush_damage(VTermScreen *screen) {
+    VTerm *vt = screen->vt;
+    if (vt->damage_start >= vt->damage_end) return;
+    VTermRect rect = {.start_row = vt->damage_start, .end_row = vt->damage_end, .start_col = 0, .end_col = vt->cols};
+    vt->damage_start = vt->damage_end = 0;
+    if (screen->cb && screen->cb->damage) screen->cb->damage(rect, screen->user);
+}
+
+void vterm_screen_set_damage_merge(VTermScreen *screen, VTermDamageSize size) { (void)screen; (void)size; }
+
+void vterm_screen_set_callbacks(VTermScreen *screen, const VTermScreenCallbacks *callbacks, void *user) {
+    screen->cb = callbacks;
+    screen->user = user;
+}
+
+int vterm_screen_get_cell(const VTermScreen *screen, VTermPos pos, VTermScreenCell *cell) {
+    const VTerm *vt = screen->vt;
+    memset(cell, 0, sizeof(*cell));
+    cell->width = 1;
+    cell->fg.type = VTERM_COLOR_DEFAULT_FG;
+    cell->bg.type = VTERM_COLOR_DEFAULT_BG;
+    if (pos.row < 0 || pos.row >= vt->rows || pos.col < 0 || pos.col >= vt->cols) return 0;
+    cell->chars[0] = vt->grid[(size_t)pos.row * (size_t)vt->cols + (size_t)pos.col];
+    return 1;
+}
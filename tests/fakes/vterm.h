@@ -0,0 +1,96 @@
+#ifndef FAKE_VTERM_H
+#define FAKE_VTERM_H
+
+// The subset of the libvterm API the terminal panes use, backed by the small
+// screen in vterm.c so term_pane.c can be built and driven in tests without
+// libvterm installed.
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct VTerm VTerm;
+typedef struct VTermState VTermState;
+typedef struct VTermScreen VTermScreen;
+
+typedef struct {
+    int row, col;
+} VTermPos;
+
+typedef struct {
+    int start_row, end_row, start_col, end_col;
+} VTermRect;
+
+typedef enum {
+    VTERM_COLOR_RGB = 0x00,
+    VTERM_COLOR_INDEXED = 0x01,
+    VTERM_COLOR_TYPE_MASK = 0x01,
+    VTERM_COLOR_DEFAULT_FG = 0x02,
+    VTERM_COLOR_DEFAULT_BG = 0x04,
+    VTERM_COLOR_DEFAULT_MASK = 0x06
+} VTermColorType;
+
+typedef union {
+    uint8_t type;
+    struct {
+        uint8_t type;
+        uint8_t red, green, blue;
+    } rgb;
+    struct {
+        uint8_t type;
+        uint8_t idx;
+    } indexed;
+} VTermColor;
+
+typedef struct {
+    unsigned int bold : 1, underline : 2, italic : 1, blink : 1, reverse : 1, conceal : 1, strike : 1, font : 4,
+        dwl : 1, dhl : 2, small : 1, baseline : 2;
+} VTermScreenCellAttrs;
+
+#define VTERM_MAX_CHARS_PER_CELL 6
+typedef struct {
+    uint32_t chars[VTERM_MAX_CHARS_PER_CELL];
+    char width;
+    VTermScreenCellAttrs attrs;
+    VTermColor fg, bg;
+} VTermScreenCell;
+
+typedef enum { VTERM_DAMAGE_CELL, VTERM_DAMAGE_ROW, VTERM_DAMAGE_SCREEN, VTERM_DAMAGE_SCROLL } VTermDamageSize;
+typedef enum { VTERM_PROP_CURSORVISIBLE = 1 } VTermProp;
+typedef union {
+    int boolean;
+    int number;
+} VTermValue;
+
+typedef struct {
+    int (*damage)(VTermRect rect, void *user);
+    int (*moverect)(VTermRect dest, VTermRect src, void *user);
+    int (*movecursor)(VTermPos pos, VTermPos oldpos, int visible, void *user);
+    int (*settermprop)(VTermProp prop, VTermValue *val, void *user);
+    int (*bell)(void *user);
+    int (*resize)(int rows, int cols, void *user);
+    int (*sb_pushline)(int cols, const VTermScreenCell *cells, void *user);
+    int (*sb_popline)(int cols, VTermScreenCell *cells, void *user);
+} VTermScreenCallbacks;
+
+VTerm *vterm_new(int rows, int cols);
+void vterm_free(VTerm *vt);
+void vterm_set_utf8(VTerm *vt, int is_utf8);
+size_t vterm_input_write(VTerm *vt, const char *bytes, size_t len);
+void vterm_set_size(VTerm *vt, int rows, int cols);
+void vterm_get_size(const VTerm *vt, int *rowsp, int *colsp);
+VTermState *vterm_obtain_state(VTerm *vt);
+VTermScreen *vterm_obtain_screen(VTerm *vt);
+void vterm_screen_enable_altscreen(VTermScreen *screen, int altscreen);
+void vterm_screen_reset(VTermScreen *screen, int hard);
+void vterm_screen_flush_damage(VTermScreen *screen);
+void vterm_screen_set_damage_merge(VTermScreen *screen, VTermDamageSize size);
+void vterm_screen_set_callbacks(VTermScreen *screen, const VTermScreenCallbacks *callbacks, void *user);
+int vterm_screen_get_cell(const VTermScreen *screen, VTermPos pos, VTermScreenCell *cell);
+
+// Test hooks: bytes fed so far, and how many writes came from the thread that
+// set fake_vterm_main_thread.
+size_t fake_vterm_bytes_fed(void);
+void fake_vterm_set_main_thread(void);
+size_t fake_vterm_main_thread_writes(void);
+
+#endif
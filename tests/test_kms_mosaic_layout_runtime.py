@@ -1,4 +1,7 @@
 import pathlib
+import subprocess
+import tempfile
+import textwrap
 import unittest
 
 
@@ -29,6 +32,99 @@ class KmsMosaicLayoutRuntimeTests(unittest.TestCase):
         self.assertIn("bool pane_hidden = options_pane_hidden(opt, i);", frame_src)
         self.assertIn("bool pane_visible = !pane_hidden && (!ui->fullscreen || ui->fs_pane == i);", frame_src)
 
+    def test_font_fitting_uses_memoized_metrics_table(self):
+        term_src = (REPO_ROOT / "src" / "term_pane.c").read_text(encoding="utf-8")
+        # term_pane.c needs libvterm, so its hand-off to the shared table is checked by source.
+        self.assertIn("return kms_font_cell_metrics(font_px, cell_w, cell_h);", term_src)
+
+        try:
+            flags = subprocess.run(["pkg-config", "--cflags", "--libs", "freetype2", "fontconfig"],
+                                   check=True, capture_output=True, text=True).stdout.split()
+        except (OSError, subprocess.CalledProcessError):
+            self.skipTest("freetype2/fontconfig development files not available")
+        with tempfile.TemporaryDirectory() as tmpdir:
+            tmp = pathlib.Path(tmpdir)
+            # panes.c only needs the opaque libvterm/mpv handles from these headers.
+            (tmp / "mpv").mkdir()
+            (tmp / "mpv" / "client.h").write_text("typedef struct mpv_handle mpv_handle;\n", encoding="utf-8")
+            (tmp / "vterm.h").write_text("\n", encoding="utf-8")
+            probe = tmp / "font_fit_probe.c"
+            probe.write_text(
+                textwrap.dedent(
+                    """
+                    #include <stdio.h>
+                    #include <stdlib.h>
+                    #include "font_util.h"
+                    #include "panes.h"
+
+                    bool term_measure_cell(int font_px, int *cell_w, int *cell_h) {
+                        return kms_font_cell_metrics(font_px, cell_w, cell_h);
+                    }
+                    term_pane *term_pane_create(const pane_layout *l, int px, const char *c, char *const a[]) {
+                        (void)l; (void)px; (void)c; (void)a; abort();
+                    }
+                    term_pane *term_pane_create_cmd(const pane_layout *l, int px, const char *c) {
+                        (void)l; (void)px; (void)c; abort();
+                    }
+                    void term_pane_destroy(term_pane *tp) { (void)tp; }
+                    void term_pane_resize(term_pane *tp, const pane_layout *l) { (void)tp; (void)l; }
+                    void term_pane_set_font_px(term_pane *tp, int px) { (void)tp; (void)px; }
+                    void term_pane_set_alpha(term_pane *tp, uint8_t a) { (void)tp; (void)a; }
+                    void term_pane_set_render_mode(term_render_mode mode) { (void)mode; }
+                    void term_pane_set_threaded(bool on) { (void)on; }
+
+                    static bool fits(int px, const pane_layout *lay) {
+                        int cw, ch;
+                        return kms_font_cell_metrics(px, &cw, &ch) && lay->w / cw >= 80 && lay->h / ch >= 24;
+                    }
+
+                    int main(void) {
+                        int cw, ch;
+                        if (!kms_font_cell_metrics(18, &cw, &ch)) { printf("nofont\\n"); return 0; }
+                        for (int px = 1; px <= KMS_FONT_METRICS_MAX_PX + 8; ++px) {
+                            int w1 = 0, h1 = 0, w2 = 0, h2 = 0;
+                            bool ok1 = kms_font_cell_metrics(px, &w1, &h1);
+                            bool ok2 = kms_font_cell_metrics(px, &w2, &h2);
+                            if (ok1 != ok2 || w1 != w2 || h1 != h2) { printf("unstable %d\\n", px); return 1; }
+                        }
+                        const int sizes[][3] = {
+                            {1920, 1080, 48}, {1280, 720, 40}, {800, 480, 18}, {640, 400, 30}, {300, 200, 24},
+                            {2000, 1200, 8}, {3840, 2160, 64}, {1001, 557, 33},
+                        };
+                        for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i) {
+                            pane_layout lay = {.x = 0, .y = 0, .w = sizes[i][0], .h = sizes[i][1]};
+                            options_t opt = {0};
+                            opt.font_px = sizes[i][2];
+                            int got = 0;
+                            panes_compute_font_sizes(&opt, &lay, 1, &got);
+                            int want = opt.font_px;
+                            if (want >= 10) {
+                                want = 10;
+                                for (int px = 10; px <= opt.font_px; ++px) if (fits(px, &lay)) want = px;
+                            }
+                            if (got != want) {
+                                printf("%dx%d@%d: got %d want %d\\n", lay.w, lay.h, opt.font_px, got, want);
+                                return 1;
+                            }
+                        }
+                        printf("ok\\n");
+                        return 0;
+                    }
+                    """
+                ),
+                encoding="utf-8",
+            )
+            exe = tmp / "font_fit_probe"
+            subprocess.run(
+                ["cc", "-std=c11", "-O2", "-Wall", "-Wextra", f"-I{tmp}", f"-I{REPO_ROOT / 'src'}",
+                 str(probe), str(REPO_ROOT / "src" / "panes.c"), str(REPO_ROOT / "src" / "font_util.c"),
+                 "-o", str(exe), *flags],
+                check=True,
+            )
+            out = subprocess.run([str(exe)], check=True, capture_output=True, text=True).stdout.strip()
+            if out == "nofont":
+                self.skipTest("no monospace font available")
+            self.assertEqual(out, "ok")
 
 if __name__ == "__main__":
     unittest.main()
@@ -1,4 +1,8 @@
+import json
 import pathlib
+import subprocess
+import tempfile
+import textwrap
 import unittest
 
 
@@ -9,6 +13,32 @@ RENDER_GL_C = ROOT / "src" / "render_gl.c"
 RENDER_GL_H = ROOT / "src" / "render_gl.h"
 RUNTIME_C = ROOT / "src" / "runtime.c"
 RUNTIME_H = ROOT / "src" / "runtime.h"
+DISPLAY_C = ROOT / "src" / "display.c"
+
+
+FAKES = ROOT / "tests" / "fakes"
+# What a terminal pane links against, with libvterm and GL swapped for tests/fakes.
+TERM_PANE_SOURCES = [
+    "src/term_pane.c", "src/term_rows.c", "src/span.c", "src/glyph_cache.c", "src/glyph_synth.c",
+    "src/font_util.c", "src/render_view.c", "tests/fakes/vterm.c", "tests/fakes/gl.c",
+]
+
+
+# Build source with the named files (relative to the repo root) and return the
+# probe's stdout. tests/fakes provides the mpv, libvterm and GL headers.
+def _run_probe(tmp: pathlib.Path, name: str, source: str, sources: list, flags: tuple = (), args: tuple = ()) -> str:
+    probe = tmp / f"{name}.c"
+    probe.write_text(textwrap.dedent(source), encoding="utf-8")
+    binary = tmp / name
+    subprocess.run(
+        ["cc", "-std=c11", "-O2", "-Wall", "-Wextra", "-pthread", f"-I{FAKES}", f"-I{ROOT / 'src'}",
+         str(probe), *[str(ROOT / src) for src in sources], "-o", str(binary), *flags, "-lm"],
+        check=True,
+        capture_output=True,
+        text=True,
+    )
+    return subprocess.run([str(binary), *args], check=False, capture_output=True, text=True,
+                          stdin=subprocess.DEVNULL).stdout.strip()
 
 
 class RenderTargetTests(unittest.TestCase):
@@ -106,6 +136,1619 @@ class RenderTargetTests(unittest.TestCase):
             app_src.find("app_restore_linux_console();"),
         )
 
+    def test_main_loop_skips_presenting_when_scene_is_clean(self) -> None:
+        app_src = APP_C.read_text(encoding="utf-8")
+        frame_src = FRAME_C.read_text(encoding="utf-8")
+
+        # The present/skip decision is app.c loop wiring, which needs DRM/EGL/mpv to build.
+        self.assertNotIn("if (use_mpv) rt->mpv_needs_render = 1;", frame_src)
+        self.assertIn("rt->scene_dirty = false;", frame_src)
+        self.assertIn("if (app_poll_panes(&opt, &ui, &rt, &panes, pane_ready)) rt.scene_dirty = true;", app_src)
+        self.assertIn("if (snapshot_path) rt.scene_dirty = true;", app_src)
+        self.assertIn("app_wait_deadline_ns(&rt, &ui, &cfg_watch, &snap_watch, &opt, &panes)", app_src)
+        self.assertLess(app_src.find("rt.idle_frames++;"), app_src.find("frame_render(&opt, &rt"))
+
+        with tempfile.TemporaryDirectory() as tmpdir:
+            tmp = pathlib.Path(tmpdir)
+            out = _run_probe(
+                tmp,
+                "idle_probe",
+                """
+                #include <stdio.h>
+                #include <string.h>
+                #include <sys/eventfd.h>
+                #include <unistd.h>
+                #include "glyph_cache.h"
+                #include "runtime.h"
+
+                term_pane *panes_get_term(const pane_runtime *panes, int slot) { (void)panes; (void)slot; return NULL; }
+                int term_pane_get_fd(const term_pane *tp) { (void)tp; return -1; }
+                pid_t term_pane_get_child_pid(const term_pane *tp) { (void)tp; return 0; }
+                static bool hung_up;
+                bool term_pane_pty_hung_up(const term_pane *tp) { (void)tp; return hung_up; }
+                void glyph_cache_get_stats(glyph_cache_stats *out) { memset(out, 0, sizeof(*out)); }
+
+                static bool any_ready(const runtime_state *rt, int except) {
+                    for (int i = 0; i < rt->source_count; ++i)
+                        if (i != except && runtime_source_ready(rt, i)) return true;
+                    return false;
+                }
+
+                int main(void) {
+                    options_t opt;
+                    memset(&opt, 0, sizeof(opt));
+                    opt.pane_count = 1;
+                    media_ctx m, pane_media;
+                    memset(&m, 0, sizeof(m));
+                    memset(&pane_media, 0, sizeof(pane_media));
+                    m.wakeup_fd = m.playlist_fifo_fd = -1;
+                    pane_media.wakeup_fd = pane_media.playlist_fifo_fd = -1;
+                    runtime_state rt;
+                    if (!runtime_init(&rt, &opt, false, &m, -1)) { printf("init\\n"); return 1; }
+                    if (!rt.scene_dirty) { printf("first frame not dirty\\n"); return 1; }
+
+                    // A dirty scene polls: the wait returns at once with nothing ready.
+                    uint64_t t0 = stats_now_ns();
+                    if (!runtime_wait(&rt, 0) || any_ready(&rt, -1)) { printf("poll\\n"); return 1; }
+                    if (stats_now_ns() - t0 > 5000000ull) { printf("poll blocked\\n"); return 1; }
+
+                    // A clean scene sleeps until its next deadline, every time it goes idle.
+                    for (int round = 0; round < 2; ++round) {
+                        t0 = stats_now_ns();
+                        if (!runtime_wait(&rt, t0 + 30000000ull)) { printf("wait\\n"); return 1; }
+                        uint64_t slept = stats_now_ns() - t0;
+                        if (slept < 29000000ull || slept > 500000000ull) {
+                            printf("slept %llu ns\\n", (unsigned long long)slept);
+                            return 1;
+                        }
+                        if (!runtime_source_ready(&rt, RUNTIME_SRC_TIMER) || any_ready(&rt, RUNTIME_SRC_TIMER)) {
+                            printf("timer round %d\\n", round);
+                            return 1;
+                        }
+                    }
+
+                    // A video wakeup ends an idle wait before its deadline.
+                    pane_media.mpv = (mpv_handle *)&pane_media;
+                    pane_media.wakeup_fd = eventfd(1, EFD_NONBLOCK);
+                    runtime_update_pane_fds(&rt, &opt, NULL, &pane_media);
+                    t0 = stats_now_ns();
+                    if (!runtime_wait(&rt, RUNTIME_NO_DEADLINE)) { printf("wait\\n"); return 1; }
+                    if (!runtime_pane_media_ready(&rt, &opt, 0) || stats_now_ns() - t0 > 100000000ull) {
+                        printf("wakeup\\n");
+                        return 1;
+                    }
+
+                    // Without a pidfd a threaded pane's exit is reported by its worker.
+                    term_pane *tp = (term_pane *)&pane_media;
+                    if (runtime_pane_child_exited(&rt, &opt, tp, 0)) { printf("exit without hangup\\n"); return 1; }
+                    hung_up = true;
+                    if (!runtime_pane_child_exited(&rt, &opt, tp, 0)) { printf("worker hangup ignored\\n"); return 1; }
+                    runtime_destroy(&rt);
+                    close(pane_media.wakeup_fd);
+                    printf("ok\\n");
+                    return 0;
+                }
+                """,
+                ["src/runtime.c", "src/stats.c"],
+            )
+        self.assertEqual(out, "ok")
+
+    def test_frame_render_retains_rt_and_repaints_damage_by_buffer_age(self) -> None:
+        frame_src = FRAME_C.read_text(encoding="utf-8")
+        display_src = DISPLAY_C.read_text(encoding="utf-8")
+
+        # frame.c and display.c need a live EGL display; their use of the damage list is checked by source.
+        self.assertIn("if (clear_all) render_gl_clear_color(0.0f, 0.0f, 0.0f, 1.0f);", frame_src)
+        self.assertIn("(compose_to_rt ? rt->pane_damaged[i]", frame_src)
+        self.assertIn("render_gl_damage_repaint_region(rg, &damage, buffer_age, &region)", frame_src)
+        self.assertIn("render_gl_blit_rt_region_to_screen(rg, opt->rotation, &region);", frame_src)
+        self.assertIn("display_egl_swap_buffers(e, egl_rects, egl_rect_count);", frame_src)
+        self.assertIn('"EGL_EXT_buffer_age"', display_src)
+        self.assertIn('eglGetProcAddress("eglSetDamageRegionKHR")', display_src)
+
+        try:
+            flags = subprocess.run(["pkg-config", "--cflags", "--libs", "glesv2"],
+                                   check=True, capture_output=True, text=True).stdout.split()
+        except (OSError, subprocess.CalledProcessError):
+            self.skipTest("GLESv2 development files not available")
+        with tempfile.TemporaryDirectory() as tmpdir:
+            tmp = pathlib.Path(tmpdir)
+            out = _run_probe(
+                tmp,
+                "damage_probe",
+                """
+                #include <stdio.h>
+                #include <string.h>
+                #include "render_gl.h"
+
+                static render_gl_damage rect(int x, int y, int w, int h) {
+                    render_gl_damage d;
+                    render_gl_damage_reset(&d);
+                    render_gl_damage_add_rect(&d, x, y, w, h);
+                    return d;
+                }
+
+                static bool covers(const render_gl_damage *d, int x, int y, int w, int h) {
+                    for (int i = 0; i < d->count; ++i) {
+                        const render_gl_rect *r = &d->rects[i];
+                        if (x >= r->x && y >= r->y && x + w <= r->x + r->w && y + h <= r->y + r->h) return true;
+                    }
+                    return false;
+                }
+
+                int main(void) {
+                    render_gl_ctx ctx;
+                    memset(&ctx, 0, sizeof(ctx));
+                    render_gl_damage region, cur = rect(10, 10, 20, 20);
+
+                    // Nothing presented yet: only an age-1 buffer can be patched up.
+                    if (render_gl_damage_repaint_region(&ctx, &cur, 0, &region)) { printf("age 0\\n"); return 1; }
+                    if (render_gl_damage_repaint_region(&ctx, &cur, 2, &region)) { printf("age past history\\n"); return 1; }
+                    if (!render_gl_damage_repaint_region(&ctx, &cur, 1, &region) || region.count != 1 ||
+                        !covers(&region, 10, 10, 20, 20)) { printf("age 1\\n"); return 1; }
+
+                    // An age-N buffer also misses the damage of the N-1 frames presented since.
+                    render_gl_damage f1 = rect(100, 0, 5, 5), f2 = rect(200, 0, 5, 5), f3 = rect(300, 0, 5, 5);
+                    render_gl_damage_push(&ctx, &f1);
+                    render_gl_damage_push(&ctx, &f2);
+                    render_gl_damage_push(&ctx, &f3);
+                    if (!render_gl_damage_repaint_region(&ctx, &cur, 3, &region) || region.count != 3 ||
+                        !covers(&region, 300, 0, 5, 5) || !covers(&region, 200, 0, 5, 5) ||
+                        covers(&region, 100, 0, 5, 5)) { printf("age 3\\n"); return 1; }
+                    if (!render_gl_damage_repaint_region(&ctx, &cur, 4, &region) || !covers(&region, 100, 0, 5, 5)) {
+                        printf("age 4\\n");
+                        return 1;
+                    }
+                    if (render_gl_damage_repaint_region(&ctx, &cur, 5, &region)) { printf("age 5\\n"); return 1; }
+
+                    // History is capped; older frames fall off and the oldest buffers repaint fully.
+                    for (int i = 0; i < RENDER_GL_DAMAGE_HISTORY + 2; ++i) render_gl_damage_push(&ctx, &f1);
+                    if (ctx.damage_history_count != RENDER_GL_DAMAGE_HISTORY) { printf("history cap\\n"); return 1; }
+                    if (render_gl_damage_repaint_region(&ctx, &cur, RENDER_GL_DAMAGE_HISTORY + 2, &region)) {
+                        printf("age past cap\\n");
+                        return 1;
+                    }
+
+                    // A full repaint anywhere in the window, or now, forces a full repaint.
+                    render_gl_damage full;
+                    render_gl_damage_reset(&full);
+                    full.full = true;
+                    render_gl_damage_push(&ctx, &full);
+                    render_gl_damage_push(&ctx, &f2);
+                    if (!render_gl_damage_repaint_region(&ctx, &cur, 2, &region)) { printf("age 2 after full\\n"); return 1; }
+                    if (render_gl_damage_repaint_region(&ctx, &cur, 3, &region)) { printf("full in history\\n"); return 1; }
+                    if (render_gl_damage_repaint_region(&ctx, &full, 1, &region)) { printf("full now\\n"); return 1; }
+
+                    // Covered rects are dropped; overflowing the list collapses it to one bounding box.
+                    render_gl_damage d = rect(0, 0, 50, 50);
+                    render_gl_damage_add_rect(&d, 10, 10, 5, 5);
+                    if (d.count != 1) { printf("contained rect kept\\n"); return 1; }
+                    int last_x = 100 + 10 * (RENDER_GL_MAX_DAMAGE_RECTS - 1);
+                    for (int x = 100; x <= last_x; x += 10) render_gl_damage_add_rect(&d, x, 60, 4, 4);
+                    if (d.count != 1 || !covers(&d, 0, 0, 50, 50) || !covers(&d, last_x, 60, 4, 4)) {
+                        printf("overflow\\n");
+                        return 1;
+                    }
+
+                    // Logical rects are clipped to the screen and mapped through the output rotation.
+                    render_view view;
+                    render_view_init_screen(&view, 400, 300, 90);
+                    render_gl_damage_reset(&d);
+                    render_gl_damage_add_view(&d, &view, -10, 0, 110, 300);
+                    render_gl_damage_add_view(&d, &view, 500, 0, 10, 10);
+                    if (d.count != 1 || d.rects[0].w != 300 || d.rects[0].h != 100) {
+                        printf("view rect %d %dx%d\\n", d.count, d.rects[0].w, d.rects[0].h);
+                        return 1;
+                    }
+                    if (!render_gl_damage_intersects_view(&d, &view, 50, 100, 10, 10) ||
+                        render_gl_damage_intersects_view(&d, &view, 200, 100, 10, 10)) {
+                        printf("intersects\\n");
+                        return 1;
+                    }
+                    printf("ok\\n");
+                    return 0;
+                }
+                """,
+                ["src/render_gl.c", "src/render_view.c"],
+                tuple(flags),
+            )
+        self.assertEqual(out, "ok")
+
+    def test_only_ui_changes_from_input_repaint_the_whole_screen(self) -> None:
+        app_src = APP_C.read_text(encoding="utf-8")
+
+        # app.c is loop wiring and needs DRM/EGL/mpv to build.
+        input_body = app_src.split("static bool app_handle_input_ready(")[1].split("\n}\n")[0]
+        self.assertIn("if (ui_handle_input(ui, opt, buf, n, use_mpv,", input_body)
+        self.assertEqual(input_body.count("rt->full_damage = true;"), 1)
+        self.assertNotIn("osd_changed ||", app_src)
+
+        with tempfile.TemporaryDirectory() as tmpdir:
+            tmp = pathlib.Path(tmpdir)
+            out = _run_probe(
+                tmp,
+                "ui_input_probe",
+                """
+                #include <stdio.h>
+                #include <string.h>
+                #include "ui.h"
+
+                static size_t g_sent;
+                void term_pane_send_input(term_pane *tp, const char *buf, size_t len) { (void)tp; (void)buf; g_sent += len; }
+                void term_pane_force_rebuild(term_pane *tp) { (void)tp; }
+
+                int main(void) {
+                    options_t opt = { .pane_count = 2, .layout_mode = 2 };
+                    ui_state ui;
+                    if (!ui_state_init(&ui, &opt, false)) { printf("init\\n"); return 1; }
+                    term_pane *terms[2] = { (term_pane *)&ui, (term_pane *)&opt };
+                    bool running = true;
+                    struct { const char *keys; bool changed; } steps[] = {
+                        { "ls -l\\r", false },  // typed into the focused pane
+                        { "\\033[A", false },   // arrows outside control mode too
+                        { "\\005", true },      // Ctrl+E enters control mode
+                        { "\\t", true },        // focus
+                        { "o", true },          // OSD
+                        { "z", true },          // fullscreen
+                        { "z", true },
+                        { "\\033[C", true },    // split resize
+                        { "f", false },         // pane rebuild damages its own rows
+                        { "\\005", true },      // and out of control mode
+                        { "q", false },
+                    };
+                    for (size_t i = 0; i < sizeof(steps) / sizeof(steps[0]); ++i) {
+                        const char *k = steps[i].keys;
+                        bool changed = ui_handle_input(&ui, &opt, k, (ssize_t)strlen(k), false, terms, NULL, 2, NULL,
+                                                       &running, false);
+                        if (changed != steps[i].changed) { printf("step %zu changed=%d\\n", i, changed); return 1; }
+                    }
+                    // "ls -l\\r", the arrow, "q" and the Ctrl+E that left control mode.
+                    if (g_sent != 11) { printf("sent %zu bytes to the pane\\n", g_sent); return 1; }
+                    ui_state_destroy(&ui);
+                    printf("ok\\n");
+                    return 0;
+                }
+                """,
+                ["src/ui.c", "src/options.c", "tests/fakes/mpv.c"],
+            )
+        self.assertEqual(out, "ok")
+
+    def test_osd_damages_its_own_rect_instead_of_the_whole_screen(self) -> None:
+        frame_src = FRAME_C.read_text(encoding="utf-8")
+
+        full_damage = frame_src.split("bool full_damage =")[1].split(";")[0]
+        self.assertNotIn("frame_osd_active", full_damage)
+        self.assertIn("osd_layout(frame_osd, osd_rects[0].x, &screen_view, &osd_rects[0].w, &osd_rects[0].h);",
+                      frame_src)
+        self.assertIn("render_gl_damage_add_view(&damage, &screen_view, osd_rects[k].x, osd_rects[k].y,", frame_src)
+        self.assertIn("frame_rect_overlaps(&osd_rects[1], lay)", frame_src)
+        self.assertIn("osd_draw(frame_osd, osd_rects[0].x, osd_rects[0].y, view);", frame_src)
+
+        try:
+            flags = subprocess.run(["pkg-config", "--cflags", "--libs", "freetype2", "fontconfig"],
+                                   check=True, capture_output=True, text=True).stdout.split()
+        except (OSError, subprocess.CalledProcessError):
+            self.skipTest("freetype2/fontconfig development files not available")
+        with tempfile.TemporaryDirectory() as tmpdir:
+            tmp = pathlib.Path(tmpdir)
+            out = _run_probe(
+                tmp,
+                "osd_layout_probe",
+                """
+                #include <stdio.h>
+                #include "osd.h"
+                #include "term_pane.h"
+
+                int main(void) {
+                    int cw, ch;
+                    if (!term_measure_cell(20, &cw, &ch)) { printf("nofont\\n"); return 0; }
+                    render_view view;
+                    render_view_init_logical(&view, 400, 300);
+                    osd_ctx *osd = osd_create(20);
+                    int w = -1, h = -1;
+                    if (osd_layout(osd, 16, &view, &w, &h)) { printf("laid out without text\\n"); return 1; }
+
+                    osd_set_text(osd, "Playing 1/2 - First");
+                    int line_w = 0, line_h = 0;
+                    if (!osd_layout(osd, 16, &view, &line_w, &line_h) || line_w <= 0 || line_h <= 0) {
+                        printf("short line %dx%d\\n", line_w, line_h);
+                        return 1;
+                    }
+                    // The rect the frame damages is the one osd_draw fills: stable until the text changes.
+                    if (!osd_layout(osd, 16, &view, &w, &h) || w != line_w || h != line_h) {
+                        printf("unstable %dx%d\\n", w, h);
+                        return 1;
+                    }
+                    // Long text wraps inside the view instead of running off it.
+                    osd_set_text(osd, "Playing 12/34 - a title long enough to need wrapping on a four hundred pixel screen");
+                    if (!osd_layout(osd, 16, &view, &w, &h) || 16 + w > view.logical_w - 16 || h <= line_h) {
+                        printf("wrapped %dx%d\\n", w, h);
+                        return 1;
+                    }
+                    osd_destroy(osd);
+                    printf("ok\\n");
+                    return 0;
+                }
+                """,
+                TERM_PANE_SOURCES + ["src/osd.c"],
+                tuple(flags),
+            )
+        if out == "nofont":
+            self.skipTest("no monospace font available")
+        self.assertEqual(out, "ok")
+
+    def test_panes_compose_straight_to_back_buffer_with_rotation_in_quads(self) -> None:
+        frame_src = FRAME_C.read_text(encoding="utf-8")
+        render_gl_src = RENDER_GL_C.read_text(encoding="utf-8")
+        term_src = (ROOT / "src" / "term_pane.c").read_text(encoding="utf-8")
+        osd_src = (ROOT / "src" / "osd.c").read_text(encoding="utf-8")
+        makefile = (ROOT / "Makefile").read_text(encoding="utf-8")
+
+        # Which framebuffer the passes draw into is frame.c wiring around a live EGL surface.
+        self.assertIn("src/render_view.c", makefile)
+        self.assertIn("render_view_init_screen(&screen_view, logical_w, logical_h, opt->rotation);", frame_src)
+        self.assertIn("bool compose_to_rt = snapshot_frame || !e->has_buffer_age;", frame_src)
+        self.assertIn("glBindFramebuffer(GL_FRAMEBUFFER, compose_to_rt ? rg->rt_fbo : 0);", frame_src)
+        self.assertIn("term_pane_render(tp, view);", frame_src)
+        self.assertIn("render_gl_draw_tex_to_view(rg, render_gl_pane_video_tex(rg, i)", frame_src)
+        self.assertLess(frame_src.find("if (snapshot_frame) {"), frame_src.find("render_gl_blit_rt_to_screen(rg, opt->rotation);"))
+        self.assertIn("render_view_quad(view, (float)x, (float)y, (float)w, (float)h, 0.f, 0.f, 1.f, 1.f, verts);",
+                      render_gl_src)
+        self.assertIn("void term_pane_render(term_pane *tp, const render_view *view) {", term_src)
+        self.assertIn("void osd_draw(osd_ctx* o, int x, int y, const render_view *view){", osd_src)
+
+        with tempfile.TemporaryDirectory() as tmpdir:
+            tmp = pathlib.Path(tmpdir)
+            out = _run_probe(
+                tmp,
+                "view_probe",
+                """
+                #include <math.h>
+                #include <stdbool.h>
+                #include <stdio.h>
+                #include "render_view.h"
+
+                // render_gl_blit_rt_to_screen's quads: screen corner (LB, RB, RT, LT) -> render target uv.
+                static const float blit_uv[4][4][2] = {
+                    { {0, 1}, {1, 1}, {1, 0}, {0, 0} },
+                    { {1, 1}, {1, 0}, {0, 0}, {0, 1} },
+                    { {1, 0}, {0, 0}, {0, 1}, {1, 1} },
+                    { {0, 0}, {0, 1}, {1, 1}, {1, 0} },
+                };
+                static const float corner_ndc[4][2] = { {-1, -1}, {1, -1}, {1, 1}, {-1, 1} };
+
+                static bool near(float a, float b) { return fabsf(a - b) < 1e-4f; }
+
+                int main(void) {
+                    const int W = 400, H = 300;
+                    render_view logical;
+                    render_view_init_logical(&logical, W, H);
+                    for (int r = 0; r < 4; ++r) {
+                        int deg = r * 90;
+                        render_view screen;
+                        render_view_init_screen(&screen, W, H, deg);
+                        bool swap = deg == 90 || deg == 270;
+                        if (screen.target_w != (swap ? H : W) || screen.target_h != (swap ? W : H)) {
+                            printf("%d target %dx%d\\n", deg, screen.target_w, screen.target_h);
+                            return 1;
+                        }
+                        for (int c = 0; c < 4; ++c) {
+                            // Where the logical pass puts the texel the blit shows at this screen corner.
+                            float u = blit_uv[r][c][0], v = blit_uv[r][c][1];
+                            float x = u * (float)W, y = (1.f - v) * (float)H;
+                            float lq[24], sq[24];
+                            render_view_quad(&logical, x, y, 0.f, 0.f, 0.f, 0.f, 1.f, 1.f, lq);
+                            render_view_quad(&screen, x, y, 0.f, 0.f, 0.f, 0.f, 1.f, 1.f, sq);
+                            if (!near(lq[0], 2.f * u - 1.f) || !near(lq[1], 2.f * v - 1.f)) {
+                                printf("logical %d corner %d\\n", deg, c);
+                                return 1;
+                            }
+                            if (!near(sq[0], corner_ndc[c][0]) || !near(sq[1], corner_ndc[c][1])) {
+                                printf("%d corner %d -> %f,%f\\n", deg, c, sq[0], sq[1]);
+                                return 1;
+                            }
+                        }
+                        // Texture row v0 sits on the logical bottom edge whatever the rotation.
+                        float q[24], bl[24];
+                        render_view_quad(&screen, 40.f, 30.f, 100.f, 50.f, 0.f, 0.f, 1.f, 1.f, q);
+                        render_view_quad(&screen, 40.f, 80.f, 0.f, 0.f, 0.f, 0.f, 1.f, 1.f, bl);
+                        if (!near(q[0], bl[0]) || !near(q[1], bl[1]) || q[2] != 0.f || q[3] != 0.f) {
+                            printf("%d v0 edge\\n", deg);
+                            return 1;
+                        }
+                        int sx, sy, sw, sh;
+                        render_view_rect(&screen, 0, 0, W, H, &sx, &sy, &sw, &sh);
+                        if (sx != 0 || sy != 0 || sw != screen.target_w || sh != screen.target_h) {
+                            printf("%d full rect\\n", deg);
+                            return 1;
+                        }
+                        render_view_rect(&screen, 0, 0, 100, 50, &sx, &sy, &sw, &sh);
+                        if (sw != (swap ? 50 : 100) || sh != (swap ? 100 : 50)) {
+                            printf("%d pane rect %dx%d\\n", deg, sw, sh);
+                            return 1;
+                        }
+                    }
+                    printf("ok\\n");
+                    return 0;
+                }
+                """,
+                ["src/render_view.c"],
+            )
+        self.assertEqual(out, "ok")
+
+    def test_loop_stages_feed_fixed_histograms_and_periodic_stats_file(self) -> None:
+        app_src = APP_C.read_text(encoding="utf-8")
+        frame_src = FRAME_C.read_text(encoding="utf-8")
+        options_src = (ROOT / "src" / "options.c").read_text(encoding="utf-8")
+
+        # Where each stage is timed is loop wiring in app.c/frame.c.
+        self.assertIn("stats_record(&rt.stats, STATS_STAGE_POLL_WAIT, stage_start_ns);", app_src)
+        self.assertIn("stats_record_pane(&rt->stats, i, STATS_PANE_TERM_POLL, poll_start_ns);", app_src)
+        self.assertIn("stats_maybe_write(&rt.stats, rt.presented_frames, rt.idle_frames, rt.partial_frames);", app_src)
+        self.assertIn("stats_record_pane(&rt->stats, i, STATS_PANE_MPV_RENDER, mpv_start_ns);", frame_src)
+        self.assertIn("stats_record(&rt->stats, STATS_STAGE_PAGE_FLIP, flip_start_ns);", frame_src)
+        self.assertIn('"--stats-file"', options_src)
+
+        with tempfile.TemporaryDirectory() as tmpdir:
+            tmp = pathlib.Path(tmpdir)
+            stats_path = tmp / "stats.json"
+            out = _run_probe(
+                tmp,
+                "stats_probe",
+                """
+                #define _POSIX_C_SOURCE 200809L
+                #include <stdio.h>
+                #include <string.h>
+                #include <time.h>
+                #include "glyph_cache.h"
+                #include "stats.h"
+
+                void glyph_cache_get_stats(glyph_cache_stats *out) { memset(out, 0, sizeof(*out)); }
+
+                int main(int argc, char **argv) {
+                    (void)argc;
+                    // Percentiles come from bucket upper bounds: never below the exact value, at most ~12.5% above.
+                    static stats_hist h;
+                    if (stats_hist_percentile_us(&h, 50.0) != 0) { printf("empty\\n"); return 1; }
+                    for (uint64_t us = 1; us <= 10000; ++us) stats_hist_add(&h, us);
+                    const double pcts[] = { 1.0, 50.0, 95.0, 99.0, 99.9 };
+                    for (int i = 0; i < 5; ++i) {
+                        uint64_t exact = (uint64_t)(10000 * pcts[i] / 100.0 + 0.999999);
+                        uint64_t p = stats_hist_percentile_us(&h, pcts[i]);
+                        if (p < exact || p > exact + exact / 8 + 1) {
+                            printf("p%.1f = %llu, exact %llu\\n", pcts[i], (unsigned long long)p, (unsigned long long)exact);
+                            return 1;
+                        }
+                    }
+                    if (stats_hist_percentile_us(&h, 100.0) != 10000 || h.max_us != 10000 || h.count != 10000) {
+                        printf("max\\n");
+                        return 1;
+                    }
+                    // Samples past the last bucket still report their exact maximum.
+                    stats_hist_add(&h, 60ull * 1000 * 1000);
+                    if (stats_hist_percentile_us(&h, 100.0) != 60ull * 1000 * 1000) { printf("overflow\\n"); return 1; }
+
+                    stats_ctx s;
+                    if (!stats_init(&s, 2, argv[1], 20)) { printf("init\\n"); return 1; }
+                    stats_record(&s, STATS_STAGE_POLL_WAIT, stats_now_ns() - 1500000ull);
+                    stats_record_pane(&s, 1, STATS_PANE_TERM_POLL, stats_now_ns() - 250000ull);
+                    stats_add_term_rows(&s, 1, 7, 3, 4096);
+                    if (stats_maybe_write(&s, 5, 4, 1)) { printf("wrote before interval\\n"); return 1; }
+                    struct timespec ts = { 0, 30 * 1000 * 1000 };
+                    nanosleep(&ts, NULL);
+                    if (!stats_write_due(&s) || !stats_maybe_write(&s, 5, 4, 1)) { printf("not written\\n"); return 1; }
+                    // Each file covers one window.
+                    if (s.stages[STATS_STAGE_POLL_WAIT].count || s.pane_stages[STATS_PANE_STAGE_COUNT].count ||
+                        s.pane_term_rows[1].rendered || s.term_rows_total.rendered != 7) {
+                        printf("window not reset\\n");
+                        return 1;
+                    }
+                    if (stats_write_due(&s)) { printf("due again\\n"); return 1; }
+                    stats_destroy(&s);
+                    printf("ok\\n");
+                    return 0;
+                }
+                """,
+                ["src/stats.c"],
+                args=(str(stats_path),),
+            )
+            self.assertEqual(out, "ok")
+            report = json.loads(stats_path.read_text(encoding="utf-8"))
+            self.assertEqual([p.name for p in tmp.iterdir() if ".tmp." in p.name], [])
+
+        self.assertEqual(report["frames_total"], {"presented": 5, "idle": 4, "partial": 1})
+        poll_wait = report["stages"]["poll_wait"]
+        self.assertEqual(poll_wait["count"], 1)
+        self.assertGreaterEqual(poll_wait["max_us"], 1500)
+        self.assertLessEqual(poll_wait["p50_us"], poll_wait["max_us"])
+        self.assertEqual(report["stages"]["page_flip"]["count"], 0)
+        self.assertEqual(len(report["panes"]), 2)
+        self.assertEqual(report["panes"][1]["term_rows"], {"rendered": 7, "skipped": 3, "upload_bytes": 4096})
+        self.assertEqual(report["panes"][1]["term_poll"]["count"], 1)
+        self.assertEqual(report["panes"][0]["term_poll"]["count"], 0)
+
+    def test_headless_mode_renders_into_pbuffer_with_timed_present(self) -> None:
+        app_src = APP_C.read_text(encoding="utf-8")
+        display_src = DISPLAY_C.read_text(encoding="utf-8")
+        options_src = (ROOT / "src" / "options.c").read_text(encoding="utf-8")
+
+        self.assertIn("display_headless_init(&d, &e, opt.headless_w, opt.headless_h, opt.headless_hz, *debug);", app_src)
+        self.assertIn("if (!d->headless) app_restore_linux_console();", app_src)
+        self.assertIn("get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL)", display_src)
+        self.assertIn("e->surf = eglCreatePbufferSurface(e->dpy, e->cfg, pbuf_attribs);", display_src)
+        self.assertIn("clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL)", display_src)
+        self.assertIn("""    if (d->headless) {
+        display_headless_present(d);
+        return;
+    }""", display_src)
+        self.assertIn('"--headless"', options_src)
+
+    def test_bench_mode_runs_synthetic_panes_and_reports_percentiles(self) -> None:
+        app_src = APP_C.read_text(encoding="utf-8")
+        bench_src = (ROOT / "src" / "bench.c").read_text(encoding="utf-8")
+        options_src = (ROOT / "src" / "options.c").read_text(encoding="utf-8")
+        makefile = (ROOT / "Makefile").read_text(encoding="utf-8")
+
+        self.assertIn("src/bench.c", makefile)
+        self.assertIn('if (argc == 3 && !strcmp(argv[1], "--bench-emit")) return bench_emit(argv[2], stop_flag);', app_src)
+        self.assertIn("if (bench_tick(&bench, &opt, pane_media, &rt)) {", app_src)
+        self.assertIn("bench_record_frame(&bench, frame_start_ns);", app_src)
+        self.assertIn('"av://lavfi:testsrc2=size=%dx%d:rate=%d"', bench_src)
+        self.assertIn('"frame-drop-count"', bench_src)
+        self.assertIn("getrusage(RUSAGE_SELF, &usage);", bench_src)
+        self.assertIn('\\"peak_rss_kb\\": %ld', bench_src)
+        self.assertIn("bool options_reset_panes(options_t *opt, int pane_count) {", options_src)
+
+    def test_event_loop_uses_epoll_timerfd_eventfd_and_pidfd(self) -> None:
+        app_src = APP_C.read_text(encoding="utf-8")
+        runtime_src = RUNTIME_C.read_text(encoding="utf-8")
+        media_src = (ROOT / "src" / "media.c").read_text(encoding="utf-8")
+        term_src = (ROOT / "src" / "term_pane.c").read_text(encoding="utf-8")
+
+        self.assertNotIn("poll(rt->pfds", app_src)
+        self.assertIn("rt->epoll_fd = epoll_create1(EPOLL_CLOEXEC);", runtime_src)
+        self.assertIn("timerfd_settime(rt->timer_fd, TFD_TIMER_ABSTIME, &its, NULL);", runtime_src)
+        self.assertIn("syscall(SYS_pidfd_open, pid, 0)", runtime_src)
+        self.assertIn("m->wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);", media_src)
+        poll_body = term_src.split("bool term_pane_poll(term_pane *tp) {")[1].split("bool term_pane_reap_child(")[0]
+        self.assertNotIn("waitpid(", poll_body)
+        reap = app_src.split("if (runtime_pane_child_exited(rt, opt, tp, i)) {")[1].split("}")[0]
+        # The PTY leaves the epoll set before the respawn closes it and frees its number.
+        self.assertLess(reap.find("runtime_forget_pane_fd(rt, i);"), reap.find("term_pane_reap_child(tp)"))
+        # Snapshot files are watched with inotify; idle there is no timed stat() wakeup.
+        self.assertIn("inotify_add_watch(watch->inotify_fd, APP_SNAPSHOT_DIR,", app_src)
+        self.assertIn("runtime_watch_snapshot_fd(&rt, snap_watch.inotify_fd);", app_src)
+        poll = app_src.split("static void app_snapshot_watch_poll(")[1].split("\n}\n")[0]
+        self.assertIn("watch->next_check_sec = INFINITY;", poll)
+        self.assertIn("watch->next_check_sec = now_sec + APP_SNAPSHOT_IDLE_CHECK_MS / 1000.0;", poll)
+        deadline = app_src.split("static uint64_t app_wait_deadline_ns(")[1].split("\n}\n")[0]
+        self.assertIn("isinf(deadline) ? RUNTIME_NO_DEADLINE", deadline)
+
+    def test_steady_state_loop_reuses_scratch_and_counts_allocations(self) -> None:
+        app_src = APP_C.read_text(encoding="utf-8")
+        layout_src = (ROOT / "src" / "layout.c").read_text(encoding="utf-8")
+        osd_src = (ROOT / "src" / "osd.c").read_text(encoding="utf-8")
+        term_src = (ROOT / "src" / "term_pane.c").read_text(encoding="utf-8")
+        stats_src = (ROOT / "src" / "stats.c").read_text(encoding="utf-8")
+        makefile = (ROOT / "Makefile").read_text(encoding="utf-8")
+
+        self.assertNotIn("calloc((size_t)scene.pane_count, sizeof(*pane_ready))", app_src)
+        self.assertNotIn("mosaic_layout active_layout", app_src)
+        self.assertIn("ui->fullscreen, ui->fs_pane, &scene->layout);", app_src)
+        self.assertIn("stats_record_allocs(&rt.stats, &loop_alloc_mark);", app_src)
+        compute_body = layout_src.split("void compute_mosaic_layout(")[1]
+        self.assertNotIn("calloc(", compute_body)
+        self.assertIn("if (o->has_text && !strcmp(o->text, text)) return;", osd_src)
+        self.assertIn("VTermScreenCell *grown = realloc(tp->row_cells", term_src)
+        self.assertIn("return __libc_malloc(size);", stats_src)
+        self.assertIn("CFLAGS += -DKMS_MOSAIC_ALLOC_STATS", makefile)
+
+    def test_osd_line_follows_mpv_property_changes(self) -> None:
+        frame_src = (ROOT / "src" / "frame.c").read_text(encoding="utf-8")
+        osd_body = frame_src.split("bool frame_update_osd_text(")[1].split("\n}\n")[0]
+        self.assertNotIn("mpv_get_property", osd_body)
+        self.assertIn("memcpy(line, osd_media->osd_line, sizeof(line));", osd_body)
+
+        try:
+            flags = subprocess.run(["pkg-config", "--cflags", "--libs", "egl"],
+                                   check=True, capture_output=True, text=True).stdout.split()
+        except (OSError, subprocess.CalledProcessError):
+            self.skipTest("EGL development files not available")
+        with tempfile.TemporaryDirectory() as tmpdir:
+            tmp = pathlib.Path(tmpdir)
+            out = _run_probe(
+                tmp,
+                "osd_probe",
+                """
+                #include <stdio.h>
+                #include <string.h>
+                #include "media.h"
+
+                static bool expect(media_ctx *m, const char *line) {
+                    int pending = 0;
+                    media_handle_wakeup(m, false, &pending);
+                    if (strcmp(m->osd_line, line)) {
+                        printf("osd '%s', want '%s'\\n", m->osd_line, line);
+                        return false;
+                    }
+                    return true;
+                }
+
+                int main(void) {
+                    options_t opt = {0};
+                    pane_media_config pane = { .enabled = true, .dual_deck = true };
+                    push_pane_video(&pane, "a.mkv");
+                    push_pane_video(&pane, "b.mkv");
+                    media_ctx m;
+                    if (!media_init_pane(&m, &opt, &pane, false)) { printf("init\\n"); return 1; }
+                    mpv_handle *active = m.mpv, *standby = m.standby_mpv;
+                    if (!expect(&m, "Playing 1/0 - (no title)")) return 1;
+
+                    // Playback changes reach the line without reading properties back.
+                    int reads = fake_mpv_property_reads();
+                    fake_mpv_change(active, "playlist-count", "2");
+                    fake_mpv_change(active, "media-title", "First");
+                    if (!expect(&m, "Playing 1/2 - First")) return 1;
+                    fake_mpv_change(active, "pause", "yes");
+                    if (!expect(&m, "Paused 1/2 - First")) return 1;
+                    fake_mpv_change(active, "pause", "no");
+                    fake_mpv_change(active, "media-title", NULL);
+                    if (!expect(&m, "Playing 1/2 - (no title)")) return 1;
+                    fake_mpv_change(active, "media-title", "First");
+                    if (!expect(&m, "Playing 1/2 - First")) return 1;
+                    if (fake_mpv_property_reads() != reads) { printf("properties read back\\n"); return 1; }
+
+                    // The standby deck's entry is tracked but not shown until it takes over.
+                    fake_mpv_change(standby, "playlist-pos", "1");
+                    fake_mpv_change(standby, "playlist-count", "2");
+                    fake_mpv_change(standby, "media-title", "Second");
+                    if (!expect(&m, "Playing 1/2 - First")) return 1;
+                    fake_mpv_event(standby, MPV_EVENT_START_FILE);
+                    fake_mpv_event(standby, MPV_EVENT_PLAYBACK_RESTART);
+                    fake_mpv_change(active, "eof-reached", "yes");
+                    if (!expect(&m, "Paused 2/2 - Second")) return 1;
+                    if (m.mpv != standby) { printf("decks not switched\\n"); return 1; }
+                    // Unpausing the incoming deck arrives as its own event.
+                    if (!expect(&m, "Playing 2/2 - Second")) return 1;
+                    fake_mpv_change(active, "media-title", "Third");
+                    if (!expect(&m, "Playing 2/2 - Second")) return 1;
+                    printf("ok\\n");
+                    return 0;
+                }
+                """,
+                ["src/media.c", "src/options.c", "tests/fakes/mpv.c", "tests/fakes/gl.c"],
+                tuple(flags),
+            )
+        self.assertEqual(out, "ok")
+
+    def test_span_kernels_match_exact_blend_and_feed_row_compositing(self) -> None:
+        term_src = (ROOT / "src" / "term_pane.c").read_text(encoding="utf-8")
+        makefile = (ROOT / "Makefile").read_text(encoding="utf-8")
+
+        self.assertIn("src/span.c", makefile)
+        self.assertIn("static void composite_row(term_pane *tp, int cy, const VTermScreenCell *cells, int cols)", term_src)
+        self.assertIn("span_blend_coverage(", term_src)
+        self.assertIn("span_fill32(", term_src)
+
+        with tempfile.TemporaryDirectory() as tmpdir:
+            tmp = pathlib.Path(tmpdir)
+            probe = tmp / "span_probe.c"
+            probe.write_text(
+                textwrap.dedent(
+                    """
+                    #include <stdio.h>
+                    #include "span.h"
+
+                    static unsigned rng = 12345;
+                    static unsigned next(void) { rng ^= rng << 13; rng ^= rng >> 17; rng ^= rng << 5; return rng; }
+
+                    int main(void) {
+                        const char *names[] = { "scalar", "sse2", "avx2", "neon" };
+                        for (int k = 0; k < 4; ++k) {
+                            if (!span_select(names[k])) continue;
+                            for (int iter = 0; iter < 2000; ++iter) {
+                                int n = (int)(next() % 70);
+                                uint8_t ref[80 * 4], out[80 * 4], cov[80];
+                                uint8_t fg[4] = { (uint8_t)next(), (uint8_t)next(), (uint8_t)next(), (uint8_t)next() };
+                                for (int i = 0; i < n * 4; ++i) ref[i] = out[i] = (uint8_t)next();
+                                for (int i = 0; i < n; ++i) {
+                                    unsigned r = next() % 4;
+                                    cov[i] = r == 0 ? 0 : r == 1 ? 255 : (uint8_t)next();
+                                    if (!cov[i]) continue;
+                                    for (int c = 0; c < 3; ++c)
+                                        ref[i * 4 + c] = (uint8_t)((fg[c] * cov[i] + ref[i * 4 + c] * (255 - cov[i])) / 255);
+                                    ref[i * 4 + 3] = fg[3];
+                                }
+                                span_blend_coverage(out, cov, n, span_pack_rgba(fg[0], fg[1], fg[2], fg[3]));
+                                for (int i = 0; i < n * 4; ++i)
+                                    if (out[i] != ref[i]) { printf("%s blend n=%d i=%d\\n", names[k], n, i); return 1; }
+                                uint32_t fill[81], px = span_pack_rgba(fg[0], fg[1], fg[2], fg[3]);
+                                fill[n] = 0;
+                                span_fill32(fill, px, n);
+                                for (int i = 0; i < n; ++i)
+                                    if (fill[i] != px) { printf("%s fill n=%d\\n", names[k], n); return 1; }
+                                if (fill[n] != 0) { printf("%s fill overrun n=%d\\n", names[k], n); return 1; }
+                            }
+                            printf("%s\\n", names[k]);
+                        }
+                        return 0;
+                    }
+                    """
+                ),
+                encoding="utf-8",
+            )
+            binary = tmp / "span_probe"
+            subprocess.run(
+                ["cc", "-std=c11", "-O2", "-Wall", "-Wextra", f"-I{ROOT / 'src'}",
+                 str(ROOT / "src" / "span.c"), str(probe), "-o", str(binary)],
+                check=True,
+                capture_output=True,
+                text=True,
+            )
+            result = subprocess.run([str(binary)], check=True, capture_output=True, text=True)
+        self.assertIn("scalar", result.stdout.split())
+
+    def test_glyph_cache_is_shared_with_ascii_fast_path_and_constant_time_eviction(self) -> None:
+        term_src = (ROOT / "src" / "term_pane.c").read_text(encoding="utf-8")
+        osd_src = (ROOT / "src" / "osd.c").read_text(encoding="utf-8")
+        cache_src = (ROOT / "src" / "glyph_cache.c").read_text(encoding="utf-8")
+        makefile = (ROOT / "Makefile").read_text(encoding="utf-8")
+
+        self.assertIn("src/glyph_cache.c", makefile)
+        self.assertNotIn("find_lru_slot", term_src)
+        self.assertNotIn("FT_Load_Char", term_src)
+        self.assertNotIn("FT_Load_Char", osd_src)
+        self.assertIn("f->face = glyph_font_acquire(px_size);", term_src)
+        self.assertIn("f->face = glyph_font_acquire(px_size);", osd_src)
+        self.assertIn("_Atomic(const glyph_bitmap *) pinned[GLYPH_PIN_COUNT];", cache_src)
+        self.assertIn("glyph_entry_remove(g_glyphs.lru_tail);", cache_src)
+
+        try:
+            flags = subprocess.run(["pkg-config", "--cflags", "--libs", "freetype2", "fontconfig"],
+                                   check=True, capture_output=True, text=True).stdout.split()
+        except (OSError, subprocess.CalledProcessError):
+            self.skipTest("freetype2/fontconfig development files not available")
+        with tempfile.TemporaryDirectory() as tmpdir:
+            tmp = pathlib.Path(tmpdir)
+            probe = tmp / "glyph_probe.c"
+            probe.write_text(
+                textwrap.dedent(
+                    """
+                    #include <stdio.h>
+                    #include "glyph_cache.h"
+
+                    int main(void) {
+                        glyph_font *a = glyph_font_acquire(16), *b = glyph_font_acquire(16);
+                        if (!a) { printf("nofont\\n"); return 0; }
+                        if (a != b) { printf("not shared\\n"); return 1; }
+                        glyph_scratch scratch = {0};
+                        const glyph_bitmap *m1 = glyph_cache_get(a, 'M', &scratch);
+                        const glyph_bitmap *m2 = glyph_cache_get(b, 'M', &scratch);
+                        if (!m1 || m1 != m2) { printf("ascii not pinned\\n"); return 1; }
+                        for (int round = 0; round < 2; ++round) {
+                            for (uint32_t cp = 0x100; cp < 0x100 + GLYPH_CACHE_CAP + 500; ++cp) {
+                                const glyph_bitmap *g = glyph_cache_get(a, cp, &scratch);
+                                if (g && g->codepoint != cp) { printf("wrong glyph %u\\n", cp); return 1; }
+                            }
+                        }
+                        glyph_cache_stats st;
+                        glyph_cache_get_stats(&st);
+                        if (st.entries != GLYPH_CACHE_CAP || !st.evictions || st.hits < 1) {
+                            printf("stats %llu %llu %llu %d\\n", st.hits, st.misses, st.evictions, st.entries);
+                            return 1;
+                        }
+                        glyph_font_release(a);
+                        glyph_font_release(b);
+                        glyph_cache_get_stats(&st);
+                        if (st.entries != 0) { printf("entries left %d\\n", st.entries); return 1; }
+                        glyph_scratch_free(&scratch);
+                        printf("ok\\n");
+                        return 0;
+                    }
+                    """
+                ),
+                encoding="utf-8",
+            )
+            binary = tmp / "glyph_probe"
+            subprocess.run(
+                ["cc", "-std=c11", "-O2", "-Wall", "-Wextra", f"-I{ROOT / 'src'}",
+                 str(ROOT / "src" / "glyph_cache.c"), str(ROOT / "src" / "glyph_synth.c"),
+                 str(ROOT / "src" / "font_util.c"), str(probe), "-o", str(binary), "-pthread", *flags, "-lm"],
+                check=True,
+                capture_output=True,
+                text=True,
+            )
+            result = subprocess.run([str(binary)], check=True, capture_output=True, text=True)
+        self.assertIn(result.stdout.strip(), ("ok", "nofont"))
+
+    def test_cell_colors_resolve_to_truecolor_through_constant_palette(self) -> None:
+        term_src = (ROOT / "src" / "term_pane.c").read_text(encoding="utf-8")
+        color_src = (ROOT / "src" / "color.h").read_text(encoding="utf-8")
+
+        self.assertNotIn("sattr_to_rgb_idx", term_src)
+        self.assertIn("if (c.type == VTERM_COLOR_RGB) return (rgb8){ c.rgb.red, c.rgb.green, c.rgb.blue };", term_src)
+        self.assertIn("if (c.type == VTERM_COLOR_INDEXED) return color_palette[c.indexed.idx];", term_src)
+        self.assertIn("static const rgb8 color_palette[256] = {", color_src)
+
+    def test_scrolls_move_rendered_rows_instead_of_rerendering(self) -> None:
+        term_src = (ROOT / "src" / "term_pane.c").read_text(encoding="utf-8")
+        makefile = (ROOT / "Makefile").read_text(encoding="utf-8")
+
+        # term_pane.c needs libvterm; its hand-off to the ring helpers is checked by source.
+        self.assertIn("src/term_rows.c", makefile)
+        moverect_body = term_src.split("static int pane_moverect_cb(")[1].split("static int pane_resize_cb(")[0]
+        self.assertIn("if (pane_scroll_surface(tp, dest, src)) return 1;", moverect_body)
+        scroll_body = term_src.split("static bool pane_scroll_surface(")[2].split("\n}\n")[0]
+        self.assertIn("term_rows_move_bits(tp->pending_rows, src.start_row, src.end_row, delta);", scroll_body)
+        self.assertIn("tp->ring_row = term_rows_scroll_ring(tp->ring_row, delta, rows);", scroll_body)
+        self.assertIn("mark_surface_dirty_rows(tp, dest.start_row, dest.end_row);", scroll_body)
+        self.assertIn("float gy = (mod(cell.y + u_ring_row, u_grid_size.y) + 0.5) / u_grid_size.y;", term_src)
+        self.assertIn("int y0 = pane_ring_row(tp, cy) * font->cell_h;", term_src)
+        update_body = term_src.split("static void update_damaged_rows(term_pane *tp) {")[1].split("static void term_pane_flush_damage(")[0]
+        self.assertNotIn("tp->surface.dirty_count = 0;", update_body)
+
+        with tempfile.TemporaryDirectory() as tmpdir:
+            tmp = pathlib.Path(tmpdir)
+            out = _run_probe(
+                tmp,
+                "ring_probe",
+                """
+                #include <stdio.h>
+                #include <string.h>
+                #include "term_rows.h"
+
+                static unsigned rng = 2024;
+                static unsigned next(void) { rng ^= rng << 13; rng ^= rng >> 17; rng ^= rng << 5; return rng; }
+
+                int main(void) {
+                    const int sizes[] = { 1, 2, 3, 24, 25, 64, 65 };
+                    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+                        int rows = sizes[s];
+                        // surface[] holds what each surface row shows; content[] what each terminal row should.
+                        int surface[80], content[80];
+                        for (int r = 0; r < rows; ++r) surface[r] = content[r] = r;
+                        int ring = 0, stamp = rows;
+                        for (int iter = 0; iter < 5000; ++iter) {
+                            // Mostly scrolls up (negative), the way output streams, with some reverse scrolls.
+                            int span = rows > 1 ? (int)(next() % (unsigned)(rows - 1)) + 1 : 1;
+                            int delta = next() % 4 ? -span : span;
+                            int old = ring;
+                            ring = term_rows_scroll_ring(ring, delta, rows);
+                            if (ring < 0 || ring >= rows) { printf("rows %d ring %d\\n", rows, ring); return 1; }
+                            int moved[80];
+                            for (int r = 0; r < rows; ++r) {
+                                int from = r - delta;
+                                if (from >= 0 && from < rows) {
+                                    moved[r] = content[from];
+                                    if (term_rows_ring_row(ring, r, rows) != term_rows_ring_row(old, from, rows)) {
+                                        printf("rows %d delta %d row %d moved\\n", rows, delta, r);
+                                        return 1;
+                                    }
+                                } else {
+                                    // Rows scrolled in are re-rendered in whatever slot the ring gives them.
+                                    moved[r] = stamp++;
+                                    surface[term_rows_ring_row(ring, r, rows)] = moved[r];
+                                }
+                            }
+                            memcpy(content, moved, sizeof(moved));
+                            for (int r = 0; r < rows; ++r) {
+                                if (surface[term_rows_ring_row(ring, r, rows)] != content[r]) {
+                                    printf("rows %d iter %d row %d\\n", rows, iter, r);
+                                    return 1;
+                                }
+                            }
+                        }
+                    }
+                    if (term_rows_scroll_ring(0, -1, 0) != 0 || term_rows_ring_row(3, 5, 0) != 5) {
+                        printf("empty\\n");
+                        return 1;
+                    }
+
+                    // Pending damage follows moved rows without being carried twice.
+                    for (int delta = -3; delta <= 3; delta += 6) {
+                        uint64_t bits[2] = { 0, 0 };
+                        term_rows_set(bits, 70);
+                        term_rows_set(bits, 66);
+                        int start = delta < 0 ? 63 : 60, end = delta < 0 ? 80 : 77;
+                        term_rows_move_bits(bits, start, end, delta);
+                        for (int r = 0; r < 128; ++r) {
+                            bool want = r == 70 || r == 66 || r == 70 + delta || r == 66 + delta;
+                            if (term_rows_test(bits, r) != want) { printf("delta %d bit %d\\n", delta, r); return 1; }
+                        }
+                    }
+                    if (term_rows_words(64) != 1 || term_rows_words(65) != 2) { printf("words\\n"); return 1; }
+                    printf("ok\\n");
+                    return 0;
+                }
+                """,
+                ["src/term_rows.c"],
+            )
+        self.assertEqual(out, "ok")
+
+    def test_damage_is_tracked_per_row_and_unchanged_rows_are_skipped(self) -> None:
+        term_src = (ROOT / "src" / "term_pane.c").read_text(encoding="utf-8")
+        stats_src = (ROOT / "src" / "stats.c").read_text(encoding="utf-8")
+        frame_src = FRAME_C.read_text(encoding="utf-8")
+        bench_src = (ROOT / "src" / "bench.c").read_text(encoding="utf-8")
+
+        # term_pane.c needs libvterm; how it feeds rows and counters through is checked by source.
+        self.assertNotIn("TERM_PANE_MAX_DIRTY_RANGES", term_src)
+        self.assertIn("for (int y = start_row; y < end_row; y++) term_rows_set(tp->pending_rows, y);", term_src)
+        render_row = term_src.split("static void pane_render_row(")[1].split("\n}\n")[0]
+        self.assertIn("if (!term_rows_update_hash(tp->row_hash, surface_row, pane_row_hash(cells, tp->layout.cols), force)) {",
+                      render_row)
+        self.assertIn("tp->raster.rows_skipped++;", render_row)
+        self.assertIn("stats_add_term_rows(&rt->stats, i, rows.rows_rendered, rows.rows_skipped, rows.upload_bytes);", frame_src)
+        self.assertIn('\\"term_rows\\": {\\"rendered\\": %llu, \\"skipped\\": %llu, \\"upload_bytes\\": %llu}', stats_src)
+        self.assertIn("b->start_term_rows = rt->stats.term_rows_total;", bench_src)
+
+        with tempfile.TemporaryDirectory() as tmpdir:
+            tmp = pathlib.Path(tmpdir)
+            out = _run_probe(
+                tmp,
+                "row_hash_probe",
+                """
+                #include <stdio.h>
+                #include <string.h>
+                #include "term_rows.h"
+
+                static unsigned rng = 99;
+                static unsigned next(void) { rng ^= rng << 13; rng ^= rng >> 17; rng ^= rng << 5; return rng; }
+
+                int main(void) {
+                    // A row of cells as raw bytes (an odd size, to cover the byte-wise tail).
+                    unsigned char row[203], copy[203];
+                    for (size_t i = 0; i < sizeof(row); ++i) row[i] = (unsigned char)next();
+                    memcpy(copy, row, sizeof(row));
+                    uint64_t h = term_rows_hash(row, sizeof(row));
+                    if (h == 0 || term_rows_hash(copy, sizeof(copy)) != h) { printf("unstable\\n"); return 1; }
+                    // Any changed byte (glyph, attribute or color) must change the hash.
+                    for (size_t i = 0; i < sizeof(row); ++i) {
+                        for (int bit = 0; bit < 8; ++bit) {
+                            copy[i] ^= (unsigned char)(1u << bit);
+                            if (term_rows_hash(copy, sizeof(copy)) == h) { printf("byte %zu bit %d\\n", i, bit); return 1; }
+                            copy[i] ^= (unsigned char)(1u << bit);
+                        }
+                    }
+                    // Rows of different widths never share a hash just because one is a prefix.
+                    if (term_rows_hash(row, 200) == term_rows_hash(row, 201)) { printf("prefix\\n"); return 1; }
+                    if (term_rows_hash(row, 0) == 0) { printf("empty row\\n"); return 1; }
+
+                    // Unknown rows render, unchanged rows are skipped, changed or forced rows render.
+                    uint64_t row_hash[4] = { 0, 0, 0, 0 };
+                    uint64_t other = term_rows_hash(row, 100);
+                    if (!term_rows_update_hash(row_hash, 2, h, false) || row_hash[2] != h) { printf("first\\n"); return 1; }
+                    if (term_rows_update_hash(row_hash, 2, h, false)) { printf("unchanged redrawn\\n"); return 1; }
+                    if (!term_rows_update_hash(row_hash, 2, h, true)) { printf("force skipped\\n"); return 1; }
+                    if (!term_rows_update_hash(row_hash, 2, other, false) || row_hash[2] != other) {
+                        printf("changed skipped\\n");
+                        return 1;
+                    }
+                    if (row_hash[0] || row_hash[1] || row_hash[3]) { printf("other rows touched\\n"); return 1; }
+                    // The same cells in another surface row are still drawn there.
+                    if (!term_rows_update_hash(row_hash, 3, other, false)) { printf("row 3\\n"); return 1; }
+                    printf("ok\\n");
+                    return 0;
+                }
+                """,
+                ["src/term_rows.c"],
+            )
+        self.assertEqual(out, "ok")
+
+    def test_pty_reads_are_budgeted_round_robin_and_fast_forward_floods(self) -> None:
+        app_src = (ROOT / "src" / "app.c").read_text(encoding="utf-8")
+
+        # The round-robin over panes is app.c loop wiring, which needs DRM/EGL/mpv to build.
+        poll_body = app_src.split("static bool app_poll_panes(")[1].split("static bool app_media_needs_render(")[0]
+        self.assertIn("int i = (start + k) % opt->pane_count;", poll_body)
+        self.assertIn("rt->pane_poll_next = (start + 1) % opt->pane_count;", poll_body)
+        self.assertIn("term_pane_poll_budget(tp, APP_PANE_POLL_BYTES, deadline_ns);", poll_body)
+
+        try:
+            flags = subprocess.run(["pkg-config", "--cflags", "--libs", "freetype2", "fontconfig"],
+                                   check=True, capture_output=True, text=True).stdout.split()
+        except (OSError, subprocess.CalledProcessError):
+            self.skipTest("freetype2/fontconfig development files not available")
+        with tempfile.TemporaryDirectory() as tmpdir:
+            tmp = pathlib.Path(tmpdir)
+            out = _run_probe(
+                tmp,
+                "budget_probe",
+                """
+                #define _POSIX_C_SOURCE 200809L
+                #include <poll.h>
+                #include <stdio.h>
+                #include <sys/ioctl.h>
+                #include <time.h>
+                #include "term_pane.h"
+
+                #define FLOOD_BYTES 2000000
+                #define BUDGET 1024
+
+                static uint64_t now_ns(void) {
+                    struct timespec ts;
+                    clock_gettime(CLOCK_MONOTONIC, &ts);
+                    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+                }
+
+                static void wait_readable(int fd) {
+                    struct pollfd p = { .fd = fd, .events = POLLIN };
+                    poll(&p, 1, 100);
+                }
+
+                static int queued_bytes(int fd) {
+                    int queued = 0;
+                    return ioctl(fd, FIONREAD, &queued) == 0 ? queued : 0;
+                }
+
+                int main(void) {
+                    int cw, ch;
+                    if (!term_measure_cell(16, &cw, &ch)) { printf("nofont\\n"); return 0; }
+                    pane_layout lay = { .w = 640, .h = 360 };
+                    term_pane *tp = term_pane_create_cmd(&lay, 16,
+                        "yes 0123456789abcdefghijklmnopqrstuvwxyz | head -c 2000000; sleep 5");
+                    if (!tp) { printf("create\\n"); return 1; }
+                    int fd = term_pane_get_fd(tp);
+
+                    // Past its deadline a poll stops after the first read.
+                    size_t last = fake_vterm_bytes_fed();
+                    while (fake_vterm_bytes_fed() == last) {
+                        wait_readable(fd);
+                        term_pane_poll_budget(tp, SIZE_MAX, 1);
+                        if (fake_vterm_bytes_fed() - last > 4096) { printf("read past deadline\\n"); return 1; }
+                    }
+
+                    // Under a byte budget no poll feeds more than it. A poll that starts with more
+                    // than a budget queued stops mid-flood (only this loop reads the pty), so those
+                    // render at most once per TERM_PANE_FLOOD_RENDER_MS; the final state still renders.
+                    uint64_t start = now_ns();
+                    int flood_polls = 0, flood_renders = 0;
+                    bool stale = true;
+                    while (now_ns() - start < 30000000000ull) {
+                        wait_readable(fd);
+                        bool backlog = queued_bytes(fd) > BUDGET;
+                        last = fake_vterm_bytes_fed();
+                        bool changed = term_pane_poll_budget(tp, BUDGET, UINT64_MAX);
+                        size_t fed = fake_vterm_bytes_fed() - last;
+                        if (fed > BUDGET) { printf("fed %zu over budget\\n", fed); return 1; }
+                        if (fed) stale = true;
+                        if (changed) stale = false;
+                        flood_polls += backlog;
+                        flood_renders += backlog && changed;
+                        if (!fed && last >= FLOOD_BYTES) break;
+                    }
+                    uint64_t elapsed_ms = (now_ns() - start) / 1000000ull;
+                    if (fake_vterm_bytes_fed() < FLOOD_BYTES) { printf("flood not consumed\\n"); return 1; }
+                    if (stale) { printf("final state not rendered\\n"); return 1; }
+                    if (!flood_polls) { printf("pty never backed up\\n"); return 1; }
+                    if (flood_renders > (int)(elapsed_ms / TERM_PANE_FLOOD_RENDER_MS) + 1) {
+                        printf("%d flood renders in %llu ms\\n", flood_renders, (unsigned long long)elapsed_ms);
+                        return 1;
+                    }
+                    term_pane_destroy(tp);
+                    printf("ok\\n");
+                    return 0;
+                }
+                """,
+                TERM_PANE_SOURCES,
+                tuple(flags),
+            )
+        if out == "nofont":
+            self.skipTest("no monospace font available")
+        self.assertEqual(out, "ok")
+
+    def test_term_threads_hand_rows_to_the_render_thread_through_snapshots(self) -> None:
+        term_src = (ROOT / "src" / "term_pane.c").read_text(encoding="utf-8")
+        options_src = (ROOT / "src" / "options.c").read_text(encoding="utf-8")
+        panes_src = (ROOT / "src" / "panes.c").read_text(encoding="utf-8")
+        makefile = (ROOT / "Makefile").read_text(encoding="utf-8")
+
+        self.assertIn('else if (!strcmp(argv[i], "--term-threads")) opt->term_threads = true;', options_src)
+        self.assertIn('if (opt->term_threads) fprintf(f, "--term-threads\\n");', options_src)
+        self.assertIn("term_pane_set_threaded(opt->term_threads);", panes_src)
+        self.assertIn("CFLAGS += -pthread", makefile)
+        # Races are not reproducible in a test: every main-thread entry point that
+        # touches worker-owned state must stop the worker first.
+        for fn in ("void term_pane_resize(", "void term_pane_set_font_px(", "void term_pane_set_alpha(",
+                   "void term_pane_force_rebuild(", "void term_pane_respawn(", "bool term_pane_reap_child("):
+            body = term_src.split(fn)[1].split("\n}\n")[0]
+            self.assertIn("bool paused = pane_worker_pause(tp);", body, fn)
+            self.assertIn("pane_worker_resume(tp, paused);", body, fn)
+
+        try:
+            flags = subprocess.run(["pkg-config", "--cflags", "--libs", "freetype2", "fontconfig"],
+                                   check=True, capture_output=True, text=True).stdout.split()
+        except (OSError, subprocess.CalledProcessError):
+            self.skipTest("freetype2/fontconfig development files not available")
+        with tempfile.TemporaryDirectory() as tmpdir:
+            tmp = pathlib.Path(tmpdir)
+            out = _run_probe(
+                tmp,
+                "worker_probe",
+                """
+                #include <poll.h>
+                #include <stdio.h>
+                #include "term_pane.h"
+
+                size_t fake_gl_upload_texels(void);
+
+                static bool wait_readable(int fd, int timeout_ms) {
+                    struct pollfd p = { .fd = fd, .events = POLLIN };
+                    return poll(&p, 1, timeout_ms) == 1;
+                }
+
+                // Wait for the worker to publish, claim the snapshot and upload it.
+                static bool claim_and_render(term_pane *tp, const render_view *view) {
+                    if (!wait_readable(term_pane_get_fd(tp), 5000)) { printf("nothing published\\n"); return false; }
+                    if (!term_pane_poll(tp)) { printf("snapshot not claimed\\n"); return false; }
+                    size_t before = fake_gl_upload_texels();
+                    term_pane_render(tp, view);
+                    if (fake_gl_upload_texels() == before) { printf("claimed rows not uploaded\\n"); return false; }
+                    return true;
+                }
+
+                int main(void) {
+                    int cw, ch;
+                    if (!term_measure_cell(16, &cw, &ch)) { printf("nofont\\n"); return 0; }
+                    fake_vterm_set_main_thread();
+                    term_pane_set_threaded(true);
+                    pane_layout lay = { .w = 640, .h = 360 };
+                    term_pane *tp = term_pane_create_cmd(&lay, 16,
+                        "printf 'first\\\\n'; read line; printf 'second\\\\n'; sleep 5");
+                    if (!tp) { printf("create\\n"); return 1; }
+                    render_view view;
+                    render_view_init_logical(&view, 640, 360);
+                    for (int i = 0; i < 50 && fake_vterm_bytes_fed() < 6; ++i) {
+                        if (!claim_and_render(tp, &view)) return 1;
+                    }
+                    // Claim whatever the worker still had queued; the shell is now blocked on read.
+                    while (wait_readable(term_pane_get_fd(tp), 300)) {
+                        if (!claim_and_render(tp, &view)) return 1;
+                    }
+                    if (term_pane_poll(tp)) { printf("claimed without new output\\n"); return 1; }
+
+                    // Resizing stops and restarts the worker; output keeps flowing afterwards.
+                    pane_layout bigger = { .w = 800, .h = 480 };
+                    term_pane_resize(tp, &bigger);
+                    render_view_init_logical(&view, 800, 480);
+                    size_t fed = fake_vterm_bytes_fed();
+                    term_pane_send_input(tp, "go\\n", 3);
+                    for (int i = 0; i < 50 && fake_vterm_bytes_fed() - fed < 6; ++i) {
+                        if (!claim_and_render(tp, &view)) return 1;
+                    }
+                    if (fake_vterm_bytes_fed() - fed < 6) { printf("output after resize lost\\n"); return 1; }
+
+                    term_pane_counters counters;
+                    term_pane_take_counters(tp, &counters);
+                    if (!counters.rows_rendered || !counters.upload_bytes) { printf("counters\\n"); return 1; }
+                    if (fake_vterm_main_thread_writes()) { printf("parsed on the main thread\\n"); return 1; }
+                    term_pane_destroy(tp);
+
+                    // The worker owns the PTY, so it reports the child's exit through its fd.
+                    tp = term_pane_create_cmd(&lay, 16, "read line");
+                    if (!tp) { printf("create\\n"); return 1; }
+                    pid_t pid = term_pane_get_child_pid(tp);
+                    term_pane_send_input(tp, "x\\n", 2);
+                    for (int i = 0; i < 50 && !term_pane_pty_hung_up(tp); ++i) {
+                        if (!wait_readable(term_pane_get_fd(tp), 5000)) { printf("hangup not signalled\\n"); return 1; }
+                        term_pane_poll(tp);
+                    }
+                    if (!term_pane_pty_hung_up(tp)) { printf("hangup not reported\\n"); return 1; }
+                    // The hangup can land just before the child is reapable; the main loop retries.
+                    bool reaped = false;
+                    for (int i = 0; i < 200 && !reaped; ++i) {
+                        reaped = term_pane_reap_child(tp);
+                        if (!reaped) poll(NULL, 0, 10);
+                    }
+                    if (!reaped || term_pane_get_child_pid(tp) == pid) { printf("not reaped\\n"); return 1; }
+                    // The respawned child is blocked on read again.
+                    if (term_pane_pty_hung_up(tp)) { printf("hangup outlived the respawn\\n"); return 1; }
+                    term_pane_destroy(tp);
+                    printf("ok\\n");
+                    return 0;
+                }
+                """,
+                TERM_PANE_SOURCES,
+                tuple(flags),
+            )
+        if out == "nofont":
+            self.skipTest("no monospace font available")
+        self.assertEqual(out, "ok")
+
+    def test_glyph_fallback_chain_is_resolved_once_and_misses_are_memoized(self) -> None:
+        font_src = (ROOT / "src" / "font_util.c").read_text(encoding="utf-8")
+        cache_src = (ROOT / "src" / "glyph_cache.c").read_text(encoding="utf-8")
+        term_src = (ROOT / "src" / "term_pane.c").read_text(encoding="utf-8")
+        self.assertIn("int kms_font_find_fallbacks(char **paths, int max) {", font_src)
+        for family in ('"monospace:lang=ja"', '"symbol"', '"emoji"'):
+            self.assertIn(family, font_src)
+        self.assertIn("FcFontSort(NULL, pat, FcTrue, NULL, &res);", font_src)
+        self.assertIn("g_glyphs.path_count = kms_font_find_fallbacks(g_glyphs.paths, GLYPH_MAX_FACES);", cache_src)
+        # The charmap decides which face renders a codepoint; nothing is rasterized to find out.
+        render = cache_src.split("static bool glyph_render_locked(")[1].split("\n}\n")[0]
+        self.assertIn("FT_Get_Char_Index(face, cp)", render)
+        self.assertIn("bool missing = !glyph_render_locked(font, cp, &g);", cache_src)
+        self.assertIn("return g == &g_glyph_missing ? NULL : g;", cache_src)
+        self.assertIn("x1 = x0 + font->cell_w * cell->width;", term_src)
+        try:
+            flags = subprocess.run(["pkg-config", "--cflags", "--libs", "freetype2", "fontconfig"],
+                                   check=True, capture_output=True, text=True).stdout.split()
+        except (OSError, subprocess.CalledProcessError):
+            self.skipTest("freetype2/fontconfig development files not available")
+        with tempfile.TemporaryDirectory() as tmpdir:
+            tmp = pathlib.Path(tmpdir)
+            probe = tmp / "fallback_probe.c"
+            probe.write_text(
+                textwrap.dedent(
+                    """
+                    #include <stdio.h>
+                    #include "glyph_cache.h"
+
+                    int main(void) {
+                        glyph_font *font = glyph_font_acquire(16);
+                        if (!font) { printf("nofont\\n"); return 0; }
+                        glyph_scratch scratch = {0};
+                        glyph_cache_stats before, after;
+                        for (uint32_t cp = 0x2000; cp < 0x2800; ++cp) glyph_cache_get(font, cp, &scratch);
+                        if (glyph_cache_get(font, 0xFFFFFFFFu, &scratch)) { printf("invalid rendered\\n"); return 1; }
+                        glyph_cache_get_stats(&before);
+                        for (uint32_t cp = 0x2000; cp < 0x2800; ++cp) glyph_cache_get(font, cp, &scratch);
+                        if (glyph_cache_get(font, 0xFFFFFFFFu, &scratch)) { printf("invalid rendered\\n"); return 1; }
+                        glyph_cache_get_stats(&after);
+                        if (after.misses != before.misses || after.missing != before.missing ||
+                            after.fallbacks != before.fallbacks) {
+                            printf("repeat lookups missed %llu\\n", after.misses - before.misses);
+                            return 1;
+                        }
+                        glyph_font_release(font);
+                        glyph_scratch_free(&scratch);
+                        printf("ok\\n");
+                        return 0;
+                    }
+                    """
+                ),
+                encoding="utf-8",
+            )
+            binary = tmp / "fallback_probe"
+            subprocess.run(
+                ["cc", "-std=c11", "-O2", "-Wall", "-Wextra", f"-I{ROOT / 'src'}",
+                 str(ROOT / "src" / "glyph_cache.c"), str(ROOT / "src" / "glyph_synth.c"),
+                 str(ROOT / "src" / "font_util.c"), str(probe), "-o", str(binary), "-pthread", *flags, "-lm"],
+                check=True,
+                capture_output=True,
+                text=True,
+            )
+            result = subprocess.run([str(binary)], check=True, capture_output=True, text=True)
+        self.assertIn(result.stdout.strip(), ("ok", "nofont"))
+
+    def test_box_block_and_braille_glyphs_are_procedural_and_pinned(self) -> None:
+        term_src = (ROOT / "src" / "term_pane.c").read_text(encoding="utf-8")
+        cache_src = (ROOT / "src" / "glyph_cache.c").read_text(encoding="utf-8")
+        makefile = (ROOT / "Makefile").read_text(encoding="utf-8")
+        self.assertIn("src/glyph_synth.c", makefile)
+        self.assertNotIn("draw_h_line", term_src)
+        self.assertNotIn("draw_v_line", term_src)
+        self.assertIn("if (glyph_synth_covers(cp)) return glyph_synth_locked(font, cp, g);", cache_src)
+        self.assertIn("_Atomic(const glyph_bitmap *) pinned[GLYPH_PIN_COUNT];", cache_src)
+        with tempfile.TemporaryDirectory() as tmpdir:
+            tmp = pathlib.Path(tmpdir)
+            probe = tmp / "synth_probe.c"
+            probe.write_text(
+                textwrap.dedent(
+                    """
+                    #include <stdio.h>
+                    #include <string.h>
+                    #include "glyph_synth.h"
+
+                    enum { W = 11, H = 20 };
+
+                    static int lit(const unsigned char *a) {
+                        int n = 0;
+                        for (int i = 0; i < W * H; ++i) n += a[i] != 0;
+                        return n;
+                    }
+
+                    int main(void) {
+                        unsigned char a[W * H];
+                        for (uint32_t cp = 0; cp < 0x3000; ++cp) {
+                            memset(a, 0, sizeof(a));
+                            if (glyph_synth_render(cp, W, H, a) != glyph_synth_covers(cp)) {
+                                printf("coverage mismatch %x\\n", cp);
+                                return 1;
+                            }
+                            if (glyph_synth_covers(cp) && cp != 0x2800 && !lit(a)) { printf("blank %x\\n", cp); return 1; }
+                        }
+                        memset(a, 0, sizeof(a));
+                        glyph_synth_render(0x2500, W, H, a);
+                        int row = -1;
+                        for (int y = 0; y < H && row < 0; ++y) if (a[y * W]) row = y;
+                        for (int x = 0; row >= 0 && x < W; ++x) if (a[row * W + x] != 255) { printf("gap\\n"); return 1; }
+                        memset(a, 0, sizeof(a));
+                        glyph_synth_render(0x2588, W, H, a);
+                        if (lit(a) != W * H) { printf("full block\\n"); return 1; }
+                        for (int dots = 0; dots < 8; ++dots) {
+                            unsigned char one[W * H] = {0};
+                            glyph_synth_render(0x2800 + (1u << dots), W, H, one);
+                            int n = lit(one);
+                            memset(a, 0, sizeof(a));
+                            glyph_synth_render(0x28FF, W, H, a);
+                            if (!n || lit(a) != 8 * n) { printf("braille %d\\n", dots); return 1; }
+                        }
+                        printf("ok\\n");
+                        return 0;
+                    }
+                    """
+                ),
+                encoding="utf-8",
+            )
+            binary = tmp / "synth_probe"
+            subprocess.run(
+                ["cc", "-std=c11", "-O2", "-Wall", "-Wextra", f"-I{ROOT / 'src'}",
+                 str(ROOT / "src" / "glyph_synth.c"), str(probe), "-o", str(binary), "-lm"],
+                check=True,
+                capture_output=True,
+                text=True,
+            )
+            result = subprocess.run([str(binary)], check=True, capture_output=True, text=True)
+        self.assertEqual(result.stdout.strip(), "ok")
+
+    def test_synchronized_updates_hold_rendering_until_the_batch_ends(self) -> None:
+        term_src = (ROOT / "src" / "term_pane.c").read_text(encoding="utf-8")
+        term_header = (ROOT / "src" / "term_pane.h").read_text(encoding="utf-8")
+        app_src = (ROOT / "src" / "app.c").read_text(encoding="utf-8")
+        self.assertIn("#define TERM_PANE_SYNC_TIMEOUT_MS 150", term_header)
+        self.assertIn("uint64_t term_pane_sync_deadline_ns(const term_pane *tp);", term_header)
+        self.assertIn('static const char sync_seq[] = "\\x1b[?2026";', term_src)
+        # Every read goes through the scanner, split so callbacks see the current mode.
+        pump = term_src.split("static bool pane_pump(")[1].split("\n}\n")[0]
+        self.assertIn("pane_feed(tp, buf, (size_t)n);", pump)
+        self.assertNotIn("vterm_input_write", pump)
+        self.assertLess(pump.find("if (tp->sync_active && !sync_expired) {"), pump.find("term_pane_flush_damage(tp);"))
+        # Scrolls inside an update are re-rendered instead of moving shown pixels.
+        scroll = term_src.split("static bool pane_scroll_surface(term_pane *tp, VTermRect dest, VTermRect src) {")[1]
+        self.assertIn("if (tp->sync_active) return false;", scroll.split("\n}\n")[0])
+        worker = term_src.split("static void *pane_worker_main(")[1].split("\n}\n")[0]
+        self.assertLess(worker.find("if (fds[1].revents || ready == 0) {"), worker.find("pane_pump(tp, TERM_PANE_WORKER_READ_BYTES"))
+        self.assertIn("term_pane_sync_deadline_ns(panes_get_term(panes, i))", app_src)
+        self.assertIn("app_collect_pane_ready(&opt, &rt, &panes, pane_ready);", app_src)
+
+
+    def test_pane_max_fps_caps_terminal_updates_without_spinning(self) -> None:
+        options_src = (ROOT / "src" / "options.c").read_text(encoding="utf-8")
+        runtime_src = (ROOT / "src" / "runtime.c").read_text(encoding="utf-8")
+        app_src = (ROOT / "src" / "app.c").read_text(encoding="utf-8")
+        self.assertIn('!strcmp(argv[i], "--pane-max-fps") && i + 2 < argc', options_src)
+        self.assertIn('fprintf(f, "--pane-max-fps %d %d\\n", i + 1, opt->pane_max_fps[i]);', options_src)
+        self.assertIn("memmove(&opt->pane_max_fps[1], &opt->pane_max_fps[0]", options_src)
+        # The PTY leaves the level-triggered epoll set until the pane is due again.
+        self.assertIn("int pty_fd = runtime_pane_throttled(rt, i, now_ns) ? -1 : term_pane_get_fd(tp);", runtime_src)
+        self.assertIn("now_ns + 1000000000ull / (uint64_t)fps", runtime_src)
+        collect = app_src.split("static void app_collect_pane_ready(")[1].split("\n}\n")[0]
+        self.assertIn("!runtime_pane_throttled(rt, i, now_ns)", collect)
+        self.assertIn("due || runtime_pane_child_exited(rt, opt, tp, i)", collect)
+        poll = app_src.split("static bool app_poll_panes(")[1].split("\n}\n")[0]
+        self.assertIn("runtime_pane_mark_polled(rt, opt, i, poll_start_ns);", poll)
+        wait = app_src.split("static uint64_t app_wait_deadline_ns(")[1].split("\n}\n")[0]
+        self.assertIn("if (next_ns > now_ns && next_ns < deadline_ns) deadline_ns = next_ns;", wait)
+        self.assertIn("if (sync_ns && sync_ns < next_ns) sync_ns = next_ns;", wait)
+
+    def test_off_screen_media_panes_suspend_decoding_and_report_the_savings(self) -> None:
+        options_src = (ROOT / "src" / "options.c").read_text(encoding="utf-8")
+        media_src = (ROOT / "src" / "media.c").read_text(encoding="utf-8")
+        stats_src = (ROOT / "src" / "stats.c").read_text(encoding="utf-8")
+        app_src = (ROOT / "src" / "app.c").read_text(encoding="utf-8")
+        self.assertIn('!strcmp(argv[i], "--hidden-video") && i + 1 < argc', options_src)
+        self.assertIn('!strcmp(argv[i], "--pane-hidden-video") && i + 2 < argc', options_src)
+        self.assertIn("return mode == HIDDEN_VIDEO_DEFAULT ? HIDDEN_VIDEO_PAUSE : mode;", options_src)
+        visible = media_src.split("bool media_set_visible(")[1].split("\n}\n")[0]
+        # Only a pause set for the off-screen stretch is undone when the pane returns.
+        self.assertIn("if (m->hidden_paused) {", visible)
+        self.assertIn("media_skip_engage(m);", visible)
+        self.assertIn("media_skip_release(m);", visible)
+        engage = media_src.split("static void media_skip_engage(media_ctx *m) {")[1].split("\n}\n")[0]
+        self.assertIn('mpv_set_property_string(m->mpv, "vd-lavc-framedrop", "nonkey");', engage)
+        release = media_src.split("static void media_skip_release(media_ctx *m) {")[1].split("\n}\n")[0]
+        self.assertIn('mpv_set_property_string(m->mpv, "framedrop", m->hidden_framedrop);', release)
+        self.assertIn('"decoder-frame-drop-count"', media_src)
+        self.assertIn('\\"video_hidden\\": {\\"paused_sec\\": %.3f, \\"frames_not_decoded\\": %llu}', stats_src)
+        update = app_src.split("static void app_update_media_visibility(")[1].split("\n}\n")[0]
+        self.assertIn("media_set_visible(pm, app_media_visible(opt, ui, pane_media, i),", update)
+        self.assertIn("options_pane_hidden_video(opt, i));", update)
+        self.assertIn("stats_add_video_suspend(&rt->stats, i, paused_ns, frames);", update)
+        self.assertLess(app_src.find("app_update_media_visibility(&opt, &ui, &rt, pane_media);"),
+                        app_src.find("stats_maybe_write(&rt.stats"))
+
+    def test_media_panes_pick_decode_tiers_from_target_size_and_load(self) -> None:
+        media_src = (ROOT / "src" / "media.c").read_text(encoding="utf-8")
+        app_src = (ROOT / "src" / "app.c").read_text(encoding="utf-8")
+        options_src = (ROOT / "src" / "options.c").read_text(encoding="utf-8")
+        self.assertIn('[MEDIA_TIER_LOW] = { "low", "all", true, 15, "min" },', media_src)
+        tier = media_src.split("bool media_update_tier(")[1].split("\n}\n")[0]
+        self.assertIn("MEDIA_TIER_FULL : scale >= 0.34 ? MEDIA_TIER_REDUCED : MEDIA_TIER_LOW;", tier)
+        self.assertIn("if (loaded && tier < MEDIA_TIER_LOW) tier++;", tier)
+        apply = media_src.split("static void media_apply_tier(")[1].split("\n}\n")[0]
+        self.assertIn('mpv_set_property_string(mpv, "vd-lavc-skiploopfilter"', apply)
+        self.assertIn('"@kms-tier:fps=%d"', apply)
+        self.assertIn('mpv_set_property_string(mpv, "hls-bitrate"', apply)
+        self.assertIn("media_apply_tier(m, m->mpv, prev, tier);", tier)
+        # Options the user passed to mpv are not overridden.
+        self.assertIn("if (!m->tier_user_scalers &&", apply)
+        self.assertIn('m->tier_user_loopfilter = media_user_set(opt, pane_media, "vd-lavc-skiploopfilter");', media_src)
+        self.assertIn("m->tier_stale = true;", media_src.split("MPV_EVENT_VIDEO_RECONFIG")[1])
+        self.assertIn('!strcmp(argv[i], "--no-video-tiers")', options_src)
+        update = app_src.split("static void app_update_media_tiers(")[1].split("\n}\n")[0]
+        self.assertIn("media_update_tier(pm, target->w, target->h, watch->loaded);", update)
+        self.assertIn("app_update_media_tiers(&opt, &ui, &scene, pane_media, &tier_watch, layout_changed);", app_src)
+
+    def test_dual_deck_prerolls_the_next_entry_and_logs_transition_gaps(self) -> None:
+        media_src = (ROOT / "src" / "media.c").read_text(encoding="utf-8")
+        frame_src = (ROOT / "src" / "frame.c").read_text(encoding="utf-8")
+        options_src = (ROOT / "src" / "options.c").read_text(encoding="utf-8")
+        self.assertIn('!strcmp(argv[i], "--pane-dual-deck")', options_src)
+        self.assertIn('fprintf(f, "--pane-dual-deck %d\\n", i + 1);', options_src)
+        deck = media_src.split("static void media_create_deck(")[1].split("\n}\n")[0]
+        self.assertIn('mpv_set_option_string(m->mpv, "keep-open", "always");', deck)
+        self.assertIn('if (standby) mpv_set_option_string(m->mpv, "pause", "yes");', deck)
+        switch = media_src.split("static void media_deck_switch(")[1].split("\n}\n")[0]
+        # Off-screen keyframe-only decoding follows the active deck across a switch.
+        self.assertLess(switch.find("if (skipping) media_skip_release(m);"), switch.find("m->mpv = m->standby_mpv;"))
+        self.assertLess(switch.find("m->mpv = m->standby_mpv;"), switch.find("if (skipping) media_skip_engage(m);"))
+        self.assertIn("media_note_rendered(pane_ctx);", frame_src)
+        note = media_src.split("void media_note_rendered(")[1].split("\n}\n")[0]
+        self.assertIn('"TRANSITION gap_ms=%.1f deck=%s\\n"', note)
+        shutdown = media_src.split("void media_shutdown(")[1].split("\n}\n")[0]
+        self.assertIn("mpv_terminate_destroy(m->standby_mpv);", shutdown)
+
+        try:
+            flags = subprocess.run(["pkg-config", "--cflags", "--libs", "egl"],
+                                   check=True, capture_output=True, text=True).stdout.split()
+        except (OSError, subprocess.CalledProcessError):
+            self.skipTest("EGL development files not available")
+        with tempfile.TemporaryDirectory() as tmpdir:
+            tmp = pathlib.Path(tmpdir)
+            out = _run_probe(
+                tmp,
+                "deck_probe",
+                """
+                #include <stdio.h>
+                #include <string.h>
+                #include "media.h"
+
+                static void pump(media_ctx *m) {
+                    int pending = 0;
+                    media_handle_wakeup(m, false, &pending);
+                }
+
+                static bool expect_pos(mpv_handle *deck, const char *pos) {
+                    char *value = mpv_get_property_string(deck, "playlist-pos");
+                    bool ok = value && !strcmp(value, pos);
+                    if (!ok) printf("playlist-pos %s, want %s\\n", value ? value : "(none)", pos);
+                    mpv_free(value);
+                    return ok;
+                }
+
+                // A dual-deck pane playing entry 0 of count, its standby deck cued.
+                static bool start(media_ctx *m, int count) {
+                    options_t opt = {0};
+                    pane_media_config pane = { .enabled = true, .dual_deck = true };
+                    const char *names[] = { "a.mkv", "b.mkv", "c.mkv" };
+                    for (int i = 0; i < count; ++i) push_pane_video(&pane, names[i]);
+                    if (!media_init_pane(m, &opt, &pane, false)) { printf("init\\n"); return false; }
+                    char n[8];
+                    snprintf(n, sizeof(n), "%d", count);
+                    fake_mpv_change(m->mpv, "playlist-count", n);
+                    fake_mpv_change(m->standby_mpv, "playlist-count", n);
+                    fake_mpv_change(m->mpv, "playlist-pos", "0");
+                    fake_mpv_event(m->mpv, MPV_EVENT_FILE_LOADED);
+                    pump(m);
+                    fake_mpv_take_commands(m->mpv);
+                    fake_mpv_take_commands(m->standby_mpv);
+                    return expect_pos(m->standby_mpv, "1");
+                }
+
+                static void preroll(media_ctx *m) {
+                    fake_mpv_event(m->standby_mpv, MPV_EVENT_START_FILE);
+                    fake_mpv_event(m->standby_mpv, MPV_EVENT_PLAYBACK_RESTART);
+                    pump(m);
+                }
+
+                static void finish(media_ctx *m) {
+                    mpv_handle *ended = m->mpv;
+                    fake_mpv_change(ended, "eof-reached", "yes");
+                    pump(m);
+                    // Cleared again, as loading another entry does.
+                    fake_mpv_change(ended, "eof-reached", "no");
+                }
+
+                int main(void) {
+                    media_ctx m;
+                    if (!start(&m, 3)) return 1;
+                    mpv_handle *a = m.mpv, *b = m.standby_mpv;
+
+                    // Frames drawn by the standby deck say nothing about the cued entry:
+                    // without its PLAYBACK_RESTART the active deck advances in place.
+                    fake_mpv_render_update(m.standby_gl, MPV_RENDER_UPDATE_FRAME);
+                    pump(&m);
+                    if (m.standby_ready) { printf("ready from a render update\\n"); return 1; }
+                    finish(&m);
+                    if (m.mpv != a) { printf("switched to an unready deck\\n"); return 1; }
+                    if (strcmp(fake_mpv_take_commands(a), "playlist-next force;")) { printf("no fallback advance\\n"); return 1; }
+                    fake_mpv_take_commands(b);
+
+                    // Once the cued entry has restarted, the decks swap and the outgoing
+                    // deck is cued to the entry after the new active one.
+                    preroll(&m);
+                    if (!m.standby_ready) { printf("not ready after PLAYBACK_RESTART\\n"); return 1; }
+                    finish(&m);
+                    if (m.mpv != b || m.standby_mpv != a) { printf("decks not switched\\n"); return 1; }
+                    if (strstr(fake_mpv_take_commands(a), "playlist-next")) { printf("advanced as well as switched\\n"); return 1; }
+                    if (!expect_pos(a, "2")) return 1;
+                    // A restart still queued from the entry it just finished is not the cue's.
+                    fake_mpv_event(a, MPV_EVENT_PLAYBACK_RESTART);
+                    pump(&m);
+                    if (m.standby_ready) { printf("new standby ready before its cue restarted\\n"); return 1; }
+                    // The cue wraps around the playlist.
+                    preroll(&m);
+                    finish(&m);
+                    if (m.mpv != a) { printf("second switch missing\\n"); return 1; }
+                    if (!expect_pos(b, "0")) return 1;
+                    media_shutdown(&m);
+
+                    // With two entries the outgoing deck already sits on the next one
+                    // and is rewound; only the restart after that seek makes it ready.
+                    if (!start(&m, 2)) return 1;
+                    a = m.mpv;
+                    b = m.standby_mpv;
+                    preroll(&m);
+                    finish(&m);
+                    if (m.mpv != b) { printf("two-entry switch missing\\n"); return 1; }
+                    if (strcmp(fake_mpv_take_commands(a), "seek 0 absolute;")) { printf("outgoing deck not rewound\\n"); return 1; }
+                    if (!expect_pos(a, "0")) return 1;
+                    fake_mpv_render_update(m.standby_gl, MPV_RENDER_UPDATE_FRAME);
+                    pump(&m);
+                    if (m.standby_ready) { printf("rewound deck ready from a render update\\n"); return 1; }
+                    fake_mpv_event(a, MPV_EVENT_PLAYBACK_RESTART);
+                    pump(&m);
+                    if (!m.standby_ready) { printf("rewound deck not ready after PLAYBACK_RESTART\\n"); return 1; }
+                    finish(&m);
+                    if (m.mpv != a || !expect_pos(b, "1")) { printf("restarted entry not switched back\\n"); return 1; }
+                    media_shutdown(&m);
+                    printf("ok\\n");
+                    return 0;
+                }
+                """,
+                ["src/media.c", "src/options.c", "tests/fakes/mpv.c", "tests/fakes/gl.c"],
+                tuple(flags),
+            )
+        self.assertEqual(out, "ok")
+
+    def test_panes_with_the_same_source_share_one_decoder(self) -> None:
+        media_src = (ROOT / "src" / "media.c").read_text(encoding="utf-8")
+        app_src = (ROOT / "src" / "app.c").read_text(encoding="utf-8")
+        frame_src = (ROOT / "src" / "frame.c").read_text(encoding="utf-8")
+        render_gl_src = (ROOT / "src" / "render_gl.c").read_text(encoding="utf-8")
+        bench_src = (ROOT / "src" / "bench.c").read_text(encoding="utf-8")
+        match = media_src.split("bool media_pane_sources_match(")[1].split("\n}\n")[0]
+        self.assertIn("if (opt->shuffle) return false;", match)
+        self.assertIn("if (!media_str_eq(a->mpv_opts[i], b->mpv_opts[i])) return false;", match)
+        self.assertIn('!media_user_set(opt, a, "panscan")', match)
+        shared = media_src.split("void media_init_shared(")[1].split("\n}\n")[0]
+        self.assertIn("m->shared = true;", shared)
+        self.assertIn('mpv_set_property_string(source->mpv, "video-rotate", "0");', shared)
+        self.assertIn('mpv_set_property_string(source->mpv, "panscan", "0");', shared)
+        init = app_src.split("int app_run(")[1]
+        self.assertIn("media_pane_sources_match(&opt, &opt.pane_media[j], &opt.pane_media[i])", init)
+        self.assertIn("media_init_shared(&pane_media[i], &pane_media[source], source, &opt, &opt.pane_media[i]);", init)
+        self.assertIn("opt->no_shared_decode = true;", bench_src)
+        # The source renders once, and every pane sharing it is redrawn from its target.
+        self.assertIn("frame_shared_target_size(pane_media, pane_layouts, pane_count, i, &vw, &vh);", frame_src)
+        self.assertIn("if (pane_media[j].shared && pane_media[j].share_pane == i) rt->pane_damaged[j] = true;", frame_src)
+        self.assertIn("render_gl_draw_video_to_view(rg, render_gl_pane_video_tex(rg, src), tw, th, pm->share_rotate,",
+                      frame_src)
+        draw = render_gl_src.split("void render_gl_draw_video_to_view(")[1].split("\n}\n")[0]
+        self.assertIn("float dw = sw * (fit + panscan * (fill - fit));", draw)
+        self.assertIn("case 1: s = b; t = 1.f - a; break;", draw)
+
 
 if __name__ == "__main__":
     unittest.main()
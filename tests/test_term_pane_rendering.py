@@ -0,0 +1,45 @@
+import pathlib
+import unittest
+
+
+ROOT = pathlib.Path(__file__).resolve().parents[1]
+TERM_PANE_C = ROOT / "src" / "term_pane.c"
+TERM_PANE_H = ROOT / "src" / "term_pane.h"
+OPTIONS_C = ROOT / "src" / "options.c"
+PANES_C = ROOT / "src" / "panes.c"
+
+
+class TermPaneRenderingTests(unittest.TestCase):
+    def test_atlas_renderer_is_selectable_alongside_cpu_path(self) -> None:
+        header = TERM_PANE_H.read_text(encoding="utf-8")
+        term_src = TERM_PANE_C.read_text(encoding="utf-8")
+        options_src = OPTIONS_C.read_text(encoding="utf-8")
+        panes_src = PANES_C.read_text(encoding="utf-8")
+
+        self.assertIn("TERM_RENDER_CPU = 0", header)
+        self.assertIn("TERM_RENDER_ATLAS = 1", header)
+        self.assertIn("void term_pane_set_render_mode(term_render_mode mode);", header)
+        self.assertIn("static glyph_atlas g_atlas;", term_src)
+        self.assertIn("if (g_render_mode == TERM_RENDER_ATLAS) grid_store_cell(tp, cx, cy, cell);", term_src)
+        self.assertIn("else composite_cell(tp, cx, cy, cell);", term_src)
+        self.assertIn("static void draw_atlas_grid(const term_pane *tp, const render_view *view)", term_src)
+        self.assertIn('"uniform sampler2D u_atlas;\\n"', term_src)
+        self.assertIn('"--term-renderer"', options_src)
+        self.assertIn('fprintf(f, "--term-renderer atlas\\n");', options_src)
+        self.assertIn("term_pane_set_render_mode(opt->term_atlas ? TERM_RENDER_ATLAS : TERM_RENDER_CPU);", panes_src)
+
+    def test_atlas_renderer_draws_double_width_cells_across_both_cells(self) -> None:
+        term_src = TERM_PANE_C.read_text(encoding="utf-8")
+        lookup = term_src.split("static bool atlas_lookup(")[1].split("\n}\n")[0]
+        # Tiles are keyed on width too, and a wide one spans two cells of the atlas.
+        self.assertIn("e->width == width", lookup)
+        self.assertIn("atlas_alloc_tile(a, font->cell_w * width, font->cell_h, &x, &y)", lookup)
+        upload = term_src.split("static bool atlas_upload_tile(")[1].split("\n}\n")[0]
+        self.assertIn("cell.width = (char)width;", upload)
+        self.assertIn("glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, tile_w, font->cell_h,", upload)
+        row = term_src.split("static void pane_emit_row(")[1].split("\n}\n")[0]
+        self.assertIn("grid_store(tp, cx, cy, has_tile, ax + tp->font.cell_w, ay, cell, &cells[cx]);", row)
+
+
+if __name__ == "__main__":
+    unittest.main()